@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include <gtk/gtk.h>
@@ -30,6 +31,9 @@
 
 #include <gtk/gtkgl.h>
 
+#include "wave.h"
+#include "wave-gl.h"
+
 #ifdef GDK_WINDOWING_QUARTZ
 #include <OpenGL/glu.h>
 #else
@@ -49,8 +53,9 @@
 
 #define TIMEOUT_INTERVAL 10
 
-#define MAXGRID 63
-#define SQRTOFTWOINV (1.0 / 1.414213562)
+#define DEFAULT_GRID 31
+
+#define BENCHMARK_FRAMES 200
 
 
 /**************************************************************************
@@ -59,19 +64,20 @@
 
 static gboolean animate = TRUE;
 
-static int grid = (MAXGRID/2);
+static int grid = DEFAULT_GRID;
 static int beginX, beginY;
 
-static float force[MAXGRID][MAXGRID];
-static float veloc[MAXGRID][MAXGRID];
-static float posit[MAXGRID][MAXGRID];
+static Wave *wave = NULL;
+static WaveGL *wave_gl = NULL;          /* set while simulating on the GPU */
+static gboolean use_gpu = FALSE;
+static gboolean benchmark = FALSE;
 
 static float dt = 0.008;
 static float sphi = 90.0;
 static float stheta = 45.0;
-static float sdepth = 5.0/4.0 * (MAXGRID/2);
-static float zNear = (MAXGRID/2)/10.0;
-static float zFar = (MAXGRID/2)*3.0;
+static float sdepth = 5.0/4.0 * DEFAULT_GRID;
+static float zNear = DEFAULT_GRID/10.0;
+static float zFar = DEFAULT_GRID*3.0;
 static float aspect = 5.0/4.0;
 
 static float lightPosition[4] = {0.0, 0.0, 1.0, 1.0};
@@ -86,6 +92,7 @@ static void         timeout_remove    (GtkWidget   *widget);
 
 static void         toggle_animation  (GtkWidget   *widget);
 static void         init_wireframe    (GtkWidget   *widget);
+static void         toggle_gpu        (GtkWidget   *widget);
 
 static GdkGLConfig *configure_gl      (void);
 
@@ -97,116 +104,116 @@ static GtkWidget   *create_window     (GdkGLConfig *glconfig);
  * The waving functions.
  **************************************************************************/
 
-void getforce (void)
+void drawWireframe (void)
 {
   int i=0, j=0;
-  float d;
 
-  for(i=0;i<grid;i++)
+  glColor3f(1.0, 1.0, 1.0);
+
+  if (wave_gl != NULL)
     {
-      for(j=0;j<grid;j++)
-	{
-	  force[i][j]=0.0;
-	}
+      wave_gl_draw (wave_gl);
+      return;
     }
 
-  for(i=2;i<grid-2;i++)
+  for(i=0;i<grid;i++)
     {
-      for(j=2;j<grid-2;j++)
-	{
-	  d=posit[i][j]-posit[i][j-1];
-	  force[i][j] -= d;
-	  force[i][j-1] += d;
-
-	  d=posit[i][j]-posit[i-1][j];
-	  force[i][j] -= d;
-	  force[i-1][j] += d;
-
-	  d= (posit[i][j]-posit[i][j+1]);
-	  force[i][j] -= d ;
-	  force[i][j+1] += d;
-
-	  d= (posit[i][j]-posit[i+1][j]);
-	  force[i][j] -= d ;
-	  force[i+1][j] += d;
-
-	  d= (posit[i][j]-posit[i+1][j+1])*SQRTOFTWOINV;
-	  force[i][j] -= d ;
-	  force[i+1][j+1] += d;
-
-	  d= (posit[i][j]-posit[i-1][j-1])*SQRTOFTWOINV;
-	  force[i][j] -= d ;
-	  force[i-1][j-1] += d;
-
-	  d= (posit[i][j]-posit[i+1][j-1])*SQRTOFTWOINV;
-	  force[i][j] -= d ;
-	  force[i+1][j-1] += d;
-
-	  d= (posit[i][j]-posit[i-1][j+1])*SQRTOFTWOINV;
-	  force[i][j] -= d ;
-	  force[i- 1][j+1] += d;
-	}
+      glBegin(GL_LINE_STRIP);
+      for(j=0;j<grid;j++) glVertex3f((float)i,(float)j,wave->position[i*grid+j]);
+      glEnd();
     }
-}
-
-void getvelocity (void)
-{
-  int i=0, j=0;
 
   for(i=0;i<grid;i++)
     {
-      for(j=0;j<grid;j++) veloc[i][j]+=force[i][j] * dt;
+      glBegin(GL_LINE_STRIP);
+      for(j=0;j<grid;j++) glVertex3f((float)j,(float)i,wave->position[j*grid+i]);
+      glEnd();
     }
 }
 
-void getposition (void)
+void resetWireframe (void)
 {
-  int i=0, j=0;
+  wave_reset (wave);
 
-  for(i=0;i<grid;i++)
-    {
-      for(j=0;j<grid;j++) posit[i][j]+=veloc[i][j];
-    }
+  if (wave_gl != NULL)
+    wave_gl_load (wave_gl, wave);
 }
 
-void drawWireframe (void)
+void stepWireframe (void)
 {
-  int i=0, j=0;
+  if (wave_gl != NULL)
+    wave_gl_step (wave_gl);
+  else
+    wave_step (wave);
+}
 
-  glColor3f(1.0, 1.0, 1.0);
+void setupView (void)
+{
+  glMatrixMode (GL_PROJECTION);
+  glLoadIdentity ();
+  gluPerspective (64.0, aspect, zNear, zFar);
+  glMatrixMode (GL_MODELVIEW);
+  glLoadIdentity ();
 
-  for(i=0;i<grid;i++)
-    {
-      glBegin(GL_LINE_STRIP);
-      for(j=0;j<grid;j++) glVertex3f((float)i,(float)j,(float)posit[i][j]);
-      glEnd();
-    }
+  glTranslatef (0.0,0.0,-sdepth);
+  glRotatef (-stheta, 1.0, 0.0, 0.0);
+  glRotatef (sphi, 0.0, 0.0, 1.0);
+  glTranslatef (-(float)((grid+1)/2-1), -(float)((grid+1)/2-1), 0.0);
+}
 
-  for(i=0;i<grid;i++)
+/* Times simulating and drawing on the CPU against the GPU. */
+void benchmarkWireframe (void)
+{
+  GTimer *timer;
+  int pass, i;
+
+  if (wave_gl != NULL)
     {
-      glBegin(GL_LINE_STRIP);
-      for(j=0;j<grid;j++) glVertex3f((float)j,(float)i,(float)posit[j][i]);
-      glEnd();
+      wave_gl_free (wave_gl);
+      wave_gl = NULL;
     }
-}
 
-void resetWireframe (void)
-{
-  int i=0, j=0;
+  timer = g_timer_new ();
+  setupView ();
 
-  for(i=0;i<grid;i++)
+  for (pass = 0; pass < 2; pass++)
     {
-      for(j=0;j<grid;j++)
-	{
-	  force[i][j]=0.0;
-	  veloc[i][j]=0.0;
+      if (pass == 1)
+        {
+          wave_gl = wave_gl_new (wave);
+          if (wave_gl == NULL)
+            {
+              g_print ("GPU: needs OpenGL 3.1 and a smaller grid\n");
+              break;
+            }
+        }
 
-	  posit[i][j]= 	(sin(G_PI*2 * ((float)i/(float)grid)) +
-			 sin(G_PI*2 * ((float)j/(float)grid)))* grid/6.0;
+      resetWireframe ();
+      glFinish ();
+      g_timer_start (timer);
 
-	  if (i==0||j==0||i==grid-1||j==grid-1) posit[i][j]=0.0;
-	}
+      for (i = 0; i < BENCHMARK_FRAMES; i++)
+        {
+          stepWireframe ();
+          glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+          drawWireframe ();
+        }
+
+      glFinish ();
+      g_print ("%s: %d frames in %6.3f seconds = %6.3f FPS\n",
+               wave_gl != NULL ? "GPU" : "CPU", BENCHMARK_FRAMES,
+               g_timer_elapsed (timer, NULL),
+               BENCHMARK_FRAMES / g_timer_elapsed (timer, NULL));
     }
+
+  if (wave_gl != NULL && !use_gpu)
+    {
+      wave_gl_free (wave_gl);
+      wave_gl = NULL;
+    }
+
+  resetWireframe ();
+  g_timer_destroy (timer);
 }
 
 
@@ -259,6 +266,17 @@ realize (GtkWidget *widget,
 
   resetWireframe ();
 
+  if (use_gpu)
+    {
+      wave_gl = wave_gl_new (wave);
+      if (wave_gl == NULL)
+        g_print ("Sorry, the GPU path needs OpenGL 3.1 and a grid that fits "
+                 "a buffer texture, using the CPU.\n");
+    }
+
+  if (benchmark)
+    benchmarkWireframe ();
+
   gtk_widget_end_gl (widget, FALSE);
   /*** OpenGL END ***/
 
@@ -314,16 +332,7 @@ draw (GtkWidget *widget,
 
   glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  glMatrixMode (GL_PROJECTION);
-  glLoadIdentity ();
-  gluPerspective (64.0, aspect, zNear, zFar);
-  glMatrixMode (GL_MODELVIEW);
-  glLoadIdentity ();
-
-  glTranslatef (0.0,0.0,-sdepth);
-  glRotatef (-stheta, 1.0, 0.0, 0.0);
-  glRotatef (sphi, 0.0, 0.0, 1.0);
-  glTranslatef (-(float)((grid+1)/2-1), -(float)((grid+1)/2-1), 0.0);
+  setupView ();
 
   drawWireframe ();
 
@@ -343,9 +352,14 @@ timeout (GtkWidget *widget)
 {
   GtkAllocation allocation;
   GdkWindow *window;
-  getforce ();
-  getvelocity ();
-  getposition ();
+
+  /*** OpenGL BEGIN ***/
+  if (gtk_widget_begin_gl (widget))
+    {
+      stepWireframe ();
+      gtk_widget_end_gl (widget, FALSE);
+    }
+  /*** OpenGL END ***/
 
   window = gtk_widget_get_window (widget);
   gtk_widget_get_allocation (widget, &allocation);
@@ -383,7 +397,7 @@ motion_notify_event (GtkWidget      *widget,
 
   if (event->state & GDK_BUTTON2_MASK)
     {
-      sdepth -= ((event->y - beginY)/(allocation.height))*(MAXGRID/2);
+      sdepth -= ((event->y - beginY)/(allocation.height))*grid;
 
       redraw = TRUE;
     }
@@ -462,6 +476,10 @@ key_press_event (GtkWidget   *widget,
       toggle_animation (widget);
       break;
 
+    case GDK_KEY_g:
+      toggle_gpu (widget);
+      break;
+
     case GDK_KEY_w:
       if (!animate)
 	timeout (widget);
@@ -500,8 +518,15 @@ static void
 unrealize (GtkWidget *widget,
 	   gpointer   data)
 {
-  /*** Fill in the details here ***/
+  /*** OpenGL BEGIN ***/
+  if (wave_gl != NULL && gtk_widget_begin_gl (widget))
+    {
+      wave_gl_free (wave_gl);
+      wave_gl = NULL;
 
+      gtk_widget_end_gl (widget, FALSE);
+    }
+  /*** OpenGL END ***/
 }
 
 
@@ -612,6 +637,37 @@ toggle_animation (GtkWidget *widget)
     }
 }
 
+/***
+ *** Switch the simulation between the CPU and the GPU.
+ ***/
+static void
+toggle_gpu (GtkWidget *widget)
+{
+  /*** OpenGL BEGIN ***/
+  if (!gtk_widget_begin_gl (widget))
+    return;
+
+  if (wave_gl != NULL)
+    {
+      wave_gl_store (wave_gl, wave);
+      wave_gl_free (wave_gl);
+      wave_gl = NULL;
+    }
+  else
+    {
+      wave_gl = wave_gl_new (wave);
+      if (wave_gl == NULL)
+        g_print ("Sorry, the GPU path needs OpenGL 3.1 and a grid that fits "
+                 "a buffer texture.\n");
+    }
+
+  gtk_widget_end_gl (widget, FALSE);
+  /*** OpenGL END ***/
+
+  use_gpu = (wave_gl != NULL);
+  g_print ("Simulating on the %s.\n", use_gpu ? "GPU" : "CPU");
+}
+
 /***
  *** Init wireframe model.
  ***/
@@ -620,7 +676,14 @@ init_wireframe (GtkWidget *widget)
 {
   GtkAllocation allocation;
 
-  resetWireframe ();
+  /*** OpenGL BEGIN ***/
+  if (gtk_widget_begin_gl (widget))
+    {
+      resetWireframe ();
+      gtk_widget_end_gl (widget, FALSE);
+    }
+  /*** OpenGL END ***/
+
   gtk_widget_get_allocation (widget, &allocation);
   gdk_window_invalidate_rect (gtk_widget_get_window (widget), &allocation, FALSE);
 }
@@ -655,6 +718,13 @@ create_popup_menu (GtkWidget *drawing_area)
 			    G_CALLBACK (init_wireframe), drawing_area);
   gtk_widget_show (menu_item);
 
+  /* Switch between the CPU and the GPU */
+  menu_item = gtk_menu_item_new_with_label ("Toggle GPU");
+  gtk_menu_shell_append (GTK_MENU_SHELL (menu), menu_item);
+  g_signal_connect_swapped (G_OBJECT (menu_item), "activate",
+			    G_CALLBACK (toggle_gpu), drawing_area);
+  gtk_widget_show (menu_item);
+
   /* Quit */
   menu_item = gtk_menu_item_new_with_label ("Quit");
   gtk_menu_shell_append (GTK_MENU_SHELL (menu), menu_item);
@@ -822,6 +892,7 @@ main (int   argc,
 {
   GtkWidget *window;
   GdkGLConfig *glconfig;
+  int i;
 
   /* Initialize GTK. */
   gtk_init (&argc, &argv);
@@ -829,6 +900,40 @@ main (int   argc,
   /* Initialize GtkGLExt. */
   gtk_gl_init (&argc, &argv);
 
+  /* Parse arguments. */
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp (argv[i], "--grid") == 0 && i + 1 < argc)
+        {
+          grid = atoi (argv[++i]);
+        }
+      else if (strcmp (argv[i], "--gpu") == 0)
+        {
+          use_gpu = TRUE;
+        }
+      else if (strcmp (argv[i], "--benchmark") == 0)
+        {
+          benchmark = TRUE;
+        }
+      else
+        {
+          g_print ("Usage: %s [--grid size] [--gpu] [--benchmark]\n", argv[0]);
+          exit (strcmp (argv[i], "--help") == 0 ? 0 : 1);
+        }
+    }
+
+  if (grid < 8)
+    {
+      g_print ("The grid must be at least 8 points wide.\n");
+      exit (1);
+    }
+
+  /* Create the wave and fit the view to it. */
+  wave = wave_new (grid, dt);
+  sdepth = 5.0/4.0 * grid;
+  zNear = grid/10.0;
+  zFar = grid*3.0;
+
   /* Configure OpenGL framebuffer. */
   glconfig = configure_gl ();
 
@@ -838,6 +943,8 @@ main (int   argc,
 
   gtk_main ();
 
+  wave_free (wave);
+
   return 0;
 }
 
@@ -35,6 +35,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include <gtk/gtk.h>
@@ -42,6 +43,8 @@
 
 #include <gtk/gtkgl.h>
 
+#include "wave.h"
+
 #ifdef GDK_WINDOWING_QUARTZ
 #include <OpenGL/glu.h>
 #else
@@ -61,8 +64,7 @@
 
 #define TIMEOUT_INTERVAL 10
 
-#define MAXGRID 64
-#define SQRTOFTWOINV (1.0 / 1.414213562)
+#define DEFAULT_GRID 32
 
 
 /**************************************************************************
@@ -71,19 +73,17 @@
 
 static gboolean animate = TRUE;
 
-static int grid = (MAXGRID/2);
+static int grid = DEFAULT_GRID;
 static int beginX, beginY;
 
-static float force[MAXGRID][MAXGRID];
-static float veloc[MAXGRID][MAXGRID];
-static float posit[MAXGRID][MAXGRID];
+static Wave *wave = NULL;
 
 static float dt = 0.008;
 static float sphi = 90.0;
 static float stheta = 45.0;
-static float sdepth = 5.0/4.0 * (MAXGRID/2);
-static float zNear = (MAXGRID/2)/10.0;
-static float zFar = (MAXGRID/2)*3.0;
+static float sdepth = 5.0/4.0 * DEFAULT_GRID;
+static float zNear = DEFAULT_GRID/10.0;
+static float zFar = DEFAULT_GRID*3.0;
 static float aspect = 5.0/4.0;
 
 static float lightPosition[4] = {0.0, 0.0, 1.0, 1.0};
@@ -109,78 +109,6 @@ static GtkWidget   *create_window     (GdkGLConfig *glconfig);
  * The waving functions.
  **************************************************************************/
 
-void getforce (void)
-{
-  int i=0, j=0;
-  float d;
-
-  for(i=0;i<grid;i++)
-    {
-      for(j=0;j<grid;j++)
-	{
-	  force[i][j]=0.0;
-	}
-    }
-
-  for(i=2;i<grid-2;i++)
-    {
-      for(j=2;j<grid-2;j++)
-	{
-	  d=posit[i][j]-posit[i][j-1];
-	  force[i][j] -= d;
-	  force[i][j-1] += d;
-
-	  d=posit[i][j]-posit[i-1][j];
-	  force[i][j] -= d;
-	  force[i-1][j] += d;
-
-	  d= (posit[i][j]-posit[i][j+1]);
-	  force[i][j] -= d ;
-	  force[i][j+1] += d;
-
-	  d= (posit[i][j]-posit[i+1][j]);
-	  force[i][j] -= d ;
-	  force[i+1][j] += d;
-
-	  d= (posit[i][j]-posit[i+1][j+1])*SQRTOFTWOINV;
-	  force[i][j] -= d ;
-	  force[i+1][j+1] += d;
-
-	  d= (posit[i][j]-posit[i-1][j-1])*SQRTOFTWOINV;
-	  force[i][j] -= d ;
-	  force[i-1][j-1] += d;
-
-	  d= (posit[i][j]-posit[i+1][j-1])*SQRTOFTWOINV;
-	  force[i][j] -= d ;
-	  force[i+1][j-1] += d;
-
-	  d= (posit[i][j]-posit[i-1][j+1])*SQRTOFTWOINV;
-	  force[i][j] -= d ;
-	  force[i- 1][j+1] += d;
-	}
-    }
-}
-
-void getvelocity (void)
-{
-  int i=0, j=0;
-
-  for(i=0;i<grid;i++)
-    {
-      for(j=0;j<grid;j++) veloc[i][j]+=force[i][j] * dt;
-    }
-}
-
-void getposition (void)
-{
-  int i=0, j=0;
-
-  for(i=0;i<grid;i++)
-    {
-      for(j=0;j<grid;j++) posit[i][j]+=veloc[i][j];
-    }
-}
-
 void drawWireframe (void)
 {
   int i=0, j=0;
@@ -190,35 +118,21 @@ void drawWireframe (void)
   for(i=0;i<grid;i++)
     {
       glBegin(GL_LINE_STRIP);
-      for(j=0;j<grid;j++) glVertex3f((float)i,(float)j,(float)posit[i][j]);
+      for(j=0;j<grid;j++) glVertex3f((float)i,(float)j,wave->position[i*grid+j]);
       glEnd();
     }
 
   for(i=0;i<grid;i++)
     {
       glBegin(GL_LINE_STRIP);
-      for(j=0;j<grid;j++) glVertex3f((float)j,(float)i,(float)posit[j][i]);
+      for(j=0;j<grid;j++) glVertex3f((float)j,(float)i,wave->position[j*grid+i]);
       glEnd();
     }
 }
 
 void resetWireframe (void)
 {
-  int i=0, j=0;
-
-  for(i=0;i<grid;i++)
-    {
-      for(j=0;j<grid;j++)
-	{
-	  force[i][j]=0.0;
-	  veloc[i][j]=0.0;
-
-	  posit[i][j]= 	(sin(G_PI*2 * ((float)i/(float)grid)) +
-			 sin(G_PI*2 * ((float)j/(float)grid)))* grid/6.0;
-
-	  if (i==0||j==0||i==grid-1||j==grid-1) posit[i][j]=0.0;
-	}
-    }
+  wave_reset (wave);
 }
 
 
@@ -352,9 +266,7 @@ timeout (GtkWidget *widget)
 {
   GtkAllocation allocation;
   GdkWindow *window;
-  getforce ();
-  getvelocity ();
-  getposition ();
+  wave_step (wave);
 
   window = gtk_widget_get_window (widget);
   gtk_widget_get_allocation (widget, &allocation);
@@ -392,7 +304,7 @@ motion_notify_event (GtkWidget      *widget,
 
   if (event->state & GDK_BUTTON2_MASK)
     {
-      sdepth -= ((event->y - beginY)/(allocation.height))*(MAXGRID/2);
+      sdepth -= ((event->y - beginY)/(allocation.height))*grid;
 
       redraw = TRUE;
     }
@@ -859,6 +771,7 @@ main (int   argc,
 {
   GtkWidget *window;
   GdkGLConfig *glconfig;
+  int i;
 
   /* Initialize GTK. */
   gtk_init (&argc, &argv);
@@ -866,6 +779,32 @@ main (int   argc,
   /* Initialize GtkGLExt. */
   gtk_gl_init (&argc, &argv);
 
+  /* Parse arguments. */
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp (argv[i], "--grid") == 0 && i + 1 < argc)
+        {
+          grid = atoi (argv[++i]);
+        }
+      else
+        {
+          g_print ("Usage: %s [--grid size]\n", argv[0]);
+          exit (strcmp (argv[i], "--help") == 0 ? 0 : 1);
+        }
+    }
+
+  if (grid < 8)
+    {
+      g_print ("The grid must be at least 8 points wide.\n");
+      exit (1);
+    }
+
+  /* Create the wave and fit the view to it. */
+  wave = wave_new (grid, dt);
+  sdepth = 5.0/4.0 * grid;
+  zNear = grid/10.0;
+  zFar = grid*3.0;
+
   /* Configure OpenGL framebuffer. */
   glconfig = configure_gl ();
 
@@ -875,6 +814,8 @@ main (int   argc,
 
   gtk_main ();
 
+  wave_free (wave);
+
   return 0;
 }
 
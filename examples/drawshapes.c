@@ -17,9 +17,11 @@
  */
 
 #include <math.h>
+#include <stdio.h>
 
 #include "drawshapes.h"
 #include <gdk/gdkglext-config.h>
+#include <gdk/gdkgl.h>
 
 #ifdef G_OS_WIN32
 #define WIN32_LEAN_AND_MEAN 1
@@ -143,7 +145,7 @@ draw_cube (gboolean solid,
            double   size)
 {
   if (solid)
-    drawBox (size, GL_QUADS);
+    shape_mesh_draw (shape_cache_cube (size));
   else
     drawBox (size, GL_LINE_LOOP);
 }
@@ -184,12 +186,15 @@ draw_sphere (gboolean solid,
              int      slices,
              int      stacks)
 {
+  if (solid)
+    {
+      shape_mesh_draw (shape_cache_sphere (radius, slices, stacks));
+      return;
+    }
+
   QUAD_OBJ_INIT();
 
-  if (solid)
-    gluQuadricDrawStyle (quadObj, GLU_FILL);
-  else
-    gluQuadricDrawStyle (quadObj, GLU_LINE);
+  gluQuadricDrawStyle (quadObj, GLU_LINE);
 
   gluQuadricNormals (quadObj, GLU_SMOOTH);
 
@@ -220,12 +225,15 @@ draw_cone (gboolean solid,
            int      slices,
            int      stacks)
 {
+  if (solid)
+    {
+      shape_mesh_draw (shape_cache_cone (base, height, slices, stacks));
+      return;
+    }
+
   QUAD_OBJ_INIT();
 
-  if (solid)
-    gluQuadricDrawStyle (quadObj, GLU_FILL);
-  else
-    gluQuadricDrawStyle (quadObj, GLU_LINE);
+  gluQuadricDrawStyle (quadObj, GLU_LINE);
 
   gluQuadricNormals (quadObj, GLU_SMOOTH);
 
@@ -301,7 +309,8 @@ draw_torus (gboolean solid,
 {
   if (solid)
     {
-      doughnut (inner_radius, outer_radius, nsides, rings);
+      shape_mesh_draw (shape_cache_torus (inner_radius, outer_radius,
+                                          nsides, rings));
     }
   else
     {
@@ -460,7 +469,7 @@ void
 draw_tetrahedron (gboolean solid)
 {
   if (solid)
-    tetrahedron (GL_TRIANGLES);
+    shape_mesh_draw (shape_cache_tetrahedron ());
   else
     tetrahedron (GL_LINE_LOOP);
 }
@@ -515,7 +524,7 @@ void
 draw_octahedron (gboolean solid)
 {
   if (solid)
-    octahedron (GL_TRIANGLES);
+    shape_mesh_draw (shape_cache_octahedron ());
   else
     octahedron (GL_LINE_LOOP);
 }
@@ -593,7 +602,7 @@ void
 draw_icosahedron (gboolean solid)
 {
   if (solid)
-    icosahedron (GL_TRIANGLES);
+    shape_mesh_draw (shape_cache_icosahedron ());
   else
     icosahedron (GL_LINE_LOOP);
 }
@@ -607,8 +616,13 @@ static GLfloat dodec[20][3];
 static void
 initDodecahedron(void)
 {
+  static int inited = 0;
   GLfloat alpha, beta;
 
+  if (inited)
+    return;
+  inited = 1;
+
   alpha = sqrt(2.0 / (3.0 + sqrt(5.0)));
   beta = 1.0 + sqrt(6.0 / (3.0 + sqrt(5.0)) -
     2.0 + 2.0 * sqrt(2.0 / (3.0 + sqrt(5.0))));
@@ -660,12 +674,7 @@ pentagon(int a, int b, int c, int d, int e, GLenum shadeType)
 static void
 dodecahedron(GLenum type)
 {
-  static int inited = 0;
-
-  if (inited == 0) {
-    inited = 1;
-    initDodecahedron();
-  }
+  initDodecahedron();
   pentagon(0, 1, 9, 16, 5, type);
   pentagon(1, 0, 3, 18, 7, type);
   pentagon(1, 7, 11, 10, 9, type);
@@ -692,7 +701,7 @@ void
 draw_dodecahedron (gboolean solid)
 {
   if (solid)
-    dodecahedron (GL_TRIANGLE_FAN);
+    shape_mesh_draw (shape_cache_dodecahedron ());
   else
     dodecahedron (GL_LINE_LOOP);
 }
@@ -855,8 +864,9 @@ teapot(GLint grid, GLdouble scale, GLenum type)
  * @scale: relative size of the teapot.
  *
  * Renders a teapot.
- * Both surface normals and texture coordinates for the teapot are generated.
- * The teapot is generated with OpenGL evaluators. 
+ * The solid teapot comes from the shape cache and has surface normals
+ * only. The wireframe teapot is generated with OpenGL evaluators and
+ * has texture coordinates too.
  *
  **/
 void
@@ -864,7 +874,1360 @@ draw_teapot (gboolean solid,
              double   scale)
 {
   if (solid)
-    teapot (7, scale, GL_FILL);
+    shape_mesh_draw (shape_cache_teapot (scale, 7));
   else
     teapot (10, scale, GL_LINE);
 }
+
+/* 
+ * Shape cache
+ *
+ * Each shape is generated once per set of parameters into one shared
+ * pair of buffer objects: interleaved position/normal vertices and
+ * 32 bit triangle indices.  A cached shape is then a single
+ * glDrawElements, and a run of them between shape_cache_begin() and
+ * shape_cache_end() shares one set of bindings.  Without buffer objects
+ * the same arrays are drawn from client memory.  Generating a new shape
+ * inside such a run uploads and binds the arrays again, as appending
+ * may have moved them.
+ *
+ * Buffer and program names only mean something in the context that
+ * made them, so each GdkGLContext gets its own cache, attached to the
+ * context object and freed with it.
+ */
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER         0x8892
+#endif
+#ifndef GL_ELEMENT_ARRAY_BUFFER
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW          0x88E4
+#endif
+
+enum
+{
+  SHAPE_CUBE,
+  SHAPE_SPHERE,
+  SHAPE_CONE,
+  SHAPE_TORUS,
+  SHAPE_TETRAHEDRON,
+  SHAPE_OCTAHEDRON,
+  SHAPE_DODECAHEDRON,
+  SHAPE_ICOSAHEDRON,
+  SHAPE_TEAPOT
+};
+
+#define SHAPE_VERTEX_SIZE 6     /* position and normal */
+
+typedef void (APIENTRY *GenBuffersProc)    (GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *DeleteBuffersProc) (GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY *BindBufferProc)    (GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferDataProc)    (GLenum target, gssize size,
+                                            const void *data, GLenum usage);
+
+#define SHAPE_CACHE_KEY      "drawshapes-cache"
+#define SHAPE_INSTANCING_KEY "drawshapes-instancing"
+
+typedef struct
+{
+  GHashTable *meshes;           /* ShapeMesh -> itself, keyed by type and params */
+  GArray *vertices;             /* GLfloat, SHAPE_VERTEX_SIZE per vertex */
+  GArray *indices;              /* GLuint */
+
+  gboolean have_buffers;
+  GLuint vertex_buffer;
+  GLuint index_buffer;
+  gboolean dirty;               /* arrays grew since the last upload */
+  gint nesting;                 /* shape_cache_begin() depth */
+
+  GenBuffersProc GenBuffers;
+  DeleteBuffersProc DeleteBuffers;
+  BindBufferProc BindBuffer;
+  BufferDataProc BufferData;
+} ShapeCache;
+
+/* the current context's, set by shape_cache_init() */
+static ShapeCache *cache = NULL;
+
+static guint
+shape_mesh_hash (gconstpointer key)
+{
+  const ShapeMesh *mesh = key;
+  guint hash = mesh->type;
+  gint i;
+
+  for (i = 0; i < 4; i++)
+    hash = hash * 31 + g_double_hash (&mesh->params[i]);
+  return hash;
+}
+
+static gboolean
+shape_mesh_equal (gconstpointer a,
+                  gconstpointer b)
+{
+  const ShapeMesh *mesh_a = a;
+  const ShapeMesh *mesh_b = b;
+  gint i;
+
+  if (mesh_a->type != mesh_b->type)
+    return FALSE;
+  for (i = 0; i < 4; i++)
+    if (mesh_a->params[i] != mesh_b->params[i])
+      return FALSE;
+  return TRUE;
+}
+
+static void
+shape_cache_free (gpointer data)
+{
+  ShapeCache *shape_cache = data;
+
+  /* the buffer objects go with the context */
+  g_hash_table_destroy (shape_cache->meshes);
+  g_array_free (shape_cache->vertices, TRUE);
+  g_array_free (shape_cache->indices, TRUE);
+  g_free (shape_cache);
+}
+
+static gboolean
+shape_cache_init (void)
+{
+  GdkGLContext *glcontext;
+  const char *version;
+  const char *suffix = NULL;
+  int major = 0, minor = 0;
+  char name[32];
+
+  cache = NULL;
+
+  glcontext = gdk_gl_context_get_current ();
+  g_return_val_if_fail (glcontext != NULL, FALSE);
+
+  cache = g_object_get_data (G_OBJECT (glcontext), SHAPE_CACHE_KEY);
+  if (cache != NULL)
+    return TRUE;
+
+  cache = g_new0 (ShapeCache, 1);
+  g_object_set_data_full (G_OBJECT (glcontext), SHAPE_CACHE_KEY,
+                          cache, shape_cache_free);
+
+  cache->meshes = g_hash_table_new_full (shape_mesh_hash, shape_mesh_equal,
+                                        g_free, NULL);
+  cache->vertices = g_array_new (FALSE, FALSE, sizeof (GLfloat));
+  cache->indices = g_array_new (FALSE, FALSE, sizeof (GLuint));
+
+  /* buffer objects are GL 1.5, or ARB_vertex_buffer_object */
+  version = (const char *) glGetString (GL_VERSION);
+  if (version != NULL && sscanf (version, "%d.%d", &major, &minor) == 2 &&
+      (major > 1 || (major == 1 && minor >= 5)))
+    suffix = "";
+  else if (gdk_gl_query_gl_extension ("GL_ARB_vertex_buffer_object"))
+    suffix = "ARB";
+
+  if (suffix != NULL)
+    {
+      g_snprintf (name, sizeof (name), "glGenBuffers%s", suffix);
+      cache->GenBuffers = (GenBuffersProc) gdk_gl_get_proc_address (name);
+      g_snprintf (name, sizeof (name), "glDeleteBuffers%s", suffix);
+      cache->DeleteBuffers = (DeleteBuffersProc) gdk_gl_get_proc_address (name);
+      g_snprintf (name, sizeof (name), "glBindBuffer%s", suffix);
+      cache->BindBuffer = (BindBufferProc) gdk_gl_get_proc_address (name);
+      g_snprintf (name, sizeof (name), "glBufferData%s", suffix);
+      cache->BufferData = (BufferDataProc) gdk_gl_get_proc_address (name);
+
+      cache->have_buffers = (cache->GenBuffers != NULL &&
+                             cache->DeleteBuffers != NULL &&
+                             cache->BindBuffer != NULL &&
+                             cache->BufferData != NULL);
+    }
+
+  return TRUE;
+}
+
+static GLuint
+add_vertex (GLfloat x, GLfloat y, GLfloat z,
+            GLfloat nx, GLfloat ny, GLfloat nz)
+{
+  GLfloat v[SHAPE_VERTEX_SIZE];
+
+  v[0] = x;  v[1] = y;  v[2] = z;
+  v[3] = nx; v[4] = ny; v[5] = nz;
+  g_array_append_vals (cache->vertices, v, SHAPE_VERTEX_SIZE);
+
+  return cache->vertices->len / SHAPE_VERTEX_SIZE - 1;
+}
+
+static void
+add_triangle (GLuint a, GLuint b, GLuint c)
+{
+  GLuint t[3];
+
+  t[0] = a; t[1] = b; t[2] = c;
+  g_array_append_vals (cache->indices, t, 3);
+}
+
+/* triangles over a (columns + 1) x (rows + 1) grid of vertices */
+static void
+add_grid (GLuint first, gint columns, gint rows)
+{
+  gint i, j;
+
+  for (j = 0; j < rows; j++)
+    for (i = 0; i < columns; i++)
+      {
+        GLuint a = first + j * (columns + 1) + i;
+        GLuint b = a + columns + 1;
+
+        add_triangle (a, b, a + 1);
+        add_triangle (a + 1, b, b + 1);
+      }
+}
+
+/* convex polygon with one normal, fanned from its first point */
+static void
+add_flat_polygon (GLfloat *p[], gint n, const GLfloat normal[3])
+{
+  GLuint first = 0;
+  gint i;
+
+  for (i = 0; i < n; i++)
+    {
+      GLuint v = add_vertex (p[i][0], p[i][1], p[i][2],
+                             normal[0], normal[1], normal[2]);
+      if (i == 0)
+        first = v;
+      else if (i >= 2)
+        add_triangle (first, v - 1, v);
+    }
+}
+
+/* the triangles subdivide() and recorditem() draw, at depth 1 */
+static void
+add_platonic (GLfloat data[][3], int ndx[][3], gint n)
+{
+  gint i, j;
+
+  for (i = n - 1; i >= 0; i--)
+    {
+      GLfloat w[3][3], q0[3], q1[3];
+      GLfloat *p[3];
+
+      for (j = 0; j < 3; j++)
+        {
+          /* recorditem(w1, w0, w2) with w0 = v2, w1 = v0, w2 = v1 */
+          static const gint order[3] = { 0, 2, 1 };
+          GLfloat *v = data[ndx[i][order[j]]];
+          GLfloat l = sqrt (v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+          w[j][0] = v[0] / l;
+          w[j][1] = v[1] / l;
+          w[j][2] = v[2] / l;
+          p[j] = w[j];
+        }
+
+      DIFF3 (w[0], w[1], q0);
+      DIFF3 (w[1], w[2], q1);
+      crossprod (q0, q1, q1);
+      normalize (q1);
+      add_flat_polygon (p, 3, q1);
+    }
+}
+
+static void
+generate_cube (GLfloat size)
+{
+  static GLfloat n[6][3] =
+  {
+    {-1.0, 0.0, 0.0},
+    {0.0, 1.0, 0.0},
+    {1.0, 0.0, 0.0},
+    {0.0, -1.0, 0.0},
+    {0.0, 0.0, 1.0},
+    {0.0, 0.0, -1.0}
+  };
+  static GLint faces[6][4] =
+  {
+    {0, 1, 2, 3},
+    {3, 2, 6, 7},
+    {7, 6, 5, 4},
+    {4, 5, 1, 0},
+    {5, 6, 2, 1},
+    {7, 4, 0, 3}
+  };
+  GLfloat v[8][3];
+  GLint i, j;
+
+  v[0][0] = v[1][0] = v[2][0] = v[3][0] = -size / 2;
+  v[4][0] = v[5][0] = v[6][0] = v[7][0] = size / 2;
+  v[0][1] = v[1][1] = v[4][1] = v[5][1] = -size / 2;
+  v[2][1] = v[3][1] = v[6][1] = v[7][1] = size / 2;
+  v[0][2] = v[3][2] = v[4][2] = v[7][2] = -size / 2;
+  v[1][2] = v[2][2] = v[5][2] = v[6][2] = size / 2;
+
+  for (i = 5; i >= 0; i--)
+    {
+      GLfloat *p[4];
+      for (j = 0; j < 4; j++)
+        p[j] = v[faces[i][j]];
+      add_flat_polygon (p, 4, n[i]);
+    }
+}
+
+/* the surface gluSphere draws */
+static void
+generate_sphere (GLfloat radius, gint slices, gint stacks)
+{
+  GLuint first = cache->vertices->len / SHAPE_VERTEX_SIZE;
+  gint i, j;
+
+  for (j = 0; j <= stacks; j++)
+    {
+      GLfloat rho = G_PI * j / stacks;
+
+      for (i = 0; i <= slices; i++)
+        {
+          GLfloat theta = 2.0 * G_PI * (i == slices ? 0 : i) / slices;
+          GLfloat x = -sin (theta) * sin (rho);
+          GLfloat y = cos (theta) * sin (rho);
+          GLfloat z = cos (rho);
+
+          add_vertex (x * radius, y * radius, z * radius, x, y, z);
+        }
+    }
+  add_grid (first, slices, stacks);
+}
+
+/* the surface gluCylinder draws with a top radius of 0, without caps */
+static void
+generate_cone (GLfloat base, GLfloat height, gint slices, gint stacks)
+{
+  GLuint first = cache->vertices->len / SHAPE_VERTEX_SIZE;
+  GLfloat nz = base / height;
+  GLfloat scale = 1.0 / sqrt (1.0 + nz * nz);
+  gint i, j;
+
+  for (j = 0; j <= stacks; j++)
+    {
+      GLfloat z = height * j / stacks;
+      GLfloat r = base * (1.0 - (GLfloat) j / stacks);
+
+      for (i = 0; i <= slices; i++)
+        {
+          GLfloat theta = 2.0 * G_PI * (i == slices ? 0 : i) / slices;
+          GLfloat x = sin (theta);
+          GLfloat y = cos (theta);
+
+          add_vertex (x * r, y * r, z,
+                      x * scale, y * scale, nz * scale);
+        }
+    }
+  add_grid (first, slices, stacks);
+}
+
+/* the surface doughnut() draws */
+static void
+generate_torus (GLfloat r, GLfloat R, gint nsides, gint rings)
+{
+  GLuint first = cache->vertices->len / SHAPE_VERTEX_SIZE;
+  gint i, j;
+
+  for (i = 0; i <= rings; i++)
+    {
+      GLfloat theta = 2.0 * G_PI * (i == rings ? 0 : i) / rings;
+      GLfloat cosTheta = cos (theta);
+      GLfloat sinTheta = sin (theta);
+
+      for (j = 0; j <= nsides; j++)
+        {
+          GLfloat phi = 2.0 * G_PI * (j == nsides ? 0 : j) / nsides;
+          GLfloat cosPhi = cos (phi);
+          GLfloat sinPhi = sin (phi);
+          GLfloat dist = R + r * cosPhi;
+
+          add_vertex (cosTheta * dist, -sinTheta * dist, r * sinPhi,
+                      cosTheta * cosPhi, -sinTheta * cosPhi, sinPhi);
+        }
+    }
+  add_grid (first, nsides, rings);
+}
+
+static void
+generate_dodecahedron (void)
+{
+  static const int faces[12][5] =
+  {
+    {0, 1, 9, 16, 5},
+    {1, 0, 3, 18, 7},
+    {1, 7, 11, 10, 9},
+    {11, 7, 18, 19, 6},
+    {8, 17, 16, 9, 10},
+    {2, 14, 15, 6, 19},
+    {2, 13, 12, 4, 14},
+    {2, 19, 18, 3, 13},
+    {3, 0, 5, 12, 13},
+    {6, 15, 8, 10, 11},
+    {4, 17, 8, 15, 14},
+    {4, 12, 5, 16, 17}
+  };
+  gint i, j;
+
+  initDodecahedron ();
+
+  for (i = 0; i < 12; i++)
+    {
+      GLfloat n0[3], d1[3], d2[3];
+      GLfloat *p[5];
+
+      for (j = 0; j < 5; j++)
+        p[j] = dodec[faces[i][j]];
+      DIFF3 (p[0], p[1], d1);
+      DIFF3 (p[1], p[2], d2);
+      crossprod (d1, d2, n0);
+      normalize (n0);
+      add_flat_polygon (p, 5, n0);
+    }
+}
+
+/* cubic Bernstein basis and its derivative */
+static void
+bernstein (GLfloat t, GLfloat b[4], GLfloat d[4])
+{
+  GLfloat s = 1.0 - t;
+
+  b[0] = s * s * s;
+  b[1] = 3.0 * t * s * s;
+  b[2] = 3.0 * t * t * s;
+  b[3] = t * t * t;
+  d[0] = -3.0 * s * s;
+  d[1] = 3.0 * s * s - 6.0 * t * s;
+  d[2] = 6.0 * t * s - 3.0 * t * t;
+  d[3] = 3.0 * t * t;
+}
+
+/* point and GL_AUTO_NORMAL style normal of a bicubic patch */
+static void
+eval_patch (float cp[4][4][3], GLfloat u, GLfloat v,
+            GLfloat p[3], GLfloat n[3])
+{
+  GLfloat bu[4], du[4], bv[4], dv[4];
+  GLfloat pu[3] = { 0, 0, 0 }, pv[3] = { 0, 0, 0 };
+  gint j, k, l;
+
+  bernstein (u, bu, du);
+  bernstein (v, bv, dv);
+  p[0] = p[1] = p[2] = 0;
+  for (j = 0; j < 4; j++)
+    for (k = 0; k < 4; k++)
+      for (l = 0; l < 3; l++)
+        {
+          p[l] += bv[j] * bu[k] * cp[j][k][l];
+          pu[l] += bv[j] * du[k] * cp[j][k][l];
+          pv[l] += dv[j] * bu[k] * cp[j][k][l];
+        }
+  crossprod (pu, pv, n);
+}
+
+static void
+add_patch (float cp[4][4][3], gint grid, GLfloat scale)
+{
+  GLuint first = cache->vertices->len / SHAPE_VERTEX_SIZE;
+  gint i, j;
+
+  for (j = 0; j <= grid; j++)
+    for (i = 0; i <= grid; i++)
+      {
+        GLfloat u = (GLfloat) i / grid;
+        GLfloat v = (GLfloat) j / grid;
+        GLfloat p[3], n[3], unused[3];
+        GLfloat l;
+
+        eval_patch (cp, u, v, p, n);
+
+        /* collapsed patch edges have no normal, take one from nearby */
+        l = sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (l < 1e-6)
+          {
+            eval_patch (cp, u, v < 0.5 ? v + 1e-3 : v - 1e-3, unused, n);
+            l = sqrt (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+          }
+        if (l < 1e-6)
+          l = 1.0;
+
+        /* glRotatef(270, 1, 0, 0), glScalef(0.5 * scale),
+           glTranslatef(0, 0, -1.5) as teapot() does */
+        add_vertex (0.5 * scale * p[0],
+                    0.5 * scale * (p[2] - 1.5),
+                    -0.5 * scale * p[1],
+                    n[0] / l, n[2] / l, -n[1] / l);
+      }
+  add_grid (first, grid, grid);
+}
+
+/* the patches teapot() evaluates */
+static void
+generate_teapot (gint grid, GLfloat scale)
+{
+  float p[4][4][3], q[4][4][3], r[4][4][3], s[4][4][3];
+  long i, j, k, l;
+
+  for (i = 0; i < 10; i++) {
+    for (j = 0; j < 4; j++) {
+      for (k = 0; k < 4; k++) {
+        for (l = 0; l < 3; l++) {
+          p[j][k][l] = cpdata[patchdata[i][j * 4 + k]][l];
+          q[j][k][l] = cpdata[patchdata[i][j * 4 + (3 - k)]][l];
+          if (l == 1)
+            q[j][k][l] *= -1.0;
+          if (i < 6) {
+            r[j][k][l] =
+              cpdata[patchdata[i][j * 4 + (3 - k)]][l];
+            if (l == 0)
+              r[j][k][l] *= -1.0;
+            s[j][k][l] = cpdata[patchdata[i][j * 4 + k]][l];
+            if (l == 0)
+              s[j][k][l] *= -1.0;
+            if (l == 1)
+              s[j][k][l] *= -1.0;
+          }
+        }
+      }
+    }
+    add_patch (p, grid, scale);
+    add_patch (q, grid, scale);
+    if (i < 6) {
+      add_patch (r, grid, scale);
+      add_patch (s, grid, scale);
+    }
+  }
+}
+
+/* Uploads the arrays if they grew and points the vertex arrays at them. */
+static void
+shape_cache_bind (void)
+{
+  gsize vertices = 0;
+
+  if (cache->have_buffers)
+    {
+      if (cache->vertex_buffer == 0)
+        {
+          cache->GenBuffers (1, &cache->vertex_buffer);
+          cache->GenBuffers (1, &cache->index_buffer);
+          cache->dirty = TRUE;
+        }
+
+      cache->BindBuffer (GL_ARRAY_BUFFER, cache->vertex_buffer);
+      cache->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, cache->index_buffer);
+
+      if (cache->dirty)
+        {
+          cache->BufferData (GL_ARRAY_BUFFER,
+                             cache->vertices->len * sizeof (GLfloat),
+                             cache->vertices->data, GL_STATIC_DRAW);
+          cache->BufferData (GL_ELEMENT_ARRAY_BUFFER,
+                             cache->indices->len * sizeof (GLuint),
+                             cache->indices->data, GL_STATIC_DRAW);
+          cache->dirty = FALSE;
+        }
+    }
+  else
+    {
+      vertices = GPOINTER_TO_SIZE (cache->vertices->data);
+    }
+
+  glEnableClientState (GL_VERTEX_ARRAY);
+  glEnableClientState (GL_NORMAL_ARRAY);
+  /* offsets into the buffer objects, or client memory addresses */
+  glVertexPointer (3, GL_FLOAT, SHAPE_VERTEX_SIZE * sizeof (GLfloat),
+                   GSIZE_TO_POINTER (vertices));
+  glNormalPointer (GL_FLOAT, SHAPE_VERTEX_SIZE * sizeof (GLfloat),
+                   GSIZE_TO_POINTER (vertices + 3 * sizeof (GLfloat)));
+}
+
+static const ShapeMesh *
+shape_cache_lookup (gint    type,
+                    gdouble p0,
+                    gdouble p1,
+                    gdouble p2,
+                    gdouble p3)
+{
+  ShapeMesh key, *mesh;
+
+  if (!shape_cache_init ())
+    return NULL;
+
+  key.type = type;
+  key.params[0] = p0;
+  key.params[1] = p1;
+  key.params[2] = p2;
+  key.params[3] = p3;
+
+  mesh = g_hash_table_lookup (cache->meshes, &key);
+  if (mesh != NULL)
+    return mesh;
+
+  mesh = g_new (ShapeMesh, 1);
+  *mesh = key;
+  mesh->first = cache->indices->len;
+
+  switch (type)
+    {
+    case SHAPE_CUBE:
+      generate_cube (p0);
+      break;
+    case SHAPE_SPHERE:
+      generate_sphere (p0, (gint) p1, (gint) p2);
+      break;
+    case SHAPE_CONE:
+      generate_cone (p0, p1, (gint) p2, (gint) p3);
+      break;
+    case SHAPE_TORUS:
+      generate_torus (p0, p1, (gint) p2, (gint) p3);
+      break;
+    case SHAPE_TETRAHEDRON:
+      add_platonic (tdata, tndex, 4);
+      break;
+    case SHAPE_OCTAHEDRON:
+      add_platonic (odata, ondex, 8);
+      break;
+    case SHAPE_DODECAHEDRON:
+      generate_dodecahedron ();
+      break;
+    case SHAPE_ICOSAHEDRON:
+      add_platonic (idata, index, 20);
+      break;
+    case SHAPE_TEAPOT:
+      generate_teapot ((gint) p1, p0);
+      break;
+    }
+
+  mesh->count = cache->indices->len - mesh->first;
+  cache->dirty = TRUE;
+
+  /* inside a begin/end run the bound copy is now short, or moved */
+  if (cache->nesting > 0)
+    shape_cache_bind ();
+
+  g_hash_table_insert (cache->meshes, mesh, mesh);
+  return mesh;
+}
+
+/**
+ * shape_cache_cube:
+ * @size: length of cube sides.
+ *
+ * Returns the cached solid cube draw_cube() renders, generating it
+ * on first use. All shape_cache functions need the GL context the
+ * cache is drawn in to be current.
+ *
+ * Return value: the cached mesh, valid until shape_cache_clear().
+ **/
+const ShapeMesh *
+shape_cache_cube (double size)
+{
+  return shape_cache_lookup (SHAPE_CUBE, size, 0, 0, 0);
+}
+
+/**
+ * shape_cache_sphere:
+ * @radius: the radius of the sphere.
+ * @slices: the number of subdivisions around the Z axis.
+ * @stacks: the number of subdivisions along the Z axis.
+ *
+ * Returns the cached solid sphere draw_sphere() renders.
+ *
+ * Return value: the cached mesh, valid until shape_cache_clear().
+ **/
+const ShapeMesh *
+shape_cache_sphere (double radius,
+                    int    slices,
+                    int    stacks)
+{
+  g_return_val_if_fail (slices > 0 && stacks > 0, NULL);
+
+  return shape_cache_lookup (SHAPE_SPHERE, radius, slices, stacks, 0);
+}
+
+/**
+ * shape_cache_cone:
+ * @base: the radius of the base of the cone.
+ * @height: the height of the cone.
+ * @slices: the number of subdivisions around the Z axis.
+ * @stacks: the number of subdivisions along the Z axis.
+ *
+ * Returns the cached solid cone draw_cone() renders.
+ *
+ * Return value: the cached mesh, valid until shape_cache_clear().
+ **/
+const ShapeMesh *
+shape_cache_cone (double base,
+                  double height,
+                  int    slices,
+                  int    stacks)
+{
+  g_return_val_if_fail (height > 0 && slices > 0 && stacks > 0, NULL);
+
+  return shape_cache_lookup (SHAPE_CONE, base, height, slices, stacks);
+}
+
+/**
+ * shape_cache_torus:
+ * @inner_radius: inner radius of the torus.
+ * @outer_radius: outer radius of the torus.
+ * @nsides: number of sides for each radial section.
+ * @rings: number of radial divisions for the torus.
+ *
+ * Returns the cached solid torus draw_torus() renders.
+ *
+ * Return value: the cached mesh, valid until shape_cache_clear().
+ **/
+const ShapeMesh *
+shape_cache_torus (double inner_radius,
+                   double outer_radius,
+                   int    nsides,
+                   int    rings)
+{
+  g_return_val_if_fail (nsides > 0 && rings > 0, NULL);
+
+  return shape_cache_lookup (SHAPE_TORUS, inner_radius, outer_radius,
+                             nsides, rings);
+}
+
+/**
+ * shape_cache_tetrahedron:
+ *
+ * Returns the cached solid tetrahedron draw_tetrahedron() renders.
+ *
+ * Return value: the cached mesh, valid until shape_cache_clear().
+ **/
+const ShapeMesh *
+shape_cache_tetrahedron (void)
+{
+  return shape_cache_lookup (SHAPE_TETRAHEDRON, 0, 0, 0, 0);
+}
+
+/**
+ * shape_cache_octahedron:
+ *
+ * Returns the cached solid octahedron draw_octahedron() renders.
+ *
+ * Return value: the cached mesh, valid until shape_cache_clear().
+ **/
+const ShapeMesh *
+shape_cache_octahedron (void)
+{
+  return shape_cache_lookup (SHAPE_OCTAHEDRON, 0, 0, 0, 0);
+}
+
+/**
+ * shape_cache_dodecahedron:
+ *
+ * Returns the cached solid dodecahedron draw_dodecahedron() renders.
+ *
+ * Return value: the cached mesh, valid until shape_cache_clear().
+ **/
+const ShapeMesh *
+shape_cache_dodecahedron (void)
+{
+  return shape_cache_lookup (SHAPE_DODECAHEDRON, 0, 0, 0, 0);
+}
+
+/**
+ * shape_cache_icosahedron:
+ *
+ * Returns the cached solid icosahedron draw_icosahedron() renders.
+ *
+ * Return value: the cached mesh, valid until shape_cache_clear().
+ **/
+const ShapeMesh *
+shape_cache_icosahedron (void)
+{
+  return shape_cache_lookup (SHAPE_ICOSAHEDRON, 0, 0, 0, 0);
+}
+
+/**
+ * shape_cache_teapot:
+ * @scale: relative size of the teapot.
+ * @grid: number of subdivisions of each Bezier patch.
+ *
+ * Returns the cached solid teapot. The patches are evaluated on the CPU
+ * into the same surface draw_teapot() renders with evaluators, without
+ * texture coordinates.
+ *
+ * Return value: the cached mesh, valid until shape_cache_clear().
+ **/
+const ShapeMesh *
+shape_cache_teapot (double scale,
+                    int    grid)
+{
+  g_return_val_if_fail (grid > 0, NULL);
+
+  return shape_cache_lookup (SHAPE_TEAPOT, scale, grid, 0, 0);
+}
+
+/**
+ * shape_cache_begin:
+ *
+ * Binds the cached shapes for drawing, uploading any generated since
+ * the last call. Calls nest; shape_mesh_draw() between a begin and the
+ * matching shape_cache_end() only issues the draw call. Shapes looked
+ * up for the first time inside the run are uploaded and bound right
+ * away. The client vertex array state is saved and restored by
+ * shape_cache_end().
+ *
+ **/
+void
+shape_cache_begin (void)
+{
+  if (!shape_cache_init ())
+    return;
+
+  if (cache->nesting++ > 0)
+    return;
+
+  glPushClientAttrib (GL_CLIENT_VERTEX_ARRAY_BIT);
+
+  shape_cache_bind ();
+}
+
+/**
+ * shape_cache_end:
+ *
+ * Undoes shape_cache_begin().
+ *
+ **/
+void
+shape_cache_end (void)
+{
+  g_return_if_fail (cache != NULL && cache->nesting > 0);
+
+  if (--cache->nesting > 0)
+    return;
+
+  if (cache->have_buffers)
+    {
+      cache->BindBuffer (GL_ARRAY_BUFFER, 0);
+      cache->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+  glPopClientAttrib ();
+}
+
+/**
+ * shape_mesh_draw:
+ * @mesh: a mesh from the shape cache.
+ *
+ * Draws @mesh with one glDrawElements call.
+ *
+ **/
+void
+shape_mesh_draw (const ShapeMesh *mesh)
+{
+  gsize indices;
+
+  g_return_if_fail (mesh != NULL);
+  g_return_if_fail (gdk_gl_context_get_current () != NULL);
+
+  shape_cache_begin ();
+
+  indices = cache->have_buffers ? 0 : GPOINTER_TO_SIZE (cache->indices->data);
+  glDrawElements (GL_TRIANGLES, mesh->count, GL_UNSIGNED_INT,
+                  GSIZE_TO_POINTER (indices + mesh->first * sizeof (GLuint)));
+
+  shape_cache_end ();
+}
+
+/*
+ * Instanced drawing
+ *
+ * shape_mesh_draw_instanced() streams the per-instance matrices and
+ * colors into a buffer object and draws every instance of a cached
+ * mesh with one glDrawElementsInstanced, using a small built-in
+ * program that lights the instances like the fixed-function light 0,
+ * either with the current material or with GL_COLOR_MATERIAL.  Where
+ * that is not available each instance is drawn with the fixed-function
+ * pipeline instead.
+ */
+
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW          0x88E0
+#endif
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER        0x8B31
+#endif
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER      0x8B30
+#endif
+#ifndef GL_COMPILE_STATUS
+#define GL_COMPILE_STATUS       0x8B81
+#endif
+#ifndef GL_LINK_STATUS
+#define GL_LINK_STATUS          0x8B82
+#endif
+#ifndef GL_CURRENT_PROGRAM
+#define GL_CURRENT_PROGRAM      0x8B8D
+#endif
+
+#define INSTANCE_MATRIX_ATTRIB  1       /* mat4: attributes 1 to 4 */
+#define INSTANCE_COLOR_ATTRIB   5
+
+typedef GLuint (APIENTRY *CreateShaderProc)       (GLenum type);
+typedef void   (APIENTRY *ShaderSourceProc)       (GLuint shader, GLsizei count,
+                                                   const char **string,
+                                                   const GLint *length);
+typedef void   (APIENTRY *CompileShaderProc)      (GLuint shader);
+typedef void   (APIENTRY *GetShaderivProc)        (GLuint shader, GLenum pname,
+                                                   GLint *params);
+typedef void   (APIENTRY *DeleteShaderProc)       (GLuint shader);
+typedef GLuint (APIENTRY *CreateProgramProc)      (void);
+typedef void   (APIENTRY *AttachShaderProc)       (GLuint program, GLuint shader);
+typedef void   (APIENTRY *BindAttribLocationProc) (GLuint program, GLuint index,
+                                                   const char *name);
+typedef void   (APIENTRY *LinkProgramProc)        (GLuint program);
+typedef void   (APIENTRY *GetProgramivProc)       (GLuint program, GLenum pname,
+                                                   GLint *params);
+typedef void   (APIENTRY *UseProgramProc)         (GLuint program);
+typedef GLint  (APIENTRY *GetUniformLocationProc) (GLuint program,
+                                                   const char *name);
+typedef void   (APIENTRY *Uniform1iProc)          (GLint location, GLint v0);
+typedef void   (APIENTRY *DeleteProgramProc)      (GLuint program);
+typedef void   (APIENTRY *VertexAttribPointerProc) (GLuint index, GLint size,
+                                                    GLenum type,
+                                                    GLboolean normalized,
+                                                    GLsizei stride,
+                                                    const void *pointer);
+typedef void   (APIENTRY *EnableVertexAttribArrayProc)  (GLuint index);
+typedef void   (APIENTRY *DisableVertexAttribArrayProc) (GLuint index);
+typedef void   (APIENTRY *VertexAttrib4fProc)     (GLuint index,
+                                                   GLfloat x, GLfloat y,
+                                                   GLfloat z, GLfloat w);
+typedef void   (APIENTRY *BufferSubDataProc)      (GLenum target, gssize offset,
+                                                   gssize size,
+                                                   const void *data);
+typedef void   (APIENTRY *VertexAttribDivisorProc) (GLuint index, GLuint divisor);
+typedef void   (APIENTRY *DrawElementsInstancedProc) (GLenum mode, GLsizei count,
+                                                      GLenum type,
+                                                      const void *indices,
+                                                      GLsizei primcount);
+
+/* the instance color replaces the ambient and diffuse material, as
+   GL_COLOR_MATERIAL with GL_AMBIENT_AND_DIFFUSE does */
+static const char *instance_vertex_shader =
+  "#version 120\n"
+  "attribute mat4 instance_matrix;\n"
+  "attribute vec4 instance_color;\n"
+  "uniform bool use_instance_color;\n"
+  "void main ()\n"
+  "{\n"
+  "  vec4 position = gl_ModelViewMatrix * (instance_matrix * gl_Vertex);\n"
+  "  vec3 normal = normalize (gl_NormalMatrix *\n"
+  "                           (mat3 (instance_matrix) * gl_Normal));\n"
+  "  vec4 light = gl_LightSource[0].position;\n"
+  "  vec3 direction = normalize (light.xyz - light.w * position.xyz);\n"
+  "  float diffuse = max (dot (normal, direction), 0.0);\n"
+  "  vec4 ambient_material = use_instance_color ?\n"
+  "    instance_color : gl_FrontMaterial.ambient;\n"
+  "  vec4 diffuse_material = use_instance_color ?\n"
+  "    instance_color : gl_FrontMaterial.diffuse;\n"
+  "  vec3 color = gl_FrontMaterial.emission.rgb\n"
+  "    + ambient_material.rgb * (gl_LightModel.ambient.rgb +\n"
+  "                              gl_LightSource[0].ambient.rgb)\n"
+  "    + diffuse * diffuse_material.rgb * gl_LightSource[0].diffuse.rgb;\n"
+  "  if (diffuse > 0.0)\n"
+  "    {\n"
+  "      vec3 half_vector = normalize (direction + vec3 (0.0, 0.0, 1.0));\n"
+  "      float specular = max (dot (normal, half_vector), 0.0);\n"
+  "      color += pow (specular, gl_FrontMaterial.shininess)\n"
+  "               * gl_FrontMaterial.specular.rgb\n"
+  "               * gl_LightSource[0].specular.rgb;\n"
+  "    }\n"
+  "  gl_FrontColor = vec4 (color, diffuse_material.a);\n"
+  "  gl_Position = gl_ProjectionMatrix * position;\n"
+  "}\n";
+
+static const char *instance_fragment_shader =
+  "#version 120\n"
+  "void main ()\n"
+  "{\n"
+  "  gl_FragColor = gl_Color;\n"
+  "}\n";
+
+typedef struct
+{
+  gboolean supported;
+
+  GLuint program;
+  GLint use_color_location;     /* use_instance_color uniform */
+  GLuint buffer;
+
+  CreateShaderProc CreateShader;
+  ShaderSourceProc ShaderSource;
+  CompileShaderProc CompileShader;
+  GetShaderivProc GetShaderiv;
+  DeleteShaderProc DeleteShader;
+  CreateProgramProc CreateProgram;
+  AttachShaderProc AttachShader;
+  BindAttribLocationProc BindAttribLocation;
+  LinkProgramProc LinkProgram;
+  GetProgramivProc GetProgramiv;
+  UseProgramProc UseProgram;
+  DeleteProgramProc DeleteProgram;
+  GetUniformLocationProc GetUniformLocation;
+  Uniform1iProc Uniform1i;
+  BufferSubDataProc BufferSubData;
+  VertexAttribPointerProc VertexAttribPointer;
+  EnableVertexAttribArrayProc EnableVertexAttribArray;
+  DisableVertexAttribArrayProc DisableVertexAttribArray;
+  VertexAttrib4fProc VertexAttrib4f;
+  VertexAttribDivisorProc VertexAttribDivisor;
+  DrawElementsInstancedProc DrawElementsInstanced;
+} ShapeInstancing;
+
+/* the current context's, set by shape_instancing_init() */
+static ShapeInstancing *instancing = NULL;
+
+static GLuint
+compile_shader (GLenum      type,
+                const char *source)
+{
+  GLuint shader;
+  GLint status = 0;
+
+  shader = instancing->CreateShader (type);
+  instancing->ShaderSource (shader, 1, &source, NULL);
+  instancing->CompileShader (shader);
+  instancing->GetShaderiv (shader, GL_COMPILE_STATUS, &status);
+  if (!status)
+    {
+      instancing->DeleteShader (shader);
+      return 0;
+    }
+
+  return shader;
+}
+
+static gboolean
+create_instance_program (void)
+{
+  GLuint vertex_shader, fragment_shader;
+  GLint status = 0;
+
+  vertex_shader = compile_shader (GL_VERTEX_SHADER, instance_vertex_shader);
+  fragment_shader = compile_shader (GL_FRAGMENT_SHADER, instance_fragment_shader);
+
+  if (vertex_shader != 0 && fragment_shader != 0)
+    {
+      instancing->program = instancing->CreateProgram ();
+      instancing->AttachShader (instancing->program, vertex_shader);
+      instancing->AttachShader (instancing->program, fragment_shader);
+      instancing->BindAttribLocation (instancing->program,
+                                     INSTANCE_MATRIX_ATTRIB, "instance_matrix");
+      instancing->BindAttribLocation (instancing->program,
+                                     INSTANCE_COLOR_ATTRIB, "instance_color");
+      instancing->LinkProgram (instancing->program);
+      instancing->GetProgramiv (instancing->program, GL_LINK_STATUS, &status);
+      if (!status)
+        {
+          instancing->DeleteProgram (instancing->program);
+          instancing->program = 0;
+        }
+      else
+        {
+          instancing->use_color_location =
+            instancing->GetUniformLocation (instancing->program,
+                                            "use_instance_color");
+        }
+    }
+
+  /* the program keeps them alive */
+  if (vertex_shader != 0)
+    instancing->DeleteShader (vertex_shader);
+  if (fragment_shader != 0)
+    instancing->DeleteShader (fragment_shader);
+
+  return instancing->program != 0;
+}
+
+static void
+shape_instancing_init (void)
+{
+  GdkGLContext *glcontext = gdk_gl_context_get_current ();
+  const char *version;
+  int major = 0, minor = 0;
+
+  instancing = g_object_get_data (G_OBJECT (glcontext), SHAPE_INSTANCING_KEY);
+  if (instancing != NULL)
+    return;
+
+  instancing = g_new0 (ShapeInstancing, 1);
+  g_object_set_data_full (G_OBJECT (glcontext), SHAPE_INSTANCING_KEY,
+                          instancing, g_free);
+
+  if (!cache->have_buffers)
+    return;
+
+  /* GLSL 1.20 is GL 2.1 */
+  version = (const char *) glGetString (GL_VERSION);
+  if (version == NULL || sscanf (version, "%d.%d", &major, &minor) != 2 ||
+      (major < 2 || (major == 2 && minor < 1)))
+    return;
+
+#define GET_PROC(proc, name) \
+  instancing->proc = (proc##Proc) gdk_gl_get_proc_address (name)
+
+  GET_PROC (CreateShader, "glCreateShader");
+  GET_PROC (ShaderSource, "glShaderSource");
+  GET_PROC (CompileShader, "glCompileShader");
+  GET_PROC (GetShaderiv, "glGetShaderiv");
+  GET_PROC (DeleteShader, "glDeleteShader");
+  GET_PROC (CreateProgram, "glCreateProgram");
+  GET_PROC (AttachShader, "glAttachShader");
+  GET_PROC (BindAttribLocation, "glBindAttribLocation");
+  GET_PROC (LinkProgram, "glLinkProgram");
+  GET_PROC (GetProgramiv, "glGetProgramiv");
+  GET_PROC (UseProgram, "glUseProgram");
+  GET_PROC (DeleteProgram, "glDeleteProgram");
+  GET_PROC (GetUniformLocation, "glGetUniformLocation");
+  GET_PROC (Uniform1i, "glUniform1i");
+  GET_PROC (BufferSubData, "glBufferSubData");
+  GET_PROC (VertexAttribPointer, "glVertexAttribPointer");
+  GET_PROC (EnableVertexAttribArray, "glEnableVertexAttribArray");
+  GET_PROC (DisableVertexAttribArray, "glDisableVertexAttribArray");
+  GET_PROC (VertexAttrib4f, "glVertexAttrib4f");
+
+  /* glDrawElementsInstanced is GL 3.1, glVertexAttribDivisor is GL 3.3 */
+  if (major > 3 || (major == 3 && minor >= 1))
+    GET_PROC (DrawElementsInstanced, "glDrawElementsInstanced");
+  else if (gdk_gl_query_gl_extension ("GL_ARB_draw_instanced"))
+    GET_PROC (DrawElementsInstanced, "glDrawElementsInstancedARB");
+  else if (gdk_gl_query_gl_extension ("GL_EXT_draw_instanced"))
+    GET_PROC (DrawElementsInstanced, "glDrawElementsInstancedEXT");
+
+  if (major > 3 || (major == 3 && minor >= 3))
+    GET_PROC (VertexAttribDivisor, "glVertexAttribDivisor");
+  else if (gdk_gl_query_gl_extension ("GL_ARB_instanced_arrays"))
+    GET_PROC (VertexAttribDivisor, "glVertexAttribDivisorARB");
+
+#undef GET_PROC
+
+  if (instancing->CreateShader == NULL ||
+      instancing->ShaderSource == NULL ||
+      instancing->CompileShader == NULL ||
+      instancing->GetShaderiv == NULL ||
+      instancing->DeleteShader == NULL ||
+      instancing->CreateProgram == NULL ||
+      instancing->AttachShader == NULL ||
+      instancing->BindAttribLocation == NULL ||
+      instancing->LinkProgram == NULL ||
+      instancing->GetProgramiv == NULL ||
+      instancing->UseProgram == NULL ||
+      instancing->DeleteProgram == NULL ||
+      instancing->GetUniformLocation == NULL ||
+      instancing->Uniform1i == NULL ||
+      instancing->BufferSubData == NULL ||
+      instancing->VertexAttribPointer == NULL ||
+      instancing->EnableVertexAttribArray == NULL ||
+      instancing->DisableVertexAttribArray == NULL ||
+      instancing->VertexAttrib4f == NULL ||
+      instancing->VertexAttribDivisor == NULL ||
+      instancing->DrawElementsInstanced == NULL)
+    return;
+
+  if (!create_instance_program ())
+    return;
+
+  cache->GenBuffers (1, &instancing->buffer);
+  instancing->supported = TRUE;
+}
+
+static void
+shape_instancing_clear (GdkGLContext *glcontext)
+{
+  instancing = g_object_get_data (G_OBJECT (glcontext), SHAPE_INSTANCING_KEY);
+  if (instancing == NULL)
+    return;
+
+  if (instancing->program != 0)
+    instancing->DeleteProgram (instancing->program);
+  if (instancing->buffer != 0)
+    cache->DeleteBuffers (1, &instancing->buffer);
+
+  g_object_set_data (G_OBJECT (glcontext), SHAPE_INSTANCING_KEY, NULL);
+  instancing = NULL;
+}
+
+static void
+draw_instances_fixed (const ShapeMesh *mesh,
+                      gint             n_instances,
+                      const GLfloat   *matrices,
+                      const GLfloat   *colors)
+{
+  gint i;
+
+  glPushAttrib (GL_CURRENT_BIT | GL_ENABLE_BIT | GL_LIGHTING_BIT);
+
+  if (colors != NULL)
+    {
+      glColorMaterial (GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+      glEnable (GL_COLOR_MATERIAL);
+    }
+
+  for (i = 0; i < n_instances; i++)
+    {
+      if (colors != NULL)
+        glColor4fv (colors + 4 * i);
+
+      glPushMatrix ();
+      glMultMatrixf (matrices + 16 * i);
+      shape_mesh_draw (mesh);
+      glPopMatrix ();
+    }
+
+  glPopAttrib ();
+}
+
+/**
+ * shape_mesh_draw_instanced:
+ * @mesh: a mesh from the shape cache.
+ * @n_instances: number of instances to draw.
+ * @matrices: @n_instances column-major 4x4 matrices, applied to @mesh
+ *            before the current modelview matrix.
+ * @colors: @n_instances RGBA colors, or NULL.
+ *
+ * Draws @n_instances copies of @mesh.  With GL 3.3 (or GL 2.1 with
+ * ARB_draw_instanced and ARB_instanced_arrays) this is one
+ * glDrawElementsInstanced call, lit by light 0.  Otherwise every
+ * instance is drawn in turn with the fixed-function pipeline.  Either
+ * way the instances use the current front material, with each
+ * instance's color from @colors as its ambient and diffuse material if
+ * given, as GL_COLOR_MATERIAL does.
+ *
+ * The instance matrices should not scale non-uniformly, as their upper
+ * 3x3 part is also used to transform the normals.
+ *
+ **/
+void
+shape_mesh_draw_instanced (const ShapeMesh *mesh,
+                           int              n_instances,
+                           const float     *matrices,
+                           const float     *colors)
+{
+  gsize matrix_size, color_size;
+  GLint program = 0;
+  gint i;
+
+  g_return_if_fail (mesh != NULL);
+  g_return_if_fail (n_instances >= 0);
+  g_return_if_fail (matrices != NULL || n_instances == 0);
+  g_return_if_fail (gdk_gl_context_get_current () != NULL);
+
+  if (n_instances == 0)
+    return;
+
+  shape_cache_begin ();
+  shape_instancing_init ();
+
+  if (!instancing->supported)
+    {
+      draw_instances_fixed (mesh, n_instances, matrices, colors);
+      shape_cache_end ();
+      return;
+    }
+
+  matrix_size = n_instances * 16 * sizeof (GLfloat);
+  color_size = colors != NULL ? n_instances * 4 * sizeof (GLfloat) : 0;
+
+  /* orphan the previous frame's storage rather than wait for it */
+  cache->BindBuffer (GL_ARRAY_BUFFER, instancing->buffer);
+  cache->BufferData (GL_ARRAY_BUFFER, matrix_size + color_size, NULL,
+                    GL_STREAM_DRAW);
+  instancing->BufferSubData (GL_ARRAY_BUFFER, 0, matrix_size, matrices);
+  if (colors != NULL)
+    instancing->BufferSubData (GL_ARRAY_BUFFER, matrix_size, color_size, colors);
+
+  for (i = 0; i < 4; i++)
+    {
+      instancing->VertexAttribPointer (INSTANCE_MATRIX_ATTRIB + i, 4, GL_FLOAT,
+                                      GL_FALSE, 16 * sizeof (GLfloat),
+                                      GSIZE_TO_POINTER (4 * i * sizeof (GLfloat)));
+      instancing->VertexAttribDivisor (INSTANCE_MATRIX_ATTRIB + i, 1);
+      instancing->EnableVertexAttribArray (INSTANCE_MATRIX_ATTRIB + i);
+    }
+
+  if (colors != NULL)
+    {
+      instancing->VertexAttribPointer (INSTANCE_COLOR_ATTRIB, 4, GL_FLOAT,
+                                      GL_FALSE, 4 * sizeof (GLfloat),
+                                      GSIZE_TO_POINTER (matrix_size));
+      instancing->VertexAttribDivisor (INSTANCE_COLOR_ATTRIB, 1);
+      instancing->EnableVertexAttribArray (INSTANCE_COLOR_ATTRIB);
+    }
+  else
+    {
+      /* unused by the program, but keep the attribute defined */
+      instancing->VertexAttrib4f (INSTANCE_COLOR_ATTRIB, 1.0, 1.0, 1.0, 1.0);
+    }
+
+  cache->BindBuffer (GL_ARRAY_BUFFER, cache->vertex_buffer);
+
+  glGetIntegerv (GL_CURRENT_PROGRAM, &program);
+  instancing->UseProgram (instancing->program);
+  instancing->Uniform1i (instancing->use_color_location, colors != NULL);
+
+  instancing->DrawElementsInstanced (GL_TRIANGLES, mesh->count, GL_UNSIGNED_INT,
+                                    GSIZE_TO_POINTER (mesh->first * sizeof (GLuint)),
+                                    n_instances);
+
+  instancing->UseProgram (program);
+
+  /* the divisors are not part of the state shape_cache_end() restores
+     on every implementation */
+  for (i = 0; i < 5; i++)
+    {
+      instancing->VertexAttribDivisor (INSTANCE_MATRIX_ATTRIB + i, 0);
+      instancing->DisableVertexAttribArray (INSTANCE_MATRIX_ATTRIB + i);
+    }
+
+  shape_cache_end ();
+}
+
+/**
+ * shape_cache_clear:
+ *
+ * Frees the current context's cached shapes and their buffer objects.
+ * Destroying the context does the same, so this is only needed to free
+ * them earlier.
+ *
+ **/
+void
+shape_cache_clear (void)
+{
+  GdkGLContext *glcontext;
+
+  glcontext = gdk_gl_context_get_current ();
+  g_return_if_fail (glcontext != NULL);
+
+  cache = g_object_get_data (G_OBJECT (glcontext), SHAPE_CACHE_KEY);
+  if (cache == NULL)
+    return;
+
+  g_return_if_fail (cache->nesting == 0);
+
+  shape_instancing_clear (glcontext);
+
+  if (cache->vertex_buffer != 0)
+    {
+      cache->DeleteBuffers (1, &cache->vertex_buffer);
+      cache->DeleteBuffers (1, &cache->index_buffer);
+    }
+
+  /* frees the CPU side */
+  g_object_set_data (G_OBJECT (glcontext), SHAPE_CACHE_KEY, NULL);
+  cache = NULL;
+}
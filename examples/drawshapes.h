@@ -54,6 +54,66 @@ void draw_icosahedron  (gboolean solid);
 void draw_teapot       (gboolean solid,
                         double   scale);
 
+/*
+ * Shape cache: solid shapes generated once per set of parameters into
+ * shared buffer objects. The draw_ functions above use it for solid
+ * shapes. Each GL context has its own cache, and a mesh may only be
+ * drawn while the context it was looked up in is current.
+ */
+
+typedef struct _ShapeMesh ShapeMesh;
+
+struct _ShapeMesh
+{
+  /*< private >*/
+  gint    type;
+  gdouble params[4];
+
+  /*< public >*/
+  gint    first;        /* first index in the shared index buffer */
+  gint    count;        /* number of indices, drawn as triangles */
+};
+
+const ShapeMesh *shape_cache_cube         (double size);
+
+const ShapeMesh *shape_cache_sphere       (double radius,
+                                           int    slices,
+                                           int    stacks);
+
+const ShapeMesh *shape_cache_cone         (double base,
+                                           double height,
+                                           int    slices,
+                                           int    stacks);
+
+const ShapeMesh *shape_cache_torus        (double inner_radius,
+                                           double outer_radius,
+                                           int    nsides,
+                                           int    rings);
+
+const ShapeMesh *shape_cache_tetrahedron  (void);
+
+const ShapeMesh *shape_cache_octahedron   (void);
+
+const ShapeMesh *shape_cache_dodecahedron (void);
+
+const ShapeMesh *shape_cache_icosahedron  (void);
+
+const ShapeMesh *shape_cache_teapot       (double scale,
+                                           int    grid);
+
+void             shape_cache_begin        (void);
+
+void             shape_cache_end          (void);
+
+void             shape_mesh_draw          (const ShapeMesh *mesh);
+
+void             shape_mesh_draw_instanced (const ShapeMesh *mesh,
+                                            int              n_instances,
+                                            const float     *matrices,
+                                            const float     *colors);
+
+void             shape_cache_clear        (void);
+
 G_END_DECLS
 
 #endif /* __DRAW_SHAPES_H__ */
@@ -7,7 +7,6 @@
  */
 
 #include <stdlib.h>
-#include <string.h>
 #include <math.h>
 
 #include <gtk/gtk.h>
@@ -15,6 +14,8 @@
 
 #include <gtk/gtkgl.h>
 
+#include "glyph-atlas.h"
+
 #ifdef G_OS_WIN32
 #define WIN32_LEAN_AND_MEAN 1
 #include <windows.h>
@@ -36,194 +37,9 @@ static const char *text = "This text is rendered with Παν語FT2.";
 
 static PangoContext *ft2_context = NULL;
 
-typedef struct _TextTexture {
-  GLuint  name;
-  GLsizei size;
-  GLvoid *texels;
-} TextTexture;
-
-static TextTexture text_texture = {
-  0, 0, NULL
-};
-
-static gboolean
-gl_tex_create_texture (GLuint *texture)
-{
-  GLuint tex_name;
-  GLint size;
-  GLvoid *texels;
-
-  glGetIntegerv (GL_MAX_TEXTURE_SIZE, &size);
-
-  do
-    {
-      GLint width;
-
-      glTexImage2D (GL_PROXY_TEXTURE_2D, 0, GL_RGBA,
-                    size, size, 0,
-                    GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-
-      glGetTexLevelParameteriv (GL_PROXY_TEXTURE_2D, 0,
-                                GL_TEXTURE_WIDTH, &width);
-      if (width != 0)
-        break;
-
-      size >>= 1;
-    }
-  while (size > 0);
-
-  if (size == 0)
-    {
-      g_print ("There are not enough resources for the texture.\n");
-      return FALSE;
-    }
-
-  texels = g_malloc (size * size * 4);
-  memset (texels, 0, size * size * 4);
-
-  glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
-
-  glGenTextures (1, &tex_name);
-
-  glBindTexture (GL_TEXTURE_2D, tex_name);
-  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexImage2D (GL_TEXTURE_2D, 0, GL_RGBA,
-                size, size, 0,
-                GL_RGBA, GL_UNSIGNED_BYTE,
-                texels);
+static GlyphAtlas *atlas = NULL;
 
-  text_texture.name = tex_name;
-  text_texture.size = size;
-  text_texture.texels = texels;
-
-  *texture = text_texture.name;
-
-  return TRUE;
-}
-
-static void
-gl_tex_delete_texture (void)
-{
-  glDeleteTextures (1, &text_texture.name);
-  g_free (text_texture.texels);
-}
-
-static gboolean
-gl_tex_pango_ft2_render_layout (PangoLayout *layout,
-                                GLuint *texture,
-                                GLfloat *s0,
-                                GLfloat *s1,
-                                GLfloat *t0,
-                                GLfloat *t1)
-{
-  PangoRectangle logical_rect;
-  FT_Bitmap bitmap;
-  guint32 *t;
-  GLfloat color[4];
-  guint32 rgb;
-  GLfloat a;
-  guint8 *row, *row_end;
-  int i;
-
-  if (text_texture.size == 0)
-    return FALSE;
-
-  pango_layout_get_extents (layout, NULL, &logical_rect);
-  if (logical_rect.width == 0 || logical_rect.height == 0)
-    return FALSE;
-
-  bitmap.rows = PANGO_PIXELS (logical_rect.height);
-  bitmap.width = PANGO_PIXELS (logical_rect.width);
-
-  /* Ad hoc :-p */
-  if (bitmap.width > text_texture.size || bitmap.rows > text_texture.size)
-    return FALSE;
-
-  bitmap.pitch = bitmap.width;
-  bitmap.buffer = g_malloc (bitmap.rows * bitmap.width);
-  bitmap.num_grays = 256;
-  bitmap.pixel_mode = ft_pixel_mode_grays;
-
-  memset (bitmap.buffer, 0, bitmap.rows * bitmap.width);
-  pango_ft2_render_layout (&bitmap, layout,
-                           PANGO_PIXELS (-logical_rect.x), 0);
-
-  glGetFloatv (GL_CURRENT_COLOR, color);
-#if !defined(GL_VERSION_1_2) && G_BYTE_ORDER == G_LITTLE_ENDIAN
-  rgb =  ((guint32) (color[0] * 255.0))        |
-        (((guint32) (color[1] * 255.0)) << 8)  |
-        (((guint32) (color[2] * 255.0)) << 16);
-#else
-  rgb = (((guint32) (color[0] * 255.0)) << 24) |
-        (((guint32) (color[1] * 255.0)) << 16) |
-        (((guint32) (color[2] * 255.0)) << 8);
-#endif
-  a = color[3];
-
-  row = bitmap.buffer + bitmap.rows * bitmap.width; /* past-the-end */
-  row_end = bitmap.buffer;      /* beginning */
-
-  t = (guint32 *) text_texture.texels;
-
-  if (a == 1.0)
-    {
-      do
-        {
-          row -= bitmap.width;
-          for (i = 0; i < bitmap.width; i++)
-#if !defined(GL_VERSION_1_2) && G_BYTE_ORDER == G_LITTLE_ENDIAN
-            *t++ = rgb | (((guint32) row[i]) << 24);
-#else
-            *t++ = rgb | ((guint32) row[i]);
-#endif
-        }
-      while (row != row_end);
-    }
-  else
-    {
-      do
-        {
-          row -= bitmap.width;
-          for (i = 0; i < bitmap.width; i++)
-#if !defined(GL_VERSION_1_2) && G_BYTE_ORDER == G_LITTLE_ENDIAN
-            *t++ = rgb | (((guint32) (a * row[i])) << 24);
-#else
-            *t++ = rgb | ((guint32) (a * row[i]));
-#endif
-        }
-      while (row != row_end);
-    }
-
-  glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
-
-  glBindTexture (GL_TEXTURE_2D, text_texture.name);
-#if !defined(GL_VERSION_1_2)
-  glTexSubImage2D (GL_TEXTURE_2D, 0,
-                   0, 0, bitmap.width, bitmap.rows,
-                   GL_RGBA, GL_UNSIGNED_BYTE,
-                   text_texture.texels);
-#else
-  glTexSubImage2D (GL_TEXTURE_2D, 0,
-                   0, 0, bitmap.width, bitmap.rows,
-                   GL_RGBA, GL_UNSIGNED_INT_8_8_8_8,
-                   text_texture.texels);
-#endif
-
-  *texture = text_texture.name;
-
-  *s0 = 0.0;
-  *s1 = (GLfloat) bitmap.width / (GLfloat) text_texture.size;
-
-  *t0 = 0.0;
-  *t1 = (GLfloat) bitmap.rows / (GLfloat) text_texture.size;
-
-  g_free (bitmap.buffer);
-
-  return TRUE;
-}
+static const float text_color[4] = { 1.0, 0.9, 0.0, 1.0 };
 
 static void
 realize (GtkWidget *widget,
@@ -233,8 +49,6 @@ realize (GtkWidget *widget,
   static GLfloat light_diffuse[] = {1.0, 0.0, 0.0, 1.0};
   static GLfloat light_position[] = {1.0, 1.0, 1.0, 0.0};
 
-  GLuint texture;
-
   /*** OpenGL BEGIN ***/
   if (!gtk_widget_begin_gl (widget))
     return;
@@ -254,8 +68,8 @@ realize (GtkWidget *widget,
   glClearColor (0.0, 0.0, 0.0, 0.0);
   glClearDepth (1.0);
 
-  /* Create texture. */
-  gl_tex_create_texture (&texture);
+  /* Create glyph cache. */
+  atlas = glyph_atlas_new (512);
 
   gtk_widget_end_gl (widget, FALSE);
   /*** OpenGL END ***/
@@ -324,10 +138,7 @@ draw (GtkWidget *widget,
   PangoContext *widget_context;
   PangoFontDescription *font_desc;
   PangoLayout *layout;
-
-  GLuint texture;
-  GLfloat s0, s1, t0, t1;
-  gboolean ret;
+  PangoRectangle logical_rect;
 
   /* Font */
   widget_context = gtk_widget_get_pango_context (widget);
@@ -349,34 +160,23 @@ draw (GtkWidget *widget,
 
   glCallList (1);
 
-  /* Text color */
-  glColor3f (1.0, 0.9, 0.0);
-
-  /* Render text */
-  ret = gl_tex_pango_ft2_render_layout (layout,
-                                        &texture,
-                                        &s0, &s1, &t0, &t1);
-  if (ret)
+  /* Render text, glyphs are only rasterized the first time they are drawn */
+  pango_layout_get_pixel_extents (layout, NULL, &logical_rect);
+  if (logical_rect.width > 0 && logical_rect.height > 0)
     {
       glPushMatrix ();
         glTranslatef (0.0, -text_z * TANGENT, text_z + 2.0);
         glRotatef (ANGLE, 1.0, 0.0, 0.0);
 
-        glEnable (GL_TEXTURE_2D);
-        glEnable (GL_BLEND);
-        glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-        glBindTexture (GL_TEXTURE_2D, texture);
-        glTexEnvi (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-        glBegin (GL_QUADS);
-          glTexCoord2f (s0, t0); glVertex3f (-1.0, 0.0,  1.0);
-          glTexCoord2f (s0, t1); glVertex3f (-1.0, 0.0, -1.0);
-          glTexCoord2f (s1, t1); glVertex3f ( 1.0, 0.0, -1.0);
-          glTexCoord2f (s1, t0); glVertex3f ( 1.0, 0.0,  1.0);
-        glEnd ();
+        /* Layout pixels onto the 2x2 square in the y = 0 plane. */
+        glTranslatef (-1.0, 0.0, -1.0);
+        glScalef (2.0 / logical_rect.width, 1.0, 2.0 / logical_rect.height);
+        glRotatef (90.0, 1.0, 0.0, 0.0);
 
-        glDisable (GL_BLEND);
-        glDisable (GL_TEXTURE_2D);
+        glyph_atlas_add_layout (atlas, layout,
+                                -logical_rect.x, -logical_rect.y,
+                                text_color);
+        glyph_atlas_flush (atlas);
 
       glPopMatrix ();
     }
@@ -397,7 +197,8 @@ unrealize (GtkWidget *widget,
   if (!gtk_widget_begin_gl (widget))
     return;
 
-  gl_tex_delete_texture ();
+  glyph_atlas_free (atlas);
+  atlas = NULL;
 
   gtk_widget_end_gl (widget, FALSE);
   /*** OpenGL END ***/
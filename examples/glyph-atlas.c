@@ -0,0 +1,602 @@
+/* -*- coding: utf-8 -*- */
+/*
+ * glyph-atlas.c:
+ * Glyph cache texture for drawing PangoFT2 layouts with OpenGL.
+ *
+ * Each glyph is rasterized with PangoFT2 the first time it is drawn
+ * and packed into one alpha texture with a skyline packer, which keeps
+ * the top edge of the used area as a list of horizontal segments and
+ * puts every new glyph as low as it fits.  glyph_atlas_add_layout()
+ * then only appends a textured quad per glyph to a vertex array, and
+ * glyph_atlas_flush() draws all of the queued quads with one
+ * glDrawArrays, from a buffer object when there is one.  When the
+ * texture is full the queued quads are drawn early, from within
+ * glyph_atlas_add_layout(), and the cache starts over.
+ */
+
+#include <stdio.h>
+
+#include "glyph-atlas.h"
+
+#include <gdk/gdkgl.h>
+
+#ifdef G_OS_WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+#endif
+
+#ifdef GDK_WINDOWING_QUARTZ
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER         0x8892
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW          0x88E0
+#endif
+
+#define GLYPH_PADDING   1       /* transparent texels around each glyph */
+#define VERTEX_SIZE     8       /* x, y, s, t, r, g, b, a */
+
+typedef void (APIENTRY *GenBuffersProc)    (GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *DeleteBuffersProc) (GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY *BindBufferProc)    (GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferDataProc)    (GLenum target, gssize size,
+                                            const void *data, GLenum usage);
+
+typedef struct _Glyph Glyph;
+
+struct _Glyph
+{
+  PangoFont  *font;
+  PangoGlyph  glyph;
+
+  int x, y;                     /* in the texture */
+  int width, height;            /* 0 for glyphs without ink */
+  int left, top;                /* from the glyph origin, in pixels */
+};
+
+typedef struct
+{
+  int x, y;
+  int width;
+} Skyline;
+
+struct _GlyphAtlas
+{
+  int               size;
+  GLuint            texture;
+
+  GHashTable       *glyphs;       /* Glyph -> itself, keyed by font and glyph */
+  GArray           *skyline;      /* Skyline, left to right across the texture */
+  GArray           *vertices;     /* GLfloat, VERTEX_SIZE per vertex */
+  PangoGlyphString *glyph_string; /* for rasterizing one glyph */
+
+  gboolean          have_buffers;
+  GLuint            buffer;
+
+  GenBuffersProc    GenBuffers;
+  DeleteBuffersProc DeleteBuffers;
+  BindBufferProc    BindBuffer;
+  BufferDataProc    BufferData;
+};
+
+static guint
+glyph_hash (gconstpointer key)
+{
+  const Glyph *glyph = key;
+
+  return g_direct_hash (glyph->font) ^ (glyph->glyph * 2654435761u);
+}
+
+static gboolean
+glyph_equal (gconstpointer a,
+             gconstpointer b)
+{
+  const Glyph *glyph_a = a;
+  const Glyph *glyph_b = b;
+
+  return glyph_a->font == glyph_b->font && glyph_a->glyph == glyph_b->glyph;
+}
+
+static void
+glyph_free (gpointer data)
+{
+  Glyph *glyph = data;
+
+  g_object_unref (glyph->font);
+  g_free (glyph);
+}
+
+static void
+glyph_atlas_reset (GlyphAtlas *atlas)
+{
+  Skyline floor = { 0, 0, 0 };
+
+  floor.width = atlas->size;
+  g_array_set_size (atlas->skyline, 0);
+  g_array_append_val (atlas->skyline, floor);
+
+  g_hash_table_remove_all (atlas->glyphs);
+}
+
+/* Finds the lowest free place for a width x height rectangle, the
+ * left-most one of those, and raises the skyline over it. */
+static gboolean
+skyline_pack (GlyphAtlas *atlas,
+              int         width,
+              int         height,
+              int        *x,
+              int        *y)
+{
+  GArray *skyline = atlas->skyline;
+  Skyline *s, *t;
+  int best = -1, best_y = atlas->size;
+  int top, left;
+  guint i, j;
+
+  for (i = 0; i < skyline->len; i++)
+    {
+      s = &g_array_index (skyline, Skyline, i);
+      if (s->x + width > atlas->size)
+        break;
+
+      /* the highest segment under the rectangle */
+      top = 0;
+      for (j = i, left = width; left > 0; j++)
+        {
+          t = &g_array_index (skyline, Skyline, j);
+          top = MAX (top, t->y);
+          left -= t->width;
+        }
+
+      if (top + height <= atlas->size && top < best_y)
+        {
+          best = i;
+          best_y = top;
+        }
+    }
+
+  if (best < 0)
+    return FALSE;
+
+  *x = g_array_index (skyline, Skyline, best).x;
+  *y = best_y;
+
+  {
+    Skyline raised;
+
+    raised.x = *x;
+    raised.y = best_y + height;
+    raised.width = width;
+    g_array_insert_val (skyline, best, raised);
+  }
+
+  /* cut the segments now under the rectangle */
+  i = best + 1;
+  while (i < skyline->len)
+    {
+      s = &g_array_index (skyline, Skyline, i);
+      left = *x + width - s->x;
+      if (left <= 0)
+        break;
+
+      if (left >= s->width)
+        {
+          g_array_remove_index (skyline, i);
+        }
+      else
+        {
+          s->x += left;
+          s->width -= left;
+          break;
+        }
+    }
+
+  /* and merge neighbours at the same height */
+  i = 0;
+  while (i + 1 < skyline->len)
+    {
+      s = &g_array_index (skyline, Skyline, i);
+      t = &g_array_index (skyline, Skyline, i + 1);
+      if (s->y == t->y)
+        {
+          s->width += t->width;
+          g_array_remove_index (skyline, i + 1);
+        }
+      else
+        {
+          i++;
+        }
+    }
+
+  return TRUE;
+}
+
+static void
+upload_glyph (GlyphAtlas *atlas,
+              Glyph      *glyph)
+{
+  FT_Bitmap bitmap;
+  GLint texture = 0;
+
+  bitmap.rows = glyph->height;
+  bitmap.width = glyph->width;
+  bitmap.pitch = glyph->width;
+  bitmap.buffer = g_malloc0 (glyph->width * glyph->height);
+  bitmap.num_grays = 256;
+  bitmap.pixel_mode = FT_PIXEL_MODE_GRAY;
+
+  atlas->glyph_string->glyphs[0].glyph = glyph->glyph;
+  pango_ft2_render (&bitmap, glyph->font, atlas->glyph_string,
+                    -glyph->left, -glyph->top);
+
+  glGetIntegerv (GL_TEXTURE_BINDING_2D, &texture);
+  glPushClientAttrib (GL_CLIENT_PIXEL_STORE_BIT);
+
+  glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+  glPixelStorei (GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei (GL_UNPACK_SKIP_ROWS, 0);
+  glPixelStorei (GL_UNPACK_SKIP_PIXELS, 0);
+
+  glBindTexture (GL_TEXTURE_2D, atlas->texture);
+  glTexSubImage2D (GL_TEXTURE_2D, 0,
+                   glyph->x, glyph->y, glyph->width, glyph->height,
+                   GL_ALPHA, GL_UNSIGNED_BYTE,
+                   bitmap.buffer);
+
+  glPopClientAttrib ();
+  glBindTexture (GL_TEXTURE_2D, texture);
+
+  g_free (bitmap.buffer);
+}
+
+static Glyph *
+lookup_glyph (GlyphAtlas *atlas,
+              PangoFont  *font,
+              PangoGlyph  glyph)
+{
+  Glyph key, *entry;
+  PangoRectangle ink;
+
+  key.font = font;
+  key.glyph = glyph;
+  entry = g_hash_table_lookup (atlas->glyphs, &key);
+  if (entry != NULL)
+    return entry;
+
+  pango_font_get_glyph_extents (font, glyph, &ink, NULL);
+
+  entry = g_new0 (Glyph, 1);
+  entry->font = g_object_ref (font);
+  entry->glyph = glyph;
+
+  if (ink.width > 0 && ink.height > 0)
+    {
+      entry->left = PANGO_PIXELS_FLOOR (ink.x) - GLYPH_PADDING;
+      entry->top = PANGO_PIXELS_FLOOR (ink.y) - GLYPH_PADDING;
+      entry->width = PANGO_PIXELS_CEIL (ink.x + ink.width) + GLYPH_PADDING - entry->left;
+      entry->height = PANGO_PIXELS_CEIL (ink.y + ink.height) + GLYPH_PADDING - entry->top;
+
+      if (entry->width > atlas->size || entry->height > atlas->size)
+        {
+          /* Would never fit; do not throw the other glyphs out for it. */
+          entry->width = entry->height = 0;
+        }
+      else if (!skyline_pack (atlas, entry->width, entry->height, &entry->x, &entry->y))
+        {
+          /* Full: draw the quads using the old glyphs and start over. */
+          glyph_atlas_flush (atlas);
+          glyph_atlas_reset (atlas);
+
+          if (!skyline_pack (atlas, entry->width, entry->height, &entry->x, &entry->y))
+            entry->width = entry->height = 0;
+        }
+
+      if (entry->width > 0)
+        upload_glyph (atlas, entry);
+    }
+
+  g_hash_table_insert (atlas->glyphs, entry, entry);
+
+  return entry;
+}
+
+static void
+add_glyph (GlyphAtlas  *atlas,
+           PangoFont   *font,
+           PangoGlyph   glyph,
+           float        x,
+           float        y,
+           const float  color[4])
+{
+  Glyph *entry;
+  GLfloat quad[4 * VERTEX_SIZE];
+  GLfloat x0, y0, x1, y1, s0, t0, s1, t1;
+  int i;
+
+  entry = lookup_glyph (atlas, font, glyph);
+  if (entry->width == 0)
+    return;
+
+  x0 = x + entry->left;
+  y0 = y + entry->top;
+  x1 = x0 + entry->width;
+  y1 = y0 + entry->height;
+
+  s0 = (GLfloat) entry->x / atlas->size;
+  t0 = (GLfloat) entry->y / atlas->size;
+  s1 = (GLfloat) (entry->x + entry->width) / atlas->size;
+  t1 = (GLfloat) (entry->y + entry->height) / atlas->size;
+
+  quad[0]  = x0; quad[1]  = y0; quad[2]  = s0; quad[3]  = t0;
+  quad[8]  = x0; quad[9]  = y1; quad[10] = s0; quad[11] = t1;
+  quad[16] = x1; quad[17] = y1; quad[18] = s1; quad[19] = t1;
+  quad[24] = x1; quad[25] = y0; quad[26] = s1; quad[27] = t0;
+
+  for (i = 0; i < 4; i++)
+    {
+      quad[i * VERTEX_SIZE + 4] = color[0];
+      quad[i * VERTEX_SIZE + 5] = color[1];
+      quad[i * VERTEX_SIZE + 6] = color[2];
+      quad[i * VERTEX_SIZE + 7] = color[3];
+    }
+
+  g_array_append_vals (atlas->vertices, quad, 4 * VERTEX_SIZE);
+}
+
+/**
+ * glyph_atlas_new:
+ * @size: width and height of the glyph texture, in texels.
+ *
+ * Creates a glyph atlas in the current OpenGL context, which has to be
+ * current for the other glyph_atlas_ calls as well.  @size is reduced
+ * to GL_MAX_TEXTURE_SIZE if need be.
+ *
+ * Return value: the new atlas.
+ **/
+GlyphAtlas *
+glyph_atlas_new (int size)
+{
+  GlyphAtlas *atlas;
+  GLint max_size = 0;
+  GLvoid *texels;
+  const char *version;
+  const char *suffix = NULL;
+  int major = 0, minor = 0;
+  char name[32];
+
+  g_return_val_if_fail (size > 0, NULL);
+
+  glGetIntegerv (GL_MAX_TEXTURE_SIZE, &max_size);
+  if (max_size > 0)
+    size = MIN (size, max_size);
+
+  atlas = g_new0 (GlyphAtlas, 1);
+  atlas->size = size;
+  atlas->glyphs = g_hash_table_new_full (glyph_hash, glyph_equal,
+                                         glyph_free, NULL);
+  atlas->skyline = g_array_new (FALSE, FALSE, sizeof (Skyline));
+  atlas->vertices = g_array_new (FALSE, FALSE, sizeof (GLfloat));
+  atlas->glyph_string = pango_glyph_string_new ();
+  pango_glyph_string_set_size (atlas->glyph_string, 1);
+  atlas->glyph_string->glyphs[0].geometry.width = 0;
+  atlas->glyph_string->glyphs[0].geometry.x_offset = 0;
+  atlas->glyph_string->glyphs[0].geometry.y_offset = 0;
+  atlas->glyph_string->glyphs[0].attr.is_cluster_start = 1;
+  atlas->glyph_string->log_clusters[0] = 0;
+
+  glyph_atlas_reset (atlas);
+
+  /* start with a transparent texture */
+  texels = g_malloc0 (size * size);
+
+  glGenTextures (1, &atlas->texture);
+  glBindTexture (GL_TEXTURE_2D, atlas->texture);
+  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glPixelStorei (GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D (GL_TEXTURE_2D, 0, GL_ALPHA,
+                size, size, 0,
+                GL_ALPHA, GL_UNSIGNED_BYTE,
+                texels);
+  glPixelStorei (GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture (GL_TEXTURE_2D, 0);
+
+  g_free (texels);
+
+  /* buffer objects are GL 1.5, or ARB_vertex_buffer_object */
+  version = (const char *) glGetString (GL_VERSION);
+  if (version != NULL && sscanf (version, "%d.%d", &major, &minor) == 2 &&
+      (major > 1 || (major == 1 && minor >= 5)))
+    suffix = "";
+  else if (gdk_gl_query_gl_extension ("GL_ARB_vertex_buffer_object"))
+    suffix = "ARB";
+
+  if (suffix != NULL)
+    {
+      g_snprintf (name, sizeof (name), "glGenBuffers%s", suffix);
+      atlas->GenBuffers = (GenBuffersProc) gdk_gl_get_proc_address (name);
+      g_snprintf (name, sizeof (name), "glDeleteBuffers%s", suffix);
+      atlas->DeleteBuffers = (DeleteBuffersProc) gdk_gl_get_proc_address (name);
+      g_snprintf (name, sizeof (name), "glBindBuffer%s", suffix);
+      atlas->BindBuffer = (BindBufferProc) gdk_gl_get_proc_address (name);
+      g_snprintf (name, sizeof (name), "glBufferData%s", suffix);
+      atlas->BufferData = (BufferDataProc) gdk_gl_get_proc_address (name);
+
+      atlas->have_buffers = (atlas->GenBuffers != NULL &&
+                             atlas->DeleteBuffers != NULL &&
+                             atlas->BindBuffer != NULL &&
+                             atlas->BufferData != NULL);
+    }
+
+  if (atlas->have_buffers)
+    atlas->GenBuffers (1, &atlas->buffer);
+
+  return atlas;
+}
+
+/**
+ * glyph_atlas_free:
+ * @atlas: a #GlyphAtlas.
+ *
+ * Frees @atlas and its texture, dropping any quads not yet drawn.
+ **/
+void
+glyph_atlas_free (GlyphAtlas *atlas)
+{
+  g_return_if_fail (atlas != NULL);
+
+  if (atlas->have_buffers)
+    atlas->DeleteBuffers (1, &atlas->buffer);
+  glDeleteTextures (1, &atlas->texture);
+
+  g_hash_table_destroy (atlas->glyphs);
+  g_array_free (atlas->skyline, TRUE);
+  g_array_free (atlas->vertices, TRUE);
+  pango_glyph_string_free (atlas->glyph_string);
+
+  g_free (atlas);
+}
+
+/**
+ * glyph_atlas_add_layout:
+ * @atlas: a #GlyphAtlas.
+ * @layout: a #PangoLayout from a PangoFT2 context.
+ * @x: x position of the layout, in pixels.
+ * @y: y position of the layout, in pixels.
+ * @color: RGBA text color.
+ *
+ * Queues quads drawing @layout with its top left corner at (@x, @y) in
+ * the z = 0 plane, one pixel per unit with y growing downwards.  Glyphs
+ * not in @atlas yet are rasterized and added to it.  Glyphs larger
+ * than the texture are skipped.  Normally nothing is drawn until
+ * glyph_atlas_flush(), so the modelview matrix in effect then applies
+ * to all queued layouts.
+ *
+ * The exception is a full texture: the quads queued so far are drawn
+ * right away, with the modelview matrix and other state current during
+ * this call, before the texture is cleared for the new glyphs.  Callers
+ * that change the modelview matrix between layouts should flush before
+ * each change, or use an atlas large enough for all glyphs of a frame.
+ **/
+void
+glyph_atlas_add_layout (GlyphAtlas  *atlas,
+                        PangoLayout *layout,
+                        float        x,
+                        float        y,
+                        const float  color[4])
+{
+  PangoLayoutIter *iter;
+
+  g_return_if_fail (atlas != NULL);
+  g_return_if_fail (PANGO_IS_LAYOUT (layout));
+
+  iter = pango_layout_get_iter (layout);
+
+  do
+    {
+      PangoLayoutRun *run;
+      PangoRectangle logical_rect;
+      int baseline, pen;
+      int i;
+
+      run = pango_layout_iter_get_run_readonly (iter);
+      if (run == NULL)
+        continue;               /* end of a line */
+
+      pango_layout_iter_get_run_extents (iter, NULL, &logical_rect);
+      baseline = pango_layout_iter_get_baseline (iter);
+
+      pen = logical_rect.x;
+      for (i = 0; i < run->glyphs->num_glyphs; i++)
+        {
+          PangoGlyphInfo *info = &run->glyphs->glyphs[i];
+
+          if (info->glyph != PANGO_GLYPH_EMPTY &&
+              !(info->glyph & PANGO_GLYPH_UNKNOWN_FLAG))
+            add_glyph (atlas, run->item->analysis.font, info->glyph,
+                       x + PANGO_PIXELS (pen + info->geometry.x_offset),
+                       y + PANGO_PIXELS (baseline + info->geometry.y_offset),
+                       color);
+
+          pen += info->geometry.width;
+        }
+    }
+  while (pango_layout_iter_next_run (iter));
+
+  pango_layout_iter_free (iter);
+}
+
+/**
+ * glyph_atlas_flush:
+ * @atlas: a #GlyphAtlas.
+ *
+ * Draws all quads queued by glyph_atlas_add_layout() with one
+ * glDrawArrays call, blended and unlit.
+ **/
+void
+glyph_atlas_flush (GlyphAtlas *atlas)
+{
+  GLsizei stride = VERTEX_SIZE * sizeof (GLfloat);
+  gsize vertices = 0;
+
+  g_return_if_fail (atlas != NULL);
+
+  if (atlas->vertices->len == 0)
+    return;
+
+  glPushAttrib (GL_CURRENT_BIT | GL_ENABLE_BIT |
+                GL_COLOR_BUFFER_BIT | GL_TEXTURE_BIT);
+  glPushClientAttrib (GL_CLIENT_VERTEX_ARRAY_BIT);
+
+  glDisable (GL_LIGHTING);
+  glEnable (GL_TEXTURE_2D);
+  glEnable (GL_BLEND);
+  glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glBindTexture (GL_TEXTURE_2D, atlas->texture);
+  glTexEnvi (GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+
+  if (atlas->have_buffers)
+    {
+      atlas->BindBuffer (GL_ARRAY_BUFFER, atlas->buffer);
+      atlas->BufferData (GL_ARRAY_BUFFER,
+                         atlas->vertices->len * sizeof (GLfloat),
+                         atlas->vertices->data, GL_STREAM_DRAW);
+    }
+  else
+    {
+      vertices = GPOINTER_TO_SIZE (atlas->vertices->data);
+    }
+
+  glEnableClientState (GL_VERTEX_ARRAY);
+  glEnableClientState (GL_TEXTURE_COORD_ARRAY);
+  glEnableClientState (GL_COLOR_ARRAY);
+  /* offsets into the buffer object, or client memory addresses */
+  glVertexPointer (2, GL_FLOAT, stride,
+                   GSIZE_TO_POINTER (vertices));
+  glTexCoordPointer (2, GL_FLOAT, stride,
+                     GSIZE_TO_POINTER (vertices + 2 * sizeof (GLfloat)));
+  glColorPointer (4, GL_FLOAT, stride,
+                  GSIZE_TO_POINTER (vertices + 4 * sizeof (GLfloat)));
+
+  glDrawArrays (GL_QUADS, 0, atlas->vertices->len / VERTEX_SIZE);
+
+  if (atlas->have_buffers)
+    atlas->BindBuffer (GL_ARRAY_BUFFER, 0);
+
+  glPopClientAttrib ();
+  glPopAttrib ();
+
+  g_array_set_size (atlas->vertices, 0);
+}
@@ -0,0 +1,30 @@
+/* -*- coding: utf-8 -*- */
+/*
+ * glyph-atlas.h:
+ * Glyph cache texture for drawing PangoFT2 layouts with OpenGL.
+ */
+
+#ifndef __GLYPH_ATLAS_H__
+#define __GLYPH_ATLAS_H__
+
+#include <pango/pangoft2.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GlyphAtlas GlyphAtlas;
+
+GlyphAtlas *glyph_atlas_new        (int          size);
+
+void        glyph_atlas_free       (GlyphAtlas  *atlas);
+
+void        glyph_atlas_add_layout (GlyphAtlas  *atlas,
+                                    PangoLayout *layout,
+                                    float        x,
+                                    float        y,
+                                    const float  color[4]);
+
+void        glyph_atlas_flush      (GlyphAtlas  *atlas);
+
+G_END_DECLS
+
+#endif /* __GLYPH_ATLAS_H__ */
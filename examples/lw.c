@@ -18,6 +18,7 @@
 
 
 #include "lw.h"
+#include <gdk/gdkgl.h>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
@@ -35,55 +36,60 @@
 #define ID_POLS MK_ID('P','O','L','S')
 #define ID_COLR MK_ID('C','O','L','R')
 
-static gint32 read_char(FILE *f)
-{
-  int c = fgetc(f);
-  g_return_val_if_fail(c != EOF, 0);
-  return c;
-}
+/*
+ * The file is mapped and every chunk is parsed straight from the mapping
+ * with explicit bounds, instead of being read a byte at a time.  All face
+ * indices live in one arena (lwObject.index); a face only records where
+ * its run starts and how long it is.
+ */
 
-static gint32 read_short(FILE *f)
+static guint32 get_u32(const guchar *p)
 {
-  return (read_char(f)<<8) | read_char(f);
+  return ((guint32)p[0]<<24) | ((guint32)p[1]<<16) | ((guint32)p[2]<<8) | p[3];
 }
 
-static gint32 read_long(FILE *f)
+static guint16 get_u16(const guchar *p)
 {
-  return (read_char(f)<<24) | (read_char(f)<<16) | (read_char(f)<<8) | read_char(f);
+  return (guint16)((p[0]<<8) | p[1]);
 }
 
-static GLfloat read_float(FILE *f)
+/* copy n big-endian 32 bit words, a loop the compiler turns into SIMD */
+static void copy_be32(guchar *dst, const guchar *src, gsize n)
 {
-  gint32 x = read_long(f);
-  return *(GLfloat*)&x;
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+  memcpy(dst, src, n*4);
+#else
+  gsize i;
+  for (i=0; i<n; i++, dst+=4, src+=4) {
+    dst[0] = src[3];
+    dst[1] = src[2];
+    dst[2] = src[1];
+    dst[3] = src[0];
+  }
+#endif
 }
 
-static gint read_string(FILE *f, char *s)
+static gsize read_string(const guchar *p, gsize nbytes, char *s)
 {
-  gint c;
-  gint cnt = 0;
-  do {
-    c = read_char(f);
-    if (cnt < LW_MAX_NAME_LEN)
-      s[cnt] = c;
-    else
-      s[LW_MAX_NAME_LEN-1] = 0;
-    cnt++;
-  } while (c != 0);
+  const guchar *nul = memchr(p, 0, nbytes);
+  gsize len = nul ? (gsize)(nul - p) : nbytes;
+  gsize cnt = len + 1;
+
+  memcpy(s, p, MIN(len, LW_MAX_NAME_LEN-1));
+  s[MIN(len, LW_MAX_NAME_LEN-1)] = 0;
   /* if length of string (including \0) is odd skip another byte */
-  if (cnt%2) {
-    read_char(f);
+  if (cnt%2)
     cnt++;
-  }
   return cnt;
 }
 
-static void read_srfs(FILE *f, gint nbytes, lwObject *lwo)
+static void read_srfs(const guchar *p, gsize nbytes, lwObject *lwo)
 {
   int guess_cnt = lwo->material_cnt;
 
   while (nbytes > 0) {
     lwMaterial *material;
+    gsize cnt;
 
     /* allocate more memory for materials if needed */
     if (guess_cnt <= lwo->material_cnt) {
@@ -93,7 +99,9 @@ static void read_srfs(FILE *f, gint nbytes, lwObject *lwo)
     material = lwo->material + lwo->material_cnt++;
 
     /* read name */
-    nbytes -= read_string(f,material->name);
+    cnt = MIN(read_string(p, nbytes, material->name), nbytes);
+    p += cnt;
+    nbytes -= cnt;
 
     /* defaults */
     material->r = 0.7;
@@ -104,14 +112,17 @@ static void read_srfs(FILE *f, gint nbytes, lwObject *lwo)
 }
 
 
-static void read_surf(FILE *f, gint nbytes, lwObject *lwo)
+static void read_surf(const guchar *p, gsize nbytes, lwObject *lwo)
 {
   int i;
   char name[LW_MAX_NAME_LEN];
   lwMaterial *material = NULL;
+  gsize cnt;
 
   /* read surface name */
-  nbytes -= read_string(f,name);
+  cnt = MIN(read_string(p, nbytes, name), nbytes);
+  p += cnt;
+  nbytes -= cnt;
 
   /* find material */
   for (i=0; i< lwo->material_cnt; i++) {
@@ -123,87 +134,120 @@ static void read_surf(FILE *f, gint nbytes, lwObject *lwo)
   g_return_if_fail(material != NULL);
 
   /* read values */
-  while (nbytes > 0) {
-    gint id = read_long(f);
-    gint len = read_short(f);
-    nbytes -= 6 + len + (len%2);
+  while (nbytes >= 6) {
+    guint32 id = get_u32(p);
+    gsize len = get_u16(p+4);
+    gsize skip = 6 + len + (len%2);
+
+    if (skip > nbytes)
+      break;
 
     switch (id) {
     case ID_COLR:
-      material->r = read_char(f) / 255.0;
-      material->g = read_char(f) / 255.0;
-      material->b = read_char(f) / 255.0;
-      read_char(f); /* dummy */
+      if (len >= 3) {
+        material->r = p[6] / 255.0;
+        material->g = p[7] / 255.0;
+        material->b = p[8] / 255.0;
+      }
       break;
-    default:
-      fseek(f, len+(len%2), SEEK_CUR);
     }
+    p += skip;
+    nbytes -= skip;
   }
 }
 
 
-static void read_pols(FILE *f, int nbytes, lwObject *lwo)
+/*
+ * Walk a POLS chunk.  The first pass (face == NULL) only counts faces and
+ * indices so the second pass can fill arrays of the exact size.
+ * Returns FALSE if the chunk is truncated.
+ */
+static gboolean walk_pols(const guchar *p, gsize nbytes,
+                          lwFace *face, GLushort *index, int index_first,
+                          int *face_cnt, int *index_cnt)
 {
-  int guess_cnt = lwo->face_cnt;
-
-  while (nbytes > 0) {
-    lwFace *face;
-    int i;
+  const guchar *end = p + nbytes;
 
-    /* allocate more memory for polygons if necessary */
-    if (guess_cnt <= lwo->face_cnt) {
-      guess_cnt += guess_cnt + 4;
-      lwo->face = g_realloc(lwo->face, sizeof(lwFace)*guess_cnt);
-    }
-    face = lwo->face + lwo->face_cnt++;
+  *face_cnt = 0;
+  *index_cnt = 0;
 
-    /* number of points in this face */
-    face->index_cnt = read_short(f);
-    nbytes -= 2;
+  while (end - p >= 2) {
+    int cnt = get_u16(p);
+    int material;
+    int i;
 
-    /* allocate space for points */
-    face->index = g_malloc0(sizeof(int)*face->index_cnt);
+    /* number of points in this face, the points and the material */
+    if ((gsize)(end - p) < 2 + (gsize)cnt*2 + 2)
+      return FALSE;
+    p += 2;
 
-    /* read points in */
-    for (i=0; i<face->index_cnt; i++) {
-      face->index[i] = read_short(f);
-      nbytes -= 2;
+    if (face) {
+      face->index_cnt = cnt;
+      face->index_first = index_first + *index_cnt;
+      for (i=0; i<cnt; i++)
+        index[*index_cnt + i] = get_u16(p + i*2);
     }
+    p += cnt*2;
+    *index_cnt += cnt;
 
-    /* read surface material */
-    face->material = read_short(f);
-    nbytes -= 2;
+    material = (gint16) get_u16(p);
+    p += 2;
 
-    /* skip over detail  polygons */
-    if (face->material < 0) {
+    /* skip over detail polygons */
+    if (material < 0) {
       int det_cnt;
-      face->material = -face->material;
-      det_cnt = read_short(f);
-      nbytes -= 2;
+      material = -material;
+      if (end - p < 2)
+        return FALSE;
+      det_cnt = get_u16(p);
+      p += 2;
       while (det_cnt-- > 0) {
-	int cnt = read_short(f);
-	fseek(f, cnt*2+2, SEEK_CUR);
-	nbytes -= cnt*2+2;
+        gsize det_bytes;
+        if (end - p < 2)
+          return FALSE;
+        det_bytes = 2 + get_u16(p)*2 + 2;
+        if ((gsize)(end - p) < det_bytes)
+          return FALSE;
+        p += det_bytes;
       }
     }
-    face->material -= 1;
+
+    if (face) {
+      face->material = material - 1;
+      face++;
+    }
+    (*face_cnt)++;
   }
-  /* readjust to true size */
-  lwo->face = g_realloc(lwo->face, sizeof(lwFace)*lwo->face_cnt);
+  return TRUE;
 }
 
+static gboolean read_pols(const guchar *p, gsize nbytes, lwObject *lwo)
+{
+  int face_cnt, index_cnt;
+
+  if (!walk_pols(p, nbytes, NULL, NULL, 0, &face_cnt, &index_cnt))
+    return FALSE;
 
+  lwo->face = g_renew(lwFace, lwo->face, lwo->face_cnt + face_cnt);
+  lwo->index = g_renew(GLushort, lwo->index, lwo->index_cnt + index_cnt);
 
-static void read_pnts(FILE *f, gint nbytes, lwObject *lwo)
+  walk_pols(p, nbytes, lwo->face + lwo->face_cnt,
+            lwo->index + lwo->index_cnt, lwo->index_cnt,
+            &face_cnt, &index_cnt);
+
+  lwo->face_cnt += face_cnt;
+  lwo->index_cnt += index_cnt;
+  return TRUE;
+}
+
+
+
+static void read_pnts(const guchar *p, gsize nbytes, lwObject *lwo)
 {
-  int i;
+  g_free(lwo->vertex);
   lwo->vertex_cnt = nbytes / 12;
-  lwo->vertex = g_malloc0(sizeof(GLfloat)*lwo->vertex_cnt*3);
-  for (i=0; i<lwo->vertex_cnt; i++) {
-    lwo->vertex[i*3+0] = read_float(f);
-    lwo->vertex[i*3+1] = read_float(f);
-    lwo->vertex[i*3+2] = read_float(f);
-  }
+  lwo->vertex = g_new(GLfloat, lwo->vertex_cnt*3);
+  copy_be32((guchar *)lwo->vertex, p, (gsize)lwo->vertex_cnt*3);
 }
 
 
@@ -215,11 +259,13 @@ gint lw_is_lwobject(const char *lw_file)
 {
   FILE *f = fopen(lw_file, "rb");
   if (f) {
-    gint32 form = read_long(f);
-    gint32 nlen = read_long(f);
-    gint32 lwob = read_long(f);
+    guchar header[12];
+    gsize n = fread(header, 1, sizeof(header), f);
     fclose(f);
-    if (form == ID_FORM && nlen != 0 && lwob == ID_LWOB)
+    if (n == sizeof(header) &&
+        get_u32(header) == ID_FORM &&
+        get_u32(header+4) != 0 &&
+        get_u32(header+8) == ID_LWOB)
       return TRUE;
   }
   return FALSE;
@@ -228,31 +274,33 @@ gint lw_is_lwobject(const char *lw_file)
 
 lwObject *lw_object_read(const char *lw_file)
 {
-  FILE *f = NULL;
+  GMappedFile *file;
+  GError *error = NULL;
   lwObject *lw_object = NULL;
-
-  gint32 form_bytes = 0;
-  gint32 read_bytes = 0;
-
-  /* open file */
-  f = fopen(lw_file, "rb");
-  if (f == NULL) {
-    g_warning("can't open file %s", lw_file);
+  const guchar *data;
+  gsize size, end, pos;
+
+  /* map file */
+  file = g_mapped_file_new(lw_file, FALSE, &error);
+  if (file == NULL) {
+    g_warning("can't open file %s: %s", lw_file, error->message);
+    g_error_free(error);
     return NULL;
   }
+  data = (const guchar *) g_mapped_file_get_contents(file);
+  size = g_mapped_file_get_length(file);
 
   /* check for headers */
-  if (read_long(f) != ID_FORM) {
+  if (size < 8 || get_u32(data) != ID_FORM) {
     g_warning("file %s is not an IFF file", lw_file);
-    fclose(f);
+    g_mapped_file_unref(file);
     return NULL;
   }
-  form_bytes = read_long(f);
-  read_bytes += 4;
+  end = MIN(size, 8 + (gsize)get_u32(data+4));
 
-  if (read_long(f) != ID_LWOB) {
+  if (end < 12 || get_u32(data+8) != ID_LWOB) {
     g_warning("file %s is not a LWOB file", lw_file);
-    fclose(f);
+    g_mapped_file_unref(file);
     return NULL;
   }
 
@@ -260,30 +308,37 @@ lwObject *lw_object_read(const char *lw_file)
   lw_object = g_malloc0(sizeof(lwObject));
 
   /* read chunks */
-  while (read_bytes < form_bytes) {
-    gint32  id     = read_long(f);
-    gint32  nbytes = read_long(f);
-    read_bytes += 8 + nbytes + (nbytes%2);
+  for (pos = 12; end - pos >= 8; ) {
+    guint32 id     = get_u32(data+pos);
+    gsize   nbytes = get_u32(data+pos+4);
+    const guchar *chunk = data + pos + 8;
+
+    if (nbytes > end - pos - 8) {
+      g_warning("file %s is truncated", lw_file);
+      break;
+    }
 
     switch (id) {
     case ID_PNTS:
-      read_pnts(f, nbytes, lw_object);
+      read_pnts(chunk, nbytes, lw_object);
       break;
     case ID_POLS:
-      read_pols(f, nbytes, lw_object);
+      if (!read_pols(chunk, nbytes, lw_object))
+        g_warning("file %s has a truncated POLS chunk", lw_file);
       break;
     case ID_SRFS:
-      read_srfs(f, nbytes, lw_object);
+      read_srfs(chunk, nbytes, lw_object);
       break;
     case ID_SURF:
-      read_surf(f, nbytes, lw_object);
+      read_surf(chunk, nbytes, lw_object);
       break;
-    default:
-      fseek(f, nbytes + (nbytes%2), SEEK_CUR);
     }
+    pos += 8 + nbytes + (nbytes%2);
+    if (pos > end)
+      break;
   }
 
-  fclose(f);
+  g_mapped_file_unref(file);
   return lw_object;
 }
 
@@ -297,12 +352,8 @@ void lw_object_free(lwObject *lw_object)
 {
   g_return_if_fail(lw_object != NULL);
  
-  if (lw_object->face) {
-    int i;
-    for (i=0; i<lw_object->face_cnt; i++)
-      g_free(lw_object->face[i].index);
-    g_free(lw_object->face);
-  }
+  g_free(lw_object->face);
+  g_free(lw_object->index);
   g_free(lw_object->material);
   g_free(lw_object->vertex);
   g_free(lw_object);
@@ -312,9 +363,43 @@ void lw_object_free(lwObject *lw_object)
 
 
 
-#define PX(i) (lw_object->vertex[face->index[i]*3+0])
-#define PY(i) (lw_object->vertex[face->index[i]*3+1])
-#define PZ(i) (lw_object->vertex[face->index[i]*3+2])
+#define PX(i) (lw_object->vertex[index[i]*3+0])
+#define PY(i) (lw_object->vertex[index[i]*3+1])
+#define PZ(i) (lw_object->vertex[index[i]*3+2])
+
+/* unit normal of a face, FALSE for faces that can't be drawn */
+static gboolean face_normal(const lwObject *lw_object, const lwFace *face,
+                            GLfloat *n)
+{
+  const GLushort *index = lw_object->index + face->index_first;
+  GLfloat ax,ay,az,bx,by,bz,nx,ny,nz,r;
+
+  /* ignore faces with less than 3 points */
+  if (face->index_cnt < 3)
+    return FALSE;
+
+  /* calculate normal */
+  ax = PX(1) - PX(0);
+  ay = PY(1) - PY(0);
+  az = PZ(1) - PZ(0);
+
+  bx = PX(face->index_cnt-1) - PX(0);
+  by = PY(face->index_cnt-1) - PY(0);
+  bz = PZ(face->index_cnt-1) - PZ(0);
+
+  nx = ay * bz - az * by;
+  ny = az * bx - ax * bz;
+  nz = ax * by - ay * bx;
+
+  r = sqrt(nx*nx + ny*ny + nz*nz);
+  if (r < 0.000001) /* avoid division by zero */
+    return FALSE;
+  n[0] = nx / r;
+  n[1] = ny / r;
+  n[2] = nz / r;
+  return TRUE;
+}
+
 void lw_object_show(const lwObject *lw_object)
 {
   int i,j;
@@ -327,33 +412,13 @@ void lw_object_show(const lwObject *lw_object)
   g_return_if_fail(lw_object != NULL);
 
   for (i=0; i<lw_object->face_cnt; i++) {
-    GLfloat ax,ay,az,bx,by,bz,nx,ny,nz,r;
+    GLfloat n[3];
     const lwFace *face = lw_object->face+i;
+    const GLushort *index = lw_object->index + face->index_first;
 
-    /* ignore faces with less than 3 points */
-    if (face->index_cnt < 3)
+    if (!face_normal(lw_object, face, n))
       continue;
 
-    /* calculate normal */
-    ax = PX(1) - PX(0);
-    ay = PY(1) - PY(0);
-    az = PZ(1) - PZ(0);
-
-    bx = PX(face->index_cnt-1) - PX(0);
-    by = PY(face->index_cnt-1) - PY(0);
-    bz = PZ(face->index_cnt-1) - PZ(0);
-
-    nx = ay * bz - az * by;
-    ny = az * bx - ax * bz;
-    nz = ax * by - ay * bx;
-
-    r = sqrt(nx*nx + ny*ny + nz*nz);
-    if (r < 0.000001) /* avoid division by zero */
-      continue;
-    nx /= r;
-    ny /= r;
-    nz /= r;
-
     /* glBegin/glEnd */
     if (prev_index_cnt != face->index_cnt || prev_index_cnt > 4) {
       if (prev_index_cnt > 0) glEnd();
@@ -379,11 +444,11 @@ void lw_object_show(const lwObject *lw_object)
     }
 
     /* update normal if necessary */
-    if (nx != prev_nx || ny != prev_ny || nz != prev_nz) {
-      prev_nx = nx;
-      prev_ny = ny;
-      prev_nz = nz;
-      glNormal3f(nx,ny,nz);
+    if (n[0] != prev_nx || n[1] != prev_ny || n[2] != prev_nz) {
+      prev_nx = n[0];
+      prev_ny = n[1];
+      prev_nz = n[2];
+      glNormal3f(n[0],n[1],n[2]);
     }
 
     /* draw polygon/triangle/quad */
@@ -398,33 +463,551 @@ void lw_object_show(const lwObject *lw_object)
 }
 
 
-GLfloat lw_object_radius(const lwObject *lwo)
+
+/*
+ * Compiled meshes.  Faces are fanned into triangles and bucketed by
+ * material once, so drawing is one glDrawElements per material out of
+ * interleaved position/normal buffer objects.  Without buffer objects
+ * the same arrays are drawn from client memory.
+ */
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER         0x8892
+#endif
+#ifndef GL_ELEMENT_ARRAY_BUFFER
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#endif
+#ifndef GL_STATIC_DRAW
+#define GL_STATIC_DRAW          0x88E4
+#endif
+
+typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferDataProc)(GLenum target, gssize size,
+                                        const void *data, GLenum usage);
+
+/* entry points differ between contexts, so each one gets its own */
+typedef struct {
+  gboolean          supported;
+  GenBuffersProc    GenBuffers;
+  DeleteBuffersProc DeleteBuffers;
+  BindBufferProc    BindBuffer;
+  BufferDataProc    BufferData;
+} lwBufferProcs;
+
+#define LW_BUFFER_PROCS_KEY "lw-buffer-procs"
+
+#define VERTEX_STRIDE (6*sizeof(GLfloat))
+
+/* the buffer object procs of the current context, NULL without them */
+static const lwBufferProcs *get_buffer_procs(void)
+{
+  GdkGLContext *glcontext;
+  lwBufferProcs *procs;
+  const char *version;
+  const char *suffix;
+  int major = 0, minor = 0;
+  char name[32];
+
+  glcontext = gdk_gl_context_get_current();
+  g_return_val_if_fail(glcontext != NULL, NULL);
+
+  procs = g_object_get_data(G_OBJECT(glcontext), LW_BUFFER_PROCS_KEY);
+  if (procs != NULL)
+    return procs->supported ? procs : NULL;
+
+  procs = g_new0(lwBufferProcs, 1);
+  g_object_set_data_full(G_OBJECT(glcontext), LW_BUFFER_PROCS_KEY,
+                         procs, g_free);
+
+  version = (const char *) glGetString(GL_VERSION);
+  if (version != NULL && sscanf(version, "%d.%d", &major, &minor) == 2 &&
+      (major > 1 || (major == 1 && minor >= 5)))
+    suffix = "";
+  else if (gdk_gl_query_gl_extension("GL_ARB_vertex_buffer_object"))
+    suffix = "ARB";
+  else
+    return NULL;
+
+  g_snprintf(name, sizeof(name), "glGenBuffers%s", suffix);
+  procs->GenBuffers = (GenBuffersProc) gdk_gl_get_proc_address(name);
+  g_snprintf(name, sizeof(name), "glDeleteBuffers%s", suffix);
+  procs->DeleteBuffers = (DeleteBuffersProc) gdk_gl_get_proc_address(name);
+  g_snprintf(name, sizeof(name), "glBindBuffer%s", suffix);
+  procs->BindBuffer = (BindBufferProc) gdk_gl_get_proc_address(name);
+  g_snprintf(name, sizeof(name), "glBufferData%s", suffix);
+  procs->BufferData = (BufferDataProc) gdk_gl_get_proc_address(name);
+
+  procs->supported = procs->GenBuffers != NULL && procs->DeleteBuffers != NULL &&
+    procs->BindBuffer != NULL && procs->BufferData != NULL;
+  return procs->supported ? procs : NULL;
+}
+
+lwMesh *lw_object_compile(const lwObject *lw_object, gboolean smooth)
+{
+  int bucket_cnt, vertex_cnt, index_cnt;
+  int *bucket, *first, *next;
+  GLfloat *normal, *vertex;
+  GLuint *index;
+  lwMesh *mesh;
+  const lwBufferProcs *procs;
+  int i, j, b;
+
+  g_return_val_if_fail(lw_object != NULL, NULL);
+
+  /* faces with no valid material go into an extra last bucket */
+  bucket_cnt = lw_object->material_cnt + 1;
+  bucket = g_new(int, lw_object->face_cnt);
+  normal = g_new(GLfloat, lw_object->face_cnt*3);
+  first  = g_new0(int, bucket_cnt+1);
+
+  /* face normals, triangle counts per material, and vertex count */
+  vertex_cnt = smooth ? lw_object->vertex_cnt : 0;
+  for (i=0; i<lw_object->face_cnt; i++) {
+    const lwFace *face = lw_object->face+i;
+    const GLushort *face_index = lw_object->index + face->index_first;
+
+    bucket[i] = -1;
+    for (j=0; j<face->index_cnt; j++)
+      if (face_index[j] >= lw_object->vertex_cnt)
+        break;
+    if (j < face->index_cnt || !face_normal(lw_object, face, normal+i*3))
+      continue;
+
+    if (face->material >= 0 && face->material < lw_object->material_cnt)
+      bucket[i] = face->material;
+    else
+      bucket[i] = lw_object->material_cnt;
+    first[bucket[i]+1] += (face->index_cnt-2)*3;
+    if (!smooth)
+      vertex_cnt += face->index_cnt;
+  }
+  for (b=0; b<bucket_cnt; b++)
+    first[b+1] += first[b];
+  index_cnt = first[bucket_cnt];
+
+  vertex = g_new0(GLfloat, (gsize)vertex_cnt*6);
+  index  = g_new(GLuint, MAX(index_cnt, 1));
+  next   = g_new(int, bucket_cnt);
+  memcpy(next, first, sizeof(int)*bucket_cnt);
+
+  if (smooth) {
+    /* shared vertices, normals averaged over the faces using them */
+    for (i=0; i<vertex_cnt; i++) {
+      vertex[i*6+0] = lw_object->vertex[i*3+0];
+      vertex[i*6+1] = lw_object->vertex[i*3+1];
+      vertex[i*6+2] = lw_object->vertex[i*3+2];
+    }
+    for (i=0; i<lw_object->face_cnt; i++) {
+      const lwFace *face = lw_object->face+i;
+      const GLushort *face_index = lw_object->index + face->index_first;
+      if (bucket[i] < 0)
+        continue;
+      for (j=0; j<face->index_cnt; j++) {
+        GLfloat *n = vertex + face_index[j]*6 + 3;
+        n[0] += normal[i*3+0];
+        n[1] += normal[i*3+1];
+        n[2] += normal[i*3+2];
+      }
+      for (j=1; j<face->index_cnt-1; j++) {
+        index[next[bucket[i]]++] = face_index[0];
+        index[next[bucket[i]]++] = face_index[j];
+        index[next[bucket[i]]++] = face_index[j+1];
+      }
+    }
+    for (i=0; i<vertex_cnt; i++) {
+      GLfloat *n = vertex + i*6 + 3;
+      GLfloat r = sqrt(n[0]*n[0] + n[1]*n[1] + n[2]*n[2]);
+      if (r > 0.000001) {
+        n[0] /= r;
+        n[1] /= r;
+        n[2] /= r;
+      }
+    }
+  } else {
+    /* every face gets its own corners carrying the face normal */
+    GLuint base = 0;
+    for (i=0; i<lw_object->face_cnt; i++) {
+      const lwFace *face = lw_object->face+i;
+      const GLushort *face_index = lw_object->index + face->index_first;
+      if (bucket[i] < 0)
+        continue;
+      for (j=0; j<face->index_cnt; j++) {
+        GLfloat *v = vertex + (base+j)*6;
+        memcpy(v, lw_object->vertex + face_index[j]*3, 3*sizeof(GLfloat));
+        memcpy(v+3, normal + i*3, 3*sizeof(GLfloat));
+      }
+      for (j=1; j<face->index_cnt-1; j++) {
+        index[next[bucket[i]]++] = base;
+        index[next[bucket[i]]++] = base+j;
+        index[next[bucket[i]]++] = base+j+1;
+      }
+      base += face->index_cnt;
+    }
+  }
+
+  mesh = g_malloc0(sizeof(lwMesh));
+  mesh->vertex = vertex;
+
+  /* 16 bit indices when they are enough */
+  if (vertex_cnt <= 65536) {
+    GLushort *index16 = g_new(GLushort, MAX(index_cnt, 1));
+    for (i=0; i<index_cnt; i++)
+      index16[i] = index[i];
+    g_free(index);
+    mesh->index = index16;
+    mesh->index_type = GL_UNSIGNED_SHORT;
+  } else {
+    mesh->index = index;
+    mesh->index_type = GL_UNSIGNED_INT;
+  }
+
+  /* one batch per material in use */
+  mesh->batch = g_new(lwBatch, bucket_cnt);
+  for (b=0; b<bucket_cnt; b++) {
+    lwBatch *batch = mesh->batch + mesh->batch_cnt;
+    if (first[b+1] == first[b])
+      continue;
+    if (b < lw_object->material_cnt) {
+      batch->r = lw_object->material[b].r;
+      batch->g = lw_object->material[b].g;
+      batch->b = lw_object->material[b].b;
+    } else {
+      batch->r = batch->g = batch->b = 0.7;
+    }
+    batch->first = first[b];
+    batch->count = first[b+1] - first[b];
+    mesh->batch_cnt++;
+  }
+
+  /* move the arrays into buffer objects */
+  procs = get_buffer_procs();
+  if (procs != NULL) {
+    gsize index_size = mesh->index_type == GL_UNSIGNED_SHORT ?
+      sizeof(GLushort) : sizeof(GLuint);
+
+    procs->GenBuffers(1, &mesh->vertex_buffer);
+    procs->BindBuffer(GL_ARRAY_BUFFER, mesh->vertex_buffer);
+    procs->BufferData(GL_ARRAY_BUFFER, (gssize)vertex_cnt*VERTEX_STRIDE,
+                      mesh->vertex, GL_STATIC_DRAW);
+    procs->BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    procs->GenBuffers(1, &mesh->index_buffer);
+    procs->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_buffer);
+    procs->BufferData(GL_ELEMENT_ARRAY_BUFFER, (gssize)index_cnt*index_size,
+                      mesh->index, GL_STATIC_DRAW);
+    procs->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    g_free(mesh->vertex);
+    g_free(mesh->index);
+    mesh->vertex = NULL;
+    mesh->index = NULL;
+  }
+
+  g_free(next);
+  g_free(first);
+  g_free(normal);
+  g_free(bucket);
+  return mesh;
+}
+
+void lw_mesh_draw(const lwMesh *mesh)
 {
+  const lwBufferProcs *procs = NULL;
+  gsize vertex_base, index_base, index_size;
   int i;
-  double max_radius = 0.0;
 
-  g_return_val_if_fail(lwo != NULL, 0.0);
+  g_return_if_fail(mesh != NULL);
 
-  for (i=0; i<lwo->vertex_cnt; i++) {
-    GLfloat *v = &lwo->vertex[i*3];
-    double r = v[0]*v[0] + v[1]*v[1] + v[2]*v[2];
-    if (r > max_radius)
-      max_radius = r;
+  /* the buffers live in the current context or one sharing with it */
+  if (mesh->vertex_buffer) {
+    procs = get_buffer_procs();
+    g_return_if_fail(procs != NULL);
   }
-  return sqrt(max_radius);
+
+  /* offsets into the buffer objects, or client memory addresses */
+  vertex_base = GPOINTER_TO_SIZE(mesh->vertex);
+  index_base  = GPOINTER_TO_SIZE(mesh->index);
+  index_size  = mesh->index_type == GL_UNSIGNED_SHORT ?
+    sizeof(GLushort) : sizeof(GLuint);
+
+  glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+  if (procs != NULL) {
+    procs->BindBuffer(GL_ARRAY_BUFFER, mesh->vertex_buffer);
+    procs->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->index_buffer);
+  }
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_NORMAL_ARRAY);
+  glVertexPointer(3, GL_FLOAT, VERTEX_STRIDE, GSIZE_TO_POINTER(vertex_base));
+  glNormalPointer(GL_FLOAT, VERTEX_STRIDE,
+                  GSIZE_TO_POINTER(vertex_base + 3*sizeof(GLfloat)));
+
+  for (i=0; i<mesh->batch_cnt; i++) {
+    const lwBatch *batch = mesh->batch+i;
+    glColor3f(batch->r, batch->g, batch->b);
+    glDrawElements(GL_TRIANGLES, batch->count, mesh->index_type,
+                   GSIZE_TO_POINTER(index_base + batch->first*index_size));
+  }
+
+  if (procs != NULL) {
+    procs->BindBuffer(GL_ARRAY_BUFFER, 0);
+    procs->BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+
+  glPopClientAttrib();
 }
 
-void lw_object_scale(lwObject *lwo, GLfloat scale)
+void lw_mesh_free(lwMesh *mesh)
+{
+  g_return_if_fail(mesh != NULL);
+
+  if (mesh->vertex_buffer) {
+    const lwBufferProcs *procs = get_buffer_procs();
+    if (procs != NULL) {
+      procs->DeleteBuffers(1, &mesh->vertex_buffer);
+      procs->DeleteBuffers(1, &mesh->index_buffer);
+    }
+  }
+  g_free(mesh->vertex);
+  g_free(mesh->index);
+  g_free(mesh->batch);
+  g_free(mesh);
+}
+
+
+/*
+ * Vertex kernels.  Each one is a plain loop over a span of the flat
+ * vertex array that the compiler can vectorize; large objects are split
+ * into one span per processor, each run on its own thread.
+ */
+
+#define LW_SPAN_MIN     65536   /* fewest vertices worth a thread */
+#define LW_MAX_SPANS    16
+
+typedef struct _lwSpan lwSpan;
+typedef void (*lwKernel)(lwSpan *span);
+
+struct _lwSpan {
+  lwKernel kernel;
+  GLfloat *vertex;              /* first vertex of the span */
+  int cnt;                      /* number of vertices */
+  const GLfloat *arg;           /* kernel argument */
+  GLfloat result[6];            /* kernel result */
+};
+
+static gpointer run_span(gpointer data)
+{
+  lwSpan *span = data;
+  span->kernel(span);
+  return NULL;
+}
+
+/* returns the number of spans the results are in */
+static int run_kernel(lwKernel kernel, GLfloat *vertex, int cnt,
+                      const GLfloat *arg, lwSpan *span)
+{
+  GThread *thread[LW_MAX_SPANS];
+  int span_cnt = MIN(g_get_num_processors(), LW_MAX_SPANS);
+  int i, first = 0;
+
+  span_cnt = CLAMP(cnt / LW_SPAN_MIN, 1, span_cnt);
+
+  for (i=0; i<span_cnt; i++) {
+    int last = (int)((gint64)cnt * (i+1) / span_cnt);
+    span[i].kernel = kernel;
+    span[i].vertex = vertex + (gsize)first*3;
+    span[i].cnt = last - first;
+    span[i].arg = arg;
+    first = last;
+  }
+
+  /* the calling thread takes the first span */
+  for (i=1; i<span_cnt; i++) {
+    thread[i] = g_thread_try_new("lw-kernel", run_span, &span[i], NULL);
+    if (thread[i] == NULL)
+      run_span(&span[i]);
+  }
+  run_span(&span[0]);
+  for (i=1; i<span_cnt; i++)
+    if (thread[i] != NULL)
+      g_thread_join(thread[i]);
+
+  return span_cnt;
+}
+
+static void bounds_kernel(lwSpan *span)
+{
+  const GLfloat *v = span->vertex;
+  GLfloat x0 = v[0], y0 = v[1], z0 = v[2];
+  GLfloat x1 = v[0], y1 = v[1], z1 = v[2];
+  int i;
+
+  for (i=1; i<span->cnt; i++) {
+    GLfloat x = v[i*3+0], y = v[i*3+1], z = v[i*3+2];
+    x0 = x < x0 ? x : x0;
+    y0 = y < y0 ? y : y0;
+    z0 = z < z0 ? z : z0;
+    x1 = x > x1 ? x : x1;
+    y1 = y > y1 ? y : y1;
+    z1 = z > z1 ? z : z1;
+  }
+  span->result[0] = x0; span->result[1] = y0; span->result[2] = z0;
+  span->result[3] = x1; span->result[4] = y1; span->result[5] = z1;
+}
+
+/* largest squared distance from arg */
+static void radius_kernel(lwSpan *span)
+{
+  const GLfloat *v = span->vertex;
+  const GLfloat cx = span->arg[0], cy = span->arg[1], cz = span->arg[2];
+  GLfloat max_r = 0.0;
+  int i;
+
+  for (i=0; i<span->cnt; i++) {
+    GLfloat x = v[i*3+0] - cx, y = v[i*3+1] - cy, z = v[i*3+2] - cz;
+    GLfloat r = x*x + y*y + z*z;
+    max_r = r > max_r ? r : max_r;
+  }
+  span->result[0] = max_r;
+}
+
+static void scale_kernel(lwSpan *span)
+{
+  GLfloat *v = span->vertex;
+  const GLfloat scale = span->arg[0];
+  int i;
+
+  for (i=0; i<span->cnt*3; i++)
+    v[i] *= scale;
+}
+
+/* arg is a column-major 4x4 matrix as used by OpenGL */
+static void transform_kernel(lwSpan *span)
 {
+  GLfloat *v = span->vertex;
+  const GLfloat *m = span->arg;
   int i;
 
+  for (i=0; i<span->cnt; i++) {
+    GLfloat x = v[i*3+0], y = v[i*3+1], z = v[i*3+2];
+    v[i*3+0] = m[0]*x + m[4]*y + m[8]*z  + m[12];
+    v[i*3+1] = m[1]*x + m[5]*y + m[9]*z  + m[13];
+    v[i*3+2] = m[2]*x + m[6]*y + m[10]*z + m[14];
+  }
+}
+
+
+void lw_object_bounds(const lwObject *lwo, GLfloat min[3], GLfloat max[3])
+{
+  lwSpan span[LW_MAX_SPANS];
+  int i, j, span_cnt;
+
   g_return_if_fail(lwo != NULL);
 
-  for (i=0; i<lwo->vertex_cnt; i++) {
-    lwo->vertex[i*3+0] *= scale;
-    lwo->vertex[i*3+1] *= scale;
-    lwo->vertex[i*3+2] *= scale;
+  if (lwo->vertex_cnt == 0) {
+    min[0] = min[1] = min[2] = 0.0;
+    max[0] = max[1] = max[2] = 0.0;
+    return;
+  }
+
+  span_cnt = run_kernel(bounds_kernel, lwo->vertex, lwo->vertex_cnt,
+                        NULL, span);
+  for (j=0; j<3; j++) {
+    min[j] = span[0].result[j];
+    max[j] = span[0].result[j+3];
+    for (i=1; i<span_cnt; i++) {
+      min[j] = MIN(min[j], span[i].result[j]);
+      max[j] = MAX(max[j], span[i].result[j+3]);
+    }
   }
 }
 
+/* sphere around the center of the bounding box */
+void lw_object_bounding_sphere(const lwObject *lwo,
+                               GLfloat center[3], GLfloat *radius)
+{
+  lwSpan span[LW_MAX_SPANS];
+  GLfloat min[3], max[3], max_r = 0.0;
+  int i, span_cnt;
+
+  g_return_if_fail(lwo != NULL);
+
+  lw_object_bounds(lwo, min, max);
+  for (i=0; i<3; i++)
+    center[i] = (min[i] + max[i]) / 2;
+
+  if (lwo->vertex_cnt > 0) {
+    span_cnt = run_kernel(radius_kernel, lwo->vertex, lwo->vertex_cnt,
+                          center, span);
+    for (i=0; i<span_cnt; i++)
+      max_r = MAX(max_r, span[i].result[0]);
+  }
+  *radius = sqrt(max_r);
+}
+
+/* sphere around the origin */
+GLfloat lw_object_radius(const lwObject *lwo)
+{
+  static const GLfloat origin[3] = { 0.0, 0.0, 0.0 };
+  lwSpan span[LW_MAX_SPANS];
+  GLfloat max_r = 0.0;
+  int i, span_cnt;
+
+  g_return_val_if_fail(lwo != NULL, 0.0);
+
+  if (lwo->vertex_cnt == 0)
+    return 0.0;
+
+  span_cnt = run_kernel(radius_kernel, lwo->vertex, lwo->vertex_cnt,
+                        origin, span);
+  for (i=0; i<span_cnt; i++)
+    max_r = MAX(max_r, span[i].result[0]);
+  return sqrt(max_r);
+}
+
+void lw_object_scale(lwObject *lwo, GLfloat scale)
+{
+  lwSpan span[LW_MAX_SPANS];
+
+  g_return_if_fail(lwo != NULL);
+
+  if (lwo->vertex_cnt > 0)
+    run_kernel(scale_kernel, lwo->vertex, lwo->vertex_cnt, &scale, span);
+}
+
+void lw_object_transform(lwObject *lwo, const GLfloat matrix[16])
+{
+  lwSpan span[LW_MAX_SPANS];
+
+  g_return_if_fail(lwo != NULL);
+
+  if (lwo->vertex_cnt > 0)
+    run_kernel(transform_kernel, lwo->vertex, lwo->vertex_cnt, matrix, span);
+}
+
+/* move the center of the bounding box to the origin */
+void lw_object_center(lwObject *lwo)
+{
+  GLfloat min[3], max[3];
+  GLfloat m[16] = { 1.0, 0.0, 0.0, 0.0,
+                    0.0, 1.0, 0.0, 0.0,
+                    0.0, 0.0, 1.0, 0.0,
+                    0.0, 0.0, 0.0, 1.0 };
+
+  g_return_if_fail(lwo != NULL);
+
+  lw_object_bounds(lwo, min, max);
+  m[12] = -(min[0] + max[0]) / 2;
+  m[13] = -(min[1] + max[1]) / 2;
+  m[14] = -(min[2] + max[2]) / 2;
+  lw_object_transform(lwo, m);
+}
+
 
@@ -46,14 +46,16 @@ typedef struct {
 typedef struct {
   int material;         /* material of this face */
   int index_cnt;        /* number of vertices */
-  int *index;           /* index to vertex */
-  float *texcoord;      /* u,v texture coordinates */
+  int index_first;      /* first index to vertex in lwObject.index */
 } lwFace;
 
 typedef struct {
   int face_cnt;
   lwFace *face;
 
+  int index_cnt;
+  GLushort *index;      /* vertex indices of all faces */
+
   int material_cnt;
   lwMaterial *material;
 
@@ -62,14 +64,43 @@ typedef struct {
 
 } lwObject;
 
+typedef struct {
+  GLfloat r,g,b;        /* material color */
+  int first;            /* first index of the batch */
+  int count;            /* number of indices */
+} lwBatch;
+
+typedef struct {
+  GLuint vertex_buffer; /* interleaved position and normal, 0 without VBOs */
+  GLuint index_buffer;
+  GLfloat *vertex;      /* client side arrays, NULL when in buffer objects */
+  void *index;
+  GLenum index_type;    /* GL_UNSIGNED_SHORT or GL_UNSIGNED_INT */
+
+  int batch_cnt;
+  lwBatch *batch;       /* one per material */
+} lwMesh;
+
 
 gint      lw_is_lwobject(const char     *lw_file);
 lwObject *lw_object_read(const char     *lw_file);
 void      lw_object_free(      lwObject *lw_object);
 void      lw_object_show(const lwObject *lw_object);
 
-GLfloat   lw_object_radius(const lwObject *lw_object);
-void      lw_object_scale (lwObject *lw_object, GLfloat scale);
+void      lw_object_bounds         (const lwObject *lw_object,
+                                    GLfloat min[3], GLfloat max[3]);
+void      lw_object_bounding_sphere(const lwObject *lw_object,
+                                    GLfloat center[3], GLfloat *radius);
+GLfloat   lw_object_radius         (const lwObject *lw_object);
+void      lw_object_scale          (lwObject *lw_object, GLfloat scale);
+void      lw_object_transform      (lwObject *lw_object,
+                                    const GLfloat matrix[16]);
+void      lw_object_center         (lwObject *lw_object);
+
+/* these need the GL context the mesh is drawn in to be current */
+lwMesh   *lw_object_compile(const lwObject *lw_object, gboolean smooth);
+void      lw_mesh_draw     (const lwMesh   *mesh);
+void      lw_mesh_free     (      lwMesh   *mesh);
 
 #endif /* LW_H */
 
@@ -78,7 +78,9 @@ def draw (widget, cr, data):
     every time the 'draw' event is signalled.'''
 
     # OpenGL BEGIN
-    if not GtkGLExt.widget_begin_gl(widget):
+    # data is the widget's GL binding, which is cheaper to begin and end
+    # every frame than the widget itself.
+    if not data.begin():
         return False
 
     GL.glClear(GL.GL_COLOR_BUFFER_BIT)
@@ -89,7 +91,7 @@ def draw (widget, cr, data):
     GL.glRectf(-25., -25., 25., 25.)
     GL.glPopMatrix()
 
-    GtkGLExt.widget_end_gl(widget, True)
+    data.end(True)
     # OpenGL END
 
     return True
@@ -316,7 +318,8 @@ def create_window(glconfig):
     # Connect signal handlers to the drawing area
     drawing_area.connect_after("realize", realize, None)
     drawing_area.connect("configure_event", configure_event, None)
-    drawing_area.connect("draw", draw, None)
+    drawing_area.connect("draw", draw,
+                         GtkGLExt.widget_get_gl_binding(drawing_area))
 
     drawing_area.connect("motion_notify_event", motion_notify_event, None)
     drawing_area.connect("button_press_event", button_press_event, None)
@@ -12,6 +12,8 @@
 #include <windows.h>
 #endif
 
+#include <gdk/gdkgl.h>
+
 #ifdef GDK_WINDOWING_QUARTZ
 #include <OpenGL/glu.h>
 #else
@@ -25,8 +27,14 @@
 #include "readtex.h"
 
 
-#ifndef SEEK_SET
-#  define SEEK_SET 0
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#define USE_WIN32_MAPPING 1
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 
@@ -44,220 +52,285 @@ typedef struct _TK_RGBImageRec {
 
 /******************************************************************************/
 
-typedef struct _rawImageRec {
-    unsigned short imagic;
-    unsigned short type;
-    unsigned short dim;
-    unsigned short sizeX, sizeY, sizeZ;
-    unsigned long min, max;
-    unsigned long wasteBytes;
-    char name[80];
-    unsigned long colorMap;
-    FILE *file;
-    unsigned char *tmp, *tmpR, *tmpG, *tmpB, *tmpA;
-    unsigned long rleEnd;
-    GLuint *rowStart;
-    GLint *rowSize;
-} rawImageRec;
+/*
+ * The whole file is mapped (or, failing that, read in one go), so rows
+ * are decoded straight from the file contents into their final place
+ * in the interleaved image, without per-row seeks, reads or scratch
+ * buffers.  Decoding stays on the calling thread: it is one pass over
+ * memory that is already mapped, and the callers load their textures
+ * from realize handlers with the context current, so handing rows to
+ * worker threads would only add synchronization.
+ */
+
+typedef struct _rgbFileRec {
+   const unsigned char *base;
+   size_t size;
+#ifdef USE_WIN32_MAPPING
+   HANDLE file;
+   HANDLE mapping;
+#else
+   int mapped;
+#endif
+} rgbFileRec;
+
+typedef struct _rgbHeaderRec {
+   GLboolean rle;
+   GLint sizeX, sizeY, sizeZ;
+   const unsigned char *rowStart;   /* big-endian offset tables, RLE only */
+   const unsigned char *rowSize;
+} rgbHeaderRec;
 
 /******************************************************************************/
 
-static void ConvertShort(unsigned short *array, long length)
+static GLuint GetLong(const unsigned char *ptr)
 {
-   unsigned long b1, b2;
-   unsigned char *ptr;
-
-   ptr = (unsigned char *)array;
-   while (length--) {
-      b1 = *ptr++;
-      b2 = *ptr++;
-      *array++ = (unsigned short) ((b1 << 8) | (b2));
-   }
+   return ((GLuint) ptr[0] << 24) | ((GLuint) ptr[1] << 16) |
+          ((GLuint) ptr[2] << 8) | (GLuint) ptr[3];
 }
 
-static void ConvertLong(GLuint *array, long length)
+static GLuint GetShort(const unsigned char *ptr)
 {
-   unsigned long b1, b2, b3, b4;
-   unsigned char *ptr;
-
-   ptr = (unsigned char *)array;
-   while (length--) {
-      b1 = *ptr++;
-      b2 = *ptr++;
-      b3 = *ptr++;
-      b4 = *ptr++;
-      *array++ = (b1 << 24) | (b2 << 16) | (b3 << 8) | (b4);
-   }
+   return ((GLuint) ptr[0] << 8) | (GLuint) ptr[1];
 }
 
-static rawImageRec *RawImageOpen(const char *fileName)
+static GLboolean RGBFileOpen(rgbFileRec *file, const char *fileName)
 {
-   union {
-      int testWord;
-      char testByte[4];
-   } endianTest;
-   rawImageRec *raw;
-   GLenum swapFlag;
-   int x;
-
-   endianTest.testWord = 1;
-   if (endianTest.testByte[0] == 1) {
-      swapFlag = GL_TRUE;
-   } else {
-      swapFlag = GL_FALSE;
-   }
-
-   raw = (rawImageRec *)malloc(sizeof(rawImageRec));
-   if (raw == NULL) {
-      fprintf(stderr, "Out of memory!\n");
-      return NULL;
+#ifdef USE_WIN32_MAPPING
+   LARGE_INTEGER size;
+
+   file->file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+   if (file->file == INVALID_HANDLE_VALUE) {
+      fprintf(stderr, "%s: cannot open file\n", fileName);
+      return GL_FALSE;
    }
-   if ((raw->file = fopen(fileName, "rb")) == NULL) {
-      perror(fileName);
-      return NULL;
+   if (!GetFileSizeEx(file->file, &size) || size.QuadPart == 0) {
+      CloseHandle(file->file);
+      return GL_FALSE;
    }
-
-   fread(raw, 1, 12, raw->file);
-
-   if (swapFlag) {
-      ConvertShort(&raw->imagic, 6);
+   file->size = (size_t) size.QuadPart;
+   file->mapping = CreateFileMappingA(file->file, NULL, PAGE_READONLY,
+                                      0, 0, NULL);
+   if (file->mapping == NULL) {
+      CloseHandle(file->file);
+      return GL_FALSE;
+   }
+   file->base = (const unsigned char *)
+      MapViewOfFile(file->mapping, FILE_MAP_READ, 0, 0, 0);
+   if (file->base == NULL) {
+      CloseHandle(file->mapping);
+      CloseHandle(file->file);
+      return GL_FALSE;
    }
+   return GL_TRUE;
+#else
+   struct stat st;
+   void *base;
+   int fd;
 
-   raw->tmp = (unsigned char *)malloc(raw->sizeX*256);
-   raw->tmpR = (unsigned char *)malloc(raw->sizeX*256);
-   raw->tmpG = (unsigned char *)malloc(raw->sizeX*256);
-   raw->tmpB = (unsigned char *)malloc(raw->sizeX*256);
-   if (raw->sizeZ==4) {
-      raw->tmpA = (unsigned char *)malloc(raw->sizeX*256);
+   fd = open(fileName, O_RDONLY);
+   if (fd < 0) {
+      perror(fileName);
+      return GL_FALSE;
    }
-   if (raw->tmp == NULL || raw->tmpR == NULL || raw->tmpG == NULL ||
-       raw->tmpB == NULL) {
-      fprintf(stderr, "Out of memory!\n");
-      return NULL;
+   if (fstat(fd, &st) < 0 || st.st_size == 0) {
+      close(fd);
+      return GL_FALSE;
    }
+   file->size = (size_t) st.st_size;
 
-   if ((raw->type & 0xFF00) == 0x0100) {
-      x = raw->sizeY * raw->sizeZ * sizeof(GLuint);
-      raw->rowStart = (GLuint *)malloc(x);
-      raw->rowSize = (GLint *)malloc(x);
-      if (raw->rowStart == NULL || raw->rowSize == NULL) {
-         fprintf(stderr, "Out of memory!\n");
-         return NULL;
-      }
-      raw->rleEnd = 512 + (2 * x);
-      fseek(raw->file, 512, SEEK_SET);
-      fread(raw->rowStart, 1, x, raw->file);
-      fread(raw->rowSize, 1, x, raw->file);
-      if (swapFlag) {
-         ConvertLong(raw->rowStart, (long) (x/sizeof(GLuint)));
-         ConvertLong((GLuint *)raw->rowSize, (long) (x/sizeof(GLint)));
+   base = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, fd, 0);
+   if (base != MAP_FAILED) {
+      file->mapped = 1;
+   }
+   else {
+      /* e.g. on a file system without mmap support */
+      file->mapped = 0;
+      base = malloc(file->size);
+      if (base == NULL ||
+          pread(fd, base, file->size, 0) != (ssize_t) file->size) {
+         free(base);
+         close(fd);
+         return GL_FALSE;
       }
    }
-   return raw;
+   close(fd);
+
+   file->base = (const unsigned char *) base;
+   return GL_TRUE;
+#endif
+}
+
+static void RGBFileClose(rgbFileRec *file)
+{
+#ifdef USE_WIN32_MAPPING
+   UnmapViewOfFile(file->base);
+   CloseHandle(file->mapping);
+   CloseHandle(file->file);
+#else
+   if (file->mapped)
+      munmap((void *) file->base, file->size);
+   else
+      free((void *) file->base);
+#endif
 }
 
-static void RawImageClose(rawImageRec *raw)
+static GLboolean RGBParseHeader(const rgbFileRec *file, rgbHeaderRec *hdr)
 {
+   const unsigned char *ptr = file->base;
+   size_t tableSize;
 
-   fclose(raw->file);
-   free(raw->tmp);
-   free(raw->tmpR);
-   free(raw->tmpG);
-   free(raw->tmpB);
-   if (raw->sizeZ>3) {
-      free(raw->tmpA);
+   if (file->size < 512 || GetShort(ptr) != 474) {
+      fprintf(stderr, "Not an SGI image file\n");
+      return GL_FALSE;
+   }
+   if (ptr[3] != 1) {
+      fprintf(stderr, "Only 8-bit SGI images are supported\n");
+      return GL_FALSE;
+   }
+
+   hdr->rle = (ptr[2] == 1) ? GL_TRUE : GL_FALSE;
+   hdr->sizeX = GetShort(ptr + 6);
+   hdr->sizeY = GetShort(ptr + 8);
+   hdr->sizeZ = GetShort(ptr + 10);
+   if (GetShort(ptr + 4) < 3)
+      hdr->sizeZ = 1;
+
+   if (hdr->rle) {
+      tableSize = (size_t) hdr->sizeY * hdr->sizeZ * 4;
+      if (file->size < 512 + 2 * tableSize)
+         return GL_FALSE;
+      hdr->rowStart = ptr + 512;
+      hdr->rowSize = ptr + 512 + tableSize;
+   }
+   else {
+      if (file->size < 512 + (size_t) hdr->sizeX * hdr->sizeY * hdr->sizeZ)
+         return GL_FALSE;
+      hdr->rowStart = hdr->rowSize = NULL;
    }
-   free(raw);
+   return GL_TRUE;
 }
 
-static void RawImageGetRow(rawImageRec *raw, unsigned char *buf, int y, int z)
+/*
+ * Expand one RLE channel row into every stride-th byte of dst.
+ */
+static GLboolean RGBDecodeRLERow(const unsigned char *src, size_t srcLen,
+                                 unsigned char *dst, GLint width, GLint stride)
 {
-   unsigned char *iPtr, *oPtr, pixel;
-   int count, done = 0;
-
-   if ((raw->type & 0xFF00) == 0x0100) {
-      fseek(raw->file, (long) raw->rowStart[y+z*raw->sizeY], SEEK_SET);
-      fread(raw->tmp, 1, (unsigned int)raw->rowSize[y+z*raw->sizeY],
-            raw->file);
-
-      iPtr = raw->tmp;
-      oPtr = buf;
-      while (!done) {
-         pixel = *iPtr++;
-         count = (int)(pixel & 0x7F);
-         if (!count) {
-			 done = 1;
-            return;
+   const unsigned char *end = src + srcLen;
+   unsigned char *last = dst + (size_t) width * stride;
+
+   while (src < end) {
+      unsigned char pixel = *src++;
+      int count = pixel & 0x7F;
+
+      if (count == 0)
+         return GL_TRUE;
+      if (dst + (size_t) (count - 1) * stride >= last)
+         return GL_FALSE;
+
+      if (pixel & 0x80) {
+         if (src + count > end)
+            return GL_FALSE;
+         while (count--) {
+            *dst = *src++;
+            dst += stride;
          }
-         if (pixel & 0x80) {
-            while (count--) {
-               *oPtr++ = *iPtr++;
-            }
-         } else {
-            pixel = *iPtr++;
-            while (count--) {
-               *oPtr++ = pixel;
-            }
+      }
+      else {
+         if (src >= end)
+            return GL_FALSE;
+         pixel = *src++;
+         while (count--) {
+            *dst = pixel;
+            dst += stride;
          }
       }
-   } else {
-      fseek(raw->file, 512+(y*raw->sizeX)+(z*raw->sizeX*raw->sizeY),
-            SEEK_SET);
-      fread(buf, 1, raw->sizeX, raw->file);
    }
+   return GL_TRUE;
 }
 
-
-static void RawImageGetData(rawImageRec *raw, TK_RGBImageRec *final)
+/*
+ * Decode the image into dest, bottom row first, with the channels of a
+ * pixel interleaved and rows rowStride bytes apart.
+ */
+static GLboolean RGBDecode(const rgbFileRec *file, const rgbHeaderRec *hdr,
+                           unsigned char *dest, GLint rowStride)
 {
-   unsigned char *ptr;
-   int i, j;
-
-   final->data = (unsigned char *)malloc((raw->sizeX+1)*(raw->sizeY+1)*4);
-   if (final->data == NULL) {
-      fprintf(stderr, "Out of memory!\n");
-   }
-
-   ptr = final->data;
-   for (i = 0; i < (int)(raw->sizeY); i++) {
-      RawImageGetRow(raw, raw->tmpR, i, 0);
-      RawImageGetRow(raw, raw->tmpG, i, 1);
-      RawImageGetRow(raw, raw->tmpB, i, 2);
-      if (raw->sizeZ>3) {
-         RawImageGetRow(raw, raw->tmpA, i, 3);
-      }
-      for (j = 0; j < (int)(raw->sizeX); j++) {
-         *ptr++ = *(raw->tmpR + j);
-         *ptr++ = *(raw->tmpG + j);
-         *ptr++ = *(raw->tmpB + j);
-         if (raw->sizeZ>3) {
-            *ptr++ = *(raw->tmpA + j);
+   GLint x, y, z;
+
+   for (y = 0; y < hdr->sizeY; y++) {
+      unsigned char *row = dest + (size_t) y * rowStride;
+
+      for (z = 0; z < hdr->sizeZ; z++) {
+         if (hdr->rle) {
+            size_t index = ((size_t) z * hdr->sizeY + y) * 4;
+            size_t start = GetLong(hdr->rowStart + index);
+            size_t len = GetLong(hdr->rowSize + index);
+
+            if (start > file->size || len > file->size - start)
+               return GL_FALSE;
+            if (!RGBDecodeRLERow(file->base + start, len,
+                                 row + z, hdr->sizeX, hdr->sizeZ))
+               return GL_FALSE;
+         }
+         else {
+            const unsigned char *src = file->base + 512 +
+               ((size_t) z * hdr->sizeY + y) * hdr->sizeX;
+            unsigned char *dst = row + z;
+
+            for (x = 0; x < hdr->sizeX; x++) {
+               *dst = src[x];
+               dst += hdr->sizeZ;
+            }
          }
       }
    }
+   return GL_TRUE;
 }
 
 
 static TK_RGBImageRec *tkRGBImageLoad(const char *fileName)
 {
-   rawImageRec *raw;
+   rgbFileRec file;
+   rgbHeaderRec hdr;
    TK_RGBImageRec *final;
 
-   raw = RawImageOpen(fileName);
-   if (!raw) {
+   if (!RGBFileOpen(&file, fileName)) {
       fprintf(stderr, "File not found\n");
       return NULL;
    }
+   if (!RGBParseHeader(&file, &hdr)) {
+      RGBFileClose(&file);
+      return NULL;
+   }
+
    final = (TK_RGBImageRec *)malloc(sizeof(TK_RGBImageRec));
    if (final == NULL) {
       fprintf(stderr, "Out of memory!\n");
+      RGBFileClose(&file);
+      return NULL;
+   }
+   final->sizeX = hdr.sizeX;
+   final->sizeY = hdr.sizeY;
+   final->components = hdr.sizeZ;
+   final->data = (unsigned char *)
+      malloc((size_t) hdr.sizeX * hdr.sizeY * hdr.sizeZ);
+   if (final->data == NULL) {
+      fprintf(stderr, "Out of memory!\n");
+      free(final);
+      RGBFileClose(&file);
       return NULL;
    }
-   final->sizeX = raw->sizeX;
-   final->sizeY = raw->sizeY;
-   final->components = raw->sizeZ;
-   RawImageGetData(raw, final);
-   RawImageClose(raw);
+
+   if (!RGBDecode(&file, &hdr, final->data, hdr.sizeX * hdr.sizeZ)) {
+      fprintf(stderr, "%s: corrupt image data\n", fileName);
+      free(final->data);
+      free(final);
+      final = NULL;
+   }
+
+   RGBFileClose(&file);
    return final;
 }
 
@@ -269,8 +342,419 @@ static void FreeImage( TK_RGBImageRec *image )
 }
 
 
+/******************************************************************************/
+
+/*
+ * GPU mipmap path.  The base level is decoded straight into a persistently
+ * mapped pixel unpack buffer and the driver builds the rest of the chain,
+ * so nothing is rescaled or filtered on the CPU and non-power-of-two images
+ * keep their size.  Every piece degrades separately: glTexStorage2D to
+ * glTexImage2D, glGenerateMipmap to GL_GENERATE_MIPMAP, and the PBO to a
+ * plain client memory upload.  If the context can do neither kind of
+ * mipmap generation, or can't take a non-power-of-two image, the caller
+ * falls back to gluBuild2DMipmaps.
+ */
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_GENERATE_MIPMAP
+#define GL_GENERATE_MIPMAP                0x8191
+#endif
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER            0x88EC
+#endif
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT                  0x0002
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT               0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE     0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT        0x00000001
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED                0x911B
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED                    0x911D
+#endif
+#ifndef GL_TEXTURE_IMMUTABLE_FORMAT
+#define GL_TEXTURE_IMMUTABLE_FORMAT       0x912F
+#endif
+
+typedef void (APIENTRY *TexStorage2DProc)(GLenum target, GLsizei levels,
+                                          GLenum internalformat,
+                                          GLsizei width, GLsizei height);
+typedef void (APIENTRY *GenerateMipmapProc)(GLenum target);
+typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint *buffers);
+typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint *buffers);
+typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *BufferStorageProc)(GLenum target, gssize size,
+                                           const void *data, GLbitfield flags);
+typedef void *(APIENTRY *MapBufferRangeProc)(GLenum target, gssize offset,
+                                             gssize length, GLbitfield access);
+typedef void *(APIENTRY *FenceSyncProc)(GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRY *ClientWaitSyncProc)(void *sync, GLbitfield flags,
+                                              guint64 timeout);
+typedef void (APIENTRY *DeleteSyncProc)(void *sync);
+
+typedef struct _gpuStateRec {
+   GLboolean npot;
+   GLboolean generateMipmapParam;
+   TexStorage2DProc TexStorage2D;
+   GenerateMipmapProc GenerateMipmap;
+
+   /* persistent upload buffer, NULL BufferStorage if unsupported */
+   GenBuffersProc GenBuffers;
+   DeleteBuffersProc DeleteBuffers;
+   BindBufferProc BindBuffer;
+   BufferStorageProc BufferStorage;
+   MapBufferRangeProc MapBufferRange;
+   FenceSyncProc FenceSync;
+   ClientWaitSyncProc ClientWaitSync;
+   DeleteSyncProc DeleteSync;
+
+   GLuint buffer;
+   gsize bufferSize;
+   GLubyte *bufferMap;
+   void *fence;                /* last upload still reading the buffer */
+} gpuStateRec;
+
+#define GPU_STATE_KEY "readtex-gpu-state"
+
+
+static GLboolean GLVersionAtLeast(GLint major, GLint minor)
+{
+   const char *version = (const char *) glGetString(GL_VERSION);
+   GLint maj = 0, min = 0;
+
+   if (!version || sscanf(version, "%d.%d", &maj, &min) != 2)
+      return GL_FALSE;
+   return maj > major || (maj == major && min >= minor);
+}
+
+
+/*
+ * Query what the current context offers.  The answers and the upload
+ * buffer are attached to the context object and go away with it, like
+ * the buffer itself does on the GL side.
+ */
+static gpuStateRec *GetGPUState(void)
+{
+   GdkGLContext *context = gdk_gl_context_get_current();
+   gpuStateRec *state;
+
+   if (!context)
+      return NULL;
+   state = (gpuStateRec *) g_object_get_data(G_OBJECT(context),
+                                             GPU_STATE_KEY);
+   if (state)
+      return state;
+
+   state = g_new0(gpuStateRec, 1);
+   g_object_set_data_full(G_OBJECT(context), GPU_STATE_KEY, state, g_free);
+
+   state->npot = GLVersionAtLeast(2, 0) ||
+      gdk_gl_query_gl_extension("GL_ARB_texture_non_power_of_two");
+   state->generateMipmapParam = GLVersionAtLeast(1, 4) ||
+      gdk_gl_query_gl_extension("GL_SGIS_generate_mipmap");
+
+   if (GLVersionAtLeast(4, 2) ||
+       gdk_gl_query_gl_extension("GL_ARB_texture_storage"))
+      state->TexStorage2D = (TexStorage2DProc)
+         gdk_gl_get_proc_address("glTexStorage2D");
+
+   if (GLVersionAtLeast(3, 0) ||
+       gdk_gl_query_gl_extension("GL_ARB_framebuffer_object"))
+      state->GenerateMipmap = (GenerateMipmapProc)
+         gdk_gl_get_proc_address("glGenerateMipmap");
+   else if (gdk_gl_query_gl_extension("GL_EXT_framebuffer_object"))
+      state->GenerateMipmap = (GenerateMipmapProc)
+         gdk_gl_get_proc_address("glGenerateMipmapEXT");
+
+   if (GLVersionAtLeast(4, 4) ||
+       (gdk_gl_query_gl_extension("GL_ARB_buffer_storage") &&
+        gdk_gl_query_gl_extension("GL_ARB_map_buffer_range") &&
+        gdk_gl_query_gl_extension("GL_ARB_sync"))) {
+      state->GenBuffers = (GenBuffersProc)
+         gdk_gl_get_proc_address("glGenBuffers");
+      state->DeleteBuffers = (DeleteBuffersProc)
+         gdk_gl_get_proc_address("glDeleteBuffers");
+      state->BindBuffer = (BindBufferProc)
+         gdk_gl_get_proc_address("glBindBuffer");
+      state->BufferStorage = (BufferStorageProc)
+         gdk_gl_get_proc_address("glBufferStorage");
+      state->MapBufferRange = (MapBufferRangeProc)
+         gdk_gl_get_proc_address("glMapBufferRange");
+      state->FenceSync = (FenceSyncProc)
+         gdk_gl_get_proc_address("glFenceSync");
+      state->ClientWaitSync = (ClientWaitSyncProc)
+         gdk_gl_get_proc_address("glClientWaitSync");
+      state->DeleteSync = (DeleteSyncProc)
+         gdk_gl_get_proc_address("glDeleteSync");
+
+      if (!state->GenBuffers || !state->DeleteBuffers || !state->BindBuffer ||
+          !state->MapBufferRange || !state->FenceSync ||
+          !state->ClientWaitSync || !state->DeleteSync)
+         state->BufferStorage = NULL;
+   }
+
+   return state;
+}
+
+
+/*
+ * Return the mapped upload buffer, at least size bytes and bound to
+ * GL_PIXEL_UNPACK_BUFFER, or NULL to upload from client memory instead.
+ * Waits for the previous upload to finish reading it first.
+ */
+static GLubyte *MapUploadBuffer(gpuStateRec *state, gsize size)
+{
+   const GLbitfield flags =
+      GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+   if (!state->BufferStorage)
+      return NULL;
+
+   if (state->fence) {
+      GLenum status;
+      do {
+         status = state->ClientWaitSync(state->fence,
+                                        GL_SYNC_FLUSH_COMMANDS_BIT,
+                                        (guint64) 1000000000);
+      } while (status == GL_TIMEOUT_EXPIRED);
+      state->DeleteSync(state->fence);
+      state->fence = NULL;
+      if (status == GL_WAIT_FAILED)
+         return NULL;
+   }
+
+   if (size > state->bufferSize) {
+      /* Storage is immutable, so grow by replacing the buffer. */
+      if (state->buffer)
+         state->DeleteBuffers(1, &state->buffer);
+      state->buffer = 0;
+      state->bufferSize = 0;
+      state->bufferMap = NULL;
+
+      state->GenBuffers(1, &state->buffer);
+      state->BindBuffer(GL_PIXEL_UNPACK_BUFFER, state->buffer);
+      state->BufferStorage(GL_PIXEL_UNPACK_BUFFER, (gssize) size,
+                           NULL, flags);
+      state->bufferMap = (GLubyte *)
+         state->MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+                               (gssize) size, flags);
+      if (!state->bufferMap) {
+         state->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+         state->DeleteBuffers(1, &state->buffer);
+         state->buffer = 0;
+         return NULL;
+      }
+      state->bufferSize = size;
+   }
+   else {
+      state->BindBuffer(GL_PIXEL_UNPACK_BUFFER, state->buffer);
+   }
+
+   return state->bufferMap;
+}
+
+
+static GLenum SizedFormat(GLint intFormat)
+{
+   switch (intFormat) {
+   case 1:
+   case GL_LUMINANCE:
+      return GL_LUMINANCE8;
+   case 2:
+   case GL_LUMINANCE_ALPHA:
+      return GL_LUMINANCE8_ALPHA8;
+   case GL_ALPHA:
+      return GL_ALPHA8;
+   case GL_INTENSITY:
+      return GL_INTENSITY8;
+   case 3:
+   case GL_RGB:
+      return GL_RGB8;
+   case 4:
+   case GL_RGBA:
+      return GL_RGBA8;
+   default:
+      /* already sized */
+      return (GLenum) intFormat;
+   }
+}
+
+
+static GLboolean IsPowerOfTwo(GLint n)
+{
+   return n > 0 && (n & (n - 1)) == 0;
+}
+
+
+/*
+ * Storage made by glTexStorage2D can't be respecified, so a texture that
+ * already has it can only be refilled with an image of the same size and
+ * format.  Return GL_FALSE if the bound texture is immutable and doesn't
+ * match, GL_TRUE otherwise with *immutable set.
+ */
+static GLboolean CheckImmutable(GLenum sizedFormat, GLint width, GLint height,
+                                GLboolean *immutable)
+{
+   GLint value = 0, w = 0, h = 0, f = 0;
+
+   glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &value);
+   *immutable = value ? GL_TRUE : GL_FALSE;
+   if (!*immutable)
+      return GL_TRUE;
+
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+   glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &f);
+   return w == width && h == height && (GLenum) f == sizedFormat;
+}
+
+
+/*
+ * Build a GL_TEXTURE_2D mipmap chain on the GPU.
+ * Return:  1 if success, 0 if error, -1 if the context can't do it and
+ *          the gluBuild2DMipmaps path should be used.
+ */
+static int LoadRGBMipmapsGPU( const char *imageFile, GLint intFormat,
+                              GLint *width, GLint *height )
+{
+   gpuStateRec *state = GetGPUState();
+   rgbFileRec file;
+   rgbHeaderRec hdr;
+   GLenum format;
+   GLubyte *pixels, *client = NULL;
+   GLint levels, size;
+   GLboolean immutable = GL_FALSE;
+   GLboolean ok;
+
+   if (!state || (!state->GenerateMipmap && !state->generateMipmapParam))
+      return -1;
+
+   if (!RGBFileOpen(&file, imageFile)) {
+      fprintf(stderr, "File not found\n");
+      return 0;
+   }
+   if (!RGBParseHeader(&file, &hdr)) {
+      RGBFileClose(&file);
+      return 0;
+   }
+
+   if (hdr.sizeZ==3) {
+      format = GL_RGB;
+   }
+   else if (hdr.sizeZ==4) {
+      format = GL_RGBA;
+   }
+   else {
+      /* not implemented */
+      fprintf(stderr,
+              "Error in LoadRGBMipmaps %d-component images not implemented\n",
+              hdr.sizeZ );
+      RGBFileClose(&file);
+      return 0;
+   }
+
+   if (!state->npot &&
+       (!IsPowerOfTwo(hdr.sizeX) || !IsPowerOfTwo(hdr.sizeY))) {
+      RGBFileClose(&file);
+      return -1;
+   }
+
+   if (state->TexStorage2D &&
+       !CheckImmutable(SizedFormat(intFormat), hdr.sizeX, hdr.sizeY,
+                       &immutable)) {
+      fprintf(stderr, "%s: texture already has storage of another size\n",
+              imageFile);
+      RGBFileClose(&file);
+      return 0;
+   }
+
+   pixels = MapUploadBuffer(state, (gsize) hdr.sizeX * hdr.sizeY * hdr.sizeZ);
+   if (!pixels) {
+      pixels = client = (GLubyte *)
+         malloc((size_t) hdr.sizeX * hdr.sizeY * hdr.sizeZ);
+      if (!pixels) {
+         fprintf(stderr, "Out of memory!\n");
+         RGBFileClose(&file);
+         return 0;
+      }
+   }
+
+   ok = RGBDecode(&file, &hdr, pixels, hdr.sizeX * hdr.sizeZ);
+   RGBFileClose(&file);
+   if (!ok)
+      fprintf(stderr, "%s: corrupt image data\n", imageFile);
+
+   if (ok) {
+      /* Offset 0 into the unpack buffer, or the client copy. */
+      const GLvoid *data = client;
+
+      glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+      glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+      glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+
+      if (!state->GenerateMipmap)
+         glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+
+      if (state->TexStorage2D) {
+         if (!immutable) {
+            size = hdr.sizeX > hdr.sizeY ? hdr.sizeX : hdr.sizeY;
+            for (levels = 1; size > 1; levels++)
+               size >>= 1;
+            state->TexStorage2D(GL_TEXTURE_2D, levels,
+                                SizedFormat(intFormat),
+                                hdr.sizeX, hdr.sizeY);
+         }
+         glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, hdr.sizeX, hdr.sizeY,
+                         format, GL_UNSIGNED_BYTE, data);
+      }
+      else {
+         glTexImage2D(GL_TEXTURE_2D, 0, intFormat, hdr.sizeX, hdr.sizeY, 0,
+                      format, GL_UNSIGNED_BYTE, data);
+      }
+
+      if (!client) {
+         state->fence = state->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+         state->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+      }
+
+      if (state->GenerateMipmap)
+         state->GenerateMipmap(GL_TEXTURE_2D);
+
+      glPopClientAttrib();
+
+      *width = hdr.sizeX;
+      *height = hdr.sizeY;
+   }
+   else if (!client) {
+      state->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+   }
+
+   free(client);
+   return ok ? 1 : 0;
+}
+
+
+
 /*
  * Load an SGI .rgb file and generate a set of 2-D mipmaps from it.
+ * With a current GdkGLContext that supports it, the mipmaps are generated
+ * on the GPU and non-power-of-two images are not rescaled.
  * Input:  imageFile - name of .rgb to read
  *         intFormat - internal texture format to use, or number of components
  * Return:  GL_TRUE if success, GL_FALSE if error.
@@ -290,6 +774,12 @@ GLboolean LoadRGBMipmaps2( const char *imageFile, GLenum target,
    GLenum format;
    TK_RGBImageRec *image;
 
+   if (target == GL_TEXTURE_2D) {
+      int result = LoadRGBMipmapsGPU( imageFile, intFormat, width, height );
+      if (result >= 0)
+         return result ? GL_TRUE : GL_FALSE;
+   }
+
    image = tkRGBImageLoad( imageFile );
    if (!image) {
       return GL_FALSE;
@@ -306,6 +796,7 @@ GLboolean LoadRGBMipmaps2( const char *imageFile, GLenum target,
       fprintf(stderr,
               "Error in LoadRGBMipmaps %d-component images not implemented\n",
               image->components );
+      FreeImage(image);
       return GL_FALSE;
    }
 
@@ -338,7 +829,6 @@ GLubyte *LoadRGBImage( const char *imageFile, GLint *width, GLint *height,
                        GLenum *format )
 {
    TK_RGBImageRec *image;
-   GLint bytes;
    GLubyte *buffer;
 
    image = tkRGBImageLoad( imageFile );
@@ -357,20 +847,16 @@ GLubyte *LoadRGBImage( const char *imageFile, GLint *width, GLint *height,
       fprintf(stderr,
               "Error in LoadRGBImage %d-component images not implemented\n",
               image->components );
+      FreeImage(image);
       return NULL;
    }
 
    *width = image->sizeX;
    *height = image->sizeY;
 
-   bytes = image->sizeX * image->sizeY * image->components;
-   buffer = (GLubyte *) malloc(bytes);
-   if (!buffer)
-      return NULL;
-
-   memcpy( (void *) buffer, (void *) image->data, bytes );
-
-   FreeImage(image);
+   /* The decoded pixels are handed out as they are. */
+   buffer = image->data;
+   free(image);
 
    return buffer;
 }
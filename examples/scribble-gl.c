@@ -65,6 +65,9 @@ struct _Point
 /* List of all the brush stroke points. */
 static GList* brushStrokeList = NULL;
 
+/* Last brush stroke point already in the back buffer. */
+static GList* lastDrawnStroke = NULL;
+
 /* Thickness of the brush strokes. */
 static gint thickness = 5;
 
@@ -136,6 +139,7 @@ configure_event (GtkWidget         *widget,
     }
   g_list_free(brushStrokeList);
   brushStrokeList = NULL;
+  lastDrawnStroke = NULL;
 
   glViewport(0, 0, w, h);
   glMatrixMode(GL_PROJECTION);
@@ -160,34 +164,103 @@ draw (GtkWidget *widget,
       cairo_t   *cr,
       gpointer   data)
 {
-  guint count;
+  GtkAllocation allocation;
+  GdkRectangle damage;
+  GList* stroke;
   Point* coord;
+  gint x0, y0, x1, y1;
+
+  gtk_widget_get_allocation (widget, &allocation);
 
   /*** OpenGL BEGIN ***/
   if (!gtk_widget_begin_gl (widget))
     return FALSE;
 
-  glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  /* If the back buffer still holds the previous frame, only the
+     strokes added since then have to be drawn and presented. */
+  if (lastDrawnStroke != NULL &&
+      gdk_gl_drawable_get_buffer_age (gtk_widget_get_gl_drawable (widget)) == 1)
+    {
+      stroke = lastDrawnStroke->next;
+
+      /* Whatever was exposed is still valid in the back buffer. */
+      if (gdk_cairo_get_clip_rectangle (cr, &damage))
+        {
+          x0 = damage.x;
+          y0 = damage.y;
+          x1 = damage.x + damage.width;
+          y1 = damage.y + damage.height;
+        }
+      else
+        {
+          x0 = allocation.width;
+          y0 = allocation.height;
+          x1 = 0;
+          y1 = 0;
+        }
+    }
+  else
+    {
+      stroke = brushStrokeList;
+
+      glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+      x0 = 0;
+      y0 = 0;
+      x1 = allocation.width;
+      y1 = allocation.height;
+    }
 
   /* Set the foreground colour. */
   glColor3f(0.0,0.0,0.0);
 
   /* Draw the list of brush strokes. */
-  for (count=0; count<g_list_length(brushStrokeList); count++)
+  for (; stroke != NULL; stroke = stroke->next)
     {
-      coord = g_list_nth_data(brushStrokeList, count);
+      coord = stroke->data;
       glRecti(coord->x + thickness,
               coord->y - thickness,
               coord->x - thickness,
               coord->y + thickness);
+
+      /* Accumulate the damage in window coordinates. */
+      x0 = MIN (x0, coord->x - thickness);
+      x1 = MAX (x1, coord->x + thickness);
+      y0 = MIN (y0, allocation.height - coord->y - thickness);
+      y1 = MAX (y1, allocation.height - coord->y + thickness);
     }
 
-  gtk_widget_end_gl (widget, TRUE);
+  lastDrawnStroke = g_list_last (brushStrokeList);
+
+  damage.x = x0;
+  damage.y = y0;
+  damage.width = MAX (x1 - x0, 0);
+  damage.height = MAX (y1 - y0, 0);
+
+  gtk_widget_end_gl_with_damage (widget, &damage, 1);
   /*** OpenGL END ***/
 
   return TRUE;
 }
 
+/***
+ *** Invalidate the area covered by a single brush stroke point.
+ ***/
+static void
+invalidate_stroke (GtkWidget *widget,
+                   gdouble    x,
+                   gdouble    y)
+{
+  GdkRectangle rect;
+
+  rect.x = (gint) x - thickness;
+  rect.y = (gint) y - thickness;
+  rect.width = 2 * thickness + 1;
+  rect.height = 2 * thickness + 1;
+
+  gdk_window_invalidate_rect (gtk_widget_get_window (widget), &rect, FALSE);
+}
+
 /***
  *** The "motion_notify_event" signal handler. Any processing required when
  *** the OpenGL-capable drawing area is under drag motion should be done here.
@@ -208,7 +281,7 @@ motion_notify_event (GtkWidget      *widget,
       coord->y = allocation.height - event->y;
 
       brushStrokeList = g_list_append(brushStrokeList, coord);
-      gdk_window_invalidate_rect (gtk_widget_get_window (widget), &allocation, FALSE);
+      invalidate_stroke (widget, event->x, event->y);
       return TRUE;
     }
 
@@ -236,7 +309,7 @@ button_press_event (GtkWidget      *widget,
       coord->y = allocation.height - event->y;
 
       brushStrokeList = g_list_append(brushStrokeList, coord);
-      gdk_window_invalidate_rect (gtk_widget_get_window (widget), &allocation, FALSE);
+      invalidate_stroke (widget, event->x, event->y);
       return TRUE;
     }
 
@@ -47,7 +47,7 @@ static const GLuint shape_dodecahedron = 6;
 static const GLuint shape_icosahedron  = 7;
 static const GLuint shape_teapot       = 8;
 
-static GLuint shape_list_base = 0;
+static const ShapeMesh *shape_mesh[NUM_SHAPES];
 static GLuint shape_current = 8;
 
 typedef struct _MaterialProp
@@ -194,73 +194,60 @@ realize (GtkWidget *widget,
   glEnable (GL_DEPTH_TEST);
   glDepthFunc (GL_LESS);
 
-  /* Shape display lists */
-  shape_list_base = glGenLists (NUM_SHAPES);
+  /* Generate the shapes into the shape cache up front. */
+  shape_mesh[shape_cube]         = shape_cache_cube (1.5);
+  shape_mesh[shape_sphere]       = shape_cache_sphere (1.0, 30, 30);
+  shape_mesh[shape_cone]         = shape_cache_cone (1.0, 2.0, 30, 30);
+  shape_mesh[shape_torus]        = shape_cache_torus (0.4, 0.8, 30, 30);
+  shape_mesh[shape_tetrahedron]  = shape_cache_tetrahedron ();
+  shape_mesh[shape_octahedron]   = shape_cache_octahedron ();
+  shape_mesh[shape_dodecahedron] = shape_cache_dodecahedron ();
+  shape_mesh[shape_icosahedron]  = shape_cache_icosahedron ();
+  shape_mesh[shape_teapot]       = shape_cache_teapot (1.0, 7);
 
-  /* Cube */
-  glNewList (shape_list_base + shape_cube, GL_COMPILE);
-    draw_cube (TRUE, 1.5);
-  glEndList ();
-
-  /* Sphere */
-  glNewList (shape_list_base + shape_sphere, GL_COMPILE);
-    draw_sphere (TRUE, 1.0, 30, 30);
-  glEndList ();
-
-  /* Cone */
-  glNewList (shape_list_base + shape_cone, GL_COMPILE);
-    glPushMatrix ();
-      glTranslatef (0.0, 0.0, -1.0);
-      draw_cone (TRUE, 1.0, 2.0, 30, 30);
-    glPopMatrix ();
-  glEndList ();
-
-  /* Torus */
-  glNewList (shape_list_base + shape_torus, GL_COMPILE);
-    draw_torus (TRUE, 0.4, 0.8, 30, 30);
-  glEndList ();
-
-  /* Tetrahedron */
-  glNewList (shape_list_base + shape_tetrahedron, GL_COMPILE);
-    glPushMatrix ();
-      glScalef (1.2, 1.2, 1.2);
-      draw_tetrahedron (TRUE);
-    glPopMatrix ();
-  glEndList ();
-
-  /* Octahedron */
-  glNewList (shape_list_base + shape_octahedron, GL_COMPILE);
-    glPushMatrix ();
-      glScalef (1.2, 1.2, 1.2);
-      draw_octahedron (TRUE);
-    glPopMatrix ();
-  glEndList ();
+  gtk_widget_end_gl (widget, FALSE);
+  /*** OpenGL END ***/
 
-  /* Dodecahedron */
-  glNewList (shape_list_base + shape_dodecahedron, GL_COMPILE);
-    glPushMatrix ();
-      glScalef (0.7, 0.7, 0.7);
-      draw_dodecahedron (TRUE);
-    glPopMatrix ();
-  glEndList ();
+  return;
+}
 
-  /* Icosahedron */
-  glNewList (shape_list_base + shape_icosahedron, GL_COMPILE);
-    glPushMatrix ();
-      glScalef (1.2, 1.2, 1.2);
-      draw_icosahedron (TRUE);
-    glPopMatrix ();
-  glEndList ();
+static void
+unrealize (GtkWidget *widget,
+           gpointer   data)
+{
+  /*** OpenGL BEGIN ***/
+  if (!gtk_widget_begin_gl (widget))
+    return;
 
-  /* Teapot */
-  glNewList (shape_list_base + shape_teapot, GL_COMPILE);
-    draw_teapot (TRUE, 1.0);
-  glEndList ();
+  shape_cache_clear ();
 
   gtk_widget_end_gl (widget, FALSE);
   /*** OpenGL END ***/
+}
 
-  return;
+static void
+draw_shape (GLuint shape)
+{
+  /* The shape's own placement, as an instance matrix. */
+  GLfloat matrix[16] = { 1.0, 0.0, 0.0, 0.0,
+                         0.0, 1.0, 0.0, 0.0,
+                         0.0, 0.0, 1.0, 0.0,
+                         0.0, 0.0, 0.0, 1.0 };
+  GLfloat scale = 1.0;
+
+  if (shape == shape_cone)
+    matrix[14] = -1.0;
+  else if (shape == shape_tetrahedron ||
+           shape == shape_octahedron ||
+           shape == shape_icosahedron)
+    scale = 1.2;
+  else if (shape == shape_dodecahedron)
+    scale = 0.7;
+
+  matrix[0] = matrix[5] = matrix[10] = scale;
+
+  /* Lit with the current material. */
+  shape_mesh_draw_instanced (shape_mesh[shape], 1, matrix, NULL);
 }
 
 static gboolean
@@ -331,7 +318,7 @@ draw (GtkWidget *widget,
   glMaterialfv (GL_FRONT, GL_DIFFUSE, mat_current->diffuse);
   glMaterialfv (GL_FRONT, GL_SPECULAR, mat_current->specular);
   glMaterialf (GL_FRONT, GL_SHININESS, mat_current->shininess * 128.0);
-  glCallList (shape_list_base + shape_current);
+  draw_shape (shape_current);
 
   gtk_widget_end_gl (widget, TRUE);
   /*** OpenGL END ***/
@@ -946,6 +933,8 @@ main (int   argc,
 
   g_signal_connect_after (G_OBJECT (drawing_area), "realize",
                           G_CALLBACK (realize), NULL);
+  g_signal_connect (G_OBJECT (drawing_area), "unrealize",
+                    G_CALLBACK (unrealize), NULL);
   g_signal_connect (G_OBJECT (drawing_area), "configure_event",
 		    G_CALLBACK (configure_event), NULL);
   g_signal_connect (G_OBJECT (drawing_area), "draw",
@@ -70,27 +70,6 @@ realize (GtkWidget *widget,
   /*** OpenGL END ***/
 }
 
-static gboolean
-configure_event (GtkWidget         *widget,
-                 GdkEventConfigure *event,
-                 gpointer           data)
-{
-  GtkAllocation allocation;
-
-  /*** OpenGL BEGIN ***/
-  if (!gtk_widget_begin_gl (widget))
-    return FALSE;
-
-  gtk_widget_get_allocation (widget, &allocation);
-  glViewport (0, 0,
-              allocation.width, allocation.height);
-
-  gtk_widget_end_gl (widget, FALSE);
-  /*** OpenGL END ***/
-
-  return TRUE;
-}
-
 static gboolean
 draw (GtkWidget *widget, cairo_t *cr, gpointer data)
 {
@@ -265,8 +244,6 @@ main (int   argc,
 
   g_signal_connect_after (G_OBJECT (drawing_area), "realize",
                           G_CALLBACK (realize), NULL);
-  g_signal_connect (G_OBJECT (drawing_area), "configure-event",
-		    G_CALLBACK (configure_event), NULL);
   g_signal_connect (G_OBJECT (drawing_area), "draw",
 		    G_CALLBACK (draw), NULL);
 
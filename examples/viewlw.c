@@ -64,6 +64,8 @@ typedef struct
 {
   gint do_init;         /* true if initgl not yet called */
   lwObject *lwobject;   /* lightwave object mesh */
+  lwMesh *mesh;         /* lwobject compiled for the current context */
+  gboolean smooth;      /* smooth or flat normals */
   float beginx,beginy;  /* position of mouse */
   float dx,dy;
   float quat[4];        /* orientation of object */
@@ -78,11 +80,13 @@ const char help_text[] = "Usage: viewlw [OPTION]... [FILE]...\n"
 "\n"
 "Options:\n"
 "  --help                            display help\n"
+"  --benchmark                       time the vertex kernels on FILEs\n"
 "\n"
 "In the program:\n"
 "  Mouse button 1 + drag             spin (virtual trackball)\n"
 "  Mouse button 2 + drag             zoom\n"
 "  Mouse button 3                    popup menu\n"
+"  s                                 toggle smooth/flat shading\n"
 "\n";
 
 static GdkGLConfig *glconfig = NULL;
@@ -159,7 +163,9 @@ draw(GtkWidget *widget,
   build_rotmatrix(m,info->quat);
   glMultMatrixf(&m[0][0]);
 
-  lw_object_show(info->lwobject);
+  if (info->mesh == NULL)
+    info->mesh = lw_object_compile(info->lwobject, info->smooth);
+  lw_mesh_draw(info->mesh);
 
   gtk_widget_end_gl(widget, TRUE);
   /*** OpenGL END ***/
@@ -193,6 +199,21 @@ configure(GtkWidget         *widget,
   return TRUE;
 }
 
+static void
+unrealize(GtkWidget *widget)
+{
+  mesh_info *info = (mesh_info*)g_object_get_data(G_OBJECT(widget), "mesh_info");
+
+  /* buffer objects go away with the context */
+  if (info->mesh != NULL && gtk_widget_begin_gl (widget))
+    {
+      lw_mesh_free(info->mesh);
+      gtk_widget_end_gl (widget, FALSE);
+    }
+  info->mesh = NULL;
+  info->do_init = TRUE;
+}
+
 static void
 destroy(GtkWidget *widget)
 {
@@ -456,6 +477,18 @@ key_press_event(GtkWidget   *widget,
       gdk_window_invalidate_rect (window, &allocation, FALSE);
       break;
 
+    case GDK_KEY_s:
+      /* normals have changed, recompile mesh */
+      info->smooth = !info->smooth;
+      if (info->mesh != NULL && gtk_widget_begin_gl (widget))
+        {
+          lw_mesh_free(info->mesh);
+          info->mesh = NULL;
+          gtk_widget_end_gl (widget, FALSE);
+        }
+      gdk_window_invalidate_rect (window, &allocation, FALSE);
+      break;
+
     case GDK_KEY_Escape:
       gtk_main_quit();
       break;
@@ -546,6 +579,8 @@ show_lwobject(const char *lwobject_name)
       g_print("Can't read LightWave 3D object %s\n", lwobject_name);
       return FALSE;
     }
+  /* models off the origin used to spin around it, now around themselves */
+  lw_object_center(lwobject);
   lw_object_scale(lwobject, 10.0 / lw_object_radius(lwobject));
 
 
@@ -592,6 +627,8 @@ show_lwobject(const char *lwobject_name)
 		   G_CALLBACK (unmap_event), NULL);
   g_signal_connect(G_OBJECT (glarea), "visibility_notify_event",
 		   G_CALLBACK (visibility_notify_event), NULL);
+  g_signal_connect(G_OBJECT(glarea), "unrealize",
+                   G_CALLBACK(unrealize), NULL);
   g_signal_connect(G_OBJECT(glarea), "destroy",
                    G_CALLBACK(destroy), NULL);
 
@@ -601,6 +638,8 @@ show_lwobject(const char *lwobject_name)
   info = (mesh_info*)g_malloc(sizeof(mesh_info));
   info->do_init = TRUE;
   info->lwobject = lwobject;
+  info->mesh = NULL;
+  info->smooth = FALSE;
   info->beginx = 0;
   info->beginy = 0;
   info->dx = 0;
@@ -659,10 +698,147 @@ select_lwobject(void)
   gtk_widget_destroy(filew);
 }
 
+/*
+ * --benchmark: the scalar loops lw.c used before its vertex kernels, run
+ * against them on the object repeated to a few million vertices.
+ */
+
+#define BENCHMARK_VERTICES (1<<22)
+#define BENCHMARK_PASSES   10
+
+static GLfloat
+scalar_radius(const lwObject *lwo)
+{
+  int i;
+  double max_radius = 0.0;
+
+  for (i=0; i<lwo->vertex_cnt; i++) {
+    GLfloat *v = &lwo->vertex[i*3];
+    double r = v[0]*v[0] + v[1]*v[1] + v[2]*v[2];
+    if (r > max_radius)
+      max_radius = r;
+  }
+  return sqrt(max_radius);
+}
+
+static void
+scalar_scale(lwObject *lwo, GLfloat scale)
+{
+  int i;
+
+  for (i=0; i<lwo->vertex_cnt; i++) {
+    lwo->vertex[i*3+0] *= scale;
+    lwo->vertex[i*3+1] *= scale;
+    lwo->vertex[i*3+2] *= scale;
+  }
+}
+
+static void
+scalar_bounds(const lwObject *lwo, GLfloat min[3], GLfloat max[3])
+{
+  int i, j;
+
+  for (j=0; j<3; j++)
+    min[j] = max[j] = lwo->vertex[j];
+  for (i=1; i<lwo->vertex_cnt; i++)
+    for (j=0; j<3; j++) {
+      if (lwo->vertex[i*3+j] < min[j]) min[j] = lwo->vertex[i*3+j];
+      if (lwo->vertex[i*3+j] > max[j]) max[j] = lwo->vertex[i*3+j];
+    }
+}
+
+static void
+benchmark_lwobject(const char *lwobject_name)
+{
+  lwObject *lwobject, big;
+  GLfloat min[3], max[3];
+  GLfloat m[16] = { 1, 0, 0, 0,  0, 1, 0, 0,  0, 0, 1, 0,  0, 0, 0, 1 };
+  gint64 start, scalar[3], kernel[4];
+  GLfloat radius[2];
+  int i, n;
+
+  lwobject = lw_object_read(lwobject_name);
+  if (lwobject == NULL || lwobject->vertex_cnt == 0)
+    {
+      g_print("Can't read LightWave 3D object %s\n", lwobject_name);
+      if (lwobject != NULL)
+        lw_object_free(lwobject);
+      return;
+    }
+
+  memset(&big, 0, sizeof(big));
+  n = (BENCHMARK_VERTICES / lwobject->vertex_cnt + 1) * lwobject->vertex_cnt;
+  big.vertex_cnt = n;
+  big.vertex = g_new(GLfloat, n*3);
+  for (i=0; i<n; i+=lwobject->vertex_cnt)
+    memcpy(big.vertex + i*3, lwobject->vertex,
+           sizeof(GLfloat)*lwobject->vertex_cnt*3);
+
+  /* alternating exact scales keep every pass working on the same data */
+  memset(scalar, 0, sizeof(scalar));
+  memset(kernel, 0, sizeof(kernel));
+  for (i=0; i<BENCHMARK_PASSES; i++)
+    {
+      GLfloat scale = (i%2) ? 0.5 : 2.0;
+
+      start = g_get_monotonic_time();
+      radius[0] = scalar_radius(&big);
+      scalar[0] += g_get_monotonic_time() - start;
+      start = g_get_monotonic_time();
+      scalar_scale(&big, scale);
+      scalar[1] += g_get_monotonic_time() - start;
+      start = g_get_monotonic_time();
+      scalar_bounds(&big, min, max);
+      scalar[2] += g_get_monotonic_time() - start;
+
+      start = g_get_monotonic_time();
+      /* measured after scalar_scale, so divide that back out */
+      radius[1] = lw_object_radius(&big) / scale;
+      kernel[0] += g_get_monotonic_time() - start;
+      start = g_get_monotonic_time();
+      lw_object_scale(&big, 1.0 / scale);
+      kernel[1] += g_get_monotonic_time() - start;
+      start = g_get_monotonic_time();
+      lw_object_bounds(&big, min, max);
+      kernel[2] += g_get_monotonic_time() - start;
+      start = g_get_monotonic_time();
+      lw_object_transform(&big, m);
+      kernel[3] += g_get_monotonic_time() - start;
+    }
+
+  g_print("%s: %d vertices, %d processors, ms per pass\n",
+          lwobject_name, n, g_get_num_processors());
+  g_print("  radius     scalar %8.3f  kernel %8.3f\n",
+          scalar[0] / 1000.0 / BENCHMARK_PASSES,
+          kernel[0] / 1000.0 / BENCHMARK_PASSES);
+  g_print("  (value)    scalar %8.3f  kernel %8.3f\n",
+          radius[0], radius[1]);
+  g_print("  scale      scalar %8.3f  kernel %8.3f\n",
+          scalar[1] / 1000.0 / BENCHMARK_PASSES,
+          kernel[1] / 1000.0 / BENCHMARK_PASSES);
+  g_print("  bounds     scalar %8.3f  kernel %8.3f\n",
+          scalar[2] / 1000.0 / BENCHMARK_PASSES,
+          kernel[2] / 1000.0 / BENCHMARK_PASSES);
+  g_print("  transform                  kernel %8.3f\n",
+          kernel[3] / 1000.0 / BENCHMARK_PASSES);
+
+  g_free(big.vertex);
+  lw_object_free(lwobject);
+}
+
 int
 main(int    argc,
      char **argv)
 {
+  /* benchmark? needs no display */
+  if (argc >= 2 && strcmp(argv[1],"--benchmark")==0)
+    {
+      int i;
+      for (i=2; i<argc; i++)
+        benchmark_lwobject(argv[i]);
+      return 0;
+    }
+
   /* initialize gtk */
   gtk_init(&argc, &argv);
 
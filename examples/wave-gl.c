@@ -0,0 +1,524 @@
+/**************************************************************************
+ * wave-gl.c
+ *
+ * The coolwave simulation run on the GPU.
+ *
+ * This program is in the public domain and you are using it at
+ * your own risk.
+ *
+ **************************************************************************/
+
+/*
+ * Positions and velocities live in two pairs of buffer objects.  A
+ * step is one point per grid point through a vertex shader which
+ * reads the neighbours from a buffer texture over the current
+ * positions, applies the same springs as wave.c and captures the new
+ * state into the other pair with transform feedback.  The positions
+ * are stored as (i, j, height, 1), so the wireframe is drawn straight
+ * from the current position buffer, as line strips split with
+ * primitive restart.  Only wave_gl_load() and wave_gl_store() move
+ * data between the CPU and the GPU.
+ *
+ * This needs OpenGL 3.1, and a buffer texture that holds every grid
+ * point; wave_gl_new() returns NULL otherwise.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "wave-gl.h"
+
+#include <gdk/gdkgl.h>
+
+#ifdef G_OS_WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+#endif
+
+#ifdef GDK_WINDOWING_QUARTZ
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#ifdef GL_VERSION_3_1
+
+#define RESTART_INDEX 0xffffffff
+
+static const char *step_shader =
+  "#version 140\n"
+  "in vec4 position;\n"
+  "in float velocity;\n"
+  "out vec4 new_position;\n"
+  "out float new_velocity;\n"
+  "uniform samplerBuffer positions;\n"
+  "uniform int grid;\n"
+  "uniform float dt;\n"
+  "const ivec2 offset[8] = ivec2[8] (ivec2 (0, -1), ivec2 (0, 1),\n"
+  "                                  ivec2 (-1, 0), ivec2 (1, 0),\n"
+  "                                  ivec2 (-1, -1), ivec2 (-1, 1),\n"
+  "                                  ivec2 (1, -1), ivec2 (1, 1));\n"
+  "float inner (ivec2 p)\n"
+  "{\n"
+  "  return all (greaterThanEqual (p, ivec2 (2))) &&\n"
+  "         all (lessThan (p, ivec2 (grid - 2))) ? 1.0 : 0.0;\n"
+  "}\n"
+  "void main ()\n"
+  "{\n"
+  "  ivec2 p = ivec2 (gl_VertexID / grid, gl_VertexID % grid);\n"
+  "  float force = 0.0;\n"
+  "  for (int k = 0; k < 8; k++)\n"
+  "    {\n"
+  "      ivec2 n = p + offset[k];\n"
+  "      if (any (lessThan (n, ivec2 (0))) || any (greaterThanEqual (n, ivec2 (grid))))\n"
+  "        continue;\n"
+  "      float weight = k < 4 ? 1.0 : 0.70710678;\n"
+  "      float height = texelFetch (positions, n.x * grid + n.y).z;\n"
+  "      force += (inner (p) + inner (n)) * weight * (height - position.z);\n"
+  "    }\n"
+  "  new_velocity = velocity + force * dt;\n"
+  "  new_position = vec4 (position.xy, position.z + new_velocity, 1.0);\n"
+  "}\n";
+
+struct _WaveGL
+{
+  int     grid;
+  float   dt;
+
+  int     current;              /* which pair holds the state */
+  GLuint  position[2];          /* vec4 (i, j, height, 1) per point */
+  GLuint  velocity[2];          /* float per point */
+  GLuint  texture[2];           /* buffer textures over position[] */
+  GLuint  index_buffer;         /* row and column line strips */
+  GLsizei index_cnt;
+
+  GLuint  program;
+  GLint   positions_location;
+
+  PFNGLGENBUFFERSPROC GenBuffers;
+  PFNGLDELETEBUFFERSPROC DeleteBuffers;
+  PFNGLBINDBUFFERPROC BindBuffer;
+  PFNGLBUFFERDATAPROC BufferData;
+  PFNGLBUFFERSUBDATAPROC BufferSubData;
+  PFNGLGETBUFFERSUBDATAPROC GetBufferSubData;
+  PFNGLBINDBUFFERBASEPROC BindBufferBase;
+  PFNGLTEXBUFFERPROC TexBuffer;
+  PFNGLCREATESHADERPROC CreateShader;
+  PFNGLSHADERSOURCEPROC ShaderSource;
+  PFNGLCOMPILESHADERPROC CompileShader;
+  PFNGLGETSHADERIVPROC GetShaderiv;
+  PFNGLDELETESHADERPROC DeleteShader;
+  PFNGLCREATEPROGRAMPROC CreateProgram;
+  PFNGLATTACHSHADERPROC AttachShader;
+  PFNGLBINDATTRIBLOCATIONPROC BindAttribLocation;
+  PFNGLTRANSFORMFEEDBACKVARYINGSPROC TransformFeedbackVaryings;
+  PFNGLLINKPROGRAMPROC LinkProgram;
+  PFNGLGETPROGRAMIVPROC GetProgramiv;
+  PFNGLUSEPROGRAMPROC UseProgram;
+  PFNGLDELETEPROGRAMPROC DeleteProgram;
+  PFNGLGETUNIFORMLOCATIONPROC GetUniformLocation;
+  PFNGLUNIFORM1IPROC Uniform1i;
+  PFNGLUNIFORM1FPROC Uniform1f;
+  PFNGLVERTEXATTRIBPOINTERPROC VertexAttribPointer;
+  PFNGLENABLEVERTEXATTRIBARRAYPROC EnableVertexAttribArray;
+  PFNGLBEGINTRANSFORMFEEDBACKPROC BeginTransformFeedback;
+  PFNGLENDTRANSFORMFEEDBACKPROC EndTransformFeedback;
+  PFNGLPRIMITIVERESTARTINDEXPROC PrimitiveRestartIndex;
+};
+
+static gboolean
+get_procs (WaveGL *wave_gl)
+{
+  gboolean ok = TRUE;
+
+#define GET_PROC(type, proc) \
+  ok = ok && (wave_gl->proc = (type) gdk_gl_get_proc_address ("gl" #proc)) != NULL
+
+  GET_PROC (PFNGLGENBUFFERSPROC, GenBuffers);
+  GET_PROC (PFNGLDELETEBUFFERSPROC, DeleteBuffers);
+  GET_PROC (PFNGLBINDBUFFERPROC, BindBuffer);
+  GET_PROC (PFNGLBUFFERDATAPROC, BufferData);
+  GET_PROC (PFNGLBUFFERSUBDATAPROC, BufferSubData);
+  GET_PROC (PFNGLGETBUFFERSUBDATAPROC, GetBufferSubData);
+  GET_PROC (PFNGLBINDBUFFERBASEPROC, BindBufferBase);
+  GET_PROC (PFNGLTEXBUFFERPROC, TexBuffer);
+  GET_PROC (PFNGLCREATESHADERPROC, CreateShader);
+  GET_PROC (PFNGLSHADERSOURCEPROC, ShaderSource);
+  GET_PROC (PFNGLCOMPILESHADERPROC, CompileShader);
+  GET_PROC (PFNGLGETSHADERIVPROC, GetShaderiv);
+  GET_PROC (PFNGLDELETESHADERPROC, DeleteShader);
+  GET_PROC (PFNGLCREATEPROGRAMPROC, CreateProgram);
+  GET_PROC (PFNGLATTACHSHADERPROC, AttachShader);
+  GET_PROC (PFNGLBINDATTRIBLOCATIONPROC, BindAttribLocation);
+  GET_PROC (PFNGLTRANSFORMFEEDBACKVARYINGSPROC, TransformFeedbackVaryings);
+  GET_PROC (PFNGLLINKPROGRAMPROC, LinkProgram);
+  GET_PROC (PFNGLGETPROGRAMIVPROC, GetProgramiv);
+  GET_PROC (PFNGLUSEPROGRAMPROC, UseProgram);
+  GET_PROC (PFNGLDELETEPROGRAMPROC, DeleteProgram);
+  GET_PROC (PFNGLGETUNIFORMLOCATIONPROC, GetUniformLocation);
+  GET_PROC (PFNGLUNIFORM1IPROC, Uniform1i);
+  GET_PROC (PFNGLUNIFORM1FPROC, Uniform1f);
+  GET_PROC (PFNGLVERTEXATTRIBPOINTERPROC, VertexAttribPointer);
+  GET_PROC (PFNGLENABLEVERTEXATTRIBARRAYPROC, EnableVertexAttribArray);
+  GET_PROC (PFNGLBEGINTRANSFORMFEEDBACKPROC, BeginTransformFeedback);
+  GET_PROC (PFNGLENDTRANSFORMFEEDBACKPROC, EndTransformFeedback);
+  GET_PROC (PFNGLPRIMITIVERESTARTINDEXPROC, PrimitiveRestartIndex);
+
+#undef GET_PROC
+
+  return ok;
+}
+
+static gboolean
+create_program (WaveGL *wave_gl)
+{
+  static const char *varyings[] = { "new_position", "new_velocity" };
+  GLuint shader;
+  GLint status = 0;
+
+  shader = wave_gl->CreateShader (GL_VERTEX_SHADER);
+  wave_gl->ShaderSource (shader, 1, &step_shader, NULL);
+  wave_gl->CompileShader (shader);
+  wave_gl->GetShaderiv (shader, GL_COMPILE_STATUS, &status);
+  if (!status)
+    {
+      wave_gl->DeleteShader (shader);
+      return FALSE;
+    }
+
+  wave_gl->program = wave_gl->CreateProgram ();
+  wave_gl->AttachShader (wave_gl->program, shader);
+  wave_gl->DeleteShader (shader);
+
+  wave_gl->BindAttribLocation (wave_gl->program, 0, "position");
+  wave_gl->BindAttribLocation (wave_gl->program, 1, "velocity");
+  wave_gl->TransformFeedbackVaryings (wave_gl->program, 2, varyings,
+                                      GL_SEPARATE_ATTRIBS);
+  wave_gl->LinkProgram (wave_gl->program);
+  wave_gl->GetProgramiv (wave_gl->program, GL_LINK_STATUS, &status);
+  if (!status)
+    {
+      wave_gl->DeleteProgram (wave_gl->program);
+      wave_gl->program = 0;
+      return FALSE;
+    }
+
+  wave_gl->positions_location = wave_gl->GetUniformLocation (wave_gl->program,
+                                                             "positions");
+
+  /* the uniforms that never change */
+  wave_gl->UseProgram (wave_gl->program);
+  wave_gl->Uniform1i (wave_gl->GetUniformLocation (wave_gl->program, "grid"),
+                      wave_gl->grid);
+  wave_gl->Uniform1f (wave_gl->GetUniformLocation (wave_gl->program, "dt"),
+                      wave_gl->dt);
+  wave_gl->UseProgram (0);
+
+  return TRUE;
+}
+
+static void
+create_buffers (WaveGL *wave_gl)
+{
+  int grid = wave_gl->grid;
+  GLuint *index, *p;
+  int i, j, k;
+
+  wave_gl->GenBuffers (2, wave_gl->position);
+  wave_gl->GenBuffers (2, wave_gl->velocity);
+  glGenTextures (2, wave_gl->texture);
+
+  for (k = 0; k < 2; k++)
+    {
+      wave_gl->BindBuffer (GL_ARRAY_BUFFER, wave_gl->position[k]);
+      wave_gl->BufferData (GL_ARRAY_BUFFER, grid * grid * 4 * sizeof (GLfloat),
+                           NULL, GL_DYNAMIC_COPY);
+      wave_gl->BindBuffer (GL_ARRAY_BUFFER, wave_gl->velocity[k]);
+      wave_gl->BufferData (GL_ARRAY_BUFFER, grid * grid * sizeof (GLfloat),
+                           NULL, GL_DYNAMIC_COPY);
+
+      glBindTexture (GL_TEXTURE_BUFFER, wave_gl->texture[k]);
+      wave_gl->TexBuffer (GL_TEXTURE_BUFFER, GL_RGBA32F, wave_gl->position[k]);
+    }
+  glBindTexture (GL_TEXTURE_BUFFER, 0);
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, 0);
+
+  /* one strip along each row and one down each column */
+  wave_gl->index_cnt = 2 * grid * (grid + 1);
+  index = p = g_new (GLuint, wave_gl->index_cnt);
+  for (i = 0; i < grid; i++)
+    {
+      for (j = 0; j < grid; j++)
+        *p++ = i * grid + j;
+      *p++ = RESTART_INDEX;
+    }
+  for (i = 0; i < grid; i++)
+    {
+      for (j = 0; j < grid; j++)
+        *p++ = j * grid + i;
+      *p++ = RESTART_INDEX;
+    }
+
+  wave_gl->GenBuffers (1, &wave_gl->index_buffer);
+  wave_gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, wave_gl->index_buffer);
+  wave_gl->BufferData (GL_ELEMENT_ARRAY_BUFFER,
+                       wave_gl->index_cnt * sizeof (GLuint), index,
+                       GL_STATIC_DRAW);
+  wave_gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  g_free (index);
+}
+
+/**
+ * wave_gl_new:
+ * @wave: the wave to take the grid, time step and state from.
+ *
+ * Creates the GPU state for @wave in the current OpenGL context, which
+ * has to stay current for the other wave_gl_ calls.
+ *
+ * Return value: the new #WaveGL, or NULL if OpenGL 3.1 is not available
+ * or the grid has more points than a buffer texture can hold.
+ **/
+WaveGL *
+wave_gl_new (const Wave *wave)
+{
+  WaveGL *wave_gl;
+  const char *version;
+  int major = 0, minor = 0;
+  GLint max_texels = 0;
+
+  g_return_val_if_fail (wave != NULL, NULL);
+
+  version = (const char *) glGetString (GL_VERSION);
+  if (version == NULL || sscanf (version, "%d.%d", &major, &minor) != 2 ||
+      major < 3 || (major == 3 && minor < 1))
+    return NULL;
+
+  /* the step shader fetches the neighbours from one buffer texture */
+  glGetIntegerv (GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+  if ((gint64) wave->grid * wave->grid > max_texels)
+    return NULL;
+
+  wave_gl = g_new0 (WaveGL, 1);
+  wave_gl->grid = wave->grid;
+  wave_gl->dt = wave->dt;
+
+  if (!get_procs (wave_gl) || !create_program (wave_gl))
+    {
+      g_free (wave_gl);
+      return NULL;
+    }
+
+  create_buffers (wave_gl);
+  wave_gl_load (wave_gl, wave);
+
+  return wave_gl;
+}
+
+/**
+ * wave_gl_free:
+ * @wave_gl: a #WaveGL.
+ *
+ * Frees @wave_gl and its OpenGL objects.
+ **/
+void
+wave_gl_free (WaveGL *wave_gl)
+{
+  g_return_if_fail (wave_gl != NULL);
+
+  wave_gl->DeleteProgram (wave_gl->program);
+  glDeleteTextures (2, wave_gl->texture);
+  wave_gl->DeleteBuffers (2, wave_gl->position);
+  wave_gl->DeleteBuffers (2, wave_gl->velocity);
+  wave_gl->DeleteBuffers (1, &wave_gl->index_buffer);
+
+  g_free (wave_gl);
+}
+
+/**
+ * wave_gl_load:
+ * @wave_gl: a #WaveGL.
+ * @wave: a wave with the same grid.
+ *
+ * Uploads the positions and velocities of @wave.
+ **/
+void
+wave_gl_load (WaveGL     *wave_gl,
+              const Wave *wave)
+{
+  int grid = wave_gl->grid;
+  GLfloat *position;
+  int i, j;
+
+  g_return_if_fail (wave->grid == grid);
+
+  position = g_new (GLfloat, grid * grid * 4);
+  for (i = 0; i < grid; i++)
+    for (j = 0; j < grid; j++)
+      {
+        GLfloat *p = position + (i * grid + j) * 4;
+
+        p[0] = i;
+        p[1] = j;
+        p[2] = wave->position[i * grid + j];
+        p[3] = 1.0;
+      }
+
+  wave_gl->current = 0;
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, wave_gl->position[0]);
+  wave_gl->BufferSubData (GL_ARRAY_BUFFER, 0,
+                          grid * grid * 4 * sizeof (GLfloat), position);
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, wave_gl->velocity[0]);
+  wave_gl->BufferSubData (GL_ARRAY_BUFFER, 0,
+                          grid * grid * sizeof (GLfloat), wave->velocity);
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, 0);
+
+  g_free (position);
+}
+
+/**
+ * wave_gl_store:
+ * @wave_gl: a #WaveGL.
+ * @wave: a wave with the same grid.
+ *
+ * Reads the positions and velocities back into @wave.
+ **/
+void
+wave_gl_store (WaveGL *wave_gl,
+               Wave   *wave)
+{
+  int grid = wave_gl->grid;
+  GLfloat *position;
+  int n;
+
+  g_return_if_fail (wave->grid == grid);
+
+  position = g_new (GLfloat, grid * grid * 4);
+
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, wave_gl->position[wave_gl->current]);
+  wave_gl->GetBufferSubData (GL_ARRAY_BUFFER, 0,
+                             grid * grid * 4 * sizeof (GLfloat), position);
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, wave_gl->velocity[wave_gl->current]);
+  wave_gl->GetBufferSubData (GL_ARRAY_BUFFER, 0,
+                             grid * grid * sizeof (GLfloat), wave->velocity);
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, 0);
+
+  for (n = 0; n < grid * grid; n++)
+    wave->position[n] = position[n * 4 + 2];
+
+  g_free (position);
+}
+
+/**
+ * wave_gl_step:
+ * @wave_gl: a #WaveGL.
+ *
+ * Advances the wave by one time step on the GPU.
+ **/
+void
+wave_gl_step (WaveGL *wave_gl)
+{
+  int src = wave_gl->current;
+  int dst = 1 - src;
+  GLint program = 0, unit = GL_TEXTURE0;
+
+  glGetIntegerv (GL_CURRENT_PROGRAM, &program);
+  glGetIntegerv (GL_ACTIVE_TEXTURE, &unit);
+
+  glPushClientAttrib (GL_CLIENT_VERTEX_ARRAY_BIT);
+
+  wave_gl->UseProgram (wave_gl->program);
+  wave_gl->Uniform1i (wave_gl->positions_location, unit - GL_TEXTURE0);
+  glBindTexture (GL_TEXTURE_BUFFER, wave_gl->texture[src]);
+
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, wave_gl->position[src]);
+  wave_gl->VertexAttribPointer (0, 4, GL_FLOAT, GL_FALSE, 0, NULL);
+  wave_gl->EnableVertexAttribArray (0);
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, wave_gl->velocity[src]);
+  wave_gl->VertexAttribPointer (1, 1, GL_FLOAT, GL_FALSE, 0, NULL);
+  wave_gl->EnableVertexAttribArray (1);
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, 0);
+
+  wave_gl->BindBufferBase (GL_TRANSFORM_FEEDBACK_BUFFER, 0, wave_gl->position[dst]);
+  wave_gl->BindBufferBase (GL_TRANSFORM_FEEDBACK_BUFFER, 1, wave_gl->velocity[dst]);
+
+  glEnable (GL_RASTERIZER_DISCARD);
+  wave_gl->BeginTransformFeedback (GL_POINTS);
+  glDrawArrays (GL_POINTS, 0, wave_gl->grid * wave_gl->grid);
+  wave_gl->EndTransformFeedback ();
+  glDisable (GL_RASTERIZER_DISCARD);
+
+  wave_gl->BindBufferBase (GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+  wave_gl->BindBufferBase (GL_TRANSFORM_FEEDBACK_BUFFER, 1, 0);
+  glBindTexture (GL_TEXTURE_BUFFER, 0);
+  wave_gl->UseProgram (program);
+
+  glPopClientAttrib ();
+
+  wave_gl->current = dst;
+}
+
+/**
+ * wave_gl_draw:
+ * @wave_gl: a #WaveGL.
+ *
+ * Draws the wave as a wireframe in the current color, with grid point
+ * (i, j) at x = i and y = j.
+ **/
+void
+wave_gl_draw (WaveGL *wave_gl)
+{
+  glPushClientAttrib (GL_CLIENT_VERTEX_ARRAY_BIT);
+
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, wave_gl->position[wave_gl->current]);
+  glEnableClientState (GL_VERTEX_ARRAY);
+  glVertexPointer (4, GL_FLOAT, 0, NULL);
+  wave_gl->BindBuffer (GL_ARRAY_BUFFER, 0);
+
+  wave_gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, wave_gl->index_buffer);
+  glEnable (GL_PRIMITIVE_RESTART);
+  wave_gl->PrimitiveRestartIndex (RESTART_INDEX);
+  glDrawElements (GL_LINE_STRIP, wave_gl->index_cnt, GL_UNSIGNED_INT, NULL);
+  glDisable (GL_PRIMITIVE_RESTART);
+  wave_gl->BindBuffer (GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  glPopClientAttrib ();
+}
+
+#else /* !GL_VERSION_3_1 */
+
+WaveGL *
+wave_gl_new (const Wave *wave)
+{
+  return NULL;
+}
+
+void
+wave_gl_free (WaveGL *wave_gl)
+{
+}
+
+void
+wave_gl_load (WaveGL     *wave_gl,
+              const Wave *wave)
+{
+}
+
+void
+wave_gl_store (WaveGL *wave_gl,
+               Wave   *wave)
+{
+}
+
+void
+wave_gl_step (WaveGL *wave_gl)
+{
+}
+
+void
+wave_gl_draw (WaveGL *wave_gl)
+{
+}
+
+#endif /* !GL_VERSION_3_1 */
@@ -0,0 +1,36 @@
+/**************************************************************************
+ * wave-gl.h
+ *
+ * The coolwave simulation run on the GPU.
+ *
+ * This program is in the public domain and you are using it at
+ * your own risk.
+ *
+ **************************************************************************/
+
+#ifndef __WAVE_GL_H__
+#define __WAVE_GL_H__
+
+#include "wave.h"
+
+G_BEGIN_DECLS
+
+typedef struct _WaveGL WaveGL;
+
+WaveGL *wave_gl_new   (const Wave *wave);
+
+void    wave_gl_free  (WaveGL     *wave_gl);
+
+void    wave_gl_load  (WaveGL     *wave_gl,
+                       const Wave *wave);
+
+void    wave_gl_store (WaveGL     *wave_gl,
+                       Wave       *wave);
+
+void    wave_gl_step  (WaveGL     *wave_gl);
+
+void    wave_gl_draw  (WaveGL     *wave_gl);
+
+G_END_DECLS
+
+#endif /* __WAVE_GL_H__ */
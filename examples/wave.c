@@ -0,0 +1,316 @@
+/**************************************************************************
+ * wave.c
+ *
+ * The wave simulation shared by the coolwave examples, originally from
+ * the IrisGL demo 'newave'.
+ *
+ * This program is in the public domain and you are using it at
+ * your own risk.
+ *
+ **************************************************************************/
+
+/*
+ * Every point is joined to its 8 neighbours by springs, the diagonal
+ * ones 1/sqrt(2) as stiff.  Springs are driven from both ends by the
+ * points 2 or more away from the border, so between two such points a
+ * spring counts twice, between one of them and an outer point once and
+ * between two outer points not at all.
+ *
+ * wave_step() gathers the force on each point from the current
+ * positions and writes the new positions into a second buffer, so rows
+ * are independent and are split across a thread pool.  The rows away
+ * from the border take a branch-free loop over contiguous floats which
+ * the compiler vectorizes.
+ */
+
+#include <math.h>
+
+#include "wave.h"
+
+#define SQRTOFTWOINV (1.0 / 1.414213562)
+
+/* lets the compiler vectorize step_inner_row() without alias checks */
+#if defined (__GNUC__) || defined (_MSC_VER)
+#define WAVE_RESTRICT __restrict
+#else
+#define WAVE_RESTRICT
+#endif
+
+#define WAVE_SPAN_MIN   16384   /* fewest points worth a thread */
+#define WAVE_MAX_SPANS  16
+
+typedef struct
+{
+  GMutex mutex;
+  GCond  cond;
+  int    pending;
+} WaveJob;
+
+typedef struct
+{
+  Wave    *wave;
+  int      first;               /* rows */
+  int      last;
+  WaveJob *job;
+} WaveSpan;
+
+static GThreadPool *pool = NULL;
+
+/* whether the point drives its springs */
+static int
+is_inner (int grid,
+          int i,
+          int j)
+{
+  return i >= 2 && i < grid - 2 && j >= 2 && j < grid - 2;
+}
+
+static float
+point_force (const float *position,
+             int          grid,
+             int          i,
+             int          j)
+{
+  static const int di[8] = { 0, 0, -1, 1, -1, -1, 1, 1 };
+  static const int dj[8] = { -1, 1, 0, 0, -1, 1, -1, 1 };
+  float p = position[i * grid + j];
+  float force = 0.0;
+  int inner = is_inner (grid, i, j);
+  int k;
+
+  for (k = 0; k < 8; k++)
+    {
+      int ni = i + di[k], nj = j + dj[k];
+      int count;
+
+      if (ni < 0 || ni >= grid || nj < 0 || nj >= grid)
+        continue;
+
+      count = inner + is_inner (grid, ni, nj);
+      if (count > 0)
+        force += count * (k < 4 ? 1.0f : (float) SQRTOFTWOINV)
+                       * (position[ni * grid + nj] - p);
+    }
+
+  return force;
+}
+
+static void
+step_point (Wave *wave,
+            int   i,
+            int   j)
+{
+  int n = i * wave->grid + j;
+
+  wave->velocity[n] += point_force (wave->position, wave->grid, i, j) * wave->dt;
+  wave->next[n] = wave->position[n] + wave->velocity[n];
+}
+
+/* a row with all 8 neighbours inner, for columns 3 to grid - 4 */
+static void
+step_inner_row (const float *WAVE_RESTRICT up,
+                const float *WAVE_RESTRICT row,
+                const float *WAVE_RESTRICT down,
+                float       *WAVE_RESTRICT velocity,
+                float       *WAVE_RESTRICT next,
+                int                        first,
+                int                        last,
+                float                      dt)
+{
+  const float diagonal = SQRTOFTWOINV;
+  const float dt2 = 2.0f * dt;
+  int j;
+
+  for (j = first; j < last; j++)
+    {
+      float p = row[j];
+      float force = (row[j - 1] + row[j + 1] + up[j] + down[j] - 4.0f * p) +
+        diagonal * (up[j - 1] + up[j + 1] + down[j - 1] + down[j + 1] - 4.0f * p);
+
+      velocity[j] += force * dt2;
+      next[j] = p + velocity[j];
+    }
+}
+
+static void
+step_rows (Wave *wave,
+           int   first,
+           int   last)
+{
+  int grid = wave->grid;
+  int i, j;
+
+  for (i = first; i < last; i++)
+    {
+      if (i >= 3 && i < grid - 3)
+        {
+          const float *row = wave->position + i * grid;
+
+          for (j = 0; j < 3; j++)
+            step_point (wave, i, j);
+
+          step_inner_row (row - grid, row, row + grid,
+                          wave->velocity + i * grid, wave->next + i * grid,
+                          3, grid - 3, wave->dt);
+
+          for (j = grid - 3; j < grid; j++)
+            step_point (wave, i, j);
+        }
+      else
+        {
+          for (j = 0; j < grid; j++)
+            step_point (wave, i, j);
+        }
+    }
+}
+
+static void
+run_span (gpointer data,
+          gpointer user_data)
+{
+  WaveSpan *span = data;
+
+  step_rows (span->wave, span->first, span->last);
+
+  g_mutex_lock (&span->job->mutex);
+  if (--span->job->pending == 0)
+    g_cond_signal (&span->job->cond);
+  g_mutex_unlock (&span->job->mutex);
+}
+
+/**
+ * wave_new:
+ * @grid: number of points along each side, at least 8.
+ * @dt: time step.
+ *
+ * Creates a wave simulation in its initial state, see wave_reset().
+ *
+ * Return value: the new wave.
+ **/
+Wave *
+wave_new (int   grid,
+          float dt)
+{
+  Wave *wave;
+
+  g_return_val_if_fail (grid >= 8, NULL);
+
+  wave = g_new0 (Wave, 1);
+  wave->grid = grid;
+  wave->dt = dt;
+  wave->position = g_new (float, grid * grid);
+  wave->velocity = g_new (float, grid * grid);
+  wave->next = g_new (float, grid * grid);
+
+  wave_reset (wave);
+
+  if (pool == NULL && g_get_num_processors () > 1)
+    pool = g_thread_pool_new (run_span, NULL,
+                              MIN (g_get_num_processors (), WAVE_MAX_SPANS) - 1,
+                              TRUE, NULL);
+
+  return wave;
+}
+
+/**
+ * wave_free:
+ * @wave: a wave.
+ *
+ * Frees @wave.
+ **/
+void
+wave_free (Wave *wave)
+{
+  g_return_if_fail (wave != NULL);
+
+  g_free (wave->position);
+  g_free (wave->velocity);
+  g_free (wave->next);
+  g_free (wave);
+}
+
+/**
+ * wave_reset:
+ * @wave: a wave.
+ *
+ * Puts @wave back at rest in the shape of two crossed sine waves, with
+ * the border points at zero.
+ **/
+void
+wave_reset (Wave *wave)
+{
+  int grid = wave->grid;
+  int i, j;
+
+  for (i = 0; i < grid; i++)
+    {
+      for (j = 0; j < grid; j++)
+        {
+          int n = i * grid + j;
+
+          wave->velocity[n] = 0.0;
+
+          if (i == 0 || j == 0 || i == grid - 1 || j == grid - 1)
+            wave->position[n] = 0.0;
+          else
+            wave->position[n] = (sin (G_PI * 2 * ((float) i / (float) grid)) +
+                                 sin (G_PI * 2 * ((float) j / (float) grid))) * grid / 6.0;
+        }
+    }
+}
+
+/**
+ * wave_step:
+ * @wave: a wave.
+ *
+ * Advances @wave by one time step.  Large grids are split across
+ * threads by rows.
+ **/
+void
+wave_step (Wave *wave)
+{
+  WaveSpan span[WAVE_MAX_SPANS];
+  WaveJob job;
+  float *swap;
+  int span_cnt = 1;
+  int i, first = 0;
+
+  g_return_if_fail (wave != NULL);
+
+  if (pool != NULL)
+    span_cnt = CLAMP (wave->grid * wave->grid / WAVE_SPAN_MIN, 1,
+                      (int) g_thread_pool_get_max_threads (pool) + 1);
+
+  g_mutex_init (&job.mutex);
+  g_cond_init (&job.cond);
+  job.pending = span_cnt - 1;
+
+  for (i = 0; i < span_cnt; i++)
+    {
+      int last = wave->grid * (i + 1) / span_cnt;
+
+      span[i].wave = wave;
+      span[i].first = first;
+      span[i].last = last;
+      span[i].job = &job;
+      first = last;
+    }
+
+  /* the calling thread takes the first span */
+  for (i = 1; i < span_cnt; i++)
+    if (!g_thread_pool_push (pool, &span[i], NULL))
+      run_span (&span[i], NULL);
+  step_rows (wave, span[0].first, span[0].last);
+
+  g_mutex_lock (&job.mutex);
+  while (job.pending > 0)
+    g_cond_wait (&job.cond, &job.mutex);
+  g_mutex_unlock (&job.mutex);
+
+  g_mutex_clear (&job.mutex);
+  g_cond_clear (&job.cond);
+
+  swap = wave->position;
+  wave->position = wave->next;
+  wave->next = swap;
+}
@@ -0,0 +1,45 @@
+/**************************************************************************
+ * wave.h
+ *
+ * The wave simulation shared by the coolwave examples, originally from
+ * the IrisGL demo 'newave'.
+ *
+ * This program is in the public domain and you are using it at
+ * your own risk.
+ *
+ **************************************************************************/
+
+#ifndef __WAVE_H__
+#define __WAVE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _Wave Wave;
+
+struct _Wave
+{
+  int    grid;          /* points along each side */
+  float  dt;
+
+  /* grid * grid values, row-major: point (i, j) is at [i * grid + j] */
+  float *position;
+  float *velocity;
+
+  /*< private >*/
+  float *next;          /* positions being computed by wave_step() */
+};
+
+Wave *wave_new   (int   grid,
+                  float dt);
+
+void  wave_free  (Wave *wave);
+
+void  wave_reset (Wave *wave);
+
+void  wave_step  (Wave *wave);
+
+G_END_DECLS
+
+#endif /* __WAVE_H__ */
@@ -32,6 +32,8 @@
 #include "gdkglquery.h"
 #include "gdkglconfig.h"
 #include "gdkglcontext.h"
+#include "gdkglstate.h"
+#include "gdkglmultisample.h"
 #include "gdkgldrawable.h"
 #include "gdkglwindow.h"
 
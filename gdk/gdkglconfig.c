@@ -104,12 +104,18 @@ gdk_gl_config_new_ci (GdkScreen       *screen,
   return NULL;
 }
 
+/* Samples per pixel requested by GDK_GL_MODE_MULTISAMPLE alone. */
+#define DEFAULT_N_SAMPLES 4
+
 static GdkGLConfig *
 gdk_gl_config_new_rgb (GdkScreen       *screen,
-                       GdkGLConfigMode  mode)
+                       GdkGLConfigMode  mode,
+                       gint             n_samples)
 {
+  GdkGLConfig *glconfig;
   int list[32];
   int n = 0;
+  int samples;
 
   list[n++] = GDK_GL_RGBA;
   list[n++] = GDK_GL_RED_SIZE;
@@ -156,19 +162,42 @@ gdk_gl_config_new_rgb (GdkScreen       *screen,
         }
     }
 
+  if ((mode & GDK_GL_MODE_MULTISAMPLE) && n_samples > 1)
+    {
+      /* Degrade to the best sample count that is available, and
+         finally to no multisampling at all. GDK_GL_SAMPLES is a
+         minimum, so stepping down one at a time finds the largest
+         count up to @n_samples, also when it is not a power of two. */
+      list[n] = GDK_GL_SAMPLE_BUFFERS;
+      list[n + 1] = 1;
+      list[n + 2] = GDK_GL_SAMPLES;
+
+      for (samples = n_samples; samples > 1; samples--)
+        {
+          list[n + 3] = samples;
+
+          glconfig = gdk_gl_config_new_for_screen (screen, list, n + 4);
+          if (glconfig != NULL)
+            return glconfig;
+        }
+
+      GDK_GL_NOTE (MISC, g_message (" -- no multisample visual available"));
+    }
+
   return gdk_gl_config_new_for_screen (screen, list, n);
 }
 
 static GdkGLConfig *
 gdk_gl_config_new_by_mode_common (GdkScreen       *screen,
-                                  GdkGLConfigMode  mode)
+                                  GdkGLConfigMode  mode,
+                                  gint             n_samples)
 {
   GdkGLConfig *glconfig;
 
 #define _GL_CONFIG_NEW_BY_MODE(__screen, __mode)        \
   ( ((__mode) & GDK_GL_MODE_INDEX) ?                    \
     gdk_gl_config_new_ci (__screen, __mode) :           \
-    gdk_gl_config_new_rgb (__screen, __mode) )
+    gdk_gl_config_new_rgb (__screen, __mode, n_samples) )
 
   glconfig = _GL_CONFIG_NEW_BY_MODE (screen, mode);
   if (glconfig == NULL)
@@ -209,7 +238,7 @@ gdk_gl_config_new_by_mode (GdkGLConfigMode mode)
 
   screen = gdk_screen_get_default ();
 
-  return gdk_gl_config_new_by_mode_common (screen, mode);
+  return gdk_gl_config_new_by_mode_common (screen, mode, DEFAULT_N_SAMPLES);
 }
 
 /**
@@ -226,7 +255,49 @@ GdkGLConfig *
 gdk_gl_config_new_by_mode_for_screen (GdkScreen       *screen,
                                       GdkGLConfigMode  mode)
 {
-  return gdk_gl_config_new_by_mode_common (screen, mode);
+  return gdk_gl_config_new_by_mode_common (screen, mode, DEFAULT_N_SAMPLES);
+}
+
+/**
+ * gdk_gl_config_new_by_mode_with_samples:
+ * @mode: display mode bit mask, including %GDK_GL_MODE_MULTISAMPLE.
+ * @n_samples: the number of samples per pixel to ask for.
+ *
+ * Like gdk_gl_config_new_by_mode(), but asks for @n_samples samples per
+ * pixel when @mode has %GDK_GL_MODE_MULTISAMPLE. If no frame buffer
+ * configuration has that many, the largest count below it is used,
+ * down to a configuration without multisampling. Use
+ * gdk_gl_config_get_n_samples() to find out what was granted.
+ *
+ * Return value: the new #GdkGLConfig.
+ **/
+GdkGLConfig *
+gdk_gl_config_new_by_mode_with_samples (GdkGLConfigMode mode,
+                                        gint            n_samples)
+{
+  GdkScreen *screen;
+
+  screen = gdk_screen_get_default ();
+
+  return gdk_gl_config_new_by_mode_common (screen, mode, n_samples);
+}
+
+/**
+ * gdk_gl_config_new_by_mode_with_samples_for_screen:
+ * @screen: target screen.
+ * @mode: display mode bit mask, including %GDK_GL_MODE_MULTISAMPLE.
+ * @n_samples: the number of samples per pixel to ask for.
+ *
+ * Like gdk_gl_config_new_by_mode_with_samples(), for @screen.
+ *
+ * Return value: the new #GdkGLConfig.
+ **/
+GdkGLConfig *
+gdk_gl_config_new_by_mode_with_samples_for_screen (GdkScreen       *screen,
+                                                   GdkGLConfigMode  mode,
+                                                   gint             n_samples)
+{
+  return gdk_gl_config_new_by_mode_common (screen, mode, n_samples);
 }
 
 /**
@@ -281,6 +352,23 @@ gdk_gl_config_get_n_sample_buffers (GdkGLConfig *glconfig)
   return glconfig->impl->n_sample_buffers;
 }
 
+/**
+ * gdk_gl_config_get_n_samples:
+ * @glconfig: a #GdkGLConfig.
+ *
+ * Gets the number of samples per pixel of the multisample buffer.
+ *
+ * Return value: number of samples per pixel, or 0 if the frame buffer
+ *               is not multisampled.
+ **/
+gint
+gdk_gl_config_get_n_samples (GdkGLConfig *glconfig)
+{
+  g_return_val_if_fail (GDK_IS_GL_CONFIG (glconfig), 0);
+
+  return glconfig->impl->n_samples;
+}
+
 /**
  * gdk_gl_config_is_rgba:
  * @glconfig: a #GdkGLConfig.
@@ -533,6 +621,105 @@ gdk_gl_config_new_for_screen (GdkScreen *screen,
   return glconfig;
 }
 
+/**
+ * gdk_gl_config_list_for_screen:
+ * @screen: target screen.
+ *
+ * Lists all OpenGL frame buffer configurations of @screen, with their
+ * attributes already fetched. Unlike gdk_gl_config_new_for_screen(), which
+ * takes whatever the window system considers the first match, this lets
+ * the application inspect every candidate; see also
+ * gdk_gl_config_choose_for_screen().
+ *
+ * Return value: (element-type GdkGLConfig) (transfer full): a list of new
+ *               #GdkGLConfig, or NULL if the window system cannot list
+ *               them. Free it with g_list_free_full() and g_object_unref().
+ **/
+GList *
+gdk_gl_config_list_for_screen (GdkScreen *screen)
+{
+  GdkDisplay *display;
+  GList *list = NULL;
+
+  display = gdk_screen_get_display(screen);
+  g_return_val_if_fail(display != NULL, NULL);
+
+#ifdef GDKGLEXT_WINDOWING_X11
+  if (GDK_IS_X11_DISPLAY(display))
+    {
+      list = gdk_x11_gl_config_list_for_screen(screen);
+    }
+  else
+#endif
+#ifdef GDKGLEXT_WINDOWING_WIN32
+  if (GDK_IS_WIN32_DISPLAY(display))
+    {
+      /* Pixel formats cannot be listed without a window yet. */
+      GDK_GL_NOTE (MISC, g_message (" -- listing pixel formats is not supported"));
+    }
+  else
+#endif
+    {
+      g_warning("Unsupported GDK backend");
+    }
+
+  return list;
+}
+
+/**
+ * gdk_gl_config_choose_for_screen:
+ * @screen: target screen.
+ * @score_func: (scope call): function that rates a #GdkGLConfig.
+ * @user_data: data to pass to @score_func.
+ *
+ * Rates every OpenGL frame buffer configuration of @screen with
+ * @score_func and returns the best one. @score_func returns a negative
+ * value for configurations that do not meet the application's needs, and
+ * otherwise a score where higher is better. Ties go to the configuration
+ * the window system lists first.
+ *
+ * For example, to get the cheapest adequate configuration, reject those
+ * that lack a required buffer, and subtract the depth, stencil and
+ * multisample sizes (gdk_gl_config_get_attrib()) from a constant, so that
+ * oversized buffers lose.
+ *
+ * Return value: the best #GdkGLConfig, or NULL if none is adequate.
+ **/
+GdkGLConfig *
+gdk_gl_config_choose_for_screen (GdkScreen            *screen,
+                                 GdkGLConfigScoreFunc  score_func,
+                                 gpointer              user_data)
+{
+  GdkGLConfig *best = NULL;
+  gint best_score = -1;
+  gint score;
+  GList *list;
+  GList *l;
+
+  GDK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (score_func != NULL, NULL);
+
+  list = gdk_gl_config_list_for_screen (screen);
+
+  for (l = list; l != NULL; l = l->next)
+    {
+      score = score_func (GDK_GL_CONFIG (l->data), user_data);
+      if (score > best_score)
+        {
+          best = GDK_GL_CONFIG (l->data);
+          best_score = score;
+        }
+    }
+
+  if (best != NULL)
+    g_object_ref (best);
+
+  g_list_free_full (list, g_object_unref);
+
+  return best;
+}
+
 /**
  * gdk_gl_config_get_screen:
  * @glconfig: a #GdkGLConfig.
@@ -566,6 +753,10 @@ gdk_gl_config_get_attrib (GdkGLConfig *glconfig,
 {
   g_return_val_if_fail (GDK_IS_GL_CONFIG (glconfig), FALSE);
 
+  /* Attributes fetched at creation time are answered from memory. */
+  if (_gdk_gl_config_impl_attrib_slot (attribute) >= 0)
+    return _gdk_gl_config_impl_lookup_attrib (glconfig, attribute, value);
+
   return GDK_GL_CONFIG_IMPL_GET_CLASS (glconfig->impl)->get_attrib (glconfig, attribute, value);
 }
 
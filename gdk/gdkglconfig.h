@@ -45,12 +45,15 @@ typedef enum
   GDK_GL_MODE_DEPTH       = 1 << 4,
   GDK_GL_MODE_STENCIL     = 1 << 5,
   GDK_GL_MODE_ACCUM       = 1 << 6,
-  GDK_GL_MODE_MULTISAMPLE = 1 << 7   /* not supported yet */
+  GDK_GL_MODE_MULTISAMPLE = 1 << 7
 } GdkGLConfigMode;
 
 struct _GdkGLConfigImpl;
 typedef struct _GdkGLConfigClass GdkGLConfigClass;
 
+typedef gint (*GdkGLConfigScoreFunc) (GdkGLConfig *glconfig,
+                                      gpointer     user_data);
+
 #define GDK_TYPE_GL_CONFIG              (gdk_gl_config_get_type ())
 #define GDK_GL_CONFIG(object)           (G_TYPE_CHECK_INSTANCE_CAST ((object), GDK_TYPE_GL_CONFIG, GdkGLConfig))
 #define GDK_GL_CONFIG_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST ((klass), GDK_TYPE_GL_CONFIG, GdkGLConfigClass))
@@ -92,6 +95,21 @@ GdkGLConfig *gdk_gl_config_new_by_mode            (GdkGLConfigMode  mode);
 GdkGLConfig *gdk_gl_config_new_by_mode_for_screen (GdkScreen       *screen,
                                                    GdkGLConfigMode  mode);
 
+#ifndef GDK_MULTIHEAD_SAFE
+GdkGLConfig *gdk_gl_config_new_by_mode_with_samples (GdkGLConfigMode  mode,
+                                                     gint             n_samples);
+#endif /* GDK_MULTIHEAD_SAFE */
+
+GdkGLConfig *gdk_gl_config_new_by_mode_with_samples_for_screen (GdkScreen       *screen,
+                                                                GdkGLConfigMode  mode,
+                                                                gint             n_samples);
+
+GList       *gdk_gl_config_list_for_screen        (GdkScreen       *screen);
+
+GdkGLConfig *gdk_gl_config_choose_for_screen      (GdkScreen            *screen,
+                                                   GdkGLConfigScoreFunc  score_func,
+                                                   gpointer              user_data);
+
 GdkScreen   *gdk_gl_config_get_screen             (GdkGLConfig     *glconfig);
 
 gboolean     gdk_gl_config_get_attrib             (GdkGLConfig     *glconfig,
@@ -108,6 +126,8 @@ gint         gdk_gl_config_get_n_aux_buffers      (GdkGLConfig     *glconfig);
 
 gint         gdk_gl_config_get_n_sample_buffers   (GdkGLConfig     *glconfig);
 
+gint         gdk_gl_config_get_n_samples          (GdkGLConfig     *glconfig);
+
 gboolean     gdk_gl_config_is_rgba                (GdkGLConfig     *glconfig);
 
 gboolean     gdk_gl_config_is_double_buffered     (GdkGLConfig     *glconfig);
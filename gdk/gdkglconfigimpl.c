@@ -32,9 +32,11 @@ gdk_gl_config_impl_init (GdkGLConfigImpl *self)
 {
   GDK_GL_NOTE_FUNC_PRIVATE ();
 
+  self->attribs_valid = 0;
   self->layer_plane = 0;
   self->n_aux_buffers = 0;
   self->n_sample_buffers = 0;
+  self->n_samples = 0;
   self->is_rgba = 0;
   self->is_double_buffered = 0;
   self->as_single_mode = 0;
@@ -68,3 +70,133 @@ gdk_gl_config_impl_class_init (GdkGLConfigImplClass *klass)
 
   object_class->finalize = gdk_gl_config_impl_finalize;
 }
+
+/* Attributes cached per config, in slot order. */
+static const int cached_attribs[GDK_GL_CONFIG_IMPL_N_ATTRIBS] =
+  {
+    GDK_GL_USE_GL,
+    GDK_GL_BUFFER_SIZE,
+    GDK_GL_LEVEL,
+    GDK_GL_RGBA,
+    GDK_GL_DOUBLEBUFFER,
+    GDK_GL_STEREO,
+    GDK_GL_AUX_BUFFERS,
+    GDK_GL_RED_SIZE,
+    GDK_GL_GREEN_SIZE,
+    GDK_GL_BLUE_SIZE,
+    GDK_GL_ALPHA_SIZE,
+    GDK_GL_DEPTH_SIZE,
+    GDK_GL_STENCIL_SIZE,
+    GDK_GL_ACCUM_RED_SIZE,
+    GDK_GL_ACCUM_GREEN_SIZE,
+    GDK_GL_ACCUM_BLUE_SIZE,
+    GDK_GL_ACCUM_ALPHA_SIZE,
+    GDK_GL_CONFIG_CAVEAT,
+    GDK_GL_X_VISUAL_TYPE,
+    GDK_GL_TRANSPARENT_TYPE,
+    GDK_GL_TRANSPARENT_INDEX_VALUE,
+    GDK_GL_TRANSPARENT_RED_VALUE,
+    GDK_GL_TRANSPARENT_GREEN_VALUE,
+    GDK_GL_TRANSPARENT_BLUE_VALUE,
+    GDK_GL_TRANSPARENT_ALPHA_VALUE,
+    GDK_GL_SAMPLE_BUFFERS,
+    GDK_GL_SAMPLES
+  };
+
+/*
+ * Returns the slot of @attribute in GdkGLConfigImpl::attribs,
+ * or -1 if it is not cached.
+ */
+gint
+_gdk_gl_config_impl_attrib_slot (int attribute)
+{
+  if (attribute >= GDK_GL_USE_GL && attribute <= GDK_GL_ACCUM_ALPHA_SIZE)
+    return attribute - GDK_GL_USE_GL;
+
+  switch (attribute)
+    {
+    case GDK_GL_CONFIG_CAVEAT:
+      return 17;
+    case GDK_GL_X_VISUAL_TYPE:
+    case GDK_GL_TRANSPARENT_TYPE:
+    case GDK_GL_TRANSPARENT_INDEX_VALUE:
+    case GDK_GL_TRANSPARENT_RED_VALUE:
+    case GDK_GL_TRANSPARENT_GREEN_VALUE:
+    case GDK_GL_TRANSPARENT_BLUE_VALUE:
+    case GDK_GL_TRANSPARENT_ALPHA_VALUE:
+      return 18 + (attribute - GDK_GL_X_VISUAL_TYPE);
+    case GDK_GL_SAMPLE_BUFFERS:
+      return 25;
+    case GDK_GL_SAMPLES:
+      return 26;
+    default:
+      break;
+    }
+
+  return -1;
+}
+
+/*
+ * Fetches every cached attribute through the backend's get_attrib ()
+ * in one sweep. Backends call this once their impl is fully set up.
+ */
+void
+_gdk_gl_config_impl_fill_attribs (GdkGLConfig *glconfig)
+{
+  GdkGLConfigImpl *impl = glconfig->impl;
+  gboolean (*get_attrib) (GdkGLConfig *, int, int *);
+  int value;
+  gint slot;
+  gint i;
+
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  impl->attribs_valid = 0;
+
+  get_attrib = GDK_GL_CONFIG_IMPL_GET_CLASS (impl)->get_attrib;
+  g_return_if_fail (get_attrib != NULL);
+
+  for (i = 0; i < GDK_GL_CONFIG_IMPL_N_ATTRIBS; i++)
+    {
+      slot = _gdk_gl_config_impl_attrib_slot (cached_attribs[i]);
+      if (slot != i)
+        {
+          /* A table bug, not a config property; leave the slot invalid. */
+          g_warning ("GL config attribute 0x%x maps to cache slot %d, not %d",
+                     cached_attribs[i], slot, i);
+          impl->attribs[i] = 0;
+          continue;
+        }
+
+      if (get_attrib (glconfig, cached_attribs[i], &value))
+        {
+          impl->attribs[i] = value;
+          impl->attribs_valid |= 1U << i;
+        }
+      else
+        {
+          impl->attribs[i] = 0;
+        }
+    }
+}
+
+/*
+ * Reads @attribute from the cache. Returns FALSE with *@value untouched if
+ * the attribute is not cached or the backend could not answer it.
+ */
+gboolean
+_gdk_gl_config_impl_lookup_attrib (GdkGLConfig *glconfig,
+                                   int          attribute,
+                                   int         *value)
+{
+  GdkGLConfigImpl *impl = glconfig->impl;
+  gint slot;
+
+  slot = _gdk_gl_config_impl_attrib_slot (attribute);
+  if (slot < 0 || !(impl->attribs_valid & (1U << slot)))
+    return FALSE;
+
+  *value = impl->attribs[slot];
+
+  return TRUE;
+}
@@ -30,16 +30,27 @@ G_BEGIN_DECLS
 #define GDK_IS_GL_CONFIG_IMPL_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), GDK_TYPE_GL_CONFIG_IMPL))
 #define GDK_GL_CONFIG_IMPL_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), GDK_TYPE_GL_CONFIG_IMPL, GdkGLConfigImplClass))
 
+/* Number of attributes cached by _gdk_gl_config_impl_fill_attribs (). */
+#define GDK_GL_CONFIG_IMPL_N_ATTRIBS 27
+
 typedef struct _GdkGLConfigImpl
 {
   GObject parent;
 
+  /* Values of all glXGetConfig () style attributes, fetched once when the
+     config is created. Bit n of attribs_valid is set if attribs[n] holds
+     an answer. */
+  gint    attribs[GDK_GL_CONFIG_IMPL_N_ATTRIBS];
+  guint32 attribs_valid;
+
   gint layer_plane;
 
   gint n_aux_buffers;
 
   gint n_sample_buffers;
 
+  gint n_samples;
+
   guint is_rgba            : 1;
   guint is_double_buffered : 1;
   guint as_single_mode     : 1;
@@ -69,6 +80,14 @@ typedef struct _GdkGLConfigImplClass
 
 GType gdk_gl_config_impl_get_type (void);
 
+gint     _gdk_gl_config_impl_attrib_slot   (int          attribute);
+
+void     _gdk_gl_config_impl_fill_attribs  (GdkGLConfig *glconfig);
+
+gboolean _gdk_gl_config_impl_lookup_attrib (GdkGLConfig *glconfig,
+                                            int          attribute,
+                                            int         *value);
+
 G_END_DECLS
 
 #endif /* __GDK_GL_CONFIG_IMPL_H__ */
@@ -220,6 +220,62 @@ gdk_gl_context_release_current ()
     GDK_GL_CONTEXT_IMPL_GET_CLASS (glcontext->impl)->make_uncurrent(glcontext);
 }
 
+/**
+ * gdk_gl_context_make_current_unchecked:
+ * @glcontext: a #GdkGLContext.
+ * @glwindow: a #GdkGLWindow compatible with @glcontext.
+ *
+ * Like gdk_gl_context_make_current() with @glwindow as both the draw and
+ * the read drawable, for code that binds the same pair every frame.
+ * The arguments are only validated in debug builds, and nothing is done
+ * if the pair is already current in the calling thread.
+ *
+ * Return value: TRUE if it is successful, FALSE otherwise.
+ **/
+gboolean
+gdk_gl_context_make_current_unchecked (GdkGLContext *glcontext,
+                                       GdkGLWindow  *glwindow)
+{
+  GdkGLContextImplClass *impl_class;
+
+#ifdef G_ENABLE_DEBUG
+  g_return_val_if_fail (GDK_IS_GL_CONTEXT (glcontext), FALSE);
+  g_return_val_if_fail (GDK_IS_GL_WINDOW (glwindow), FALSE);
+#endif
+
+  impl_class = GDK_GL_CONTEXT_IMPL_GET_CLASS (glcontext->impl);
+
+  if (impl_class->make_current_unchecked != NULL)
+    return impl_class->make_current_unchecked (glcontext, glwindow);
+
+  return impl_class->make_current (glcontext,
+                                   (GdkGLDrawable *) glwindow,
+                                   (GdkGLDrawable *) glwindow);
+}
+
+/**
+ * gdk_gl_context_release_current_unchecked:
+ * @glcontext: the current #GdkGLContext.
+ *
+ * Like gdk_gl_context_release_current(), for a caller that knows which
+ * context is current and so does not need it looked up. The argument is
+ * only validated in debug builds.
+ **/
+void
+gdk_gl_context_release_current_unchecked (GdkGLContext *glcontext)
+{
+  GdkGLContextImplClass *impl_class;
+
+#ifdef G_ENABLE_DEBUG
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+#endif
+
+  impl_class = GDK_GL_CONTEXT_IMPL_GET_CLASS (glcontext->impl);
+
+  if (impl_class->make_uncurrent != NULL)
+    impl_class->make_uncurrent (glcontext);
+}
+
 /**
  * gdk_gl_context_get_current:
  *
@@ -79,6 +79,11 @@ void           gdk_gl_context_release_current (void);
 
 GdkGLContext  *gdk_gl_context_get_current     (void);
 
+gboolean       gdk_gl_context_make_current_unchecked    (GdkGLContext *glcontext,
+                                                         GdkGLWindow  *glwindow);
+
+void           gdk_gl_context_release_current_unchecked (GdkGLContext *glcontext);
+
 G_END_DECLS
 
 #endif /* __GDK_GL_CONTEXT_H__ */
@@ -22,7 +22,7 @@
 
 #include <gdk/gdk.h>            /* for gdk_error_trap_(push|pop) () */
 
-#include "gdkgldebug.h"
+#include "gdkglprivate.h"
 #include "gdkglcontextimpl.h"
 
 G_DEFINE_TYPE (GdkGLContextImpl, gdk_gl_context_impl, G_TYPE_OBJECT);
@@ -31,13 +31,23 @@ static void
 gdk_gl_context_impl_init (GdkGLContextImpl *self)
 {
   GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  self->state_cache = NULL;
 }
 
 static void
 gdk_gl_context_impl_finalize (GObject *object)
 {
+  GdkGLContextImpl *impl = GDK_GL_CONTEXT_IMPL (object);
+
   GDK_GL_NOTE_FUNC_PRIVATE ();
 
+  if (impl->state_cache != NULL)
+    {
+      _gdk_gl_state_cache_free (impl->state_cache);
+      impl->state_cache = NULL;
+    }
+
   G_OBJECT_CLASS (gdk_gl_context_impl_parent_class)->finalize (object);
 }
 
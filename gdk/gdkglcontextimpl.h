@@ -33,6 +33,9 @@ G_BEGIN_DECLS
 typedef struct _GdkGLContextImpl
 {
   GObject parent;
+
+  /* Client-side state shadow, NULL unless state tracking is enabled. */
+  struct _GdkGLStateCache *state_cache;
 } GdkGLContextImpl;
 
 typedef struct _GdkGLContextImplClass
@@ -51,6 +54,8 @@ typedef struct _GdkGLContextImplClass
                                  GdkGLDrawable *draw,
                                  GdkGLDrawable *read);
   void           (*make_uncurrent)(GdkGLContext *glcontext);
+  gboolean       (*make_current_unchecked) (GdkGLContext *glcontext,
+                                            GdkGLWindow  *glwindow);
 
 } GdkGLContextImplClass;
 
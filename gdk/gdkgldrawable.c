@@ -79,6 +79,69 @@ gdk_gl_drawable_swap_buffers (GdkGLDrawable *gldrawable)
   GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->swap_buffers (gldrawable);
 }
 
+/**
+ * gdk_gl_drawable_swap_buffers_with_damage:
+ * @gldrawable: a #GdkGLDrawable.
+ * @rects: (array length=n_rects) (allow-none): the damaged rectangles in
+ *         window coordinates (origin at the upper-left corner).
+ * @n_rects: number of rectangles in @rects.
+ *
+ * Presents the back buffer like gdk_gl_drawable_swap_buffers(), but tells
+ * the window system that only @rects have changed since the previous
+ * frame. If the drawable can present a sub-region, only the damaged area
+ * is copied to the front buffer and the back buffer is kept intact, which
+ * gdk_gl_drawable_get_buffer_age() then reports as an age of 1. Otherwise
+ * this falls back to a full buffer swap.
+ *
+ * If @rects is NULL or @n_rects is 0, the whole drawable is presented.
+ **/
+void
+gdk_gl_drawable_swap_buffers_with_damage (GdkGLDrawable      *gldrawable,
+                                          const GdkRectangle *rects,
+                                          gint                n_rects)
+{
+  GdkGLDrawableClass *iface;
+
+  g_return_if_fail (GDK_IS_GL_DRAWABLE (gldrawable));
+  g_return_if_fail (n_rects >= 0);
+
+  iface = GDK_GL_DRAWABLE_GET_CLASS (gldrawable);
+
+  if (rects == NULL || n_rects == 0 || iface->swap_buffers_with_damage == NULL)
+    iface->swap_buffers (gldrawable);
+  else
+    iface->swap_buffers_with_damage (gldrawable, rects, n_rects);
+}
+
+/**
+ * gdk_gl_drawable_get_buffer_age:
+ * @gldrawable: a #GdkGLDrawable.
+ *
+ * Returns the age of the back buffer of the @gldrawable, that is how many
+ * frames ago its current contents were presented. An age of 1 means the
+ * back buffer holds the previous frame, so only the regions that changed
+ * since then need to be repainted. An age of 0 means the contents are
+ * undefined and the whole drawable must be repainted.
+ *
+ * The age is only meaningful while a context is current to @gldrawable.
+ *
+ * Return value: the back buffer age, or 0 if unknown.
+ **/
+gint
+gdk_gl_drawable_get_buffer_age (GdkGLDrawable *gldrawable)
+{
+  GdkGLDrawableClass *iface;
+
+  g_return_val_if_fail (GDK_IS_GL_DRAWABLE (gldrawable), 0);
+
+  iface = GDK_GL_DRAWABLE_GET_CLASS (gldrawable);
+
+  if (iface->get_buffer_age == NULL)
+    return 0;
+
+  return iface->get_buffer_age (gldrawable);
+}
+
 /**
  * gdk_gl_drawable_wait_gl:
  * @gldrawable: a #GdkGLDrawable.
@@ -109,6 +172,138 @@ gdk_gl_drawable_wait_gdk (GdkGLDrawable *gldrawable)
   GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->wait_gdk (gldrawable);
 }
 
+/**
+ * gdk_gl_drawable_set_present_mode:
+ * @gldrawable: a #GdkGLDrawable.
+ * @mode: the #GdkGLPresentMode.
+ * @max_frames_in_flight: for %GDK_GL_PRESENT_BOUNDED, the number of
+ *                        presented frames the GPU may still be working on
+ *                        before a swap blocks. Ignored for other modes.
+ *
+ * Sets how buffer swaps of @gldrawable are paced.
+ *
+ * %GDK_GL_PRESENT_FIFO synchronizes swaps to the vertical retrace and lets
+ * the driver queue as many frames as it likes. %GDK_GL_PRESENT_MAILBOX
+ * swaps without waiting for the retrace, so a new frame replaces the
+ * previous one as soon as it is ready. %GDK_GL_PRESENT_BOUNDED is like
+ * FIFO, but blocks in the swap until at most @max_frames_in_flight frames
+ * are still pending on the GPU, which bounds input-to-display latency.
+ *
+ * The mode takes effect at the next buffer swap. Which modes can be
+ * honoured depends on the window system and driver.
+ **/
+void
+gdk_gl_drawable_set_present_mode (GdkGLDrawable    *gldrawable,
+                                  GdkGLPresentMode  mode,
+                                  guint             max_frames_in_flight)
+{
+  g_return_if_fail (GDK_IS_GL_DRAWABLE (gldrawable));
+
+  if (GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->set_present_mode != NULL)
+    GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->set_present_mode (gldrawable,
+                                                              mode,
+                                                              max_frames_in_flight);
+}
+
+/**
+ * gdk_gl_drawable_get_present_mode:
+ * @gldrawable: a #GdkGLDrawable.
+ * @max_frames_in_flight: (out) (allow-none): return location for the
+ *                        frame bound, or NULL.
+ *
+ * Gets the present mode set with gdk_gl_drawable_set_present_mode().
+ *
+ * Return value: the #GdkGLPresentMode of @gldrawable.
+ **/
+GdkGLPresentMode
+gdk_gl_drawable_get_present_mode (GdkGLDrawable *gldrawable,
+                                  guint         *max_frames_in_flight)
+{
+  g_return_val_if_fail (GDK_IS_GL_DRAWABLE (gldrawable), GDK_GL_PRESENT_FIFO);
+
+  if (GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->get_present_mode == NULL)
+    {
+      if (max_frames_in_flight != NULL)
+        *max_frames_in_flight = 0;
+      return GDK_GL_PRESENT_FIFO;
+    }
+
+  return GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->get_present_mode (gldrawable,
+                                                                   max_frames_in_flight);
+}
+
+/**
+ * gdk_gl_drawable_set_present_func:
+ * @gldrawable: a #GdkGLDrawable.
+ * @func: (allow-none): the function to call when a presented frame has
+ *        completed, or NULL to remove the current one.
+ * @user_data: data to pass to @func.
+ * @destroy: (allow-none): function to free @user_data, or NULL.
+ *
+ * Installs a function that is called once per presented frame, with the
+ * time in microseconds from the buffer swap until the GPU was seen to
+ * have finished the frame. The function is called in the default main
+ * context: from within a later buffer swap of @gldrawable when that
+ * happens in the main context, with the rendering context still current,
+ * or queued to the main context for swaps done on another thread.
+ *
+ * The latency is an upper bound, not a GPU timestamp. Frame completion
+ * is only checked at later buffer swaps, so a frame that finished early
+ * still reports about one swap interval, and the values step with the
+ * rate at which @gldrawable is swapped. Without GL_ARB_sync, frames are
+ * reported only in the #GDK_GL_PRESENT_BOUNDED mode with one frame in
+ * flight, and the latency is the time glFinish() blocked after the swap.
+ **/
+void
+gdk_gl_drawable_set_present_func (GdkGLDrawable    *gldrawable,
+                                  GdkGLPresentFunc  func,
+                                  gpointer          user_data,
+                                  GDestroyNotify    destroy)
+{
+  g_return_if_fail (GDK_IS_GL_DRAWABLE (gldrawable));
+
+  if (GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->set_present_func != NULL)
+    GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->set_present_func (gldrawable,
+                                                              func,
+                                                              user_data,
+                                                              destroy);
+  else if (destroy != NULL)
+    destroy (user_data);
+}
+
+/**
+ * gdk_gl_drawable_get_sync_values:
+ * @gldrawable: a #GdkGLDrawable.
+ * @ust: (out) (allow-none): return location for the unadjusted system
+ *       time of the most recent vertical retrace, or NULL.
+ * @msc: (out) (allow-none): return location for the media stream counter,
+ *       the number of vertical retraces so far, or NULL.
+ * @sbc: (out) (allow-none): return location for the swap buffer counter,
+ *       the number of completed buffer swaps of @gldrawable, or NULL.
+ *
+ * Queries the display timing of @gldrawable. This needs
+ * GLX_OML_sync_control on X11. On Linux the UST is in microseconds of
+ * the monotonic clock, the same time base as g_get_monotonic_time().
+ *
+ * Return value: TRUE if the values could be queried, FALSE otherwise.
+ **/
+gboolean
+gdk_gl_drawable_get_sync_values (GdkGLDrawable *gldrawable,
+                                 gint64        *ust,
+                                 gint64        *msc,
+                                 gint64        *sbc)
+{
+  g_return_val_if_fail (GDK_IS_GL_DRAWABLE (gldrawable), FALSE);
+
+  if (GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->get_sync_values == NULL)
+    return FALSE;
+
+  return GDK_GL_DRAWABLE_GET_CLASS (gldrawable)->get_sync_values (gldrawable,
+                                                                  ust,
+                                                                  msc,
+                                                                  sbc);
+}
+
 /**
  * gdk_gl_drawable_get_gl_config:
  * @gldrawable: a #GdkGLDrawable.
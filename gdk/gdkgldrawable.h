@@ -30,6 +30,21 @@ G_BEGIN_DECLS
 
 typedef struct _GdkGLDrawableClass GdkGLDrawableClass;
 
+/*
+ * Present policy.
+ */
+
+typedef enum
+{
+  GDK_GL_PRESENT_FIFO,          /* synchronized to vblank, driver-queued */
+  GDK_GL_PRESENT_MAILBOX,       /* never wait for vblank */
+  GDK_GL_PRESENT_BOUNDED        /* FIFO with a bound on frames in flight */
+} GdkGLPresentMode;
+
+typedef void (*GdkGLPresentFunc) (GdkGLDrawable *gldrawable,
+                                  gint64         latency,
+                                  gpointer       user_data);
+
 #define GDK_TYPE_GL_DRAWABLE		  (gdk_gl_drawable_get_type ())
 #define GDK_GL_DRAWABLE(inst)		  (G_TYPE_CHECK_INSTANCE_CAST ((inst), GDK_TYPE_GL_DRAWABLE, GdkGLDrawable))
 #define GDK_GL_DRAWABLE_CLASS(vtable)	  (G_TYPE_CHECK_CLASS_CAST ((vtable), GDK_TYPE_GL_DRAWABLE, GdkGLDrawableClass))
@@ -51,6 +66,26 @@ struct _GdkGLDrawableClass
   void          (*wait_gl)              (GdkGLDrawable *gldrawable);
   void          (*wait_gdk)             (GdkGLDrawable *gldrawable);
   GdkGLConfig*  (*get_gl_config)        (GdkGLDrawable *gldrawable);
+
+  void          (*swap_buffers_with_damage) (GdkGLDrawable      *gldrawable,
+                                             const GdkRectangle *rects,
+                                             gint                n_rects);
+  gint          (*get_buffer_age)       (GdkGLDrawable *gldrawable);
+
+  void          (*set_present_mode)     (GdkGLDrawable    *gldrawable,
+                                         GdkGLPresentMode  mode,
+                                         guint             max_frames_in_flight);
+  GdkGLPresentMode (*get_present_mode)  (GdkGLDrawable    *gldrawable,
+                                         guint            *max_frames_in_flight);
+  void          (*set_present_func)     (GdkGLDrawable    *gldrawable,
+                                         GdkGLPresentFunc  func,
+                                         gpointer          user_data,
+                                         GDestroyNotify    destroy);
+
+  gboolean      (*get_sync_values)      (GdkGLDrawable *gldrawable,
+                                         gint64        *ust,
+                                         gint64        *msc,
+                                         gint64        *sbc);
 };
 
 GType          gdk_gl_drawable_get_type           (void);
@@ -59,6 +94,29 @@ gboolean       gdk_gl_drawable_is_double_buffered (GdkGLDrawable *gldrawable);
 
 void           gdk_gl_drawable_swap_buffers       (GdkGLDrawable *gldrawable);
 
+void           gdk_gl_drawable_swap_buffers_with_damage (GdkGLDrawable      *gldrawable,
+                                                         const GdkRectangle *rects,
+                                                         gint                n_rects);
+
+gint           gdk_gl_drawable_get_buffer_age     (GdkGLDrawable *gldrawable);
+
+void           gdk_gl_drawable_set_present_mode   (GdkGLDrawable    *gldrawable,
+                                                   GdkGLPresentMode  mode,
+                                                   guint             max_frames_in_flight);
+
+GdkGLPresentMode gdk_gl_drawable_get_present_mode (GdkGLDrawable    *gldrawable,
+                                                   guint            *max_frames_in_flight);
+
+void           gdk_gl_drawable_set_present_func   (GdkGLDrawable    *gldrawable,
+                                                   GdkGLPresentFunc  func,
+                                                   gpointer          user_data,
+                                                   GDestroyNotify    destroy);
+
+gboolean       gdk_gl_drawable_get_sync_values    (GdkGLDrawable *gldrawable,
+                                                   gint64        *ust,
+                                                   gint64        *msc,
+                                                   gint64        *sbc);
+
 void           gdk_gl_drawable_wait_gl            (GdkGLDrawable *gldrawable);
 
 void           gdk_gl_drawable_wait_gdk           (GdkGLDrawable *gldrawable);
@@ -30,6 +30,10 @@ static gboolean gdk_gl_initialized = FALSE;
 
 guint gdk_gl_debug_flags = 0;   /* Global GdkGLExt debug flag */
 
+gboolean _gdk_gl_profile_cache = FALSE;
+
+gboolean _gdk_gl_shm_present = FALSE;
+
 #ifdef G_ENABLE_DEBUG
 
 static const GDebugKey gdk_gl_debug_keys[] = {
@@ -72,6 +76,20 @@ gdk_gl_parse_args (int    *argc,
       env_string = NULL;
     }
 
+  env_string = g_getenv ("GDK_GL_PROFILE_CACHE");
+  if (env_string != NULL)
+    {
+      _gdk_gl_profile_cache = !!g_ascii_strtoll (env_string, NULL, 0);
+      env_string = NULL;
+    }
+
+  env_string = g_getenv ("GDK_GL_SHM_PRESENT");
+  if (env_string != NULL)
+    {
+      _gdk_gl_shm_present = !!g_ascii_strtoll (env_string, NULL, 0);
+      env_string = NULL;
+    }
+
 #ifdef G_ENABLE_DEBUG
   env_string = g_getenv ("GDK_GL_DEBUG");
   if (env_string != NULL)
@@ -94,6 +112,16 @@ gdk_gl_parse_args (int    *argc,
               _gdk_gl_context_force_indirect = TRUE;
               (*argv)[i] = NULL;
             }
+          else if (strcmp ("--gdk-gl-profile-cache", (*argv)[i]) == 0)
+            {
+              _gdk_gl_profile_cache = TRUE;
+              (*argv)[i] = NULL;
+            }
+          else if (strcmp ("--gdk-gl-shm-present", (*argv)[i]) == 0)
+            {
+              _gdk_gl_shm_present = TRUE;
+              (*argv)[i] = NULL;
+            }
 #ifdef G_ENABLE_DEBUG
           else if ((strcmp ("--gdk-gl-debug", (*argv)[i]) == 0) ||
                    (strncmp ("--gdk-gl-debug=", (*argv)[i], 15) == 0))
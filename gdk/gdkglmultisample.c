@@ -0,0 +1,460 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "gdkglprivate.h"
+#include "gdkglquery.h"
+#include "gdkglmultisample.h"
+
+#ifdef G_OS_WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+#endif
+
+#ifdef GDK_WINDOWING_QUARTZ
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+/* GL_ARB_framebuffer_object / GL_EXT_framebuffer_{object,multisample,blit} */
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER                  0x8D40
+#endif
+#ifndef GL_RENDERBUFFER
+#define GL_RENDERBUFFER                 0x8D41
+#endif
+#ifndef GL_READ_FRAMEBUFFER
+#define GL_READ_FRAMEBUFFER             0x8CA8
+#endif
+#ifndef GL_DRAW_FRAMEBUFFER
+#define GL_DRAW_FRAMEBUFFER             0x8CA9
+#endif
+#ifndef GL_FRAMEBUFFER_BINDING
+#define GL_FRAMEBUFFER_BINDING          0x8CA6
+#endif
+#ifndef GL_COLOR_ATTACHMENT0
+#define GL_COLOR_ATTACHMENT0            0x8CE0
+#endif
+#ifndef GL_DEPTH_ATTACHMENT
+#define GL_DEPTH_ATTACHMENT             0x8D00
+#endif
+#ifndef GL_STENCIL_ATTACHMENT
+#define GL_STENCIL_ATTACHMENT           0x8D20
+#endif
+#ifndef GL_FRAMEBUFFER_COMPLETE
+#define GL_FRAMEBUFFER_COMPLETE         0x8CD5
+#endif
+#ifndef GL_MAX_SAMPLES
+#define GL_MAX_SAMPLES                  0x8D57
+#endif
+#ifndef GL_DEPTH24_STENCIL8
+#define GL_DEPTH24_STENCIL8             0x88F0
+#endif
+#ifndef GL_DEPTH_COMPONENT24
+#define GL_DEPTH_COMPONENT24            0x81A6
+#endif
+
+typedef void   (APIENTRY *GenObjectsProc)      (GLsizei, GLuint *);
+typedef void   (APIENTRY *DeleteObjectsProc)   (GLsizei, const GLuint *);
+typedef void   (APIENTRY *BindObjectProc)      (GLenum, GLuint);
+typedef void   (APIENTRY *RenderbufferStorageMultisampleProc) (GLenum, GLsizei, GLenum, GLsizei, GLsizei);
+typedef void   (APIENTRY *FramebufferRenderbufferProc)        (GLenum, GLenum, GLenum, GLuint);
+typedef GLenum (APIENTRY *CheckFramebufferStatusProc)         (GLenum);
+typedef void   (APIENTRY *BlitFramebufferProc) (GLint, GLint, GLint, GLint,
+                                                GLint, GLint, GLint, GLint,
+                                                GLbitfield, GLenum);
+
+/*
+ * An offscreen multisampled color buffer (and optionally depth/stencil
+ * buffer) that is resolved into the window on request only.
+ */
+
+struct _GdkGLMultisample
+{
+  gint width;
+  gint height;
+  gint n_samples;
+
+  GLuint framebuffer;
+  GLuint color_buffer;
+  GLuint depth_buffer;
+  GLenum depth_format;
+
+  GLint previous_framebuffer;
+
+  GenObjectsProc                     gen_framebuffers;
+  DeleteObjectsProc                  delete_framebuffers;
+  BindObjectProc                     bind_framebuffer;
+  GenObjectsProc                     gen_renderbuffers;
+  DeleteObjectsProc                  delete_renderbuffers;
+  BindObjectProc                     bind_renderbuffer;
+  RenderbufferStorageMultisampleProc renderbuffer_storage_multisample;
+  FramebufferRenderbufferProc        framebuffer_renderbuffer;
+  CheckFramebufferStatusProc         check_framebuffer_status;
+  BlitFramebufferProc                blit_framebuffer;
+
+  guint depth : 1;
+};
+
+static gboolean
+gdk_gl_multisample_load_procs (GdkGLMultisample *multisample)
+{
+  const gchar *suffix;
+
+  if (gdk_gl_query_gl_extension ("GL_ARB_framebuffer_object"))
+    {
+      suffix = "";
+      multisample->depth_format = GL_DEPTH24_STENCIL8;
+    }
+  else if (gdk_gl_query_gl_extension ("GL_EXT_framebuffer_object") &&
+           gdk_gl_query_gl_extension ("GL_EXT_framebuffer_multisample") &&
+           gdk_gl_query_gl_extension ("GL_EXT_framebuffer_blit"))
+    {
+      suffix = "EXT";
+      multisample->depth_format = gdk_gl_query_gl_extension ("GL_EXT_packed_depth_stencil") ?
+                                  GL_DEPTH24_STENCIL8 : GL_DEPTH_COMPONENT24;
+    }
+  else
+    {
+      return FALSE;
+    }
+
+#define _LOAD_PROC(__field, __type, __name)                             \
+  G_STMT_START {                                                        \
+    gchar *__proc_name = g_strconcat (__name, suffix, NULL);            \
+    multisample->__field = (__type) gdk_gl_get_proc_address (__proc_name); \
+    g_free (__proc_name);                                               \
+    if (multisample->__field == NULL)                                   \
+      return FALSE;                                                     \
+  } G_STMT_END
+
+  _LOAD_PROC (gen_framebuffers,                 GenObjectsProc,                     "glGenFramebuffers");
+  _LOAD_PROC (delete_framebuffers,              DeleteObjectsProc,                  "glDeleteFramebuffers");
+  _LOAD_PROC (bind_framebuffer,                 BindObjectProc,                     "glBindFramebuffer");
+  _LOAD_PROC (gen_renderbuffers,                GenObjectsProc,                     "glGenRenderbuffers");
+  _LOAD_PROC (delete_renderbuffers,             DeleteObjectsProc,                  "glDeleteRenderbuffers");
+  _LOAD_PROC (bind_renderbuffer,                BindObjectProc,                     "glBindRenderbuffer");
+  _LOAD_PROC (renderbuffer_storage_multisample, RenderbufferStorageMultisampleProc, "glRenderbufferStorageMultisample");
+  _LOAD_PROC (framebuffer_renderbuffer,         FramebufferRenderbufferProc,        "glFramebufferRenderbuffer");
+  _LOAD_PROC (check_framebuffer_status,         CheckFramebufferStatusProc,         "glCheckFramebufferStatus");
+  _LOAD_PROC (blit_framebuffer,                 BlitFramebufferProc,                "glBlitFramebuffer");
+
+#undef _LOAD_PROC
+
+  return TRUE;
+}
+
+/*
+ * (Re)allocate the renderbuffers. If the driver rejects the sample
+ * count, retry with fewer samples. A sample count of 0 allocates
+ * plain single-sampled buffers.
+ */
+static gboolean
+gdk_gl_multisample_allocate (GdkGLMultisample *multisample,
+                             gint              n_samples)
+{
+  GLint previous_framebuffer = 0;
+  GLenum status = 0;
+
+  glGetIntegerv (GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+  multisample->bind_framebuffer (GL_FRAMEBUFFER, multisample->framebuffer);
+
+  for (;;)
+    {
+      multisample->bind_renderbuffer (GL_RENDERBUFFER, multisample->color_buffer);
+      multisample->renderbuffer_storage_multisample (GL_RENDERBUFFER, n_samples, GL_RGBA8,
+                                                     multisample->width, multisample->height);
+      multisample->framebuffer_renderbuffer (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                             GL_RENDERBUFFER, multisample->color_buffer);
+
+      if (multisample->depth)
+        {
+          multisample->bind_renderbuffer (GL_RENDERBUFFER, multisample->depth_buffer);
+          multisample->renderbuffer_storage_multisample (GL_RENDERBUFFER, n_samples,
+                                                         multisample->depth_format,
+                                                         multisample->width, multisample->height);
+          multisample->framebuffer_renderbuffer (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                                 GL_RENDERBUFFER, multisample->depth_buffer);
+          if (multisample->depth_format == GL_DEPTH24_STENCIL8)
+            multisample->framebuffer_renderbuffer (GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT,
+                                                   GL_RENDERBUFFER, multisample->depth_buffer);
+        }
+
+      status = multisample->check_framebuffer_status (GL_FRAMEBUFFER);
+      if (status == GL_FRAMEBUFFER_COMPLETE)
+        break;
+
+      GDK_GL_NOTE (MISC,
+        g_message (" -- multisample framebuffer with %d samples incomplete (0x%x)",
+                   n_samples, status));
+
+      if (n_samples == 0)
+        break;
+
+      /* Halve the sample count, down to no multisampling at all. */
+      n_samples = (n_samples > 2) ? n_samples / 2 : 0;
+    }
+
+  multisample->bind_renderbuffer (GL_RENDERBUFFER, 0);
+
+  if (status != GL_FRAMEBUFFER_COMPLETE)
+    {
+      /* Never leave the unusable framebuffer bound. */
+      if ((GLuint) previous_framebuffer == multisample->framebuffer)
+        previous_framebuffer = 0;
+      multisample->bind_framebuffer (GL_FRAMEBUFFER, previous_framebuffer);
+      return FALSE;
+    }
+
+  multisample->bind_framebuffer (GL_FRAMEBUFFER, previous_framebuffer);
+
+  multisample->n_samples = n_samples;
+
+  return TRUE;
+}
+
+/**
+ * gdk_gl_multisample_new:
+ * @width: width of the buffer in pixels.
+ * @height: height of the buffer in pixels.
+ * @n_samples: the number of samples per pixel to ask for.
+ * @depth: whether a depth (and, where available, stencil) buffer is needed.
+ *
+ * Creates an offscreen multisampled framebuffer in the current rendering
+ * context. Draw into it between gdk_gl_multisample_begin() and
+ * gdk_gl_multisample_end(), then copy the antialiased result to the
+ * window with gdk_gl_multisample_resolve(). Unlike a multisampled
+ * #GdkGLConfig, this lets the application decide which parts of the frame
+ * are antialiased and when the resolve happens.
+ *
+ * The sample count is clamped to what the implementation supports, and
+ * lowered further if the framebuffer cannot be completed with it. A
+ * @n_samples of 0 gives an ordinary single-sampled framebuffer, for
+ * callers that want to own the frame contents (see #GtkGLDrawingArea).
+ * Needs GL_ARB_framebuffer_object, or GL_EXT_framebuffer_object with
+ * GL_EXT_framebuffer_multisample and GL_EXT_framebuffer_blit.
+ *
+ * Return value: the new #GdkGLMultisample, or NULL if multisampled
+ *               framebuffers are not supported.
+ **/
+GdkGLMultisample *
+gdk_gl_multisample_new (gint     width,
+                        gint     height,
+                        gint     n_samples,
+                        gboolean depth)
+{
+  GdkGLMultisample *multisample;
+  GLint max_samples = 0;
+
+  GDK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+
+  multisample = g_new0 (GdkGLMultisample, 1);
+
+  if (!gdk_gl_multisample_load_procs (multisample))
+    {
+      GDK_GL_NOTE (MISC, g_message (" -- multisample framebuffers not supported"));
+      g_free (multisample);
+      return NULL;
+    }
+
+  glGetIntegerv (GL_MAX_SAMPLES, &max_samples);
+  n_samples = MIN (n_samples, max_samples);
+  if (n_samples < 2)
+    n_samples = 0;
+
+  multisample->width = width;
+  multisample->height = height;
+  multisample->depth = depth ? TRUE : FALSE;
+
+  multisample->gen_framebuffers (1, &multisample->framebuffer);
+  multisample->gen_renderbuffers (1, &multisample->color_buffer);
+  if (multisample->depth)
+    multisample->gen_renderbuffers (1, &multisample->depth_buffer);
+
+  if (!gdk_gl_multisample_allocate (multisample, n_samples))
+    {
+      gdk_gl_multisample_free (multisample);
+      return NULL;
+    }
+
+  return multisample;
+}
+
+/**
+ * gdk_gl_multisample_free:
+ * @multisample: a #GdkGLMultisample.
+ *
+ * Destroys @multisample. The rendering context it was created in must
+ * be current.
+ **/
+void
+gdk_gl_multisample_free (GdkGLMultisample *multisample)
+{
+  g_return_if_fail (multisample != NULL);
+
+  if (multisample->depth_buffer != 0)
+    multisample->delete_renderbuffers (1, &multisample->depth_buffer);
+  if (multisample->color_buffer != 0)
+    multisample->delete_renderbuffers (1, &multisample->color_buffer);
+  if (multisample->framebuffer != 0)
+    multisample->delete_framebuffers (1, &multisample->framebuffer);
+
+  g_free (multisample);
+}
+
+/**
+ * gdk_gl_multisample_resize:
+ * @multisample: a #GdkGLMultisample.
+ * @width: new width in pixels.
+ * @height: new height in pixels.
+ *
+ * Reallocates the buffers of @multisample for a new size. The contents
+ * are lost. Nothing happens if the size did not change. On failure,
+ * which only happens when not even a single-sampled framebuffer of the
+ * new size can be completed, @multisample is no longer bound and can
+ * only be freed.
+ *
+ * Return value: TRUE if it is successful, FALSE otherwise.
+ **/
+gboolean
+gdk_gl_multisample_resize (GdkGLMultisample *multisample,
+                           gint              width,
+                           gint              height)
+{
+  g_return_val_if_fail (multisample != NULL, FALSE);
+  g_return_val_if_fail (width > 0 && height > 0, FALSE);
+
+  if (width == multisample->width && height == multisample->height)
+    return TRUE;
+
+  multisample->width = width;
+  multisample->height = height;
+
+  return gdk_gl_multisample_allocate (multisample, multisample->n_samples);
+}
+
+/**
+ * gdk_gl_multisample_get_n_samples:
+ * @multisample: a #GdkGLMultisample.
+ *
+ * Gets the number of samples per pixel that was actually granted.
+ *
+ * Return value: number of samples per pixel.
+ **/
+gint
+gdk_gl_multisample_get_n_samples (GdkGLMultisample *multisample)
+{
+  g_return_val_if_fail (multisample != NULL, 0);
+
+  return multisample->n_samples;
+}
+
+/**
+ * gdk_gl_multisample_begin:
+ * @multisample: a #GdkGLMultisample.
+ *
+ * Redirects rendering into the multisampled buffers of @multisample.
+ **/
+void
+gdk_gl_multisample_begin (GdkGLMultisample *multisample)
+{
+  g_return_if_fail (multisample != NULL);
+
+  glGetIntegerv (GL_FRAMEBUFFER_BINDING, &multisample->previous_framebuffer);
+
+  multisample->bind_framebuffer (GL_FRAMEBUFFER, multisample->framebuffer);
+}
+
+/**
+ * gdk_gl_multisample_end:
+ * @multisample: a #GdkGLMultisample.
+ *
+ * Restores the framebuffer that was bound when gdk_gl_multisample_begin()
+ * was called. Nothing is copied to the window; see
+ * gdk_gl_multisample_resolve().
+ **/
+void
+gdk_gl_multisample_end (GdkGLMultisample *multisample)
+{
+  g_return_if_fail (multisample != NULL);
+
+  multisample->bind_framebuffer (GL_FRAMEBUFFER, multisample->previous_framebuffer);
+}
+
+/**
+ * gdk_gl_multisample_resolve:
+ * @multisample: a #GdkGLMultisample.
+ * @rect: (allow-none): the area to resolve, in window coordinates with the
+ *        origin at the upper-left corner, or NULL for the whole buffer.
+ *
+ * Averages the samples of @rect down into the same area of the window's
+ * back buffer (or front buffer for single-buffered windows). Pixels of
+ * the window outside @rect are left alone, so only the part of the frame
+ * that needs antialiasing pays for it.
+ **/
+void
+gdk_gl_multisample_resolve (GdkGLMultisample   *multisample,
+                            const GdkRectangle *rect)
+{
+  GLint previous_framebuffer = 0;
+  gint x0, y0, x1, y1;
+
+  g_return_if_fail (multisample != NULL);
+
+  if (rect != NULL)
+    {
+      x0 = CLAMP (rect->x, 0, multisample->width);
+      x1 = CLAMP (rect->x + rect->width, 0, multisample->width);
+      /* GL window coordinates have their origin at the lower-left. */
+      y0 = CLAMP (multisample->height - (rect->y + rect->height), 0, multisample->height);
+      y1 = CLAMP (multisample->height - rect->y, 0, multisample->height);
+
+      if (x1 <= x0 || y1 <= y0)
+        return;
+    }
+  else
+    {
+      x0 = 0;
+      y0 = 0;
+      x1 = multisample->width;
+      y1 = multisample->height;
+    }
+
+  glGetIntegerv (GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+  multisample->bind_framebuffer (GL_READ_FRAMEBUFFER, multisample->framebuffer);
+  multisample->bind_framebuffer (GL_DRAW_FRAMEBUFFER, 0);
+
+  /* Multisample resolves need matching source and destination areas. */
+  multisample->blit_framebuffer (x0, y0, x1, y1,
+                                 x0, y0, x1, y1,
+                                 GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+  multisample->bind_framebuffer (GL_FRAMEBUFFER, previous_framebuffer);
+}
@@ -0,0 +1,57 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+#if !defined (__GDKGL_H_INSIDE__) && !defined (GDK_GL_COMPILATION)
+#error "Only <gdk/gdkgl.h> can be included directly."
+#endif
+
+#ifndef __GDK_GL_MULTISAMPLE_H__
+#define __GDK_GL_MULTISAMPLE_H__
+
+#include <gdk/gdkgldefs.h>
+#include <gdk/gdkgltypes.h>
+
+#include <gdk/gdk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GdkGLMultisample GdkGLMultisample;
+
+GdkGLMultisample *gdk_gl_multisample_new           (gint                width,
+                                                    gint                height,
+                                                    gint                n_samples,
+                                                    gboolean            depth);
+
+void              gdk_gl_multisample_free          (GdkGLMultisample   *multisample);
+
+gboolean          gdk_gl_multisample_resize        (GdkGLMultisample   *multisample,
+                                                    gint                width,
+                                                    gint                height);
+
+gint              gdk_gl_multisample_get_n_samples (GdkGLMultisample   *multisample);
+
+void              gdk_gl_multisample_begin         (GdkGLMultisample   *multisample);
+
+void              gdk_gl_multisample_end           (GdkGLMultisample   *multisample);
+
+void              gdk_gl_multisample_resolve       (GdkGLMultisample   *multisample,
+                                                    const GdkRectangle *rect);
+
+G_END_DECLS
+
+#endif /* __GDK_GL_MULTISAMPLE_H__ */
@@ -37,9 +37,25 @@ void _gdk_gl_window_get_size (GdkGLDrawable *gldrawable,
 
 void _gdk_gl_print_gl_info (void);
 
+void _gdk_gl_window_frame_presented (GdkGLWindow *glwindow,
+                                     gint64       ust,
+                                     gint64       msc,
+                                     gint64       sbc);
+
+void _gdk_gl_window_frame_completed (GdkGLWindow *glwindow,
+                                     gint64       latency);
+
+gboolean _gdk_gl_window_has_frame_presented_handler (GdkGLWindow *glwindow);
+
+typedef struct _GdkGLStateCache GdkGLStateCache;
+
+void _gdk_gl_state_cache_free (GdkGLStateCache *cache);
+
 /* Internal globals */
 
 extern gboolean _gdk_gl_context_force_indirect;
+extern gboolean _gdk_gl_profile_cache;
+extern gboolean _gdk_gl_shm_present;
 
 G_END_DECLS
 
@@ -0,0 +1,586 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "gdkglprivate.h"
+#include "gdkglcontext.h"
+#include "gdkglcontextimpl.h"
+#include "gdkglstate.h"
+
+#ifdef G_OS_WIN32
+#define WIN32_LEAN_AND_MEAN 1
+#include <windows.h>
+#endif
+
+#ifdef GDK_WINDOWING_QUARTZ
+#include <OpenGL/gl.h>
+#else
+#include <GL/gl.h>
+#endif
+
+#ifndef GL_TEXTURE_3D
+#define GL_TEXTURE_3D                   0x806F
+#endif
+#ifndef GL_TEXTURE_CUBE_MAP
+#define GL_TEXTURE_CUBE_MAP             0x8513
+#endif
+
+/*
+ * Shadow copy of the most frequently changed pieces of fixed-function
+ * state. A value is only trusted after it has been set through one of
+ * the gdk_gl_state_*() wrappers; everything starts out unknown so the
+ * first call always reaches the GL.
+ */
+
+enum {
+  TEXTURE_TARGET_1D,
+  TEXTURE_TARGET_2D,
+  TEXTURE_TARGET_3D,
+  TEXTURE_TARGET_CUBE_MAP,
+  N_TEXTURE_TARGETS
+};
+
+enum {
+  STATE_VALID_MATRIX_MODE = 1 << 0,
+  STATE_VALID_SHADE_MODEL = 1 << 1,
+  STATE_VALID_BLEND_FUNC  = 1 << 2,
+  STATE_VALID_DEPTH_FUNC  = 1 << 3,
+  STATE_VALID_DEPTH_MASK  = 1 << 4,
+  STATE_VALID_CULL_FACE   = 1 << 5,
+  STATE_VALID_TEXTURE     = 1 << 8  /* shifted by the target index */
+};
+
+struct _GdkGLStateCache
+{
+  guint32 caps_known;
+  guint32 caps_enabled;
+
+  guint valid;
+
+  GLuint textures[N_TEXTURE_TARGETS];
+
+  GLenum matrix_mode;
+  GLenum shade_model;
+  GLenum blend_sfactor;
+  GLenum blend_dfactor;
+  GLenum depth_func;
+  GLenum cull_face;
+  GLboolean depth_mask;
+
+  guint n_issued;
+  guint n_elided;
+};
+
+#define STATE_CACHE(glcontext) ((glcontext)->impl->state_cache)
+
+/*
+ * Map a glEnable() capability to its bit in caps_known/caps_enabled.
+ * Capabilities not listed here are passed straight through.
+ */
+static gint
+cap_to_bit (GLenum cap)
+{
+  switch (cap)
+    {
+    case GL_ALPHA_TEST:          return 0;
+    case GL_AUTO_NORMAL:         return 1;
+    case GL_BLEND:               return 2;
+    case GL_COLOR_MATERIAL:      return 3;
+    case GL_CULL_FACE:           return 4;
+    case GL_DEPTH_TEST:          return 5;
+    case GL_DITHER:              return 6;
+    case GL_FOG:                 return 7;
+    case GL_LIGHTING:            return 8;
+    case GL_LINE_SMOOTH:         return 9;
+    case GL_NORMALIZE:           return 10;
+    case GL_POINT_SMOOTH:        return 11;
+    case GL_POLYGON_OFFSET_FILL: return 12;
+    case GL_POLYGON_SMOOTH:      return 13;
+    case GL_SCISSOR_TEST:        return 14;
+    case GL_STENCIL_TEST:        return 15;
+    case GL_TEXTURE_1D:          return 16;
+    case GL_TEXTURE_2D:          return 17;
+    case GL_TEXTURE_GEN_S:       return 18;
+    case GL_TEXTURE_GEN_T:       return 19;
+    default:
+      break;
+    }
+
+  /* GL_LIGHT0 .. GL_LIGHT7 */
+  if (cap >= GL_LIGHT0 && cap < GL_LIGHT0 + 8)
+    return 20 + (cap - GL_LIGHT0);
+
+  return -1;
+}
+
+static gint
+texture_target_to_index (GLenum target)
+{
+  switch (target)
+    {
+    case GL_TEXTURE_1D:       return TEXTURE_TARGET_1D;
+    case GL_TEXTURE_2D:       return TEXTURE_TARGET_2D;
+    case GL_TEXTURE_3D:       return TEXTURE_TARGET_3D;
+    case GL_TEXTURE_CUBE_MAP: return TEXTURE_TARGET_CUBE_MAP;
+    default:
+      break;
+    }
+
+  return -1;
+}
+
+/*< private >*/
+void
+_gdk_gl_state_cache_free (GdkGLStateCache *cache)
+{
+  g_free (cache);
+}
+
+/**
+ * gdk_gl_context_set_state_tracking:
+ * @glcontext: a #GdkGLContext.
+ * @setting: whether to shadow GL state on the client side.
+ *
+ * Enables or disables the state cache of @glcontext. While the cache is
+ * enabled, the gdk_gl_state_*() functions remember the last value set for
+ * each piece of state and skip calls that would not change it. On indirect
+ * rendering contexts every skipped call saves a protocol request; on direct
+ * contexts it saves driver-side state validation.
+ *
+ * The cache only sees changes made through the gdk_gl_state_*() functions.
+ * If you change the same state with plain GL calls, glPopAttrib(), display
+ * lists or glActiveTexture(), call gdk_gl_state_invalidate() afterwards.
+ * With tracking disabled (the default), the wrappers call GL directly.
+ **/
+void
+gdk_gl_context_set_state_tracking (GdkGLContext *glcontext,
+                                   gboolean      setting)
+{
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  GDK_GL_NOTE_FUNC ();
+
+  if (setting && STATE_CACHE (glcontext) == NULL)
+    {
+      STATE_CACHE (glcontext) = g_new0 (GdkGLStateCache, 1);
+    }
+  else if (!setting && STATE_CACHE (glcontext) != NULL)
+    {
+      GDK_GL_NOTE (MISC,
+        g_message (" -- State cache: %u issued, %u elided",
+                   STATE_CACHE (glcontext)->n_issued,
+                   STATE_CACHE (glcontext)->n_elided));
+
+      _gdk_gl_state_cache_free (STATE_CACHE (glcontext));
+      STATE_CACHE (glcontext) = NULL;
+    }
+}
+
+/**
+ * gdk_gl_context_get_state_tracking:
+ * @glcontext: a #GdkGLContext.
+ *
+ * Returns whether the state cache of @glcontext is enabled.
+ *
+ * Return value: TRUE if state tracking is enabled, FALSE otherwise.
+ **/
+gboolean
+gdk_gl_context_get_state_tracking (GdkGLContext *glcontext)
+{
+  g_return_val_if_fail (GDK_IS_GL_CONTEXT (glcontext), FALSE);
+
+  return STATE_CACHE (glcontext) != NULL;
+}
+
+/**
+ * gdk_gl_state_invalidate:
+ * @glcontext: a #GdkGLContext.
+ *
+ * Forgets all cached state of @glcontext, so that the next call to each
+ * gdk_gl_state_*() function reaches the GL. The statistics are kept.
+ **/
+void
+gdk_gl_state_invalidate (GdkGLContext *glcontext)
+{
+  GdkGLStateCache *cache;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+  if (cache == NULL)
+    return;
+
+  cache->caps_known = 0;
+  cache->valid = 0;
+}
+
+/**
+ * gdk_gl_state_get_stats:
+ * @glcontext: a #GdkGLContext.
+ * @n_issued: (out) (allow-none): return location for the number of calls
+ *            passed on to GL, or NULL.
+ * @n_elided: (out) (allow-none): return location for the number of
+ *            redundant calls skipped, or NULL.
+ *
+ * Gets the state cache counters of @glcontext. Both counters are zero if
+ * state tracking is disabled.
+ **/
+void
+gdk_gl_state_get_stats (GdkGLContext *glcontext,
+                        guint        *n_issued,
+                        guint        *n_elided)
+{
+  GdkGLStateCache *cache;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+
+  if (n_issued != NULL)
+    *n_issued = (cache != NULL) ? cache->n_issued : 0;
+  if (n_elided != NULL)
+    *n_elided = (cache != NULL) ? cache->n_elided : 0;
+}
+
+/**
+ * gdk_gl_state_reset_stats:
+ * @glcontext: a #GdkGLContext.
+ *
+ * Resets the state cache counters of @glcontext to zero.
+ **/
+void
+gdk_gl_state_reset_stats (GdkGLContext *glcontext)
+{
+  GdkGLStateCache *cache;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+  if (cache == NULL)
+    return;
+
+  cache->n_issued = 0;
+  cache->n_elided = 0;
+}
+
+static void
+gdk_gl_state_set_cap (GdkGLContext *glcontext,
+                      GLenum        cap,
+                      gboolean      enable)
+{
+  GdkGLStateCache *cache = STATE_CACHE (glcontext);
+  gint bit;
+
+  if (cache != NULL && (bit = cap_to_bit (cap)) >= 0)
+    {
+      guint32 mask = (guint32) 1 << bit;
+
+      if ((cache->caps_known & mask) &&
+          ((cache->caps_enabled & mask) != 0) == (enable != FALSE))
+        {
+          cache->n_elided++;
+          return;
+        }
+
+      cache->caps_known |= mask;
+      if (enable)
+        cache->caps_enabled |= mask;
+      else
+        cache->caps_enabled &= ~mask;
+    }
+
+  if (cache != NULL)
+    cache->n_issued++;
+
+  if (enable)
+    glEnable (cap);
+  else
+    glDisable (cap);
+}
+
+/**
+ * gdk_gl_state_enable:
+ * @glcontext: the current #GdkGLContext.
+ * @cap: a GL capability, such as GL_DEPTH_TEST.
+ *
+ * Calls glEnable() unless @cap is already known to be enabled.
+ **/
+void
+gdk_gl_state_enable (GdkGLContext *glcontext,
+                     guint         cap)
+{
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  gdk_gl_state_set_cap (glcontext, cap, TRUE);
+}
+
+/**
+ * gdk_gl_state_disable:
+ * @glcontext: the current #GdkGLContext.
+ * @cap: a GL capability, such as GL_DEPTH_TEST.
+ *
+ * Calls glDisable() unless @cap is already known to be disabled.
+ **/
+void
+gdk_gl_state_disable (GdkGLContext *glcontext,
+                      guint         cap)
+{
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  gdk_gl_state_set_cap (glcontext, cap, FALSE);
+}
+
+/**
+ * gdk_gl_state_bind_texture:
+ * @glcontext: the current #GdkGLContext.
+ * @target: GL_TEXTURE_1D, GL_TEXTURE_2D, GL_TEXTURE_3D or
+ *          GL_TEXTURE_CUBE_MAP.
+ * @texture: the texture object name.
+ *
+ * Calls glBindTexture() unless @texture is already bound to @target.
+ * Bindings are tracked for the active texture unit only.
+ **/
+void
+gdk_gl_state_bind_texture (GdkGLContext *glcontext,
+                           guint         target,
+                           guint         texture)
+{
+  GdkGLStateCache *cache;
+  gint index;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+
+  if (cache != NULL && (index = texture_target_to_index (target)) >= 0)
+    {
+      guint valid = STATE_VALID_TEXTURE << index;
+
+      if ((cache->valid & valid) && cache->textures[index] == texture)
+        {
+          cache->n_elided++;
+          return;
+        }
+
+      cache->valid |= valid;
+      cache->textures[index] = texture;
+    }
+
+  if (cache != NULL)
+    cache->n_issued++;
+
+  glBindTexture (target, texture);
+}
+
+/*
+ * Helper for the single-enum state setters below. Returns TRUE if the
+ * call can be skipped.
+ */
+static gboolean
+gdk_gl_state_update_enum (GdkGLStateCache *cache,
+                          guint            valid,
+                          GLenum          *cached,
+                          GLenum           value)
+{
+  if ((cache->valid & valid) && *cached == value)
+    {
+      cache->n_elided++;
+      return TRUE;
+    }
+
+  cache->valid |= valid;
+  *cached = value;
+  cache->n_issued++;
+
+  return FALSE;
+}
+
+/**
+ * gdk_gl_state_matrix_mode:
+ * @glcontext: the current #GdkGLContext.
+ * @mode: GL_MODELVIEW, GL_PROJECTION or GL_TEXTURE.
+ *
+ * Calls glMatrixMode() unless @mode is already the current matrix mode.
+ **/
+void
+gdk_gl_state_matrix_mode (GdkGLContext *glcontext,
+                          guint         mode)
+{
+  GdkGLStateCache *cache;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+
+  if (cache != NULL &&
+      gdk_gl_state_update_enum (cache, STATE_VALID_MATRIX_MODE,
+                                &cache->matrix_mode, mode))
+    return;
+
+  glMatrixMode (mode);
+}
+
+/**
+ * gdk_gl_state_shade_model:
+ * @glcontext: the current #GdkGLContext.
+ * @mode: GL_FLAT or GL_SMOOTH.
+ *
+ * Calls glShadeModel() unless @mode is already the current shade model.
+ **/
+void
+gdk_gl_state_shade_model (GdkGLContext *glcontext,
+                          guint         mode)
+{
+  GdkGLStateCache *cache;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+
+  if (cache != NULL &&
+      gdk_gl_state_update_enum (cache, STATE_VALID_SHADE_MODEL,
+                                &cache->shade_model, mode))
+    return;
+
+  glShadeModel (mode);
+}
+
+/**
+ * gdk_gl_state_blend_func:
+ * @glcontext: the current #GdkGLContext.
+ * @sfactor: the source blend factor.
+ * @dfactor: the destination blend factor.
+ *
+ * Calls glBlendFunc() unless the factors are already current.
+ **/
+void
+gdk_gl_state_blend_func (GdkGLContext *glcontext,
+                         guint         sfactor,
+                         guint         dfactor)
+{
+  GdkGLStateCache *cache;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+
+  if (cache != NULL)
+    {
+      if ((cache->valid & STATE_VALID_BLEND_FUNC) &&
+          cache->blend_sfactor == sfactor &&
+          cache->blend_dfactor == dfactor)
+        {
+          cache->n_elided++;
+          return;
+        }
+
+      cache->valid |= STATE_VALID_BLEND_FUNC;
+      cache->blend_sfactor = sfactor;
+      cache->blend_dfactor = dfactor;
+      cache->n_issued++;
+    }
+
+  glBlendFunc (sfactor, dfactor);
+}
+
+/**
+ * gdk_gl_state_depth_func:
+ * @glcontext: the current #GdkGLContext.
+ * @func: the depth comparison function.
+ *
+ * Calls glDepthFunc() unless @func is already the current depth function.
+ **/
+void
+gdk_gl_state_depth_func (GdkGLContext *glcontext,
+                         guint         func)
+{
+  GdkGLStateCache *cache;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+
+  if (cache != NULL &&
+      gdk_gl_state_update_enum (cache, STATE_VALID_DEPTH_FUNC,
+                                &cache->depth_func, func))
+    return;
+
+  glDepthFunc (func);
+}
+
+/**
+ * gdk_gl_state_depth_mask:
+ * @glcontext: the current #GdkGLContext.
+ * @flag: whether the depth buffer is enabled for writing.
+ *
+ * Calls glDepthMask() unless @flag is already the current depth mask.
+ **/
+void
+gdk_gl_state_depth_mask (GdkGLContext *glcontext,
+                         gboolean      flag)
+{
+  GdkGLStateCache *cache;
+  GLboolean mask = flag ? GL_TRUE : GL_FALSE;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+
+  if (cache != NULL)
+    {
+      if ((cache->valid & STATE_VALID_DEPTH_MASK) && cache->depth_mask == mask)
+        {
+          cache->n_elided++;
+          return;
+        }
+
+      cache->valid |= STATE_VALID_DEPTH_MASK;
+      cache->depth_mask = mask;
+      cache->n_issued++;
+    }
+
+  glDepthMask (mask);
+}
+
+/**
+ * gdk_gl_state_cull_face:
+ * @glcontext: the current #GdkGLContext.
+ * @mode: GL_FRONT, GL_BACK or GL_FRONT_AND_BACK.
+ *
+ * Calls glCullFace() unless @mode is already the current cull face mode.
+ **/
+void
+gdk_gl_state_cull_face (GdkGLContext *glcontext,
+                        guint         mode)
+{
+  GdkGLStateCache *cache;
+
+  g_return_if_fail (GDK_IS_GL_CONTEXT (glcontext));
+
+  cache = STATE_CACHE (glcontext);
+
+  if (cache != NULL &&
+      gdk_gl_state_update_enum (cache, STATE_VALID_CULL_FACE,
+                                &cache->cull_face, mode))
+    return;
+
+  glCullFace (mode);
+}
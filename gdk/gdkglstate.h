@@ -0,0 +1,75 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+#if !defined (__GDKGL_H_INSIDE__) && !defined (GDK_GL_COMPILATION)
+#error "Only <gdk/gdkgl.h> can be included directly."
+#endif
+
+#ifndef __GDK_GL_STATE_H__
+#define __GDK_GL_STATE_H__
+
+#include <gdk/gdkgldefs.h>
+#include <gdk/gdkgltypes.h>
+
+G_BEGIN_DECLS
+
+void     gdk_gl_context_set_state_tracking (GdkGLContext *glcontext,
+                                            gboolean      setting);
+
+gboolean gdk_gl_context_get_state_tracking (GdkGLContext *glcontext);
+
+void     gdk_gl_state_invalidate           (GdkGLContext *glcontext);
+
+void     gdk_gl_state_get_stats            (GdkGLContext *glcontext,
+                                            guint        *n_issued,
+                                            guint        *n_elided);
+
+void     gdk_gl_state_reset_stats          (GdkGLContext *glcontext);
+
+void     gdk_gl_state_enable               (GdkGLContext *glcontext,
+                                            guint         cap);
+
+void     gdk_gl_state_disable              (GdkGLContext *glcontext,
+                                            guint         cap);
+
+void     gdk_gl_state_bind_texture         (GdkGLContext *glcontext,
+                                            guint         target,
+                                            guint         texture);
+
+void     gdk_gl_state_matrix_mode          (GdkGLContext *glcontext,
+                                            guint         mode);
+
+void     gdk_gl_state_shade_model          (GdkGLContext *glcontext,
+                                            guint         mode);
+
+void     gdk_gl_state_blend_func           (GdkGLContext *glcontext,
+                                            guint         sfactor,
+                                            guint         dfactor);
+
+void     gdk_gl_state_depth_func           (GdkGLContext *glcontext,
+                                            guint         func);
+
+void     gdk_gl_state_depth_mask           (GdkGLContext *glcontext,
+                                            gboolean      flag);
+
+void     gdk_gl_state_cull_face            (GdkGLContext *glcontext,
+                                            guint         mode);
+
+G_END_DECLS
+
+#endif /* __GDK_GL_STATE_H__ */
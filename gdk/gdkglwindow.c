@@ -37,6 +37,23 @@ static void          _gdk_gl_window_swap_buffers        (GdkGLDrawable *gldrawab
 static void          _gdk_gl_window_wait_gl             (GdkGLDrawable *gldrawable);
 static void          _gdk_gl_window_wait_gdk            (GdkGLDrawable *gldrawable);
 static GdkGLConfig  *_gdk_gl_window_get_gl_config       (GdkGLDrawable *gldrawable);
+static void          _gdk_gl_window_swap_buffers_with_damage (GdkGLDrawable      *gldrawable,
+                                                              const GdkRectangle *rects,
+                                                              gint                n_rects);
+static gint          _gdk_gl_window_get_buffer_age      (GdkGLDrawable *gldrawable);
+static void          _gdk_gl_window_set_present_mode    (GdkGLDrawable    *gldrawable,
+                                                         GdkGLPresentMode  mode,
+                                                         guint             max_frames_in_flight);
+static GdkGLPresentMode _gdk_gl_window_get_present_mode (GdkGLDrawable    *gldrawable,
+                                                         guint            *max_frames_in_flight);
+static void          _gdk_gl_window_set_present_func    (GdkGLDrawable    *gldrawable,
+                                                         GdkGLPresentFunc  func,
+                                                         gpointer          user_data,
+                                                         GDestroyNotify    destroy);
+static gboolean      _gdk_gl_window_get_sync_values     (GdkGLDrawable *gldrawable,
+                                                         gint64        *ust,
+                                                         gint64        *msc,
+                                                         gint64        *sbc);
 
 static void gdk_gl_window_gl_drawable_interface_init (GdkGLDrawableClass *iface);
 
@@ -48,6 +65,13 @@ G_DEFINE_TYPE_EXTENDED  (GdkGLWindow,
                           GDK_TYPE_GL_DRAWABLE,
                           gdk_gl_window_gl_drawable_interface_init))
 
+enum {
+  FRAME_PRESENTED,
+  LAST_SIGNAL
+};
+
+static guint gl_window_signals[LAST_SIGNAL] = { 0 };
+
 static void
 gdk_gl_window_init (GdkGLWindow *self)
 {
@@ -78,6 +102,33 @@ gdk_gl_window_class_init (GdkGLWindowClass *klass)
   GDK_GL_NOTE_FUNC_PRIVATE ();
 
   object_class->finalize = gdk_gl_window_finalize;
+
+  /**
+   * GdkGLWindow::frame-presented:
+   * @glwindow: the #GdkGLWindow.
+   * @ust: the unadjusted system time at which the frame was presented.
+   * @msc: the media stream counter at which the frame was presented.
+   * @sbc: the swap buffer counter of the presented frame.
+   *
+   * Emitted when a frame of @glwindow has reached the screen. The
+   * signal is always emitted in the default main context; for buffer
+   * swaps done on another thread it is queued there. On X11
+   * this is driven by GLX_INTEL_swap_event, or polled with
+   * GLX_OML_sync_control at the following buffer swap. On Linux the
+   * UST is in microseconds of the monotonic clock, the same time base
+   * as g_get_monotonic_time().
+   */
+  gl_window_signals[FRAME_PRESENTED] =
+    g_signal_new ("frame-presented",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (GdkGLWindowClass, frame_presented),
+                  NULL, NULL,
+                  g_cclosure_marshal_generic,
+                  G_TYPE_NONE, 3,
+                  G_TYPE_INT64,
+                  G_TYPE_INT64,
+                  G_TYPE_INT64);
 }
 
 static void
@@ -91,6 +142,12 @@ gdk_gl_window_gl_drawable_interface_init (GdkGLDrawableClass *iface)
   iface->wait_gl            = _gdk_gl_window_wait_gl;
   iface->wait_gdk           = _gdk_gl_window_wait_gdk;
   iface->get_gl_config      = _gdk_gl_window_get_gl_config;
+  iface->swap_buffers_with_damage = _gdk_gl_window_swap_buffers_with_damage;
+  iface->get_buffer_age     = _gdk_gl_window_get_buffer_age;
+  iface->set_present_mode   = _gdk_gl_window_set_present_mode;
+  iface->get_present_mode   = _gdk_gl_window_get_present_mode;
+  iface->set_present_func   = _gdk_gl_window_set_present_func;
+  iface->get_sync_values    = _gdk_gl_window_get_sync_values;
 }
 
 static GdkGLContext *
@@ -171,6 +228,243 @@ _gdk_gl_window_get_gl_config (GdkGLDrawable *gldrawable)
   return GDK_GL_WINDOW_IMPL_GET_CLASS (glwindow->impl)->get_gl_config (glwindow);
 }
 
+static void
+_gdk_gl_window_swap_buffers_with_damage (GdkGLDrawable      *gldrawable,
+                                         const GdkRectangle *rects,
+                                         gint                n_rects)
+{
+  GdkGLWindow *glwindow;
+  GdkGLWindowImplClass *impl_class;
+
+  g_return_if_fail(GDK_IS_GL_WINDOW(gldrawable));
+
+  glwindow = GDK_GL_WINDOW (gldrawable);
+  impl_class = GDK_GL_WINDOW_IMPL_GET_CLASS (glwindow->impl);
+
+  if (impl_class->swap_buffers_with_damage != NULL)
+    impl_class->swap_buffers_with_damage (glwindow, rects, n_rects);
+  else
+    impl_class->swap_buffers (glwindow);
+}
+
+static gint
+_gdk_gl_window_get_buffer_age (GdkGLDrawable *gldrawable)
+{
+  GdkGLWindow *glwindow;
+  GdkGLWindowImplClass *impl_class;
+
+  g_return_val_if_fail(GDK_IS_GL_WINDOW(gldrawable), 0);
+
+  glwindow = GDK_GL_WINDOW (gldrawable);
+  impl_class = GDK_GL_WINDOW_IMPL_GET_CLASS (glwindow->impl);
+
+  if (impl_class->get_buffer_age == NULL)
+    return 0;
+
+  return impl_class->get_buffer_age (glwindow);
+}
+
+static void
+_gdk_gl_window_set_present_mode (GdkGLDrawable    *gldrawable,
+                                 GdkGLPresentMode  mode,
+                                 guint             max_frames_in_flight)
+{
+  GdkGLWindowImpl *impl;
+
+  g_return_if_fail(GDK_IS_GL_WINDOW(gldrawable));
+
+  impl = GDK_GL_WINDOW (gldrawable)->impl;
+
+  if (mode != GDK_GL_PRESENT_BOUNDED)
+    max_frames_in_flight = 0;
+  else if (max_frames_in_flight == 0)
+    max_frames_in_flight = 1;
+
+  if (impl->present_mode == mode &&
+      impl->max_frames_in_flight == max_frames_in_flight)
+    return;
+
+  impl->present_mode = mode;
+  impl->max_frames_in_flight = max_frames_in_flight;
+  impl->present_mode_changed = TRUE;
+}
+
+static GdkGLPresentMode
+_gdk_gl_window_get_present_mode (GdkGLDrawable *gldrawable,
+                                 guint         *max_frames_in_flight)
+{
+  GdkGLWindowImpl *impl;
+
+  g_return_val_if_fail(GDK_IS_GL_WINDOW(gldrawable), GDK_GL_PRESENT_FIFO);
+
+  impl = GDK_GL_WINDOW (gldrawable)->impl;
+
+  if (max_frames_in_flight != NULL)
+    *max_frames_in_flight = impl->max_frames_in_flight;
+
+  return impl->present_mode;
+}
+
+static void
+_gdk_gl_window_set_present_func (GdkGLDrawable    *gldrawable,
+                                 GdkGLPresentFunc  func,
+                                 gpointer          user_data,
+                                 GDestroyNotify    destroy)
+{
+  GdkGLWindowImpl *impl;
+
+  g_return_if_fail(GDK_IS_GL_WINDOW(gldrawable));
+
+  impl = GDK_GL_WINDOW (gldrawable)->impl;
+
+  if (impl->present_destroy != NULL)
+    impl->present_destroy (impl->present_data);
+
+  impl->present_func = func;
+  impl->present_data = user_data;
+  impl->present_destroy = destroy;
+}
+
+static gboolean
+_gdk_gl_window_get_sync_values (GdkGLDrawable *gldrawable,
+                                gint64        *ust,
+                                gint64        *msc,
+                                gint64        *sbc)
+{
+  GdkGLWindow *glwindow;
+  GdkGLWindowImplClass *impl_class;
+
+  g_return_val_if_fail(GDK_IS_GL_WINDOW(gldrawable), FALSE);
+
+  glwindow = GDK_GL_WINDOW (gldrawable);
+  impl_class = GDK_GL_WINDOW_IMPL_GET_CLASS (glwindow->impl);
+
+  if (impl_class->get_sync_values == NULL)
+    return FALSE;
+
+  return impl_class->get_sync_values (glwindow, ust, msc, sbc);
+}
+
+/*
+ * Presentation feedback goes to the default main context, also when the
+ * buffer swap happened on another thread.
+ */
+
+typedef struct
+{
+  GdkGLWindow *glwindow;
+  gint64       ust;
+  gint64       msc;
+  gint64       sbc;
+  gint64       latency;
+} GdkGLWindowFeedback;
+
+static GdkGLWindowFeedback *
+gl_window_feedback_new (GdkGLWindow *glwindow)
+{
+  GdkGLWindowFeedback *feedback;
+
+  feedback = g_slice_new0 (GdkGLWindowFeedback);
+  feedback->glwindow = g_object_ref (glwindow);
+
+  return feedback;
+}
+
+static void
+gl_window_feedback_free (gpointer data)
+{
+  GdkGLWindowFeedback *feedback = data;
+
+  g_object_unref (feedback->glwindow);
+  g_slice_free (GdkGLWindowFeedback, feedback);
+}
+
+static gboolean
+gl_window_emit_frame_presented (gpointer data)
+{
+  GdkGLWindowFeedback *feedback = data;
+
+  GDK_GL_NOTE (MISC,
+    g_message (" -- frame presented: ust = %" G_GINT64_FORMAT
+               ", msc = %" G_GINT64_FORMAT ", sbc = %" G_GINT64_FORMAT,
+               feedback->ust, feedback->msc, feedback->sbc));
+
+  g_signal_emit (feedback->glwindow, gl_window_signals[FRAME_PRESENTED], 0,
+                 feedback->ust, feedback->msc, feedback->sbc);
+
+  return FALSE;
+}
+
+static gboolean
+gl_window_call_present_func (gpointer data)
+{
+  GdkGLWindowFeedback *feedback = data;
+  GdkGLWindowImpl *impl = feedback->glwindow->impl;
+
+  if (impl != NULL && impl->present_func != NULL)
+    impl->present_func (GDK_GL_DRAWABLE (feedback->glwindow),
+                        feedback->latency,
+                        impl->present_data);
+
+  return FALSE;
+}
+
+/*
+ * Called by the backends when a frame has reached the screen.
+ */
+void
+_gdk_gl_window_frame_presented (GdkGLWindow *glwindow,
+                                gint64       ust,
+                                gint64       msc,
+                                gint64       sbc)
+{
+  GdkGLWindowFeedback *feedback;
+
+  g_return_if_fail (GDK_IS_GL_WINDOW (glwindow));
+
+  feedback = gl_window_feedback_new (glwindow);
+  feedback->ust = ust;
+  feedback->msc = msc;
+  feedback->sbc = sbc;
+
+  g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT,
+                              gl_window_emit_frame_presented,
+                              feedback,
+                              gl_window_feedback_free);
+}
+
+/*
+ * Called by the backends when the GPU has finished a presented frame,
+ * @latency microseconds after its buffer swap.
+ */
+void
+_gdk_gl_window_frame_completed (GdkGLWindow *glwindow,
+                                gint64       latency)
+{
+  GdkGLWindowFeedback *feedback;
+
+  g_return_if_fail (GDK_IS_GL_WINDOW (glwindow));
+
+  if (glwindow->impl->present_func == NULL)
+    return;
+
+  feedback = gl_window_feedback_new (glwindow);
+  feedback->latency = latency;
+
+  g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT,
+                              gl_window_call_present_func,
+                              feedback,
+                              gl_window_feedback_free);
+}
+
+gboolean
+_gdk_gl_window_has_frame_presented_handler (GdkGLWindow *glwindow)
+{
+  return g_signal_has_handler_pending (glwindow,
+                                       gl_window_signals[FRAME_PRESENTED],
+                                       0, TRUE);
+}
+
 /**
  * gdk_gl_window_new:
  * @glconfig: a #GdkGLConfig.
@@ -211,6 +505,24 @@ gdk_gl_window_get_window (GdkGLWindow *glwindow)
   return glwindow->window;
 }
 
+/**
+ * gdk_gl_window_swap_buffers_unchecked:
+ * @glwindow: a double-buffered #GdkGLWindow.
+ *
+ * Like gdk_gl_drawable_swap_buffers(), without going through the
+ * #GdkGLDrawable interface. The argument is only validated in debug
+ * builds.
+ **/
+void
+gdk_gl_window_swap_buffers_unchecked (GdkGLWindow *glwindow)
+{
+#ifdef G_ENABLE_DEBUG
+  g_return_if_fail (GDK_IS_GL_WINDOW (glwindow));
+#endif
+
+  GDK_GL_WINDOW_IMPL_GET_CLASS (glwindow->impl)->swap_buffers (glwindow);
+}
+
 /*
  * OpenGL extension to GdkWindow
  */
@@ -52,6 +52,12 @@ struct _GdkGLWindow
 struct _GdkGLWindowClass
 {
   GObjectClass parent_class;
+
+  /* Signals */
+  void (*frame_presented) (GdkGLWindow *glwindow,
+                           gint64       ust,
+                           gint64       msc,
+                           gint64       sbc);
 };
 
 GType        gdk_gl_window_get_type         (void);
@@ -66,6 +72,8 @@ GdkGLWindow *gdk_gl_window_new              (GdkGLConfig *glconfig,
 
 GdkWindow   *gdk_gl_window_get_window       (GdkGLWindow *glwindow);
 
+void         gdk_gl_window_swap_buffers_unchecked (GdkGLWindow *glwindow);
+
 /*
  * OpenGL extension to GdkWindow
  */
@@ -31,13 +31,25 @@ static void
 gdk_gl_window_impl_init (GdkGLWindowImpl *self)
 {
   GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  self->present_mode = GDK_GL_PRESENT_FIFO;
+  self->max_frames_in_flight = 0;
+  self->present_mode_changed = 0;
+  self->present_func = NULL;
+  self->present_data = NULL;
+  self->present_destroy = NULL;
 }
 
 static void
 gdk_gl_window_impl_finalize (GObject *object)
 {
+  GdkGLWindowImpl *impl = GDK_GL_WINDOW_IMPL (object);
+
   GDK_GL_NOTE_FUNC_PRIVATE ();
 
+  if (impl->present_destroy != NULL)
+    impl->present_destroy (impl->present_data);
+
   G_OBJECT_CLASS (gdk_gl_window_impl_parent_class)->finalize (object);
 }
 
@@ -55,6 +67,8 @@ gdk_gl_window_impl_class_init (GdkGLWindowImplClass *klass)
   klass->wait_gdk               = NULL;
   klass->get_gl_config          = NULL;
   klass->destroy_gl_window_impl = NULL;
+  klass->swap_buffers_with_damage = NULL;
+  klass->get_buffer_age         = NULL;
 
   object_class->finalize = gdk_gl_window_impl_finalize;
 }
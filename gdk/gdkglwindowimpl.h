@@ -33,6 +33,15 @@ G_BEGIN_DECLS
 typedef struct _GdkGLWindowImpl
 {
   GObject parent;
+
+  /* Present policy, enforced by the backend when swapping buffers. */
+  GdkGLPresentMode present_mode;
+  guint            max_frames_in_flight;
+  guint            present_mode_changed : 1;
+
+  GdkGLPresentFunc present_func;
+  gpointer         present_data;
+  GDestroyNotify   present_destroy;
 } GdkGLWindowImpl;
 
 typedef struct _GdkGLWindowImplClass
@@ -49,6 +58,14 @@ typedef struct _GdkGLWindowImplClass
   void          (*wait_gdk)               (GdkGLWindow *glwindow);
   GdkGLConfig*  (*get_gl_config)          (GdkGLWindow *glwindow);
   void          (*destroy_gl_window_impl) (GdkGLWindow *glwindow);
+  void          (*swap_buffers_with_damage) (GdkGLWindow        *glwindow,
+                                             const GdkRectangle *rects,
+                                             gint                n_rects);
+  gint          (*get_buffer_age)         (GdkGLWindow *glwindow);
+  gboolean      (*get_sync_values)        (GdkGLWindow *glwindow,
+                                           gint64      *ust,
+                                           gint64      *msc,
+                                           gint64      *sbc);
 } GdkGLWindowImplClass;
 
 GType gdk_gl_window_impl_get_type (void);
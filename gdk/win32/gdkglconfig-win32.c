@@ -230,6 +230,13 @@ gdk_gl_config_parse_attrib_list (const int             *attrib_list,
         	  pfd->cAccumAlphaBits = *(++p);
             ++i;
             break;
+          case GDK_GL_SAMPLE_BUFFERS:
+          case GDK_GL_SAMPLES:
+            /* Multisampling needs WGL_ARB_pixel_format, which
+               ChoosePixelFormat knows nothing about. Skip the value. */
+            ++p;
+            ++i;
+            break;
         }
       ++p;
     }
@@ -444,6 +451,10 @@ gdk_win32_gl_config_impl_init_attrib (GdkGLConfig *glconfig)
 
   /* Number of multisample buffers (not supported yet) */
   glconfig->impl->n_sample_buffers = 0;
+  glconfig->impl->n_samples = 0;
+
+  /* Cache the attribute table after layer_plane, which GDK_GL_LEVEL reads. */
+  _gdk_gl_config_impl_fill_attribs (glconfig);
 }
 
 static GdkGLConfig *
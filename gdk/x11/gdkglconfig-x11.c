@@ -26,6 +26,8 @@
 #include "gdkglprivate-x11.h"
 #include "gdkglconfig-x11.h"
 #include "gdkglwindow-x11.h"
+#include "gdkglprofile-x11.h"
+#include "gdkglshm-x11.h"
 
 #include <gdk/gdk.h>
 
@@ -104,52 +106,49 @@ gdk_gl_config_impl_x11_class_init (GdkGLConfigImplX11Class *klass)
 static void
 gdk_x11_gl_config_impl_init_attrib (GdkGLConfig *glconfig)
 {
-  GdkGLConfigImplX11 *x11_impl;
   int value;
 
-  x11_impl = GDK_GL_CONFIG_IMPL_X11 (glconfig->impl);
+  /* Fetch all attributes at once; everything below is a memory read. */
+  _gdk_gl_config_impl_fill_attribs (glconfig);
 
 #define _GET_CONFIG(__attrib) \
-  glXGetConfig (x11_impl->xdisplay, x11_impl->xvinfo, __attrib, &value)
+  (_gdk_gl_config_impl_lookup_attrib (glconfig, __attrib, &value) ? value : 0)
 
   /* RGBA mode? */
-  _GET_CONFIG (GLX_RGBA);
-  glconfig->impl->is_rgba = value ? TRUE : FALSE;
+  glconfig->impl->is_rgba = _GET_CONFIG (GDK_GL_RGBA) ? TRUE : FALSE;
 
   /* Layer plane. */
-  _GET_CONFIG (GLX_LEVEL);
-  glconfig->impl->layer_plane = value;
+  glconfig->impl->layer_plane = _GET_CONFIG (GDK_GL_LEVEL);
 
   /* Double buffering is supported? */
-  _GET_CONFIG (GLX_DOUBLEBUFFER);
-  glconfig->impl->is_double_buffered = value ? TRUE : FALSE;
+  glconfig->impl->is_double_buffered = _GET_CONFIG (GDK_GL_DOUBLEBUFFER) ? TRUE : FALSE;
 
   /* Stereo is supported? */
-  _GET_CONFIG (GLX_STEREO);
-  glconfig->impl->is_stereo = value ? TRUE : FALSE;
+  glconfig->impl->is_stereo = _GET_CONFIG (GDK_GL_STEREO) ? TRUE : FALSE;
 
   /* Number of aux buffers */
-  _GET_CONFIG (GLX_AUX_BUFFERS);
-  glconfig->impl->n_aux_buffers = value;
+  glconfig->impl->n_aux_buffers = _GET_CONFIG (GDK_GL_AUX_BUFFERS);
 
   /* Has alpha bits? */
-  _GET_CONFIG (GLX_ALPHA_SIZE);
-  glconfig->impl->has_alpha = value ? TRUE : FALSE;
+  glconfig->impl->has_alpha = _GET_CONFIG (GDK_GL_ALPHA_SIZE) ? TRUE : FALSE;
 
   /* Has depth buffer? */
-  _GET_CONFIG (GLX_DEPTH_SIZE);
-  glconfig->impl->has_depth_buffer = value ? TRUE : FALSE;
+  glconfig->impl->has_depth_buffer = _GET_CONFIG (GDK_GL_DEPTH_SIZE) ? TRUE : FALSE;
 
   /* Has stencil buffer? */
-  _GET_CONFIG (GLX_STENCIL_SIZE);
-  glconfig->impl->has_stencil_buffer = value ? TRUE : FALSE;
+  glconfig->impl->has_stencil_buffer = _GET_CONFIG (GDK_GL_STENCIL_SIZE) ? TRUE : FALSE;
 
   /* Has accumulation buffer? */
-  _GET_CONFIG (GLX_ACCUM_RED_SIZE);
-  glconfig->impl->has_accum_buffer = value ? TRUE : FALSE;
+  glconfig->impl->has_accum_buffer = _GET_CONFIG (GDK_GL_ACCUM_RED_SIZE) ? TRUE : FALSE;
+
+  /* Number of multisample buffers and samples per pixel.
+     Servers without GLX 1.4 or GLX_ARB_multisample do not know them. */
+  glconfig->impl->n_sample_buffers = _GET_CONFIG (GDK_GL_SAMPLE_BUFFERS);
 
-  /* Number of multisample buffers (not supported yet) */
-  glconfig->impl->n_sample_buffers = 0;
+  if (glconfig->impl->n_sample_buffers > 0)
+    glconfig->impl->n_samples = _GET_CONFIG (GDK_GL_SAMPLES);
+  else
+    glconfig->impl->n_samples = 0;
 
 #undef _GET_CONFIG
 }
@@ -216,6 +215,17 @@ glx_attrib_list_from_attrib_list (const gint *attrib_list, gsize n_attribs)
             /* not supported anymore */
             break;
 
+          case GDK_GL_SAMPLE_BUFFERS:
+          case GDK_GL_SAMPLES:
+            /* Same values as the GLX 1.4 tokens, but out of the
+               range of the lookup tables above. */
+            glx_attrib_list[glx_attrib_index++] = attrib_list[attrib_index];
+            ++attrib_index;
+            if (attrib_index == n_attribs)
+              goto err_n_attribs;
+            glx_attrib_list[glx_attrib_index++] = attrib_list[attrib_index];
+            break;
+
           default:
             glx_attrib_list[glx_attrib_index++] = glx_attrib_of_attrib[attrib_list[attrib_index]];
             if ( has_param[attrib_list[attrib_index]] )
@@ -241,6 +251,99 @@ err_g_malloc:
   return NULL;
 }
 
+/*
+ * Checks a visual against a glXChooseVisual () attribute list, with
+ * the same rules: boolean attributes must be set, GLX_LEVEL must match
+ * and everything else is a minimum.
+ */
+static gboolean
+gdk_x11_gl_visual_matches (Display     *xdisplay,
+                           XVisualInfo *xvinfo,
+                           const int   *glx_attrib_list)
+{
+  int value;
+  gint i;
+
+  for (i = 0; glx_attrib_list[i] != None; i++)
+    {
+      int attrib = glx_attrib_list[i];
+
+      if (glXGetConfig (xdisplay, xvinfo, attrib, &value) != Success)
+        return FALSE;
+
+      switch (attrib)
+        {
+        case GLX_USE_GL:
+        case GLX_RGBA:
+        case GLX_DOUBLEBUFFER:
+        case GLX_STEREO:
+          if (!value)
+            return FALSE;
+          break;
+
+        case GLX_LEVEL:
+          if (value != glx_attrib_list[++i])
+            return FALSE;
+          break;
+
+        default:
+          if (value < glx_attrib_list[++i])
+            return FALSE;
+          break;
+        }
+    }
+
+  return TRUE;
+}
+
+/*
+ * Looks up a visual remembered by the profile cache, checking that it
+ * still exists on the screen and still satisfies glx_attrib_list.
+ * Returns NULL, and forgets the visual, if it cannot be used.
+ */
+static XVisualInfo *
+gdk_x11_gl_get_cached_xvinfo (GdkScreen *screen,
+                              const int *glx_attrib_list)
+{
+  Display *xdisplay;
+  XVisualInfo xvinfo_template;
+  XVisualInfo *xvinfo;
+  VisualID xvisualid;
+  int nitems_return;
+
+  if (!_gdk_x11_gl_profile_lookup_visual (screen, glx_attrib_list, &xvisualid))
+    return NULL;
+
+  xdisplay = GDK_SCREEN_XDISPLAY (screen);
+
+  xvinfo_template.visualid = xvisualid;
+  xvinfo_template.screen = GDK_SCREEN_XNUMBER (screen);
+
+  xvinfo = XGetVisualInfo (xdisplay,
+                           VisualIDMask | VisualScreenMask,
+                           &xvinfo_template,
+                           &nitems_return);
+  if (xvinfo == NULL)
+    {
+      _gdk_x11_gl_profile_forget_visual (screen, glx_attrib_list);
+      return NULL;
+    }
+
+  if (nitems_return != 1 ||
+      !gdk_x11_gl_visual_matches (xdisplay, xvinfo, glx_attrib_list))
+    {
+      GDK_GL_NOTE (MISC, g_message (" -- cached visual id = 0x%lx is stale",
+                                    xvisualid));
+      XFree (xvinfo);
+      _gdk_x11_gl_profile_forget_visual (screen, glx_attrib_list);
+      return NULL;
+    }
+
+  GDK_GL_NOTE (MISC, g_message (" -- cached visual id = 0x%lx", xvisualid));
+
+  return xvinfo;
+}
+
 static GdkGLConfig *
 gdk_x11_gl_config_impl_new_common (GdkGLConfig *glconfig,
                                    GdkScreen *screen,
@@ -271,12 +374,19 @@ gdk_x11_gl_config_impl_new_common (GdkGLConfig *glconfig,
   if (glx_attrib_list == NULL)
     goto err_glx_attrib_list_from_attrib_list;
 
-  GDK_GL_NOTE_FUNC_IMPL ("glXChooseVisual");
-
-  xvinfo = glXChooseVisual (xdisplay, screen_num, glx_attrib_list);
+  xvinfo = gdk_x11_gl_get_cached_xvinfo (screen, glx_attrib_list);
 
   if (xvinfo == NULL)
-    goto err_glXChooseVisual;
+    {
+      GDK_GL_NOTE_FUNC_IMPL ("glXChooseVisual");
+
+      xvinfo = glXChooseVisual (xdisplay, screen_num, glx_attrib_list);
+
+      if (xvinfo == NULL)
+        goto err_glXChooseVisual;
+
+      _gdk_x11_gl_profile_store_visual (screen, glx_attrib_list, xvinfo->visualid);
+    }
 
   GDK_GL_NOTE (MISC,
     g_message (" -- glXChooseVisual: screen number = %d", xvinfo->screen));
@@ -379,45 +489,22 @@ gdk_x11_gl_get_xvinfo (Display  *xdisplay,
   return xvinfo_list;
 }
 
+/*
+ * Takes ownership of xvinfo, which must be freeable with XFree ().
+ */
 static GdkGLConfig *
-gdk_x11_gl_config_impl_new_from_visualid_common (GdkGLConfig *glconfig,
-                                                 GdkScreen   *screen,
-                                                 VisualID     xvisualid)
+gdk_x11_gl_config_impl_new_from_xvinfo_common (GdkGLConfig *glconfig,
+                                               GdkScreen   *screen,
+                                               XVisualInfo *xvinfo)
 {
   GdkGLConfigImplX11 *x11_impl;
 
-  Display *xdisplay;
-  int screen_num;
-  XVisualInfo *xvinfo;
-  int is_rgba;
-
   GDK_GL_NOTE_FUNC_PRIVATE ();
 
-  xdisplay = GDK_SCREEN_XDISPLAY (screen);
-  screen_num = GDK_SCREEN_XNUMBER (screen);
-
   GDK_GL_NOTE (MISC,
-               g_message (" -- GLX_VENDOR     : %s",
-                          glXGetClientString (xdisplay, GLX_VENDOR)));
+    g_message (" -- xvinfo: screen number = %d", xvinfo->screen));
   GDK_GL_NOTE (MISC,
-               g_message (" -- GLX_VERSION    : %s",
-                          glXGetClientString (xdisplay, GLX_VERSION)));
-  GDK_GL_NOTE (MISC,
-               g_message (" -- GLX_EXTENSIONS : %s",
-                          glXGetClientString (xdisplay, GLX_EXTENSIONS)));
-
-  /*
-   * Get XVisualInfo.
-   */
-
-  xvinfo = gdk_x11_gl_get_xvinfo (xdisplay, screen_num, xvisualid);
-  if (xvinfo == NULL)
-    return NULL;
-
-  GDK_GL_NOTE (MISC,
-    g_message (" -- gdk_x11_gl_get_xvinfo: screen number = %d", xvinfo->screen));
-  GDK_GL_NOTE (MISC,
-    g_message (" -- gdk_x11_gl_get_xvinfo: visual id = 0x%lx", xvinfo->visualid));
+    g_message (" -- xvinfo: visual id = 0x%lx", xvinfo->visualid));
 
   /*
    * Instantiate the GdkGLConfigImplX11 object.
@@ -427,14 +514,11 @@ gdk_x11_gl_config_impl_new_from_visualid_common (GdkGLConfig *glconfig,
 
   g_return_val_if_fail(x11_impl != NULL, NULL);
 
-  x11_impl->xdisplay = xdisplay;
-  x11_impl->screen_num = screen_num;
+  x11_impl->xdisplay = GDK_SCREEN_XDISPLAY (screen);
+  x11_impl->screen_num = GDK_SCREEN_XNUMBER (screen);
   x11_impl->xvinfo = xvinfo;
   x11_impl->screen = screen;
 
-  /* RGBA mode? */
-  glXGetConfig (xdisplay, xvinfo, GLX_RGBA, &is_rgba);
-
   /*
    * Init GdkGLConfig
    */
@@ -450,6 +534,41 @@ gdk_x11_gl_config_impl_new_from_visualid_common (GdkGLConfig *glconfig,
   return glconfig;
 }
 
+static GdkGLConfig *
+gdk_x11_gl_config_impl_new_from_visualid_common (GdkGLConfig *glconfig,
+                                                 GdkScreen   *screen,
+                                                 VisualID     xvisualid)
+{
+  Display *xdisplay;
+  int screen_num;
+  XVisualInfo *xvinfo;
+
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  xdisplay = GDK_SCREEN_XDISPLAY (screen);
+  screen_num = GDK_SCREEN_XNUMBER (screen);
+
+  GDK_GL_NOTE (MISC,
+               g_message (" -- GLX_VENDOR     : %s",
+                          glXGetClientString (xdisplay, GLX_VENDOR)));
+  GDK_GL_NOTE (MISC,
+               g_message (" -- GLX_VERSION    : %s",
+                          glXGetClientString (xdisplay, GLX_VERSION)));
+  GDK_GL_NOTE (MISC,
+               g_message (" -- GLX_EXTENSIONS : %s",
+                          glXGetClientString (xdisplay, GLX_EXTENSIONS)));
+
+  /*
+   * Get XVisualInfo.
+   */
+
+  xvinfo = gdk_x11_gl_get_xvinfo (xdisplay, screen_num, xvisualid);
+  if (xvinfo == NULL)
+    return NULL;
+
+  return gdk_x11_gl_config_impl_new_from_xvinfo_common (glconfig, screen, xvinfo);
+}
+
 GdkGLConfig *
 _gdk_x11_gl_config_impl_new_from_visualid_for_screen (GdkGLConfig *glconfig,
                                                       GdkScreen   *screen,
@@ -463,6 +582,20 @@ _gdk_x11_gl_config_impl_new_from_visualid_for_screen (GdkGLConfig *glconfig,
   return gdk_x11_gl_config_impl_new_from_visualid_common (glconfig, screen, xvisualid);
 }
 
+GdkGLConfig *
+_gdk_x11_gl_config_impl_new_from_xvinfo_for_screen (GdkGLConfig *glconfig,
+                                                    GdkScreen   *screen,
+                                                    XVisualInfo *xvinfo)
+{
+  GDK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (GDK_IS_X11_GL_CONFIG(glconfig), NULL);
+  g_return_val_if_fail (GDK_IS_SCREEN (screen), NULL);
+  g_return_val_if_fail (xvinfo != NULL, NULL);
+
+  return gdk_x11_gl_config_impl_new_from_xvinfo_common (glconfig, screen, xvinfo);
+}
+
 static Display *
 _gdk_x11_gl_config_impl_get_xdisplay (GdkGLConfig *glconfig)
 {
@@ -497,6 +630,14 @@ _gdk_x11_gl_config_impl_create_gl_window (GdkGLConfig *glconfig,
 
   g_return_val_if_fail (GDK_IS_X11_GL_CONFIG (glconfig), NULL);
 
+  if (_gdk_gl_shm_present)
+    {
+      /* Falls back to GLX if the window cannot be presented that way. */
+      glwindow = _gdk_x11_gl_window_shm_new (glconfig, window);
+      if (glwindow != NULL)
+        return glwindow;
+    }
+
   glwindow = g_object_new (GDK_TYPE_X11_GL_WINDOW, NULL);
 
   g_return_val_if_fail(glwindow != NULL, NULL);
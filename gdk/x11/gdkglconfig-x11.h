@@ -68,6 +68,9 @@ GdkGLConfig *_gdk_x11_gl_config_impl_new_for_screen               (GdkGLConfig *
 GdkGLConfig *_gdk_x11_gl_config_impl_new_from_visualid_for_screen (GdkGLConfig *glconfig,
                                                                    GdkScreen   *screen,
                                                                    VisualID     xvisualid);
+GdkGLConfig *_gdk_x11_gl_config_impl_new_from_xvinfo_for_screen   (GdkGLConfig *glconfig,
+                                                                   GdkScreen   *screen,
+                                                                   XVisualInfo *xvinfo);
 
 G_END_DECLS
 
@@ -27,6 +27,7 @@
 #include "gdkglconfig-x11.h"
 #include "gdkglwindow-x11.h"
 #include "gdkglcontext-x11.h"
+#include "gdkglshm-x11.h"
 
 static void          gdk_gl_context_insert (GdkGLContext *glcontext);
 static void          gdk_gl_context_remove (GdkGLContext *glcontext);
@@ -43,6 +44,8 @@ static int            _gdk_x11_gl_context_impl_get_render_type  (GdkGLContext *g
 static gboolean       _gdk_x11_gl_context_impl_make_current     (GdkGLContext  *glcontext,
                                                                  GdkGLDrawable *draw,
                                                                  GdkGLDrawable *read);
+static gboolean       _gdk_x11_gl_context_impl_make_current_unchecked (GdkGLContext *glcontext,
+                                                                       GdkGLWindow  *glwindow);
 static GLXContext     _gdk_x11_gl_context_impl_get_glxcontext   (GdkGLContext *glcontext);
 
 G_DEFINE_TYPE (GdkGLContextImplX11,             \
@@ -149,6 +152,7 @@ gdk_gl_context_impl_x11_class_init (GdkGLContextImplX11Class *klass)
   klass->parent_class.get_render_type = _gdk_x11_gl_context_impl_get_render_type;
   klass->parent_class.make_current    = _gdk_x11_gl_context_impl_make_current;
   klass->parent_class.make_uncurrent  = NULL;
+  klass->parent_class.make_current_unchecked = _gdk_x11_gl_context_impl_make_current_unchecked;
 
   object_class->finalize = gdk_gl_context_impl_x11_finalize;
 }
@@ -444,7 +448,6 @@ _gdk_x11_gl_context_impl_make_current (GdkGLContext  *glcontext,
   GdkGLWindow *glwindow;
   GdkGLWindowImplX11 *x11_impl;
   GdkGLConfig *glconfig;
-  GdkWindow *window;
   Window glxwindow;
   GLXContext glxcontext;
 
@@ -454,19 +457,22 @@ _gdk_x11_gl_context_impl_make_current (GdkGLContext  *glcontext,
   glwindow = GDK_GL_WINDOW(draw);
   x11_impl = GDK_GL_WINDOW_IMPL_X11 (glwindow->impl);
   glconfig = x11_impl->glconfig;
-  window = gdk_gl_window_get_window(glwindow);
   glxwindow = x11_impl->glxwindow;
   glxcontext = GDK_GL_CONTEXT_GLXCONTEXT (glcontext);
 
   if (glxwindow == None || glxcontext == NULL)
     return FALSE;
 
+  /* From the config, not the GdkWindow: this may run on a render thread. */
   GDK_GL_NOTE (MISC,
     g_message (" -- Window: screen number = %d",
-      GDK_SCREEN_XNUMBER (gdk_window_get_screen (window))));
+      GDK_GL_CONFIG_SCREEN_XNUMBER (glconfig)));
   GDK_GL_NOTE (MISC,
     g_message (" -- Window: visual id = 0x%lx",
-      GDK_VISUAL_XVISUAL (gdk_window_get_visual (window))->visualid));
+      GDK_GL_CONFIG_XVINFO (glconfig)->visualid));
+
+  /* An OSMesa context would stay current next to the GLX one. */
+  _gdk_x11_gl_shm_release_current ();
 
   GDK_GL_NOTE_FUNC_IMPL ("glXMakeCurrent");
 
@@ -498,23 +504,73 @@ _gdk_x11_gl_context_impl_make_current (GdkGLContext  *glcontext,
   return TRUE;
 }
 
+/*
+ * Per-frame variant of the above: no type checks or debug notes, and
+ * no glXMakeCurrent() (which implies a flush) if the context is still
+ * bound to the window since the previous frame.
+ */
+static gboolean
+_gdk_x11_gl_context_impl_make_current_unchecked (GdkGLContext *glcontext,
+                                                 GdkGLWindow  *glwindow)
+{
+  GdkGLContextImplX11 *impl = (GdkGLContextImplX11 *) glcontext->impl;
+  GdkGLWindowImplX11 *x11_impl = (GdkGLWindowImplX11 *) glwindow->impl;
+  GdkGLDrawable *draw = (GdkGLDrawable *) glwindow;
+  Display *xdisplay;
+
+  if (x11_impl->glxwindow == None || impl->glxcontext == NULL)
+    return FALSE;
+
+  if (impl->gldrawable == draw &&
+      glXGetCurrentContext () == impl->glxcontext &&
+      glXGetCurrentDrawable () == x11_impl->glxwindow)
+    return TRUE;
+
+  xdisplay = ((GdkGLConfigImplX11 *) x11_impl->glconfig->impl)->xdisplay;
+
+  _gdk_x11_gl_shm_release_current ();
+
+  if (!glXMakeCurrent (xdisplay, x11_impl->glxwindow, impl->glxcontext))
+    {
+      g_warning ("glXMakeCurrent() failed");
+      _gdk_x11_gl_context_impl_set_gl_drawable (glcontext, NULL);
+      return FALSE;
+    }
+
+  _gdk_x11_gl_context_impl_set_gl_drawable (glcontext, draw);
+
+  if (_GDK_GL_CONFIG_AS_SINGLE_MODE (x11_impl->glconfig))
+    {
+      glDrawBuffer (GL_FRONT);
+      glReadBuffer (GL_FRONT);
+    }
+
+  return TRUE;
+}
+
+/* GLX keeps a current context per thread, so does the cache. */
+static GPrivate current_private = G_PRIVATE_INIT (NULL);
+
 GdkGLContext *
 _gdk_x11_gl_context_impl_get_current (void)
 {
-  static GdkGLContext *current = NULL;
+  GdkGLContext *current;
   GLXContext glxcontext;
 
   GDK_GL_NOTE_FUNC ();
 
   glxcontext = glXGetCurrentContext ();
 
+  /* Contexts of shared memory presentation are not GLX contexts. */
   if (glxcontext == NULL)
-    return NULL;
+    return _gdk_x11_gl_context_shm_get_current ();
 
+  current = g_private_get (&current_private);
   if (current && GDK_GL_CONTEXT_GLXCONTEXT (current) == glxcontext)
     return current;
 
   current = gdk_gl_context_lookup (glxcontext);
+  g_private_set (&current_private, current);
 
   return current;
 }
@@ -532,6 +588,7 @@ _gdk_x11_gl_context_impl_get_glxcontext (GdkGLContext *glcontext)
  */
 
 static GHashTable *gl_context_ht = NULL;
+G_LOCK_DEFINE_STATIC (gl_context_ht);
 
 static void
 gdk_gl_context_insert (GdkGLContext *glcontext)
@@ -540,6 +597,8 @@ gdk_gl_context_insert (GdkGLContext *glcontext)
 
   GDK_GL_NOTE_FUNC_PRIVATE ();
 
+  G_LOCK (gl_context_ht);
+
   if (gl_context_ht == NULL)
     {
       GDK_GL_NOTE (MISC, g_message (" -- Create GL context hash table."));
@@ -555,6 +614,8 @@ gdk_gl_context_insert (GdkGLContext *glcontext)
   impl = GDK_GL_CONTEXT_IMPL_X11 (glcontext->impl);
 
   g_hash_table_insert (gl_context_ht, impl->glxcontext, glcontext);
+
+  G_UNLOCK (gl_context_ht);
 }
 
 static void
@@ -564,8 +625,13 @@ gdk_gl_context_remove (GdkGLContext *glcontext)
 
   GDK_GL_NOTE_FUNC_PRIVATE ();
 
+  G_LOCK (gl_context_ht);
+
   if (gl_context_ht == NULL)
-    return;
+    {
+      G_UNLOCK (gl_context_ht);
+      return;
+    }
 
   impl = GDK_GL_CONTEXT_IMPL_X11 (glcontext->impl);
 
@@ -577,15 +643,23 @@ gdk_gl_context_remove (GdkGLContext *glcontext)
       g_hash_table_destroy (gl_context_ht);
       gl_context_ht = NULL;
     }
+
+  G_UNLOCK (gl_context_ht);
 }
 
 static GdkGLContext *
 gdk_gl_context_lookup (GLXContext glxcontext)
 {
+  GdkGLContext *glcontext = NULL;
+
   GDK_GL_NOTE_FUNC_PRIVATE ();
 
-  if (gl_context_ht == NULL)
-    return NULL;
+  G_LOCK (gl_context_ht);
+
+  if (gl_context_ht != NULL)
+    glcontext = g_hash_table_lookup (gl_context_ht, glxcontext);
+
+  G_UNLOCK (gl_context_ht);
 
-  return g_hash_table_lookup (gl_context_ht, glxcontext);
+  return glcontext;
 }
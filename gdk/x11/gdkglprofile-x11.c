@@ -0,0 +1,397 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+/*
+ * On-disk cache of per-server GLX profile data.
+ *
+ * Finding a visual and fetching the GLX extensions string cost round
+ * trips to the X server, which add up over indirect GLX.  When enabled
+ * with --gdk-gl-profile-cache or GDK_GL_PROFILE_CACHE, the results are
+ * kept in $XDG_CACHE_HOME/gtkglext/glx-profile.ini, in one group per
+ * display and screen.  The group name is a checksum of the X server
+ * vendor and release, the GLX server and client vendors and versions,
+ * the display name and the screen number, so any driver or server
+ * update starts a new group.  The GLX server strings cost two round
+ * trips, made once per screen; everything else is known locally.
+ * Cached visuals are still checked against the requested attributes
+ * before use.
+ *
+ * Stores made while starting up are written out together from an idle
+ * handler, or when the display closes or the process exits if that
+ * comes first, to a temporary file that is then renamed over the cache,
+ * so other processes never read a partial file.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "gdkglx.h"
+#include "gdkglprivate-x11.h"
+#include "gdkglprofile-x11.h"
+
+#define PROFILE_DIR_NAME  "gtkglext"
+#define PROFILE_FILE_NAME "glx-profile.ini"
+
+#define PROFILE_GROUP_KEY "gdk-gl-profile-group"
+
+G_LOCK_DEFINE_STATIC (profile);
+
+static GKeyFile *profile = NULL;
+static gchar *profile_path = NULL;
+static guint profile_save_id = 0;
+
+/* Called with the lock held. */
+static GKeyFile *
+gdk_x11_gl_profile_get (void)
+{
+  if (profile != NULL)
+    return profile;
+
+  profile_path = g_build_filename (g_get_user_cache_dir (),
+                                   PROFILE_DIR_NAME,
+                                   PROFILE_FILE_NAME,
+                                   NULL);
+
+  profile = g_key_file_new ();
+
+  if (g_key_file_load_from_file (profile, profile_path, G_KEY_FILE_NONE, NULL))
+    GDK_GL_NOTE (MISC, g_message (" -- loaded GLX profile cache %s", profile_path));
+
+  return profile;
+}
+
+static gboolean
+gdk_x11_gl_profile_write (GError **error)
+{
+  gchar *dir_name;
+  gchar *tmp_path;
+  gchar *data;
+  gsize length;
+  gboolean ret = FALSE;
+  int fd;
+
+  dir_name = g_path_get_dirname (profile_path);
+  g_mkdir_with_parents (dir_name, 0700);
+  g_free (dir_name);
+
+  data = g_key_file_to_data (profile, &length, NULL);
+
+  tmp_path = g_strconcat (profile_path, ".XXXXXX", NULL);
+
+  fd = g_mkstemp (tmp_path);
+  if (fd < 0)
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                   "%s: %s", tmp_path, g_strerror (errno));
+      goto out;
+    }
+
+  if (write (fd, data, length) != (gssize) length)
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                   "%s: %s", tmp_path, g_strerror (errno));
+      close (fd);
+      g_unlink (tmp_path);
+      goto out;
+    }
+
+  close (fd);
+
+  if (g_rename (tmp_path, profile_path) != 0)
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                   "%s: %s", profile_path, g_strerror (errno));
+      g_unlink (tmp_path);
+      goto out;
+    }
+
+  ret = TRUE;
+
+ out:
+  g_free (tmp_path);
+  g_free (data);
+
+  return ret;
+}
+
+/* Called with the lock held. */
+static void
+gdk_x11_gl_profile_save_now (void)
+{
+  GError *error = NULL;
+
+  if (!gdk_x11_gl_profile_write (&error))
+    {
+      GDK_GL_NOTE (MISC, g_message (" -- cannot save GLX profile cache: %s",
+                                    error->message));
+      g_error_free (error);
+    }
+}
+
+static gboolean
+gdk_x11_gl_profile_save_idle (gpointer data)
+{
+  G_LOCK (profile);
+
+  if (profile_save_id != 0)
+    {
+      profile_save_id = 0;
+      gdk_x11_gl_profile_save_now ();
+    }
+
+  G_UNLOCK (profile);
+
+  return FALSE;
+}
+
+/*
+ * Writes out a pending save right away.
+ */
+static void
+gdk_x11_gl_profile_flush (void)
+{
+  G_LOCK (profile);
+
+  if (profile_save_id != 0)
+    {
+      g_source_remove (profile_save_id);
+      profile_save_id = 0;
+      gdk_x11_gl_profile_save_now ();
+    }
+
+  G_UNLOCK (profile);
+}
+
+static void
+gdk_x11_gl_profile_display_closed (GdkDisplay *display,
+                                   gboolean    is_error,
+                                   gpointer    data)
+{
+  gdk_x11_gl_profile_flush ();
+}
+
+/* Called with the lock held. */
+static void
+gdk_x11_gl_profile_save (void)
+{
+  static gboolean atexit_done = FALSE;
+
+  if (profile_save_id != 0)
+    return;
+
+  profile_save_id = g_idle_add_full (G_PRIORITY_LOW,
+                                     gdk_x11_gl_profile_save_idle,
+                                     NULL, NULL);
+
+  /* In case the main loop never gets idle again. */
+  if (!atexit_done)
+    {
+      atexit (gdk_x11_gl_profile_flush);
+      atexit_done = TRUE;
+    }
+}
+
+static const gchar *
+gdk_x11_gl_profile_get_group (GdkScreen *screen)
+{
+  Display *xdisplay;
+  int screen_num;
+  const char *server_vendor;
+  const char *server_version;
+  gchar *key;
+  gchar *group;
+
+  group = g_object_get_data (G_OBJECT (screen), PROFILE_GROUP_KEY);
+  if (group != NULL)
+    return group;
+
+  xdisplay = GDK_SCREEN_XDISPLAY (screen);
+  screen_num = GDK_SCREEN_XNUMBER (screen);
+
+  /* The server side driver, which matters for indirect GLX. */
+  server_vendor = glXQueryServerString (xdisplay, screen_num, GLX_VENDOR);
+  server_version = glXQueryServerString (xdisplay, screen_num, GLX_VERSION);
+
+  key = g_strdup_printf ("%s|%d|%s|%s|%s|%s|%s|%d",
+                         ServerVendor (xdisplay),
+                         VendorRelease (xdisplay),
+                         server_vendor ? server_vendor : "",
+                         server_version ? server_version : "",
+                         glXGetClientString (xdisplay, GLX_VENDOR),
+                         glXGetClientString (xdisplay, GLX_VERSION),
+                         DisplayString (xdisplay),
+                         screen_num);
+
+  group = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+
+  GDK_GL_NOTE (MISC, g_message (" -- GLX profile %s: %s", group, key));
+
+  g_free (key);
+
+  g_object_set_data_full (G_OBJECT (screen), PROFILE_GROUP_KEY,
+                          group, (GDestroyNotify) g_free);
+
+  g_signal_connect (gdk_screen_get_display (screen), "closed",
+                    G_CALLBACK (gdk_x11_gl_profile_display_closed), NULL);
+
+  return group;
+}
+
+static gchar *
+gdk_x11_gl_profile_visual_key (const int *glx_attrib_list)
+{
+  GString *key;
+  gint i;
+
+  key = g_string_new ("visual");
+
+  for (i = 0; glx_attrib_list[i] != None; i++)
+    g_string_append_printf (key, "-%x", glx_attrib_list[i]);
+
+  return g_string_free (key, FALSE);
+}
+
+gboolean
+_gdk_x11_gl_profile_lookup_visual (GdkScreen *screen,
+                                   const int *glx_attrib_list,
+                                   VisualID  *xvisualid)
+{
+  const gchar *group;
+  gchar *key;
+  gchar *value;
+
+  if (!_gdk_gl_profile_cache)
+    return FALSE;
+
+  group = gdk_x11_gl_profile_get_group (screen);
+  key = gdk_x11_gl_profile_visual_key (glx_attrib_list);
+
+  G_LOCK (profile);
+  value = g_key_file_get_value (gdk_x11_gl_profile_get (), group, key, NULL);
+  G_UNLOCK (profile);
+
+  g_free (key);
+
+  if (value == NULL)
+    return FALSE;
+
+  *xvisualid = g_ascii_strtoull (value, NULL, 0);
+  g_free (value);
+
+  return *xvisualid != 0;
+}
+
+void
+_gdk_x11_gl_profile_store_visual (GdkScreen *screen,
+                                  const int *glx_attrib_list,
+                                  VisualID   xvisualid)
+{
+  const gchar *group;
+  gchar *key;
+  gchar *value;
+
+  if (!_gdk_gl_profile_cache)
+    return;
+
+  group = gdk_x11_gl_profile_get_group (screen);
+  key = gdk_x11_gl_profile_visual_key (glx_attrib_list);
+  value = g_strdup_printf ("0x%lx", xvisualid);
+
+  G_LOCK (profile);
+  g_key_file_set_value (gdk_x11_gl_profile_get (), group, key, value);
+  gdk_x11_gl_profile_save ();
+  G_UNLOCK (profile);
+
+  g_free (value);
+  g_free (key);
+}
+
+void
+_gdk_x11_gl_profile_forget_visual (GdkScreen *screen,
+                                   const int *glx_attrib_list)
+{
+  const gchar *group;
+  gchar *key;
+
+  if (!_gdk_gl_profile_cache)
+    return;
+
+  group = gdk_x11_gl_profile_get_group (screen);
+  key = gdk_x11_gl_profile_visual_key (glx_attrib_list);
+
+  G_LOCK (profile);
+  if (g_key_file_remove_key (gdk_x11_gl_profile_get (), group, key, NULL))
+    gdk_x11_gl_profile_save ();
+  G_UNLOCK (profile);
+
+  g_free (key);
+}
+
+/*
+ * Returns an interned string, or NULL if there is no cached one.
+ */
+const char *
+_gdk_x11_gl_profile_lookup_glx_extensions (GdkScreen *screen)
+{
+  const gchar *group;
+  gchar *value;
+  const char *extensions;
+
+  if (!_gdk_gl_profile_cache)
+    return NULL;
+
+  group = gdk_x11_gl_profile_get_group (screen);
+
+  G_LOCK (profile);
+  value = g_key_file_get_value (gdk_x11_gl_profile_get (), group,
+                                "glx-extensions", NULL);
+  G_UNLOCK (profile);
+
+  if (value == NULL)
+    return NULL;
+
+  extensions = g_intern_string (value);
+  g_free (value);
+
+  return extensions;
+}
+
+void
+_gdk_x11_gl_profile_store_glx_extensions (GdkScreen  *screen,
+                                          const char *extensions)
+{
+  const gchar *group;
+
+  if (!_gdk_gl_profile_cache || extensions == NULL)
+    return;
+
+  group = gdk_x11_gl_profile_get_group (screen);
+
+  G_LOCK (profile);
+  g_key_file_set_value (gdk_x11_gl_profile_get (), group,
+                        "glx-extensions", extensions);
+  gdk_x11_gl_profile_save ();
+  G_UNLOCK (profile);
+}
@@ -0,0 +1,46 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+#ifndef __GDK_GL_PROFILE_X11_H__
+#define __GDK_GL_PROFILE_X11_H__
+
+#include <gdk/gdkx.h>
+
+#include <GL/glx.h>
+
+G_BEGIN_DECLS
+
+gboolean    _gdk_x11_gl_profile_lookup_visual         (GdkScreen   *screen,
+                                                       const int   *glx_attrib_list,
+                                                       VisualID    *xvisualid);
+
+void        _gdk_x11_gl_profile_store_visual          (GdkScreen   *screen,
+                                                       const int   *glx_attrib_list,
+                                                       VisualID     xvisualid);
+
+void        _gdk_x11_gl_profile_forget_visual         (GdkScreen   *screen,
+                                                       const int   *glx_attrib_list);
+
+const char *_gdk_x11_gl_profile_lookup_glx_extensions (GdkScreen   *screen);
+
+void        _gdk_x11_gl_profile_store_glx_extensions  (GdkScreen   *screen,
+                                                       const char  *extensions);
+
+G_END_DECLS
+
+#endif /* __GDK_GL_PROFILE_X11_H__ */
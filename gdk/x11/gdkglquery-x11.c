@@ -33,6 +33,8 @@
 #include "gdkglx.h"
 #include "gdkglprivate-x11.h"
 #include "gdkglconfig-x11.h"
+#include "gdkglprofile-x11.h"
+#include "gdkglshm-x11.h"
 #include "gdkglquery.h"
 
 #include "gdkglquery-x11.h"
@@ -87,6 +89,9 @@ gdk_x11_gl_query_glx_extension (GdkGLConfig *glconfig,
   if (where || *extension == '\0')
     return FALSE;
 
+  if (extensions == NULL)
+    extensions = _gdk_x11_gl_profile_lookup_glx_extensions (gdk_gl_config_get_screen (glconfig));
+
   if (extensions == NULL)
     {
       /* Be careful not to call glXQueryExtensionsString if it
@@ -102,6 +107,9 @@ gdk_x11_gl_query_glx_extension (GdkGLConfig *glconfig,
 
       extensions = glXQueryExtensionsString (GDK_GL_CONFIG_XDISPLAY (glconfig),
                                              GDK_GL_CONFIG_SCREEN_XNUMBER (glconfig));
+
+      _gdk_x11_gl_profile_store_glx_extensions (gdk_gl_config_get_screen (glconfig),
+                                                extensions);
     }
 
   /* It takes a bit of care to be fool-proof about parsing
@@ -278,6 +286,16 @@ _gdk_x11_gl_get_proc_address (const char *proc_name)
 
   if (strncmp ("glu", proc_name, 3) != 0)
     {
+      /* Shared memory presentation renders with OSMesa, not libGL. */
+      if (_gdk_x11_gl_context_shm_get_current () != NULL)
+        {
+          proc_address = _gdk_x11_gl_shm_get_proc_address (proc_name);
+          GDK_GL_NOTE (IMPL, g_message (" ** OSMesaGetProcAddress () - %s",
+                                        proc_address ? "succeeded" : "failed"));
+          if (proc_address != NULL)
+            return proc_address;
+        }
+
       if (glx_get_proc_address == (__glXGetProcAddressProc) -1)
         {
           /*
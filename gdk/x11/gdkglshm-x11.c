@@ -0,0 +1,985 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+/*
+ * Shared memory presentation.
+ *
+ * Over indirect or remote GLX every GL command is sent to the X server,
+ * which is very slow for large vertex streams.  When enabled with
+ * --gdk-gl-shm-present or GDK_GL_SHM_PRESENT, OpenGL windows are instead
+ * rendered locally by OSMesa, straight into the pixels of an XImage,
+ * and finished frames are copied to the X window with XShmPutImage.
+ * If the X server cannot attach the shared memory segment (e.g. it runs
+ * on another host), XPutImage is used instead.  Presenting with damage
+ * only sends the damaged rectangles, and since the image keeps its
+ * contents between frames, the buffer age is always 1.
+ *
+ * OSMesa only renders what is called through its own entry points, so
+ * the application must take its gl* functions from libOSMesa rather
+ * than libGL; with a GLVND or other non-OSMesa libGL the calls would
+ * never reach the image.  Windows therefore fall back to GLX unless
+ * the process's glClear () is OSMesa's, and gdk_gl_get_proc_address ()
+ * resolves through OSMesaGetProcAddress () while an OSMesa context is
+ * current.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "gdkglx.h"
+#include "gdkglprivate-x11.h"
+#include "gdkglconfig-x11.h"
+#include "gdkglshm-x11.h"
+
+#ifdef HAVE_GDK_GL_SHM_PRESENT
+
+#include <stdlib.h>
+
+#include <gmodule.h>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <X11/extensions/XShm.h>
+
+#include <GL/osmesa.h>
+
+#include <gdk/gdkglcontextimpl.h>
+#include <gdk/gdkglwindowimpl.h>
+
+/*
+ * Window implementation.
+ */
+
+typedef struct _GdkGLWindowImplShm      GdkGLWindowImplShm;
+typedef struct _GdkGLWindowImplShmClass GdkGLWindowImplShmClass;
+
+#define GDK_TYPE_GL_WINDOW_IMPL_SHM       (gdk_gl_window_impl_shm_get_type ())
+#define GDK_GL_WINDOW_IMPL_SHM(object)    (G_TYPE_CHECK_INSTANCE_CAST ((object), GDK_TYPE_GL_WINDOW_IMPL_SHM, GdkGLWindowImplShm))
+#define GDK_IS_GL_WINDOW_IMPL_SHM(object) (G_TYPE_CHECK_INSTANCE_TYPE ((object), GDK_TYPE_GL_WINDOW_IMPL_SHM))
+
+struct _GdkGLWindowImplShm
+{
+  GdkGLWindowImpl parent_instance;
+
+  GdkGLConfig *glconfig;
+
+  Display *xdisplay;
+  Window   xwindow;
+  Visual  *xvisual;
+  int      depth;
+  GC       gc;
+
+  /* Pixel layout OSMesa renders in, matching the visual. */
+  GLenum osmesa_format;
+
+  /* Frame buffer, whose pixels the X server reads directly if use_shm. */
+  XImage          *ximage;
+  XShmSegmentInfo  shminfo;
+
+  /* ShmCompletion events still to come for frames already presented,
+     counted by a filter on window. */
+  GdkWindow *window;
+  int        shm_event_base;
+  guint      puts_pending;
+
+  guint use_shm : 1;
+  guint presented : 1;
+  guint is_destroyed : 1;
+};
+
+struct _GdkGLWindowImplShmClass
+{
+  GdkGLWindowImplClass parent_class;
+};
+
+static GType gdk_gl_window_impl_shm_get_type (void);
+
+G_DEFINE_TYPE (GdkGLWindowImplShm,              \
+               gdk_gl_window_impl_shm,          \
+               GDK_TYPE_GL_WINDOW_IMPL)
+
+/*
+ * Context implementation.
+ */
+
+typedef struct _GdkGLContextImplShm      GdkGLContextImplShm;
+typedef struct _GdkGLContextImplShmClass GdkGLContextImplShmClass;
+
+#define GDK_TYPE_GL_CONTEXT_IMPL_SHM       (gdk_gl_context_impl_shm_get_type ())
+#define GDK_GL_CONTEXT_IMPL_SHM(object)    (G_TYPE_CHECK_INSTANCE_CAST ((object), GDK_TYPE_GL_CONTEXT_IMPL_SHM, GdkGLContextImplShm))
+#define GDK_IS_GL_CONTEXT_IMPL_SHM(object) (G_TYPE_CHECK_INSTANCE_TYPE ((object), GDK_TYPE_GL_CONTEXT_IMPL_SHM))
+
+struct _GdkGLContextImplShm
+{
+  GdkGLContextImpl parent_instance;
+
+  OSMesaContext osmesa_context;
+  GdkGLContext *share_list;
+  int render_type;
+
+  GdkGLConfig *glconfig;
+
+  GdkGLDrawable *gldrawable;
+};
+
+struct _GdkGLContextImplShmClass
+{
+  GdkGLContextImplClass parent_class;
+};
+
+static GType gdk_gl_context_impl_shm_get_type (void);
+
+G_DEFINE_TYPE (GdkGLContextImplShm,             \
+               gdk_gl_context_impl_shm,         \
+               GDK_TYPE_GL_CONTEXT_IMPL)
+
+/* OSMesa keeps a current context per thread, so does the cache. */
+static GPrivate current_private = G_PRIVATE_INIT (NULL);
+
+/* Weak notify tying an implementation object to its wrapper. */
+static void
+gl_shm_release_impl (gpointer  data,
+                     GObject  *where_the_object_was)
+{
+  g_object_unref (data);
+}
+
+static Bool
+gl_window_shm_is_completion (Display  *xdisplay,
+                             XEvent   *xevent,
+                             XPointer  arg)
+{
+  GdkGLWindowImplShm *impl = (GdkGLWindowImplShm *) arg;
+
+  return (xevent->type == impl->shm_event_base + ShmCompletion &&
+          ((XShmCompletionEvent *) xevent)->drawable == impl->xwindow);
+}
+
+/*
+ * Completions GDK reads off the connection before we wait for them
+ * end up here instead.
+ */
+static GdkFilterReturn
+gl_window_shm_filter (GdkXEvent *gdk_xevent,
+                      GdkEvent  *event,
+                      gpointer   data)
+{
+  GdkGLWindowImplShm *impl = (GdkGLWindowImplShm *) data;
+  XEvent *xevent = (XEvent *) gdk_xevent;
+
+  if (!gl_window_shm_is_completion (impl->xdisplay, xevent, (XPointer) impl))
+    return GDK_FILTER_CONTINUE;
+
+  if (impl->puts_pending > 0)
+    impl->puts_pending--;
+
+  return GDK_FILTER_REMOVE;
+}
+
+/*
+ * Blocks until the server has copied every presented rectangle out of
+ * the shared image, without a round trip when it already has.
+ */
+static void
+gl_window_shm_wait_puts (GdkGLWindowImplShm *impl)
+{
+  XEvent xevent;
+
+  while (impl->puts_pending > 0)
+    {
+      XIfEvent (impl->xdisplay, &xevent,
+                gl_window_shm_is_completion, (XPointer) impl);
+      impl->puts_pending--;
+    }
+}
+
+static void
+gl_window_shm_remove_filter (GdkGLWindowImplShm *impl)
+{
+  if (impl->window == NULL)
+    return;
+
+  gdk_window_remove_filter (impl->window, gl_window_shm_filter, impl);
+  g_object_remove_weak_pointer (G_OBJECT (impl->window),
+                                (gpointer *) &(impl->window));
+  impl->window = NULL;
+}
+
+static void
+gl_window_shm_free_image (GdkGLWindowImplShm *impl)
+{
+  if (impl->ximage == NULL)
+    return;
+
+  /* The server may still be reading the last frame. */
+  gl_window_shm_wait_puts (impl);
+
+  if (impl->use_shm)
+    {
+      XShmDetach (impl->xdisplay, &impl->shminfo);
+      shmdt (impl->shminfo.shmaddr);
+      impl->ximage->data = NULL;
+    }
+
+  XDestroyImage (impl->ximage);
+  impl->ximage = NULL;
+}
+
+static XImage *
+gl_window_shm_create_shm_image (GdkGLWindowImplShm *impl,
+                                gint                width,
+                                gint                height)
+{
+  XImage *ximage;
+  gboolean attached = FALSE;
+
+  ximage = XShmCreateImage (impl->xdisplay, impl->xvisual, impl->depth,
+                            ZPixmap, NULL, &impl->shminfo,
+                            width, height);
+  if (ximage == NULL)
+    return NULL;
+
+  impl->shminfo.shmid = shmget (IPC_PRIVATE,
+                                ximage->bytes_per_line * height,
+                                IPC_CREAT | 0600);
+  if (impl->shminfo.shmid >= 0)
+    {
+      impl->shminfo.shmaddr = shmat (impl->shminfo.shmid, NULL, 0);
+      impl->shminfo.readOnly = False;
+
+      if (impl->shminfo.shmaddr != (char *) -1)
+        {
+          gdk_error_trap_push ();
+          XShmAttach (impl->xdisplay, &impl->shminfo);
+          XSync (impl->xdisplay, False);
+          attached = (gdk_error_trap_pop () == Success);
+
+          if (!attached)
+            shmdt (impl->shminfo.shmaddr);
+        }
+
+      /* Freed once both sides have detached. */
+      shmctl (impl->shminfo.shmid, IPC_RMID, NULL);
+    }
+
+  if (!attached)
+    {
+      XDestroyImage (ximage);
+      return NULL;
+    }
+
+  ximage->data = impl->shminfo.shmaddr;
+
+  return ximage;
+}
+
+/*
+ * (Re)allocates the frame buffer for a window of the given size.
+ */
+static gboolean
+gl_window_shm_ensure_image (GdkGLWindowImplShm *impl,
+                            gint                width,
+                            gint                height)
+{
+  if (impl->ximage != NULL &&
+      impl->ximage->width == width &&
+      impl->ximage->height == height)
+    return TRUE;
+
+  gl_window_shm_free_image (impl);
+  impl->presented = FALSE;
+
+  if (width <= 0 || height <= 0)
+    return FALSE;
+
+  if (impl->use_shm)
+    {
+      impl->ximage = gl_window_shm_create_shm_image (impl, width, height);
+      if (impl->ximage == NULL)
+        {
+          GDK_GL_NOTE (MISC, g_message (" -- MIT-SHM not usable, falling back to XPutImage"));
+          impl->use_shm = FALSE;
+        }
+    }
+
+  if (impl->ximage == NULL)
+    {
+      impl->ximage = XCreateImage (impl->xdisplay, impl->xvisual, impl->depth,
+                                   ZPixmap, 0, NULL, width, height, 32, 0);
+      if (impl->ximage == NULL)
+        return FALSE;
+
+      /* XDestroyImage () releases it with free (). */
+      impl->ximage->data = malloc (impl->ximage->bytes_per_line * height);
+      if (impl->ximage->data == NULL)
+        {
+          XDestroyImage (impl->ximage);
+          impl->ximage = NULL;
+          return FALSE;
+        }
+    }
+
+  return TRUE;
+}
+
+/*
+ * Gets the frame buffer ready for rendering the next frame.
+ */
+static gboolean
+gl_window_shm_begin_frame (GdkGLWindow *glwindow)
+{
+  GdkGLWindowImplShm *impl = (GdkGLWindowImplShm *) glwindow->impl;
+
+  if (impl->is_destroyed || glwindow->window == NULL)
+    return FALSE;
+
+  if (!gl_window_shm_ensure_image (impl,
+                                   gdk_window_get_width (glwindow->window),
+                                   gdk_window_get_height (glwindow->window)))
+    return FALSE;
+
+  /* Do not draw over pixels the server has yet to copy. */
+  gl_window_shm_wait_puts (impl);
+
+  return TRUE;
+}
+
+static void
+gl_window_shm_present (GdkGLWindow        *glwindow,
+                       const GdkRectangle *rects,
+                       gint                n_rects)
+{
+  GdkGLWindowImplShm *impl = GDK_GL_WINDOW_IMPL_SHM (glwindow->impl);
+  GdkRectangle bounds;
+  GdkRectangle area;
+  gint i;
+
+  if (impl->is_destroyed || impl->ximage == NULL)
+    return;
+
+  /* OSMesa renders on the CPU, make sure the frame is complete. */
+  if (OSMesaGetCurrentContext () != NULL)
+    glFinish ();
+
+  bounds.x = 0;
+  bounds.y = 0;
+  bounds.width = impl->ximage->width;
+  bounds.height = impl->ximage->height;
+
+  if (rects == NULL || n_rects <= 0)
+    {
+      rects = &bounds;
+      n_rects = 1;
+    }
+
+  GDK_GL_NOTE_FUNC_IMPL (impl->use_shm ? "XShmPutImage" : "XPutImage");
+
+  for (i = 0; i < n_rects; i++)
+    {
+      if (!gdk_rectangle_intersect (&rects[i], &bounds, &area))
+        continue;
+
+      if (impl->use_shm)
+        {
+          XShmPutImage (impl->xdisplay, impl->xwindow, impl->gc, impl->ximage,
+                        area.x, area.y, area.x, area.y, area.width, area.height,
+                        True);
+          impl->puts_pending++;
+        }
+      else
+        XPutImage (impl->xdisplay, impl->xwindow, impl->gc, impl->ximage,
+                   area.x, area.y, area.x, area.y, area.width, area.height);
+    }
+
+  XFlush (impl->xdisplay);
+
+  impl->presented = TRUE;
+}
+
+static GdkGLContext *
+_gdk_x11_gl_window_impl_shm_create_gl_context (GdkGLWindow  *glwindow,
+                                               GdkGLContext *share_list,
+                                               gboolean      direct,
+                                               int           render_type)
+{
+  GdkGLWindowImplShm *window_impl = GDK_GL_WINDOW_IMPL_SHM (glwindow->impl);
+  GdkGLContextImplShm *impl;
+  GdkGLContext *glcontext;
+  OSMesaContext osmesa_context;
+  OSMesaContext share_osmesa_context = NULL;
+  int depth_size = 0;
+  int stencil_size = 0;
+  int accum_size = 0;
+
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  /* Only other OSMesa contexts can share objects with this one. */
+  if (share_list != NULL && GDK_IS_GL_CONTEXT (share_list) &&
+      GDK_IS_GL_CONTEXT_IMPL_SHM (share_list->impl))
+    share_osmesa_context = GDK_GL_CONTEXT_IMPL_SHM (share_list->impl)->osmesa_context;
+
+  gdk_gl_config_get_attrib (window_impl->glconfig, GDK_GL_DEPTH_SIZE, &depth_size);
+  gdk_gl_config_get_attrib (window_impl->glconfig, GDK_GL_STENCIL_SIZE, &stencil_size);
+  gdk_gl_config_get_attrib (window_impl->glconfig, GDK_GL_ACCUM_RED_SIZE, &accum_size);
+
+  GDK_GL_NOTE_FUNC_IMPL ("OSMesaCreateContextExt");
+
+  osmesa_context = OSMesaCreateContextExt (window_impl->osmesa_format,
+                                           depth_size,
+                                           stencil_size,
+                                           accum_size * 4,
+                                           share_osmesa_context);
+  if (osmesa_context == NULL)
+    {
+      g_warning ("OSMesaCreateContextExt() failed");
+      return NULL;
+    }
+
+  glcontext = g_object_new (GDK_TYPE_GL_CONTEXT, NULL);
+
+  impl = g_object_new (GDK_TYPE_GL_CONTEXT_IMPL_SHM, NULL);
+  impl->osmesa_context = osmesa_context;
+  impl->render_type = render_type;
+  impl->glconfig = g_object_ref (window_impl->glconfig);
+
+  if (share_list != NULL && GDK_IS_GL_CONTEXT (share_list))
+    impl->share_list = g_object_ref (share_list);
+
+  glcontext->impl = GDK_GL_CONTEXT_IMPL (impl);
+
+  /* The implementation goes away with its context. */
+  g_object_weak_ref (G_OBJECT (glcontext),
+                     gl_shm_release_impl,
+                     impl);
+
+  return glcontext;
+}
+
+static gboolean
+_gdk_x11_gl_window_impl_shm_is_double_buffered (GdkGLWindow *glwindow)
+{
+  /* Frames only reach the window when presented, whatever the config. */
+  return TRUE;
+}
+
+static void
+_gdk_x11_gl_window_impl_shm_swap_buffers (GdkGLWindow *glwindow)
+{
+  g_return_if_fail (GDK_IS_GL_WINDOW_IMPL_SHM (glwindow->impl));
+
+  gl_window_shm_present (glwindow, NULL, 0);
+}
+
+static void
+_gdk_x11_gl_window_impl_shm_swap_buffers_with_damage (GdkGLWindow        *glwindow,
+                                                      const GdkRectangle *rects,
+                                                      gint                n_rects)
+{
+  g_return_if_fail (GDK_IS_GL_WINDOW_IMPL_SHM (glwindow->impl));
+
+  gl_window_shm_present (glwindow, rects, n_rects);
+}
+
+static void
+_gdk_x11_gl_window_impl_shm_wait_gl (GdkGLWindow *glwindow)
+{
+  if (OSMesaGetCurrentContext () != NULL)
+    glFinish ();
+}
+
+static void
+_gdk_x11_gl_window_impl_shm_wait_gdk (GdkGLWindow *glwindow)
+{
+  GdkGLWindowImplShm *impl = GDK_GL_WINDOW_IMPL_SHM (glwindow->impl);
+
+  gl_window_shm_wait_puts (impl);
+  XSync (impl->xdisplay, False);
+}
+
+static GdkGLConfig *
+_gdk_x11_gl_window_impl_shm_get_gl_config (GdkGLWindow *glwindow)
+{
+  g_return_val_if_fail (GDK_IS_GL_WINDOW_IMPL_SHM (glwindow->impl), NULL);
+
+  return GDK_GL_WINDOW_IMPL_SHM (glwindow->impl)->glconfig;
+}
+
+static void
+_gdk_x11_gl_window_impl_shm_destroy (GdkGLWindow *glwindow)
+{
+  GdkGLWindowImplShm *impl = GDK_GL_WINDOW_IMPL_SHM (glwindow->impl);
+
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (impl->is_destroyed)
+    return;
+
+  gl_window_shm_free_image (impl);
+  gl_window_shm_remove_filter (impl);
+
+  XFreeGC (impl->xdisplay, impl->gc);
+  impl->gc = NULL;
+
+  impl->is_destroyed = TRUE;
+}
+
+static gint
+_gdk_x11_gl_window_impl_shm_get_buffer_age (GdkGLWindow *glwindow)
+{
+  /* There is a single buffer; it holds the last presented frame. */
+  return GDK_GL_WINDOW_IMPL_SHM (glwindow->impl)->presented ? 1 : 0;
+}
+
+static gboolean
+_gdk_x11_gl_window_impl_shm_get_sync_values (GdkGLWindow *glwindow,
+                                             gint64      *ust,
+                                             gint64      *msc,
+                                             gint64      *sbc)
+{
+  return FALSE;
+}
+
+static void
+gdk_gl_window_impl_shm_init (GdkGLWindowImplShm *self)
+{
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+}
+
+static void
+gdk_gl_window_impl_shm_finalize (GObject *object)
+{
+  GdkGLWindowImplShm *impl = GDK_GL_WINDOW_IMPL_SHM (object);
+
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (!impl->is_destroyed)
+    {
+      gl_window_shm_free_image (impl);
+      gl_window_shm_remove_filter (impl);
+      XFreeGC (impl->xdisplay, impl->gc);
+    }
+
+  g_object_unref (G_OBJECT (impl->glconfig));
+
+  G_OBJECT_CLASS (gdk_gl_window_impl_shm_parent_class)->finalize (object);
+}
+
+static void
+gdk_gl_window_impl_shm_class_init (GdkGLWindowImplShmClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  klass->parent_class.create_gl_context      = _gdk_x11_gl_window_impl_shm_create_gl_context;
+  klass->parent_class.is_double_buffered     = _gdk_x11_gl_window_impl_shm_is_double_buffered;
+  klass->parent_class.swap_buffers           = _gdk_x11_gl_window_impl_shm_swap_buffers;
+  klass->parent_class.wait_gl                = _gdk_x11_gl_window_impl_shm_wait_gl;
+  klass->parent_class.wait_gdk               = _gdk_x11_gl_window_impl_shm_wait_gdk;
+  klass->parent_class.get_gl_config          = _gdk_x11_gl_window_impl_shm_get_gl_config;
+  klass->parent_class.destroy_gl_window_impl = _gdk_x11_gl_window_impl_shm_destroy;
+  klass->parent_class.swap_buffers_with_damage = _gdk_x11_gl_window_impl_shm_swap_buffers_with_damage;
+  klass->parent_class.get_buffer_age         = _gdk_x11_gl_window_impl_shm_get_buffer_age;
+  klass->parent_class.get_sync_values        = _gdk_x11_gl_window_impl_shm_get_sync_values;
+
+  object_class->finalize = gdk_gl_window_impl_shm_finalize;
+}
+
+/*
+ * Finds the OSMesa pixel layout of 32-bit pixels of the visual.
+ */
+static gboolean
+gl_shm_get_osmesa_format (Display     *xdisplay,
+                          XVisualInfo *xvinfo,
+                          GLenum      *osmesa_format)
+{
+  XPixmapFormatValues *formats;
+  int n_formats, i;
+  int bits_per_pixel = 0;
+
+  if (xvinfo->class != TrueColor ||
+      xvinfo->red_mask != 0xff0000 ||
+      xvinfo->green_mask != 0x00ff00 ||
+      xvinfo->blue_mask != 0x0000ff)
+    return FALSE;
+
+  formats = XListPixmapFormats (xdisplay, &n_formats);
+  if (formats == NULL)
+    return FALSE;
+
+  for (i = 0; i < n_formats; i++)
+    {
+      if (formats[i].depth == xvinfo->depth)
+        bits_per_pixel = formats[i].bits_per_pixel;
+    }
+
+  XFree (formats);
+
+  if (bits_per_pixel != 32)
+    return FALSE;
+
+  *osmesa_format = (ImageByteOrder (xdisplay) == LSBFirst) ? OSMESA_BGRA : OSMESA_ARGB;
+
+  return TRUE;
+}
+
+/*
+ * Checks that the application's GL calls end up in OSMesa.
+ */
+static gboolean
+gl_shm_is_osmesa_linked (void)
+{
+  static gint linked = -1;
+  GModule *module;
+  gpointer gl_clear = NULL;
+
+  if (linked >= 0)
+    return linked;
+
+  module = g_module_open (NULL, G_MODULE_BIND_LAZY);
+  if (module != NULL)
+    {
+      g_module_symbol (module, "glClear", &gl_clear);
+      g_module_close (module);
+    }
+
+  linked = (gl_clear != NULL &&
+            gl_clear == (gpointer) OSMesaGetProcAddress ("glClear"));
+
+  GDK_GL_NOTE (MISC, g_message (" -- OpenGL entry points %s from OSMesa",
+                                linked ? "are" : "are not"));
+
+  return linked;
+}
+
+/*< private >*/
+GdkGLWindow *
+_gdk_x11_gl_window_shm_new (GdkGLConfig *glconfig,
+                            GdkWindow   *window)
+{
+  GdkGLWindow *glwindow;
+  GdkGLWindowImplShm *impl;
+  Display *xdisplay;
+  XVisualInfo *xvinfo;
+  GLenum osmesa_format;
+
+  GDK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (GDK_IS_X11_GL_CONFIG (glconfig), NULL);
+  g_return_val_if_fail (GDK_IS_WINDOW (window), NULL);
+
+  if (!gl_shm_is_osmesa_linked ())
+    {
+      g_warning ("Shared memory presentation needs the application to be "
+                 "linked with OSMesa, using GLX instead");
+      return NULL;
+    }
+
+  xdisplay = GDK_GL_CONFIG_XDISPLAY (glconfig);
+  xvinfo = GDK_GL_CONFIG_XVINFO (glconfig);
+
+  if (!gl_shm_get_osmesa_format (xdisplay, xvinfo, &osmesa_format))
+    {
+      GDK_GL_NOTE (MISC,
+        g_message (" -- Visual 0x%lx cannot be presented through shared memory",
+                   xvinfo->visualid));
+      return NULL;
+    }
+
+  glwindow = g_object_new (GDK_TYPE_GL_WINDOW, NULL);
+
+  impl = g_object_new (GDK_TYPE_GL_WINDOW_IMPL_SHM, NULL);
+  impl->glconfig = g_object_ref (glconfig);
+  impl->xdisplay = xdisplay;
+  impl->xwindow = GDK_WINDOW_XID (window);
+  impl->xvisual = xvinfo->visual;
+  impl->depth = xvinfo->depth;
+  impl->osmesa_format = osmesa_format;
+  impl->gc = XCreateGC (xdisplay, impl->xwindow, 0, NULL);
+  impl->use_shm = XShmQueryExtension (xdisplay) ? TRUE : FALSE;
+
+  if (impl->use_shm)
+    {
+      impl->shm_event_base = XShmGetEventBase (xdisplay);
+
+      impl->window = window;
+      g_object_add_weak_pointer (G_OBJECT (impl->window),
+                                 (gpointer *) &(impl->window));
+      gdk_window_add_filter (impl->window, gl_window_shm_filter, impl);
+    }
+
+  glwindow->impl = GDK_GL_WINDOW_IMPL (impl);
+  glwindow->window = window;
+  g_object_add_weak_pointer (G_OBJECT (glwindow->window),
+                             (gpointer *) &(glwindow->window));
+
+  /* The implementation goes away with its window. */
+  g_object_weak_ref (G_OBJECT (glwindow),
+                     gl_shm_release_impl,
+                     impl);
+
+  return glwindow;
+}
+
+/*
+ * Context implementation.
+ */
+
+static void
+gl_context_shm_set_gl_drawable (GdkGLContext  *glcontext,
+                                GdkGLDrawable *gldrawable)
+{
+  GdkGLContextImplShm *impl = (GdkGLContextImplShm *) glcontext->impl;
+
+  if (impl->gldrawable == gldrawable)
+    return;
+
+  if (impl->gldrawable != NULL)
+    g_object_remove_weak_pointer (G_OBJECT (impl->gldrawable),
+                                  (gpointer *) &(impl->gldrawable));
+
+  impl->gldrawable = gldrawable;
+
+  if (impl->gldrawable != NULL)
+    g_object_add_weak_pointer (G_OBJECT (impl->gldrawable),
+                               (gpointer *) &(impl->gldrawable));
+}
+
+static gboolean
+gl_context_shm_make_current (GdkGLContext *glcontext,
+                             GdkGLWindow  *glwindow)
+{
+  GdkGLContextImplShm *impl = (GdkGLContextImplShm *) glcontext->impl;
+  XImage *ximage;
+
+  if (!gl_window_shm_begin_frame (glwindow))
+    return FALSE;
+
+  ximage = ((GdkGLWindowImplShm *) glwindow->impl)->ximage;
+
+  /* GLX and OSMesa each keep their own current context; leave only one. */
+  if (glXGetCurrentContext () != NULL)
+    glXMakeCurrent (glXGetCurrentDisplay (), None, NULL);
+
+  if (!OSMesaMakeCurrent (impl->osmesa_context, ximage->data, GL_UNSIGNED_BYTE,
+                          ximage->width, ximage->height))
+    {
+      g_warning ("OSMesaMakeCurrent() failed");
+      gl_context_shm_set_gl_drawable (glcontext, NULL);
+      return FALSE;
+    }
+
+  /* Render top-down, in the row layout of the image. */
+  OSMesaPixelStore (OSMESA_ROW_LENGTH, ximage->bytes_per_line / 4);
+  OSMesaPixelStore (OSMESA_Y_UP, 0);
+
+  gl_context_shm_set_gl_drawable (glcontext, GDK_GL_DRAWABLE (glwindow));
+
+  g_private_set (&current_private, glcontext);
+
+  return TRUE;
+}
+
+static gboolean
+_gdk_x11_gl_context_impl_shm_copy (GdkGLContext  *glcontext,
+                                   GdkGLContext  *src,
+                                   unsigned long  mask)
+{
+  /* OSMesa has no equivalent of glXCopyContext (). */
+  return FALSE;
+}
+
+static GdkGLDrawable *
+_gdk_x11_gl_context_impl_shm_get_gl_drawable (GdkGLContext *glcontext)
+{
+  return GDK_GL_CONTEXT_IMPL_SHM (glcontext->impl)->gldrawable;
+}
+
+static GdkGLConfig *
+_gdk_x11_gl_context_impl_shm_get_gl_config (GdkGLContext *glcontext)
+{
+  return GDK_GL_CONTEXT_IMPL_SHM (glcontext->impl)->glconfig;
+}
+
+static GdkGLContext *
+_gdk_x11_gl_context_impl_shm_get_share_list (GdkGLContext *glcontext)
+{
+  return GDK_GL_CONTEXT_IMPL_SHM (glcontext->impl)->share_list;
+}
+
+static gboolean
+_gdk_x11_gl_context_impl_shm_is_direct (GdkGLContext *glcontext)
+{
+  /* Rendering never goes through the X server. */
+  return TRUE;
+}
+
+static int
+_gdk_x11_gl_context_impl_shm_get_render_type (GdkGLContext *glcontext)
+{
+  return GDK_GL_CONTEXT_IMPL_SHM (glcontext->impl)->render_type;
+}
+
+static gboolean
+_gdk_x11_gl_context_impl_shm_make_current (GdkGLContext  *glcontext,
+                                           GdkGLDrawable *draw,
+                                           GdkGLDrawable *read)
+{
+  g_return_val_if_fail (GDK_IS_GL_CONTEXT_IMPL_SHM (glcontext->impl), FALSE);
+  g_return_val_if_fail (GDK_IS_GL_WINDOW (draw), FALSE);
+  g_return_val_if_fail (GDK_IS_GL_WINDOW_IMPL_SHM (GDK_GL_WINDOW (draw)->impl), FALSE);
+
+  GDK_GL_NOTE_FUNC_IMPL ("OSMesaMakeCurrent");
+
+  return gl_context_shm_make_current (glcontext, GDK_GL_WINDOW (draw));
+}
+
+static gboolean
+_gdk_x11_gl_context_impl_shm_make_current_unchecked (GdkGLContext *glcontext,
+                                                     GdkGLWindow  *glwindow)
+{
+  return gl_context_shm_make_current (glcontext, glwindow);
+}
+
+static void
+gdk_gl_context_impl_shm_init (GdkGLContextImplShm *self)
+{
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+}
+
+static void
+gdk_gl_context_impl_shm_finalize (GObject *object)
+{
+  GdkGLContextImplShm *impl = GDK_GL_CONTEXT_IMPL_SHM (object);
+
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (OSMesaGetCurrentContext () == impl->osmesa_context)
+    {
+      OSMesaMakeCurrent (NULL, NULL, GL_UNSIGNED_BYTE, 0, 0);
+      g_private_set (&current_private, NULL);
+    }
+
+  GDK_GL_NOTE_FUNC_IMPL ("OSMesaDestroyContext");
+  OSMesaDestroyContext (impl->osmesa_context);
+
+  if (impl->gldrawable != NULL)
+    g_object_remove_weak_pointer (G_OBJECT (impl->gldrawable),
+                                  (gpointer *) &(impl->gldrawable));
+
+  if (impl->share_list != NULL)
+    g_object_unref (G_OBJECT (impl->share_list));
+
+  g_object_unref (G_OBJECT (impl->glconfig));
+
+  G_OBJECT_CLASS (gdk_gl_context_impl_shm_parent_class)->finalize (object);
+}
+
+static void
+gdk_gl_context_impl_shm_class_init (GdkGLContextImplShmClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  GDK_GL_NOTE_FUNC_PRIVATE ();
+
+  klass->parent_class.copy_gl_context_impl = _gdk_x11_gl_context_impl_shm_copy;
+  klass->parent_class.get_gl_drawable = _gdk_x11_gl_context_impl_shm_get_gl_drawable;
+  klass->parent_class.get_gl_config   = _gdk_x11_gl_context_impl_shm_get_gl_config;
+  klass->parent_class.get_share_list  = _gdk_x11_gl_context_impl_shm_get_share_list;
+  klass->parent_class.is_direct       = _gdk_x11_gl_context_impl_shm_is_direct;
+  klass->parent_class.get_render_type = _gdk_x11_gl_context_impl_shm_get_render_type;
+  klass->parent_class.make_current    = _gdk_x11_gl_context_impl_shm_make_current;
+  klass->parent_class.make_uncurrent  = NULL;
+  klass->parent_class.make_current_unchecked = _gdk_x11_gl_context_impl_shm_make_current_unchecked;
+
+  object_class->finalize = gdk_gl_context_impl_shm_finalize;
+}
+
+/*< private >*/
+GdkGLProc
+_gdk_x11_gl_shm_get_proc_address (const char *proc_name)
+{
+  return (GdkGLProc) OSMesaGetProcAddress (proc_name);
+}
+
+/*< private >*/
+GdkGLContext *
+_gdk_x11_gl_context_shm_get_current (void)
+{
+  GdkGLContext *current;
+  OSMesaContext osmesa_context;
+
+  osmesa_context = OSMesaGetCurrentContext ();
+  if (osmesa_context == NULL)
+    return NULL;
+
+  current = g_private_get (&current_private);
+  if (current != NULL &&
+      GDK_GL_CONTEXT_IMPL_SHM (current->impl)->osmesa_context == osmesa_context)
+    return current;
+
+  return NULL;
+}
+
+/*< private >*/
+void
+_gdk_x11_gl_shm_release_current (void)
+{
+  if (OSMesaGetCurrentContext () == NULL)
+    return;
+
+  OSMesaMakeCurrent (NULL, NULL, GL_UNSIGNED_BYTE, 0, 0);
+  g_private_set (&current_private, NULL);
+}
+
+#else /* !HAVE_GDK_GL_SHM_PRESENT */
+
+/*< private >*/
+GdkGLWindow *
+_gdk_x11_gl_window_shm_new (GdkGLConfig *glconfig,
+                            GdkWindow   *window)
+{
+  GDK_GL_NOTE (MISC,
+    g_message (" -- Built without shared memory presentation support"));
+
+  return NULL;
+}
+
+/*< private >*/
+GdkGLProc
+_gdk_x11_gl_shm_get_proc_address (const char *proc_name)
+{
+  return NULL;
+}
+
+/*< private >*/
+GdkGLContext *
+_gdk_x11_gl_context_shm_get_current (void)
+{
+  return NULL;
+}
+
+/*< private >*/
+void
+_gdk_x11_gl_shm_release_current (void)
+{
+}
+
+#endif /* HAVE_GDK_GL_SHM_PRESENT */
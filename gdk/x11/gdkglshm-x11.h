@@ -0,0 +1,41 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+#ifndef __GDK_GL_SHM_X11_H__
+#define __GDK_GL_SHM_X11_H__
+
+#include <gdk/gdkx.h>
+
+#include <gdk/gdkglconfig.h>
+#include <gdk/gdkglcontext.h>
+#include <gdk/gdkglwindow.h>
+
+G_BEGIN_DECLS
+
+GdkGLWindow  *_gdk_x11_gl_window_shm_new          (GdkGLConfig *glconfig,
+                                                   GdkWindow   *window);
+
+GdkGLProc     _gdk_x11_gl_shm_get_proc_address    (const char  *proc_name);
+
+GdkGLContext *_gdk_x11_gl_context_shm_get_current (void);
+
+void          _gdk_x11_gl_shm_release_current     (void);
+
+G_END_DECLS
+
+#endif /* __GDK_GL_SHM_X11_H__ */
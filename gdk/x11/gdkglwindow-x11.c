@@ -30,6 +30,37 @@
 
 #include <gdk/gdkglquery.h>
 
+#ifndef GLX_BACK_BUFFER_AGE_EXT
+#define GLX_BACK_BUFFER_AGE_EXT 0x20F4
+#endif
+
+#ifndef GLX_BufferSwapComplete
+#define GLX_BufferSwapComplete 1
+#endif
+
+#ifndef GLX_BUFFER_SWAP_COMPLETE_INTEL_MASK
+#define GLX_BUFFER_SWAP_COMPLETE_INTEL_MASK 0x04000000
+#endif
+
+/* GL_ARB_sync */
+#define _GL_SYNC_GPU_COMMANDS_COMPLETE  0x9117
+#define _GL_SYNC_FLUSH_COMMANDS_BIT     0x00000001
+#define _GL_ALREADY_SIGNALED            0x911A
+#define _GL_TIMEOUT_EXPIRED             0x911B
+#define _GL_CONDITION_SATISFIED         0x911C
+#define _GL_WAIT_FAILED                 0x911D
+
+/* Upper bound for a blocking wait on a frame fence, in nanoseconds. */
+#define FENCE_WAIT_TIMEOUT              G_GUINT64_CONSTANT (1000000000)
+
+typedef gpointer (APIENTRY *FenceSyncProc)      (GLenum, GLbitfield);
+typedef GLenum   (APIENTRY *ClientWaitSyncProc) (gpointer, GLbitfield, guint64);
+typedef void     (APIENTRY *DeleteSyncProc)     (gpointer);
+
+typedef Bool (APIENTRY *GetSyncValuesOMLProc)   (Display *, GLXDrawable, gint64 *, gint64 *, gint64 *);
+typedef void (APIENTRY *SelectEventProc)        (Display *, GLXDrawable, unsigned long);
+typedef void (APIENTRY *GetSelectedEventProc)   (Display *, GLXDrawable, unsigned long *);
+
 static GdkGLContext *_gdk_x11_gl_window_impl_create_gl_context  (GdkGLWindow  *glwindow,
                                                                  GdkGLContext *share_list,
                                                                  gboolean      direct,
@@ -40,6 +71,21 @@ static void         _gdk_x11_gl_window_impl_wait_gl             (GdkGLWindow  *g
 static void         _gdk_x11_gl_window_impl_wait_gdk            (GdkGLWindow  *glwindow);
 static GdkGLConfig *_gdk_x11_gl_window_impl_get_gl_config       (GdkGLWindow  *glwindow);
 static Window       _gdk_x11_gl_window_impl_get_glxwindow       (GdkGLWindow  *glwindow);
+static void         _gdk_x11_gl_window_impl_swap_buffers_with_damage (GdkGLWindow        *glwindow,
+                                                                      const GdkRectangle *rects,
+                                                                      gint                n_rects);
+static gint         _gdk_x11_gl_window_impl_get_buffer_age      (GdkGLWindow  *glwindow);
+static gboolean     _gdk_x11_gl_window_impl_get_sync_values     (GdkGLWindow  *glwindow,
+                                                                 gint64       *ust,
+                                                                 gint64       *msc,
+                                                                 gint64       *sbc);
+static GdkFilterReturn gdk_x11_gl_window_impl_event_filter      (GdkXEvent    *xevent,
+                                                                 GdkEvent     *event,
+                                                                 gpointer      data);
+static void         gdk_x11_gl_window_impl_begin_present         (GdkGLWindow  *glwindow);
+static void         gdk_x11_gl_window_impl_end_present           (GdkGLWindow  *glwindow);
+static void         gdk_x11_gl_window_impl_drop_fences           (GdkGLWindowImplX11 *x11_impl);
+static void         gdk_x11_gl_window_impl_select_swap_events    (GdkGLWindow  *glwindow);
 
 G_DEFINE_TYPE (GdkGLWindowImplX11,
                gdk_gl_window_impl_x11,
@@ -52,7 +98,30 @@ gdk_gl_window_impl_x11_init (GdkGLWindowImplX11 *self)
 
   self->glxwindow = None;
   self->glconfig = NULL;
+  self->copy_sub_buffer = NULL;
+  self->query_drawable = NULL;
+  self->preserved_width = 0;
+  self->preserved_height = 0;
+  self->swap_interval_ext = NULL;
+  self->swap_interval_mesa = NULL;
+  self->swap_interval_sgi = NULL;
+  self->fence_sync = NULL;
+  self->client_wait_sync = NULL;
+  self->delete_sync = NULL;
+  self->fence_head = 0;
+  self->n_fences = 0;
+  self->fence_context = NULL;
+  self->get_sync_values = NULL;
+  self->select_event = NULL;
+  self->get_selected_event = NULL;
+  self->glx_event_base = 0;
+  self->last_sbc = 0;
   self->is_destroyed = 0;
+  self->extensions_probed = 0;
+  self->has_buffer_age = 0;
+  self->back_buffer_preserved = 0;
+  self->sync_probed = 0;
+  self->swap_events_selected = 0;
 }
 
 static void
@@ -69,6 +138,8 @@ _gdk_x11_gl_window_impl_destroy (GdkGLWindow *glwindow)
 
   xdisplay = GDK_GL_CONFIG_XDISPLAY (x11_impl->glconfig);
 
+  gdk_x11_gl_window_impl_drop_fences (x11_impl);
+
   if (x11_impl->glxwindow == glXGetCurrentDrawable ())
     {
       glXWaitGL ();
@@ -77,6 +148,15 @@ _gdk_x11_gl_window_impl_destroy (GdkGLWindow *glwindow)
       glXMakeCurrent (xdisplay, None, NULL);
     }
 
+  if (x11_impl->swap_events_selected)
+    {
+      if (glwindow->window != NULL)
+        gdk_window_remove_filter (glwindow->window,
+                                  gdk_x11_gl_window_impl_event_filter,
+                                  glwindow);
+      x11_impl->swap_events_selected = FALSE;
+    }
+
   if (gdk_x11_gl_query_glx_extension (x11_impl->glconfig, "GLX_MESA_release_buffers"))
     {
       /* Release buffers if GLX_MESA_release_buffers is supported. */
@@ -124,6 +204,9 @@ gdk_gl_window_impl_x11_class_init (GdkGLWindowImplX11Class *klass)
   klass->parent_class.wait_gdk               = _gdk_x11_gl_window_impl_wait_gdk;
   klass->parent_class.get_gl_config          = _gdk_x11_gl_window_impl_get_gl_config;
   klass->parent_class.destroy_gl_window_impl = _gdk_x11_gl_window_impl_destroy;
+  klass->parent_class.swap_buffers_with_damage = _gdk_x11_gl_window_impl_swap_buffers_with_damage;
+  klass->parent_class.get_buffer_age         = _gdk_x11_gl_window_impl_get_buffer_age;
+  klass->parent_class.get_sync_values        = _gdk_x11_gl_window_impl_get_sync_values;
 
   object_class->finalize = gdk_gl_window_impl_x11_finalize;
 }
@@ -173,6 +256,9 @@ _gdk_x11_gl_window_impl_new (GdkGLWindow *glwindow,
   g_object_add_weak_pointer (G_OBJECT (glwindow->window),
                              (gpointer *) &(glwindow->window));
 
+  /* Done here, so that swaps from other threads need not touch GDK. */
+  gdk_x11_gl_window_impl_select_swap_events (glwindow);
+
   return glwindow;
 }
 
@@ -224,9 +310,520 @@ _gdk_x11_gl_window_impl_swap_buffers (GdkGLWindow *glwindow)
   if (glxwindow == None)
     return;
 
+  gdk_x11_gl_window_impl_begin_present (glwindow);
+
   GDK_GL_NOTE_FUNC_IMPL ("glXSwapBuffers");
 
   glXSwapBuffers (xdisplay, glxwindow);
+
+  GDK_GL_WINDOW_IMPL_X11 (glwindow->impl)->back_buffer_preserved = FALSE;
+
+  gdk_x11_gl_window_impl_end_present (glwindow);
+}
+
+static void
+gdk_x11_gl_window_impl_probe_extensions (GdkGLWindowImplX11 *x11_impl)
+{
+  if (x11_impl->extensions_probed)
+    return;
+
+  if (gdk_x11_gl_query_glx_extension (x11_impl->glconfig, "GLX_MESA_copy_sub_buffer"))
+    x11_impl->copy_sub_buffer = gdk_gl_get_proc_address ("glXCopySubBufferMESA");
+
+  if (gdk_x11_gl_query_glx_extension (x11_impl->glconfig, "GLX_EXT_buffer_age"))
+    {
+      x11_impl->query_drawable = gdk_gl_get_proc_address ("glXQueryDrawable");
+      x11_impl->has_buffer_age = (x11_impl->query_drawable != NULL);
+    }
+
+  if (gdk_x11_gl_query_glx_extension (x11_impl->glconfig, "GLX_EXT_swap_control"))
+    x11_impl->swap_interval_ext = gdk_gl_get_proc_address ("glXSwapIntervalEXT");
+  if (gdk_x11_gl_query_glx_extension (x11_impl->glconfig, "GLX_MESA_swap_control"))
+    x11_impl->swap_interval_mesa = gdk_gl_get_proc_address ("glXSwapIntervalMESA");
+  if (gdk_x11_gl_query_glx_extension (x11_impl->glconfig, "GLX_SGI_swap_control"))
+    x11_impl->swap_interval_sgi = gdk_gl_get_proc_address ("glXSwapIntervalSGI");
+
+  if (gdk_x11_gl_query_glx_extension (x11_impl->glconfig, "GLX_OML_sync_control"))
+    x11_impl->get_sync_values = gdk_gl_get_proc_address ("glXGetSyncValuesOML");
+
+  if (gdk_x11_gl_query_glx_extension (x11_impl->glconfig, "GLX_INTEL_swap_event"))
+    {
+      x11_impl->select_event = gdk_gl_get_proc_address ("glXSelectEvent");
+      x11_impl->get_selected_event = gdk_gl_get_proc_address ("glXGetSelectedEvent");
+    }
+
+  GDK_GL_NOTE (MISC,
+    g_message (" -- Window: copy_sub_buffer = %s, buffer_age = %s",
+               x11_impl->copy_sub_buffer != NULL ? "yes" : "no",
+               x11_impl->has_buffer_age ? "yes" : "no"));
+
+  GDK_GL_NOTE (MISC,
+    g_message (" -- Window: sync_values = %s, swap_event = %s",
+               x11_impl->get_sync_values != NULL ? "yes" : "no",
+               x11_impl->select_event != NULL ? "yes" : "no"));
+
+  x11_impl->extensions_probed = TRUE;
+}
+
+/*
+ * Present pacing.
+ */
+
+static void
+gdk_x11_gl_window_impl_apply_swap_interval (GdkGLWindow *glwindow)
+{
+  GdkGLWindowImpl *impl = glwindow->impl;
+  GdkGLWindowImplX11 *x11_impl = GDK_GL_WINDOW_IMPL_X11 (impl);
+  Display *xdisplay;
+  int interval;
+
+  impl->present_mode_changed = FALSE;
+
+  gdk_x11_gl_window_impl_probe_extensions (x11_impl);
+
+  xdisplay = GDK_GL_CONFIG_XDISPLAY (x11_impl->glconfig);
+  interval = (impl->present_mode == GDK_GL_PRESENT_MAILBOX) ? 0 : 1;
+
+  if (x11_impl->swap_interval_ext != NULL)
+    {
+      GDK_GL_NOTE_FUNC_IMPL ("glXSwapIntervalEXT");
+      ((void (APIENTRY *)(Display *, GLXDrawable, int))
+        x11_impl->swap_interval_ext) (xdisplay, x11_impl->glxwindow, interval);
+    }
+  else if (x11_impl->swap_interval_mesa != NULL)
+    {
+      GDK_GL_NOTE_FUNC_IMPL ("glXSwapIntervalMESA");
+      ((int (APIENTRY *)(unsigned int)) x11_impl->swap_interval_mesa) (interval);
+    }
+  else if (x11_impl->swap_interval_sgi != NULL && interval > 0)
+    {
+      /* GLX_SGI_swap_control cannot turn synchronization off. */
+      GDK_GL_NOTE_FUNC_IMPL ("glXSwapIntervalSGI");
+      ((int (APIENTRY *)(int)) x11_impl->swap_interval_sgi) (interval);
+    }
+  else
+    {
+      GDK_GL_NOTE (MISC, g_message (" -- Window: cannot set swap interval %d",
+                                    interval));
+    }
+}
+
+static void
+gdk_x11_gl_window_impl_probe_sync (GdkGLWindowImplX11 *x11_impl)
+{
+  if (x11_impl->sync_probed)
+    return;
+
+  /* Needs a current context. */
+  if (gdk_gl_query_gl_extension ("GL_ARB_sync"))
+    {
+      x11_impl->fence_sync = gdk_gl_get_proc_address ("glFenceSync");
+      x11_impl->client_wait_sync = gdk_gl_get_proc_address ("glClientWaitSync");
+      x11_impl->delete_sync = gdk_gl_get_proc_address ("glDeleteSync");
+
+      if (x11_impl->fence_sync == NULL ||
+          x11_impl->client_wait_sync == NULL ||
+          x11_impl->delete_sync == NULL)
+        {
+          x11_impl->fence_sync = NULL;
+          x11_impl->client_wait_sync = NULL;
+          x11_impl->delete_sync = NULL;
+        }
+    }
+
+  x11_impl->sync_probed = TRUE;
+}
+
+/*
+ * Retire the oldest frame fence if it has signaled, or wait for it to
+ * signal if @wait is TRUE. Returns TRUE if a fence was retired; a fence
+ * still pending after the wait is kept.
+ *
+ * Fences are polled from later swaps, so the latency reported here runs
+ * until the poll, not until the fence signaled: an upper bound, in steps
+ * of the swap interval.
+ */
+static gboolean
+gdk_x11_gl_window_impl_retire_fence (GdkGLWindow *glwindow,
+                                     gboolean     wait)
+{
+  GdkGLWindowImpl *impl = glwindow->impl;
+  GdkGLWindowImplX11 *x11_impl = GDK_GL_WINDOW_IMPL_X11 (impl);
+  gpointer sync;
+  GLenum status;
+  gint64 latency;
+
+  if (x11_impl->n_fences == 0)
+    return FALSE;
+
+  sync = x11_impl->fences[x11_impl->fence_head];
+
+  status = ((ClientWaitSyncProc) x11_impl->client_wait_sync) (sync,
+                                                              _GL_SYNC_FLUSH_COMMANDS_BIT,
+                                                              wait ? FENCE_WAIT_TIMEOUT : 0);
+  if (status == _GL_TIMEOUT_EXPIRED)
+    {
+      if (wait)
+        g_warning ("frame fence has not signaled after %" G_GUINT64_FORMAT " ms",
+                   FENCE_WAIT_TIMEOUT / 1000000);
+      return FALSE;
+    }
+
+  latency = g_get_monotonic_time () - x11_impl->fence_times[x11_impl->fence_head];
+
+  ((DeleteSyncProc) x11_impl->delete_sync) (sync);
+
+  x11_impl->fences[x11_impl->fence_head] = NULL;
+  x11_impl->fence_head = (x11_impl->fence_head + 1) % GDK_GL_WINDOW_IMPL_X11_MAX_FENCES;
+  x11_impl->n_fences--;
+
+  /* A failed wait retires the fence, but says nothing about the frame. */
+  if (status == _GL_ALREADY_SIGNALED || status == _GL_CONDITION_SATISFIED)
+    _gdk_gl_window_frame_completed (glwindow, latency);
+
+  return TRUE;
+}
+
+/*
+ * Forget all frame fences. They can only be deleted with a context of
+ * the share group that created them current; otherwise they are leaked
+ * on purpose, and go away with that context.
+ */
+static void
+gdk_x11_gl_window_impl_drop_fences (GdkGLWindowImplX11 *x11_impl)
+{
+  gboolean can_delete;
+
+  can_delete = (x11_impl->fence_context != NULL &&
+                x11_impl->fence_context == glXGetCurrentContext ());
+
+  while (x11_impl->n_fences > 0)
+    {
+      if (can_delete)
+        ((DeleteSyncProc) x11_impl->delete_sync) (x11_impl->fences[x11_impl->fence_head]);
+
+      x11_impl->fences[x11_impl->fence_head] = NULL;
+      x11_impl->fence_head = (x11_impl->fence_head + 1) % GDK_GL_WINDOW_IMPL_X11_MAX_FENCES;
+      x11_impl->n_fences--;
+    }
+
+  x11_impl->fence_context = NULL;
+}
+
+/*
+ * Presentation feedback.
+ */
+
+static GdkFilterReturn
+gdk_x11_gl_window_impl_event_filter (GdkXEvent *xevent,
+                                     GdkEvent  *event,
+                                     gpointer   data)
+{
+  GdkGLWindow *glwindow = GDK_GL_WINDOW (data);
+  GdkGLWindowImplX11 *x11_impl = GDK_GL_WINDOW_IMPL_X11 (glwindow->impl);
+  XEvent *xev = (XEvent *) xevent;
+  GLXBufferSwapComplete *swap_event;
+
+  if (xev->type != x11_impl->glx_event_base + GLX_BufferSwapComplete)
+    return GDK_FILTER_CONTINUE;
+
+  swap_event = (GLXBufferSwapComplete *) xev;
+  if (swap_event->drawable != x11_impl->glxwindow)
+    return GDK_FILTER_CONTINUE;
+
+  x11_impl->last_sbc = swap_event->sbc;
+
+  _gdk_gl_window_frame_presented (glwindow,
+                                  swap_event->ust,
+                                  swap_event->msc,
+                                  swap_event->sbc);
+
+  return GDK_FILTER_REMOVE;
+}
+
+static void
+gdk_x11_gl_window_impl_select_swap_events (GdkGLWindow *glwindow)
+{
+  GdkGLWindowImplX11 *x11_impl = GDK_GL_WINDOW_IMPL_X11 (glwindow->impl);
+  Display *xdisplay;
+  unsigned long mask = 0;
+  int error_base;
+
+  gdk_x11_gl_window_impl_probe_extensions (x11_impl);
+
+  if (x11_impl->select_event == NULL || glwindow->window == NULL)
+    return;
+
+  xdisplay = GDK_GL_CONFIG_XDISPLAY (x11_impl->glconfig);
+
+  if (!glXQueryExtension (xdisplay, &error_base, &x11_impl->glx_event_base))
+    return;
+
+  if (x11_impl->get_selected_event != NULL)
+    ((GetSelectedEventProc) x11_impl->get_selected_event) (xdisplay,
+                                                           x11_impl->glxwindow,
+                                                           &mask);
+
+  GDK_GL_NOTE_FUNC_IMPL ("glXSelectEvent");
+  ((SelectEventProc) x11_impl->select_event) (xdisplay,
+                                              x11_impl->glxwindow,
+                                              mask | GLX_BUFFER_SWAP_COMPLETE_INTEL_MASK);
+
+  gdk_window_add_filter (glwindow->window,
+                         gdk_x11_gl_window_impl_event_filter,
+                         glwindow);
+
+  x11_impl->swap_events_selected = TRUE;
+}
+
+/*
+ * Without swap events, report the most recently completed swap by
+ * polling the sync values. This costs a server round trip, so it is
+ * only done while somebody is listening.
+ */
+static void
+gdk_x11_gl_window_impl_poll_presented (GdkGLWindow *glwindow)
+{
+  GdkGLWindowImplX11 *x11_impl = GDK_GL_WINDOW_IMPL_X11 (glwindow->impl);
+  gint64 ust, msc, sbc;
+
+  if (x11_impl->swap_events_selected || x11_impl->get_sync_values == NULL)
+    return;
+
+  if (!_gdk_gl_window_has_frame_presented_handler (glwindow))
+    return;
+
+  if (!_gdk_x11_gl_window_impl_get_sync_values (glwindow, &ust, &msc, &sbc))
+    return;
+
+  if (sbc <= x11_impl->last_sbc)
+    return;
+
+  x11_impl->last_sbc = sbc;
+
+  _gdk_gl_window_frame_presented (glwindow, ust, msc, sbc);
+}
+
+static gboolean
+_gdk_x11_gl_window_impl_get_sync_values (GdkGLWindow *glwindow,
+                                         gint64      *ust,
+                                         gint64      *msc,
+                                         gint64      *sbc)
+{
+  GdkGLWindowImplX11 *x11_impl;
+  gint64 ust_val, msc_val, sbc_val;
+
+  g_return_val_if_fail (GDK_IS_X11_GL_WINDOW (glwindow), FALSE);
+
+  x11_impl = GDK_GL_WINDOW_IMPL_X11 (glwindow->impl);
+
+  if (x11_impl->glxwindow == None)
+    return FALSE;
+
+  gdk_x11_gl_window_impl_probe_extensions (x11_impl);
+
+  if (x11_impl->get_sync_values == NULL)
+    return FALSE;
+
+  GDK_GL_NOTE_FUNC_IMPL ("glXGetSyncValuesOML");
+
+  if (!((GetSyncValuesOMLProc) x11_impl->get_sync_values) (GDK_GL_CONFIG_XDISPLAY (x11_impl->glconfig),
+                                                           x11_impl->glxwindow,
+                                                           &ust_val, &msc_val, &sbc_val))
+    return FALSE;
+
+  if (ust != NULL)
+    *ust = ust_val;
+  if (msc != NULL)
+    *msc = msc_val;
+  if (sbc != NULL)
+    *sbc = sbc_val;
+
+  return TRUE;
+}
+
+static void
+gdk_x11_gl_window_impl_begin_present (GdkGLWindow *glwindow)
+{
+  if (glwindow->impl->present_mode_changed)
+    gdk_x11_gl_window_impl_apply_swap_interval (glwindow);
+}
+
+static void
+gdk_x11_gl_window_impl_end_present (GdkGLWindow *glwindow)
+{
+  GdkGLWindowImpl *impl = glwindow->impl;
+  GdkGLWindowImplX11 *x11_impl = GDK_GL_WINDOW_IMPL_X11 (impl);
+  gboolean bounded = (impl->present_mode == GDK_GL_PRESENT_BOUNDED);
+  guint max_fences;
+  guint tail;
+  gint64 start;
+
+  gdk_x11_gl_window_impl_poll_presented (glwindow);
+
+  if (!bounded && impl->present_func == NULL)
+    {
+      /* Nothing to pace or report; flush out fences of an earlier mode. */
+      while (gdk_x11_gl_window_impl_retire_fence (glwindow, FALSE))
+        ;
+      return;
+    }
+
+  gdk_x11_gl_window_impl_probe_sync (x11_impl);
+
+  if (x11_impl->fence_sync == NULL)
+    {
+      /* Without fences a single frame in flight is all we can bound.
+         This runs right after the swap, so the time glFinish () blocks
+         stands in for the latency of the frame. */
+      if (bounded && impl->max_frames_in_flight <= 1)
+        {
+          start = g_get_monotonic_time ();
+          glFinish ();
+
+          _gdk_gl_window_frame_completed (glwindow,
+                                          g_get_monotonic_time () - start);
+        }
+      return;
+    }
+
+  /* Fences of another context cannot be waited on with this one. */
+  if (x11_impl->n_fences > 0 && x11_impl->fence_context != glXGetCurrentContext ())
+    gdk_x11_gl_window_impl_drop_fences (x11_impl);
+
+  /* Make room in the ring. */
+  if (x11_impl->n_fences == GDK_GL_WINDOW_IMPL_X11_MAX_FENCES)
+    gdk_x11_gl_window_impl_retire_fence (glwindow, TRUE);
+
+  /* This frame goes untracked if the oldest one is still pending. */
+  if (x11_impl->n_fences < GDK_GL_WINDOW_IMPL_X11_MAX_FENCES)
+    {
+      tail = (x11_impl->fence_head + x11_impl->n_fences) % GDK_GL_WINDOW_IMPL_X11_MAX_FENCES;
+      x11_impl->fences[tail] = ((FenceSyncProc) x11_impl->fence_sync) (_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      x11_impl->fence_times[tail] = g_get_monotonic_time ();
+      if (x11_impl->fences[tail] != NULL)
+        {
+          x11_impl->fence_context = glXGetCurrentContext ();
+          x11_impl->n_fences++;
+        }
+    }
+
+  /* Report frames that have completed meanwhile. */
+  while (gdk_x11_gl_window_impl_retire_fence (glwindow, FALSE))
+    ;
+
+  if (!bounded)
+    return;
+
+  max_fences = CLAMP (impl->max_frames_in_flight, 1, GDK_GL_WINDOW_IMPL_X11_MAX_FENCES);
+
+  while (x11_impl->n_fences > max_fences &&
+         gdk_x11_gl_window_impl_retire_fence (glwindow, TRUE))
+    ;
+}
+
+static void
+_gdk_x11_gl_window_impl_swap_buffers_with_damage (GdkGLWindow        *glwindow,
+                                                  const GdkRectangle *rects,
+                                                  gint                n_rects)
+{
+  GdkGLWindowImplX11 *x11_impl;
+  Display *xdisplay;
+  gint width, height;
+  gint i;
+
+  g_return_if_fail (GDK_IS_X11_GL_WINDOW (glwindow));
+
+  x11_impl = GDK_GL_WINDOW_IMPL_X11 (glwindow->impl);
+
+  if (x11_impl->glxwindow == None || glwindow->window == NULL)
+    return;
+
+  gdk_x11_gl_window_impl_probe_extensions (x11_impl);
+
+  /*
+   * There is no swap-with-damage in GLX, so the damage can only be
+   * honoured by copying the rectangles from the back to the front
+   * buffer. This leaves the back buffer untouched, so the next frame
+   * only has to repaint what changes again.
+   */
+
+  if (x11_impl->copy_sub_buffer == NULL)
+    {
+      _gdk_x11_gl_window_impl_swap_buffers (glwindow);
+      return;
+    }
+
+  xdisplay = GDK_GL_CONFIG_XDISPLAY (x11_impl->glconfig);
+  width = gdk_window_get_width (glwindow->window);
+  height = gdk_window_get_height (glwindow->window);
+
+  gdk_x11_gl_window_impl_begin_present (glwindow);
+
+  GDK_GL_NOTE_FUNC_IMPL ("glXCopySubBufferMESA");
+
+  for (i = 0; i < n_rects; i++)
+    {
+      gint x0 = CLAMP (rects[i].x, 0, width);
+      gint y0 = CLAMP (rects[i].y, 0, height);
+      gint x1 = CLAMP (rects[i].x + rects[i].width, 0, width);
+      gint y1 = CLAMP (rects[i].y + rects[i].height, 0, height);
+
+      if (x1 <= x0 || y1 <= y0)
+        continue;
+
+      /* GL window coordinates have their origin at the lower-left. */
+      ((void (APIENTRY *)(Display *, GLXDrawable, int, int, int, int))
+        x11_impl->copy_sub_buffer) (xdisplay, x11_impl->glxwindow,
+                                    x0, height - y1, x1 - x0, y1 - y0);
+    }
+
+  x11_impl->back_buffer_preserved = TRUE;
+  x11_impl->preserved_width = width;
+  x11_impl->preserved_height = height;
+
+  gdk_x11_gl_window_impl_end_present (glwindow);
+}
+
+static gint
+_gdk_x11_gl_window_impl_get_buffer_age (GdkGLWindow *glwindow)
+{
+  GdkGLWindowImplX11 *x11_impl;
+  unsigned int age = 0;
+
+  g_return_val_if_fail (GDK_IS_X11_GL_WINDOW (glwindow), 0);
+
+  x11_impl = GDK_GL_WINDOW_IMPL_X11 (glwindow->impl);
+
+  if (x11_impl->glxwindow == None || glwindow->window == NULL)
+    return 0;
+
+  /* The back buffer was left intact by a partial present, unless the
+     window has been resized since. */
+  if (x11_impl->back_buffer_preserved)
+    {
+      if (x11_impl->preserved_width == gdk_window_get_width (glwindow->window) &&
+          x11_impl->preserved_height == gdk_window_get_height (glwindow->window))
+        return 1;
+
+      x11_impl->back_buffer_preserved = FALSE;
+      return 0;
+    }
+
+  gdk_x11_gl_window_impl_probe_extensions (x11_impl);
+
+  if (!x11_impl->has_buffer_age)
+    return 0;
+
+  GDK_GL_NOTE_FUNC_IMPL ("glXQueryDrawable");
+
+  ((void (APIENTRY *)(Display *, GLXDrawable, int, unsigned int *))
+    x11_impl->query_drawable) (GDK_GL_CONFIG_XDISPLAY (x11_impl->glconfig),
+                               x11_impl->glxwindow,
+                               GLX_BACK_BUFFER_AGE_EXT,
+                               &age);
+
+  return (gint) age;
 }
 
 static void
@@ -36,6 +36,8 @@ typedef struct _GdkGLWindowImplX11Class GdkGLWindowImplX11Class;
 #define GDK_IS_GL_WINDOW_IMPL_X11_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE ((klass), GDK_TYPE_GL_WINDOW_IMPL_X11))
 #define GDK_GL_WINDOW_IMPL_X11_GET_CLASS(obj)    (G_TYPE_INSTANCE_GET_CLASS ((obj), GDK_TYPE_GL_WINDOW_IMPL_X11, GdkGLWindowImplX11Class))
 
+#define GDK_GL_WINDOW_IMPL_X11_MAX_FENCES 8
+
 struct _GdkGLWindowImplX11
 {
   GdkGLWindowImpl parent_instance;
@@ -45,7 +47,42 @@ struct _GdkGLWindowImplX11
 
   GdkGLConfig *glconfig;
 
+  /* Partial present support, probed on first use. */
+  GdkGLProc copy_sub_buffer;    /* glXCopySubBufferMESA */
+  GdkGLProc query_drawable;     /* glXQueryDrawable */
+
+  /* Size of the back buffer when it was last kept intact. */
+  gint preserved_width;
+  gint preserved_height;
+
+  /* Swap interval control, probed on first use. */
+  GdkGLProc swap_interval_ext;  /* glXSwapIntervalEXT */
+  GdkGLProc swap_interval_mesa; /* glXSwapIntervalMESA */
+  GdkGLProc swap_interval_sgi;  /* glXSwapIntervalSGI */
+
+  /* GL_ARB_sync fences of the frames in flight, oldest first. */
+  GdkGLProc fence_sync;
+  GdkGLProc client_wait_sync;
+  GdkGLProc delete_sync;
+  gpointer  fences[GDK_GL_WINDOW_IMPL_X11_MAX_FENCES];
+  gint64    fence_times[GDK_GL_WINDOW_IMPL_X11_MAX_FENCES];
+  guint     fence_head;
+  guint     n_fences;
+  GLXContext fence_context;     /* current when the fences were made */
+
+  /* Presentation feedback. */
+  GdkGLProc get_sync_values;    /* glXGetSyncValuesOML */
+  GdkGLProc select_event;       /* glXSelectEvent */
+  GdkGLProc get_selected_event; /* glXGetSelectedEvent */
+  int       glx_event_base;
+  gint64    last_sbc;
+
   guint is_destroyed : 1;
+  guint extensions_probed : 1;
+  guint has_buffer_age : 1;
+  guint back_buffer_preserved : 1;
+  guint sync_probed : 1;
+  guint swap_events_selected : 1;
 };
 
 struct _GdkGLWindowImplX11Class
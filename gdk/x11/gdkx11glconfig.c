@@ -196,6 +196,86 @@ gdk_x11_gl_config_new_from_visualid_for_screen (GdkScreen *screen,
   return glconfig;
 }
 
+/**
+ * gdk_x11_gl_config_list_for_screen:
+ * @screen: target screen.
+ *
+ * Lists the OpenGL-capable visuals of @screen, in the order the server
+ * reports them. Xlib lists the visuals from the data it got when the
+ * display was opened, and glXGetConfig() answers from the visual configs
+ * GLX fetches once per display, so this does not cost a server round
+ * trip per visual.
+ *
+ * Return value: (element-type GdkGLConfig) (transfer full): a list of new
+ *               #GdkGLConfig. Free it with g_list_free_full() and
+ *               g_object_unref().
+ **/
+GList *
+gdk_x11_gl_config_list_for_screen (GdkScreen *screen)
+{
+  Display *xdisplay;
+  XVisualInfo xvinfo_template;
+  XVisualInfo *xvinfo_list;
+  XVisualInfo *xvinfo;
+  GdkGLConfig *glconfig;
+  GList *list = NULL;
+  int nitems_return;
+  int nitems;
+  int value;
+  int i;
+
+  GDK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (GDK_IS_X11_SCREEN (screen), NULL);
+
+  xdisplay = GDK_SCREEN_XDISPLAY (screen);
+
+  xvinfo_template.screen = GDK_SCREEN_XNUMBER (screen);
+
+  xvinfo_list = XGetVisualInfo (xdisplay,
+                                VisualScreenMask,
+                                &xvinfo_template,
+                                &nitems_return);
+  if (xvinfo_list == NULL)
+    return NULL;
+
+  for (i = 0; i < nitems_return; i++)
+    {
+      if (glXGetConfig (xdisplay, &xvinfo_list[i], GLX_USE_GL, &value) != Success ||
+          !value)
+        continue;
+
+      /* Each GdkGLConfig frees its own XVisualInfo with XFree (), so
+         get one allocated by Xlib for this visual alone. */
+      xvinfo_template.visualid = xvinfo_list[i].visualid;
+      xvinfo = XGetVisualInfo (xdisplay,
+                               VisualIDMask | VisualScreenMask,
+                               &xvinfo_template,
+                               &nitems);
+      if (xvinfo == NULL)
+        continue;
+
+      glconfig = g_object_new (GDK_TYPE_X11_GL_CONFIG, NULL);
+
+      if (_gdk_x11_gl_config_impl_new_from_xvinfo_for_screen (glconfig,
+                                                              screen,
+                                                              xvinfo) == NULL)
+        {
+          XFree (xvinfo);
+          g_object_unref (glconfig);
+          continue;
+        }
+
+      list = g_list_prepend (list, glconfig);
+    }
+
+  XFree (xvinfo_list);
+
+  GDK_GL_NOTE (MISC, g_message (" -- %u OpenGL-capable visuals", g_list_length (list)));
+
+  return g_list_reverse (list);
+}
+
 /**
  * gdk_x11_gl_config_get_xdisplay:
  * @glconfig: a #GdkGLConfig.
@@ -59,6 +59,8 @@ GdkGLConfig *gdk_x11_gl_config_new_from_visualid            (VisualID   xvisuali
 GdkGLConfig *gdk_x11_gl_config_new_from_visualid_for_screen (GdkScreen *screen,
                                                              VisualID   xvisualid);
 
+GList       *gdk_x11_gl_config_list_for_screen  (GdkScreen *screen);
+
 Display     *gdk_x11_gl_config_get_xdisplay      (GdkGLConfig  *glconfig);
 int          gdk_x11_gl_config_get_screen_number (GdkGLConfig  *glconfig);
 XVisualInfo *gdk_x11_gl_config_get_xvinfo        (GdkGLConfig  *glconfig);
@@ -27,6 +27,7 @@
 #include "gtkglversion.h"
 #include "gtkglinit.h"
 #include "gtkglwidget.h"
+#include "gtkgldrawingarea.h"
 
 #undef __GTKGL_H_INSIDE__
 
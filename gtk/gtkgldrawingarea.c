@@ -0,0 +1,674 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include "gtkglprivate.h"
+#include "gtkglwidget.h"
+#include "gtkgldrawingarea.h"
+
+#include <GL/gl.h>
+
+struct _GtkGLDrawingAreaPrivate
+{
+  GdkGLConfig *glconfig;
+
+  /* Offscreen framebuffer the "render" signal draws into. */
+  GdkGLMultisample *framebuffer;
+  gint n_samples;
+
+  guint tick_id;
+
+  guint continuous : 1;
+  guint needs_render : 1;
+  guint framebuffer_stale : 1;
+  guint framebuffer_unsupported : 1;
+};
+
+enum {
+  PROP_0,
+  PROP_GL_CONFIG,
+  PROP_N_SAMPLES,
+  PROP_CONTINUOUS
+};
+
+enum {
+  RENDER,
+  RESIZE,
+  LAST_SIGNAL
+};
+
+static guint gl_drawing_area_signals[LAST_SIGNAL] = { 0 };
+
+G_DEFINE_TYPE (GtkGLDrawingArea,
+               gtk_gl_drawing_area,
+               GTK_TYPE_DRAWING_AREA)
+
+static void
+gtk_gl_drawing_area_init (GtkGLDrawingArea *self)
+{
+  GtkGLDrawingAreaPrivate *priv;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  priv = G_TYPE_INSTANCE_GET_PRIVATE (self,
+                                      GTK_TYPE_GL_DRAWING_AREA,
+                                      GtkGLDrawingAreaPrivate);
+  self->priv = priv;
+
+  priv->glconfig = NULL;
+  priv->framebuffer = NULL;
+  priv->n_samples = 0;
+  priv->tick_id = 0;
+  priv->continuous = FALSE;
+  priv->needs_render = TRUE;
+  priv->framebuffer_stale = FALSE;
+  priv->framebuffer_unsupported = FALSE;
+}
+
+/*
+ * Continuous rendering.
+ */
+
+/* Called once per frame clock cycle, so frames are paced by the
+   display instead of spinning the main loop. */
+static gboolean
+gtk_gl_drawing_area_tick (GtkWidget     *widget,
+                          GdkFrameClock *frame_clock,
+                          gpointer       data)
+{
+  gtk_gl_drawing_area_queue_render (GTK_GL_DRAWING_AREA (widget));
+
+  return TRUE;
+}
+
+static void
+gtk_gl_drawing_area_update_tick (GtkGLDrawingArea *area)
+{
+  GtkGLDrawingAreaPrivate *priv = area->priv;
+
+  if (priv->continuous && gtk_widget_get_mapped (GTK_WIDGET (area)))
+    {
+      if (priv->tick_id == 0)
+        priv->tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (area),
+                                                      gtk_gl_drawing_area_tick,
+                                                      NULL,
+                                                      NULL);
+    }
+  else if (priv->tick_id != 0)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (area), priv->tick_id);
+      priv->tick_id = 0;
+    }
+}
+
+/*
+ * Framebuffer management. All of these need the widget's context current.
+ */
+
+static void
+gtk_gl_drawing_area_ensure_framebuffer (GtkGLDrawingArea *area,
+                                        gint              width,
+                                        gint              height)
+{
+  GtkGLDrawingAreaPrivate *priv = area->priv;
+
+  if (priv->framebuffer_stale)
+    {
+      if (priv->framebuffer != NULL)
+        gdk_gl_multisample_free (priv->framebuffer);
+      priv->framebuffer = NULL;
+      priv->framebuffer_stale = FALSE;
+      priv->framebuffer_unsupported = FALSE;
+    }
+
+  if (priv->framebuffer != NULL || priv->framebuffer_unsupported)
+    return;
+
+  priv->framebuffer = gdk_gl_multisample_new (MAX (width, 1),
+                                              MAX (height, 1),
+                                              priv->n_samples,
+                                              TRUE);
+  if (priv->framebuffer == NULL)
+    {
+      GTK_GL_NOTE (MISC,
+        g_message (" - framebuffer objects not supported, rendering to the window"));
+      priv->framebuffer_unsupported = TRUE;
+    }
+
+  priv->needs_render = TRUE;
+}
+
+static void
+gtk_gl_drawing_area_gl_resize (GtkWidget *widget,
+                               gint       width,
+                               gint       height,
+                               gpointer   data)
+{
+  GtkGLDrawingArea *area = GTK_GL_DRAWING_AREA (widget);
+  GtkGLDrawingAreaPrivate *priv = area->priv;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  /* The context is current here. If the framebuffer cannot be sized,
+     even without multisampling, fall back to rendering to the window. */
+  if (priv->framebuffer != NULL && width > 0 && height > 0)
+    {
+      if (!gdk_gl_multisample_resize (priv->framebuffer, width, height))
+        {
+          GTK_GL_NOTE (MISC,
+            g_message (" - cannot resize the framebuffer, rendering to the window"));
+          gdk_gl_multisample_free (priv->framebuffer);
+          priv->framebuffer = NULL;
+          priv->framebuffer_unsupported = TRUE;
+        }
+    }
+
+  priv->needs_render = TRUE;
+
+  g_signal_emit (area, gl_drawing_area_signals[RESIZE], 0, width, height);
+}
+
+/* Connected before the handler of gtk_widget_set_gl_capability (), which
+   destroys the context the framebuffer lives in. */
+static void
+gtk_gl_drawing_area_gl_unrealize (GtkWidget *widget,
+                                  gpointer   data)
+{
+  GtkGLDrawingAreaPrivate *priv = GTK_GL_DRAWING_AREA (widget)->priv;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (priv->framebuffer != NULL && gtk_widget_begin_gl (widget))
+    {
+      gdk_gl_multisample_free (priv->framebuffer);
+      gtk_widget_end_gl (widget, FALSE);
+    }
+
+  priv->framebuffer = NULL;
+  priv->framebuffer_stale = FALSE;
+  priv->framebuffer_unsupported = FALSE;
+  priv->needs_render = TRUE;
+}
+
+/*
+ * GObject and GtkWidget methods.
+ */
+
+static void
+gtk_gl_drawing_area_constructed (GObject *object)
+{
+  GtkGLDrawingAreaPrivate *priv = GTK_GL_DRAWING_AREA (object)->priv;
+  GtkWidget *widget = GTK_WIDGET (object);
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (G_OBJECT_CLASS (gtk_gl_drawing_area_parent_class)->constructed != NULL)
+    G_OBJECT_CLASS (gtk_gl_drawing_area_parent_class)->constructed (object);
+
+  if (priv->glconfig == NULL)
+    priv->glconfig = gdk_gl_config_new_by_mode (GDK_GL_MODE_RGBA  |
+                                                GDK_GL_MODE_DEPTH |
+                                                GDK_GL_MODE_DOUBLE);
+
+  g_signal_connect (object, "unrealize",
+                    G_CALLBACK (gtk_gl_drawing_area_gl_unrealize),
+                    NULL);
+
+  if (priv->glconfig == NULL ||
+      !gtk_widget_set_gl_capability (widget,
+                                     priv->glconfig,
+                                     NULL,
+                                     TRUE,
+                                     GDK_GL_RGBA_TYPE))
+    {
+      g_warning ("cannot set OpenGL-capability to GtkGLDrawingArea\n");
+      return;
+    }
+
+  gtk_widget_set_gl_resize_func (widget, gtk_gl_drawing_area_gl_resize,
+                                 NULL, NULL);
+}
+
+static void
+gtk_gl_drawing_area_dispose (GObject *object)
+{
+  GtkGLDrawingAreaPrivate *priv = GTK_GL_DRAWING_AREA (object)->priv;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (priv->tick_id != 0)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (object), priv->tick_id);
+      priv->tick_id = 0;
+    }
+
+  G_OBJECT_CLASS (gtk_gl_drawing_area_parent_class)->dispose (object);
+}
+
+static void
+gtk_gl_drawing_area_finalize (GObject *object)
+{
+  GtkGLDrawingAreaPrivate *priv = GTK_GL_DRAWING_AREA (object)->priv;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (priv->glconfig != NULL)
+    g_object_unref (priv->glconfig);
+
+  G_OBJECT_CLASS (gtk_gl_drawing_area_parent_class)->finalize (object);
+}
+
+static void
+gtk_gl_drawing_area_set_property (GObject      *object,
+                                  guint         property_id,
+                                  const GValue *value,
+                                  GParamSpec   *pspec)
+{
+  GtkGLDrawingArea *area = GTK_GL_DRAWING_AREA (object);
+
+  switch (property_id)
+    {
+    case PROP_GL_CONFIG:
+      area->priv->glconfig = g_value_dup_object (value);
+      break;
+    case PROP_N_SAMPLES:
+      gtk_gl_drawing_area_set_n_samples (area, g_value_get_int (value));
+      break;
+    case PROP_CONTINUOUS:
+      gtk_gl_drawing_area_set_continuous (area, g_value_get_boolean (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+static void
+gtk_gl_drawing_area_get_property (GObject    *object,
+                                  guint       property_id,
+                                  GValue     *value,
+                                  GParamSpec *pspec)
+{
+  GtkGLDrawingArea *area = GTK_GL_DRAWING_AREA (object);
+
+  switch (property_id)
+    {
+    case PROP_GL_CONFIG:
+      g_value_set_object (value, area->priv->glconfig);
+      break;
+    case PROP_N_SAMPLES:
+      g_value_set_int (value, area->priv->n_samples);
+      break;
+    case PROP_CONTINUOUS:
+      g_value_set_boolean (value, area->priv->continuous);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+static void
+gtk_gl_drawing_area_map (GtkWidget *widget)
+{
+  GTK_WIDGET_CLASS (gtk_gl_drawing_area_parent_class)->map (widget);
+
+  gtk_gl_drawing_area_update_tick (GTK_GL_DRAWING_AREA (widget));
+}
+
+static void
+gtk_gl_drawing_area_unmap (GtkWidget *widget)
+{
+  GTK_WIDGET_CLASS (gtk_gl_drawing_area_parent_class)->unmap (widget);
+
+  gtk_gl_drawing_area_update_tick (GTK_GL_DRAWING_AREA (widget));
+}
+
+static gboolean
+gtk_gl_drawing_area_draw (GtkWidget *widget,
+                          cairo_t   *cr)
+{
+  GtkGLDrawingArea *area = GTK_GL_DRAWING_AREA (widget);
+  GtkGLDrawingAreaPrivate *priv = area->priv;
+  GtkAllocation allocation;
+  GdkRectangle clip;
+  gboolean rendered = FALSE;
+  gboolean handled;
+
+  if (!gtk_widget_begin_gl (widget))
+    return FALSE;
+
+  gtk_widget_get_allocation (widget, &allocation);
+
+  gtk_gl_drawing_area_ensure_framebuffer (area, allocation.width, allocation.height);
+
+  if (priv->framebuffer == NULL)
+    {
+      /* No framebuffer objects; render straight into the window. */
+      glViewport (0, 0, allocation.width, allocation.height);
+      g_signal_emit (area, gl_drawing_area_signals[RENDER], 0,
+                     gtk_widget_get_gl_context (widget), &handled);
+      priv->needs_render = FALSE;
+
+      gtk_widget_end_gl (widget, TRUE);
+      return TRUE;
+    }
+
+  /*
+   * Only re-render when asked to. Plain exposes just copy the existing
+   * frame to the window again.
+   */
+
+  if (priv->needs_render)
+    {
+      gdk_gl_multisample_begin (priv->framebuffer);
+      glViewport (0, 0, allocation.width, allocation.height);
+      g_signal_emit (area, gl_drawing_area_signals[RENDER], 0,
+                     gtk_widget_get_gl_context (widget), &handled);
+      gdk_gl_multisample_end (priv->framebuffer);
+
+      priv->needs_render = FALSE;
+      rendered = TRUE;
+    }
+
+  /*
+   * A partial expose only needs its own area copied, provided the back
+   * buffer still holds the previous frame everywhere else.
+   */
+
+  if (!rendered &&
+      gdk_cairo_get_clip_rectangle (cr, &clip) &&
+      gdk_gl_drawable_get_buffer_age (gtk_widget_get_gl_drawable (widget)) == 1)
+    {
+      gdk_gl_multisample_resolve (priv->framebuffer, &clip);
+      gtk_widget_end_gl_with_damage (widget, &clip, 1);
+    }
+  else
+    {
+      gdk_gl_multisample_resolve (priv->framebuffer, NULL);
+      gtk_widget_end_gl (widget, TRUE);
+    }
+
+  return TRUE;
+}
+
+static void
+gtk_gl_drawing_area_class_init (GtkGLDrawingAreaClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  g_type_class_add_private (klass, sizeof (GtkGLDrawingAreaPrivate));
+
+  object_class->constructed  = gtk_gl_drawing_area_constructed;
+  object_class->dispose      = gtk_gl_drawing_area_dispose;
+  object_class->finalize     = gtk_gl_drawing_area_finalize;
+  object_class->set_property = gtk_gl_drawing_area_set_property;
+  object_class->get_property = gtk_gl_drawing_area_get_property;
+
+  widget_class->map    = gtk_gl_drawing_area_map;
+  widget_class->unmap  = gtk_gl_drawing_area_unmap;
+  widget_class->draw   = gtk_gl_drawing_area_draw;
+
+  klass->render = NULL;
+  klass->resize = NULL;
+
+  g_object_class_install_property (object_class,
+                                   PROP_GL_CONFIG,
+                                   g_param_spec_object ("gl-config",
+                                                        "GL config",
+                                                        "The frame buffer configuration of the window",
+                                                        GDK_TYPE_GL_CONFIG,
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_CONSTRUCT_ONLY));
+
+  g_object_class_install_property (object_class,
+                                   PROP_N_SAMPLES,
+                                   g_param_spec_int ("n-samples",
+                                                     "Number of samples",
+                                                     "Samples per pixel of the offscreen framebuffer, 0 for none",
+                                                     0, G_MAXINT, 0,
+                                                     G_PARAM_READWRITE));
+
+  g_object_class_install_property (object_class,
+                                   PROP_CONTINUOUS,
+                                   g_param_spec_boolean ("continuous",
+                                                         "Continuous",
+                                                         "Whether to render a new frame whenever the previous one is done",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE));
+
+  /**
+   * GtkGLDrawingArea::render:
+   * @area: the #GtkGLDrawingArea.
+   * @glcontext: the widget's #GdkGLContext, which is current.
+   *
+   * Emitted when a new frame is needed, with the offscreen framebuffer
+   * bound and the viewport covering the whole widget. Do not swap
+   * buffers; the widget copies the frame to the window afterwards.
+   *
+   * Return value: TRUE to stop other handlers from being invoked.
+   */
+  gl_drawing_area_signals[RENDER] =
+    g_signal_new ("render",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (GtkGLDrawingAreaClass, render),
+                  g_signal_accumulator_true_handled, NULL,
+                  g_cclosure_marshal_generic,
+                  G_TYPE_BOOLEAN, 1,
+                  GDK_TYPE_GL_CONTEXT);
+
+  /**
+   * GtkGLDrawingArea::resize:
+   * @area: the #GtkGLDrawingArea.
+   * @width: the new width in pixels.
+   * @height: the new height in pixels.
+   *
+   * Emitted with the widget's context current when the size of the
+   * framebuffer changed, including when it is first set up. A "render"
+   * follows.
+   */
+  gl_drawing_area_signals[RESIZE] =
+    g_signal_new ("resize",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (GtkGLDrawingAreaClass, resize),
+                  NULL, NULL,
+                  g_cclosure_marshal_generic,
+                  G_TYPE_NONE, 2,
+                  G_TYPE_INT,
+                  G_TYPE_INT);
+}
+
+/**
+ * gtk_gl_drawing_area_new:
+ * @glconfig: (allow-none): a #GdkGLConfig, or NULL for a double-buffered
+ *            RGBA configuration with a depth buffer.
+ *
+ * Creates a widget that owns its OpenGL context and renders into an
+ * offscreen framebuffer with depth and stencil buffers (see
+ * #GdkGLMultisample). The application draws in the "render" signal,
+ * which is only emitted after gtk_gl_drawing_area_queue_render(), a
+ * resize, or on every frame in continuous mode. Other exposes copy the
+ * last frame to the window again, limited to the exposed area when the
+ * back buffer allows it, without emitting "render".
+ *
+ * Without framebuffer object support, "render" draws straight into the
+ * window on every expose.
+ *
+ * Return value: the new #GtkGLDrawingArea.
+ **/
+GtkWidget *
+gtk_gl_drawing_area_new (GdkGLConfig *glconfig)
+{
+  GTK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (glconfig == NULL || GDK_IS_GL_CONFIG (glconfig), NULL);
+
+  return g_object_new (GTK_TYPE_GL_DRAWING_AREA,
+                       "gl-config", glconfig,
+                       NULL);
+}
+
+/**
+ * gtk_gl_drawing_area_get_gl_config:
+ * @area: a #GtkGLDrawingArea.
+ *
+ * Returns the #GdkGLConfig of the @area's window.
+ *
+ * Return value: (transfer none): the #GdkGLConfig.
+ **/
+GdkGLConfig *
+gtk_gl_drawing_area_get_gl_config (GtkGLDrawingArea *area)
+{
+  g_return_val_if_fail (GTK_IS_GL_DRAWING_AREA (area), NULL);
+
+  return area->priv->glconfig;
+}
+
+/**
+ * gtk_gl_drawing_area_get_gl_context:
+ * @area: a realized #GtkGLDrawingArea.
+ *
+ * Returns the #GdkGLContext owned by the @area.
+ *
+ * Return value: (transfer none): the #GdkGLContext.
+ **/
+GdkGLContext *
+gtk_gl_drawing_area_get_gl_context (GtkGLDrawingArea *area)
+{
+  g_return_val_if_fail (GTK_IS_GL_DRAWING_AREA (area), NULL);
+
+  return gtk_widget_get_gl_context (GTK_WIDGET (area));
+}
+
+/**
+ * gtk_gl_drawing_area_set_n_samples:
+ * @area: a #GtkGLDrawingArea.
+ * @n_samples: samples per pixel, or 0 to disable multisampling.
+ *
+ * Sets the number of samples per pixel of the offscreen framebuffer.
+ * The antialiased frame is resolved into the window by the @area, so
+ * the #GdkGLConfig does not need to be multisampled.
+ **/
+void
+gtk_gl_drawing_area_set_n_samples (GtkGLDrawingArea *area,
+                                   gint              n_samples)
+{
+  GtkGLDrawingAreaPrivate *priv;
+
+  g_return_if_fail (GTK_IS_GL_DRAWING_AREA (area));
+  g_return_if_fail (n_samples >= 0);
+
+  priv = area->priv;
+
+  if (priv->n_samples == n_samples)
+    return;
+
+  priv->n_samples = n_samples;
+
+  /* Reallocated at the next draw, with the context current. */
+  priv->framebuffer_stale = TRUE;
+  gtk_gl_drawing_area_queue_render (area);
+
+  g_object_notify (G_OBJECT (area), "n-samples");
+}
+
+/**
+ * gtk_gl_drawing_area_get_n_samples:
+ * @area: a #GtkGLDrawingArea.
+ *
+ * Gets the number of samples per pixel set with
+ * gtk_gl_drawing_area_set_n_samples().
+ *
+ * Return value: the requested number of samples per pixel.
+ **/
+gint
+gtk_gl_drawing_area_get_n_samples (GtkGLDrawingArea *area)
+{
+  g_return_val_if_fail (GTK_IS_GL_DRAWING_AREA (area), 0);
+
+  return area->priv->n_samples;
+}
+
+/**
+ * gtk_gl_drawing_area_set_continuous:
+ * @area: a #GtkGLDrawingArea.
+ * @continuous: whether to render continuously.
+ *
+ * In continuous mode the @area renders a new frame on every tick of
+ * its frame clock, for as long as it is mapped. Otherwise frames
+ * are only rendered on demand, see gtk_gl_drawing_area_queue_render().
+ **/
+void
+gtk_gl_drawing_area_set_continuous (GtkGLDrawingArea *area,
+                                    gboolean          continuous)
+{
+  g_return_if_fail (GTK_IS_GL_DRAWING_AREA (area));
+
+  continuous = continuous ? TRUE : FALSE;
+
+  if (area->priv->continuous == continuous)
+    return;
+
+  area->priv->continuous = continuous;
+
+  gtk_gl_drawing_area_update_tick (area);
+
+  g_object_notify (G_OBJECT (area), "continuous");
+}
+
+/**
+ * gtk_gl_drawing_area_get_continuous:
+ * @area: a #GtkGLDrawingArea.
+ *
+ * Returns whether the @area renders continuously.
+ *
+ * Return value: TRUE in continuous mode, FALSE otherwise.
+ **/
+gboolean
+gtk_gl_drawing_area_get_continuous (GtkGLDrawingArea *area)
+{
+  g_return_val_if_fail (GTK_IS_GL_DRAWING_AREA (area), FALSE);
+
+  return area->priv->continuous;
+}
+
+/**
+ * gtk_gl_drawing_area_queue_render:
+ * @area: a #GtkGLDrawingArea.
+ *
+ * Schedules a new frame: "render" is emitted at the next redraw of
+ * the @area. gtk_widget_queue_draw() alone only copies the previous
+ * frame to the window again.
+ **/
+void
+gtk_gl_drawing_area_queue_render (GtkGLDrawingArea *area)
+{
+  g_return_if_fail (GTK_IS_GL_DRAWING_AREA (area));
+
+  area->priv->needs_render = TRUE;
+
+  gtk_widget_queue_draw (GTK_WIDGET (area));
+}
@@ -0,0 +1,85 @@
+/* GdkGLExt - OpenGL Extension to GDK
+ * Copyright (C) 2002-2004  Naofumi Yasufuku
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA.
+ */
+
+#if !defined (__GTKGL_H_INSIDE__) && !defined (GTK_GL_COMPILATION)
+#error "Only <gtk/gtkgl.h> can be included directly."
+#endif
+
+#ifndef __GTK_GL_DRAWING_AREA_H__
+#define __GTK_GL_DRAWING_AREA_H__
+
+#include <gdk/gdk.h>
+#include <gdk/gdkgl.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+#define GTK_TYPE_GL_DRAWING_AREA            (gtk_gl_drawing_area_get_type ())
+#define GTK_GL_DRAWING_AREA(object)         (G_TYPE_CHECK_INSTANCE_CAST ((object), GTK_TYPE_GL_DRAWING_AREA, GtkGLDrawingArea))
+#define GTK_GL_DRAWING_AREA_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GTK_TYPE_GL_DRAWING_AREA, GtkGLDrawingAreaClass))
+#define GTK_IS_GL_DRAWING_AREA(object)      (G_TYPE_CHECK_INSTANCE_TYPE ((object), GTK_TYPE_GL_DRAWING_AREA))
+#define GTK_IS_GL_DRAWING_AREA_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GTK_TYPE_GL_DRAWING_AREA))
+#define GTK_GL_DRAWING_AREA_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GTK_TYPE_GL_DRAWING_AREA, GtkGLDrawingAreaClass))
+
+typedef struct _GtkGLDrawingArea        GtkGLDrawingArea;
+typedef struct _GtkGLDrawingAreaClass   GtkGLDrawingAreaClass;
+typedef struct _GtkGLDrawingAreaPrivate GtkGLDrawingAreaPrivate;
+
+struct _GtkGLDrawingArea
+{
+  GtkDrawingArea parent_instance;
+
+  /*< private >*/
+  GtkGLDrawingAreaPrivate *priv;
+};
+
+struct _GtkGLDrawingAreaClass
+{
+  GtkDrawingAreaClass parent_class;
+
+  /* Signals */
+  gboolean (*render) (GtkGLDrawingArea *area,
+                      GdkGLContext     *glcontext);
+  void     (*resize) (GtkGLDrawingArea *area,
+                      gint              width,
+                      gint              height);
+};
+
+GType         gtk_gl_drawing_area_get_type       (void);
+
+GtkWidget    *gtk_gl_drawing_area_new            (GdkGLConfig      *glconfig);
+
+GdkGLConfig  *gtk_gl_drawing_area_get_gl_config  (GtkGLDrawingArea *area);
+
+GdkGLContext *gtk_gl_drawing_area_get_gl_context (GtkGLDrawingArea *area);
+
+void          gtk_gl_drawing_area_set_n_samples  (GtkGLDrawingArea *area,
+                                                  gint              n_samples);
+
+gint          gtk_gl_drawing_area_get_n_samples  (GtkGLDrawingArea *area);
+
+void          gtk_gl_drawing_area_set_continuous (GtkGLDrawingArea *area,
+                                                  gboolean          continuous);
+
+gboolean      gtk_gl_drawing_area_get_continuous (GtkGLDrawingArea *area);
+
+void          gtk_gl_drawing_area_queue_render   (GtkGLDrawingArea *area);
+
+G_END_DECLS
+
+#endif /* __GTK_GL_DRAWING_AREA_H__ */
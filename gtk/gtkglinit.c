@@ -77,6 +77,17 @@ gtk_gl_parse_args (int    *argc,
       env_string = NULL;
     }
 
+  /*
+   * Give the OpenGL visual to a child window of the widget only, so the
+   * top-level window and the rest of the UI stay on the default visual.
+   */
+  env_string = g_getenv ("GTK_GL_CHILD_WINDOW");
+  if (env_string != NULL)
+    {
+      _gtk_gl_widget_use_child_window = !!g_ascii_strtoll (env_string, NULL, 0);
+      env_string = NULL;
+    }
+
 #ifdef G_ENABLE_DEBUG
   env_string = g_getenv ("GTK_GL_DEBUG");
   if (env_string != NULL)
@@ -99,6 +110,11 @@ gtk_gl_parse_args (int    *argc,
               _gtk_gl_widget_install_toplevel_visual = TRUE;
               (*argv)[i] = NULL;
             }
+          else if (strcmp ("--gtk-gl-child-window", (*argv)[i]) == 0)
+            {
+              _gtk_gl_widget_use_child_window = TRUE;
+              (*argv)[i] = NULL;
+            }
 #ifdef G_ENABLE_DEBUG
           else if ((strcmp ("--gtk-gl-debug", (*argv)[i]) == 0) ||
                    (strncmp ("--gtk-gl-debug=", (*argv)[i], 15) == 0))
@@ -27,6 +27,9 @@ G_BEGIN_DECLS
 /* Install visual to top-level window. */
 extern gboolean _gtk_gl_widget_install_toplevel_visual;
 
+/* Render to a child window that alone has the OpenGL visual. */
+extern gboolean _gtk_gl_widget_use_child_window;
+
 G_END_DECLS
 
 #endif /* __GTK_GL_PRIVATE_H__ */
@@ -25,7 +25,62 @@
 
 #include <GL/gl.h>
 
+/*
+ * Render thread.
+ */
+
+typedef struct
+{
+  gpointer       data;
+  GDestroyNotify destroy;
+} GLRenderSnapshot;
+
 typedef struct
+{
+  GtkGLRenderFunc func;
+  gpointer        user_data;
+  GDestroyNotify  destroy;
+
+  GThread      *thread;
+  GdkGLWindow  *glwindow;
+
+  /* Created on the main thread, only made current on the render thread. */
+  GdkGLContext *glcontext;
+
+  /* Handed over from the main thread without locking. */
+  GLRenderSnapshot *pending;
+  gint width;
+  gint height;
+  gint resize_serial;
+  gint quit;
+
+  /* Only used to park the thread while there is nothing to do. */
+  GMutex   lock;
+  GCond    cond;
+  gboolean wakeup;
+} GLRenderThread;
+
+/*
+ * Resolved begin/end state, see gtk_widget_get_gl_binding ().
+ */
+
+typedef struct _GLWidgetPrivate GLWidgetPrivate;
+
+struct _GtkGLBinding
+{
+  gint ref_count;
+
+  /* Cleared when the widget goes away. */
+  GtkWidget       *widget;
+  GLWidgetPrivate *private;
+
+  /* Resolved at the first begin after realize, cleared at unrealize. */
+  GdkGLContext *glcontext;
+  GdkGLWindow  *glwindow;
+  gboolean      double_buffered;
+};
+
+struct _GLWidgetPrivate
 {
   GdkGLConfig *glconfig;
   GdkGLContext *share_list;
@@ -34,17 +89,51 @@ typedef struct
 
   GdkGLContext *glcontext;
 
+  /* Native child window carrying the GL visual, in child window mode. */
+  GdkWindow *child_window;
+
+  /* Size the viewport was last set up for, or -1. */
+  gint width;
+  gint height;
+
   gulong unrealize_handler;
+  gulong frame_presented_handler;
+
+  /* Latest presentation feedback, in microseconds. */
+  gint64 presentation_time;
+  gint64 presentation_msc;
+  gint64 refresh_interval;
+
+  GLRenderThread *render_thread;
+
+  GtkGLBinding *binding;
+
+  /* Context creation ahead of the first draw. */
+  GtkGLPrewarmFunc prewarm_func;
+  gpointer         prewarm_data;
+  GDestroyNotify   prewarm_destroy;
+  guint            prewarm_id;
+  guint            prewarm : 1;
+
+  /* Called from gtk_gl_widget_apply_resize (). */
+  GtkGLResizeFunc resize_func;
+  gpointer        resize_data;
+  GDestroyNotify  resize_destroy;
 
   guint is_realized : 1;
+  guint has_presentation : 1;
+  guint use_child_window : 1;
+  guint resize_pending : 1;
 
-} GLWidgetPrivate;
+};
 
 static const gchar quark_gl_private_string[] = "gtk-gl-widget-private";
 static GQuark quark_gl_private = 0;
 
 gboolean _gtk_gl_widget_install_toplevel_visual = FALSE;
 
+gboolean _gtk_gl_widget_use_child_window = FALSE;
+
 static void     gtk_gl_widget_realize            (GtkWidget         *widget,
                                                   GLWidgetPrivate   *private);
 static gboolean gtk_gl_widget_configure_event    (GtkWidget         *widget,
@@ -62,8 +151,107 @@ static void     gtk_gl_widget_style_set          (GtkWidget         *widget,
                                                   GtkStyle          *previous_style,
                                                   gpointer           user_data);
 
+static void     gtk_gl_widget_frame_presented    (GdkGLWindow       *glwindow,
+                                                  gint64             ust,
+                                                  gint64             msc,
+                                                  gint64             sbc,
+                                                  GLWidgetPrivate   *private);
+
+static gboolean gtk_gl_widget_draw               (GtkWidget         *widget,
+                                                  cairo_t           *cr,
+                                                  GLWidgetPrivate   *private);
+
+static void     gtk_gl_widget_apply_resize       (GtkWidget         *widget,
+                                                  GLWidgetPrivate   *private);
+
+static gboolean gtk_gl_widget_prewarm            (gpointer           data);
+
+static void     gl_render_thread_start           (GtkWidget         *widget,
+                                                  GLWidgetPrivate   *private);
+static void     gl_render_thread_stop            (GLWidgetPrivate   *private);
+static void     gl_render_thread_wakeup          (GLRenderThread    *render_thread);
+
 static void     gl_widget_private_destroy        (GLWidgetPrivate   *private);
 
+static GdkWindow *gtk_gl_widget_get_gl_gdk_window (GtkWidget        *widget);
+
+static gboolean  gtk_gl_binding_resolve          (GtkGLBinding     *binding);
+
+/*
+ * Child window mode.
+ */
+
+static void
+gtk_gl_widget_create_child_window (GtkWidget       *widget,
+                                   GLWidgetPrivate *private)
+{
+  GtkAllocation allocation;
+  GdkWindowAttr attributes;
+  gint attributes_mask;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  /*
+   * Only this window gets the GL visual; the widget's own window and
+   * the top-level window stay on the default visual.
+   */
+
+  gtk_widget_get_allocation (widget, &allocation);
+
+  attributes.window_type = GDK_WINDOW_CHILD;
+  attributes.x = 0;
+  attributes.y = 0;
+  attributes.width = allocation.width;
+  attributes.height = allocation.height;
+  attributes.wclass = GDK_INPUT_OUTPUT;
+  attributes.visual = gdk_gl_config_get_visual (private->glconfig);
+  attributes.event_mask = gtk_widget_get_events (widget) | GDK_EXPOSURE_MASK;
+
+  attributes_mask = GDK_WA_X | GDK_WA_Y | GDK_WA_VISUAL;
+
+  private->child_window = gdk_window_new (gtk_widget_get_window (widget),
+                                          &attributes, attributes_mask);
+
+  /* Events on the child window are delivered to the widget. */
+  gdk_window_set_user_data (private->child_window, widget);
+
+  gdk_window_ensure_native (private->child_window);
+
+  /* Background of "None", as for widget->window. */
+  gdk_window_set_background_pattern (private->child_window, NULL);
+
+  gdk_window_show (private->child_window);
+}
+
+static void
+gtk_gl_widget_destroy_child_window (GLWidgetPrivate *private)
+{
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  gdk_window_set_user_data (private->child_window, NULL);
+  gdk_window_destroy (private->child_window);
+  private->child_window = NULL;
+
+  private->width = -1;
+  private->height = -1;
+}
+
+/*
+ * Returns the window OpenGL renders to: widget->window, or the GL child
+ * window in child window mode.
+ */
+static GdkWindow *
+gtk_gl_widget_get_gl_gdk_window (GtkWidget *widget)
+{
+  GLWidgetPrivate *private;
+
+  private = g_object_get_qdata (G_OBJECT (widget), quark_gl_private);
+  if (private != NULL && private->child_window != NULL)
+    return private->child_window;
+
+  return gtk_widget_get_window (widget);
+}
+
 /*
  * Signal handlers.
  */
@@ -82,7 +270,10 @@ gtk_gl_widget_realize (GtkWidget       *widget,
    * handlers.
    */
 
-  window = gtk_widget_get_window (widget);
+  if (private->use_child_window && private->child_window == NULL)
+    gtk_gl_widget_create_child_window (widget, private);
+
+  window = gtk_gl_widget_get_gl_gdk_window (widget);
   if (!gdk_window_is_gl_capable (window))
     {
       glwindow = gdk_window_set_gl_capability (window,
@@ -94,13 +285,31 @@ gtk_gl_widget_realize (GtkWidget       *widget,
           return;
         }
 
+      /* Track presentation timestamps of the window. */
+      private->has_presentation = FALSE;
+      private->frame_presented_handler = g_signal_connect (G_OBJECT (glwindow), "frame-presented",
+                                                           G_CALLBACK (gtk_gl_widget_frame_presented),
+                                                           private);
+
       /* Connect "unrealize" signal handler. */
       if (private->unrealize_handler == 0)
         private->unrealize_handler = g_signal_connect (G_OBJECT (widget), "unrealize",
                                                        G_CALLBACK (gtk_gl_widget_unrealize),
                                                        private);
+
+      if (private->render_thread != NULL)
+        gl_render_thread_start (widget, private);
+      else if (private->prewarm && private->prewarm_id == 0)
+        /* Runs ahead of the first redraw, while the window gets mapped. */
+        private->prewarm_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                                               gtk_gl_widget_prewarm,
+                                               widget,
+                                               NULL);
     }
 
+  /* Set up the viewport at the first draw. */
+  private->resize_pending = TRUE;
+
   private->is_realized = TRUE;
 }
 
@@ -125,18 +334,30 @@ gtk_gl_widget_size_allocate (GtkWidget       *widget,
                              GtkAllocation   *allocation,
                              GLWidgetPrivate *private)
 {
-  GdkGLDrawable *gldrawable;
-
   GTK_GL_NOTE_FUNC_PRIVATE ();
 
+  if (private->child_window != NULL)
+    gdk_window_resize (private->child_window,
+                       allocation->width, allocation->height);
+
   /*
    * Synchronize OpenGL and window resizing request streams.
    */
 
-  if (gtk_widget_get_realized (widget) && private->is_realized)
+  if (private->render_thread != NULL && private->render_thread->thread != NULL)
     {
-      gldrawable = gdk_window_get_gl_drawable (gtk_widget_get_window (widget));
-      gdk_gl_drawable_wait_gdk (gldrawable);
+      /* The render thread waits for GDK itself, with its context current. */
+      g_atomic_int_set (&private->render_thread->width, allocation->width);
+      g_atomic_int_set (&private->render_thread->height, allocation->height);
+      g_atomic_int_inc (&private->render_thread->resize_serial);
+      gl_render_thread_wakeup (private->render_thread);
+    }
+  else if (allocation->width != private->width ||
+           allocation->height != private->height)
+    {
+      /* Several allocations may happen in one frame; only the size at
+         the next draw matters. See gtk_gl_widget_apply_resize (). */
+      private->resize_pending = TRUE;
     }
 }
 
@@ -144,8 +365,29 @@ static void
 gtk_gl_widget_unrealize (GtkWidget       *widget,
                          GLWidgetPrivate *private)
 {
+  GdkGLWindow *glwindow;
+
   GTK_GL_NOTE_FUNC_PRIVATE ();
 
+  /*
+   * Stop the render thread first, it still draws to widget->window.
+   */
+
+  if (private->render_thread != NULL)
+    gl_render_thread_stop (private);
+
+  if (private->prewarm_id != 0)
+    {
+      g_source_remove (private->prewarm_id);
+      private->prewarm_id = 0;
+    }
+
+  if (private->binding != NULL)
+    {
+      private->binding->glcontext = NULL;
+      private->binding->glwindow = NULL;
+    }
+
   /*
    * Destroy OpenGL rendering context.
    */
@@ -161,11 +403,333 @@ gtk_gl_widget_unrealize (GtkWidget       *widget,
    */
 
   if (gtk_widget_get_realized (widget))
-    gdk_window_unset_gl_capability (gtk_widget_get_window (widget));
+    {
+      glwindow = gdk_window_get_gl_window (gtk_gl_widget_get_gl_gdk_window (widget));
+      if (glwindow != NULL && private->frame_presented_handler != 0)
+        g_signal_handler_disconnect (glwindow, private->frame_presented_handler);
+
+      gdk_window_unset_gl_capability (gtk_gl_widget_get_gl_gdk_window (widget));
+    }
+
+  if (private->child_window != NULL)
+    gtk_gl_widget_destroy_child_window (private);
 
+  private->frame_presented_handler = 0;
+  private->width = -1;
+  private->height = -1;
+  private->has_presentation = FALSE;
+  private->resize_pending = FALSE;
   private->is_realized = FALSE;
 }
 
+static void
+gtk_gl_widget_frame_presented (GdkGLWindow     *glwindow,
+                               gint64           ust,
+                               gint64           msc,
+                               gint64           sbc,
+                               GLWidgetPrivate *private)
+{
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  /*
+   * Derive the refresh interval from consecutive presentations. The
+   * signal is emitted in the default main context, also for frames
+   * swapped on a render thread, so no locking is needed.
+   */
+
+  if (private->has_presentation &&
+      msc > private->presentation_msc &&
+      ust > private->presentation_time)
+    private->refresh_interval = (ust - private->presentation_time) /
+                                (msc - private->presentation_msc);
+
+  private->presentation_time = ust;
+  private->presentation_msc = msc;
+  private->has_presentation = TRUE;
+}
+
+static gboolean
+gtk_gl_widget_draw (GtkWidget       *widget,
+                    cairo_t         *cr,
+                    GLWidgetPrivate *private)
+{
+  /*
+   * In child window mode "draw" is emitted for widget->window as well
+   * as for the GL child window. Stop the emission for the former, so
+   * the application renders and swaps once per frame.
+   */
+
+  if (private->child_window != NULL &&
+      !gtk_cairo_should_draw_window (cr, private->child_window))
+    return TRUE;
+
+  /* Exposed; have the render thread draw its latest snapshot again. */
+  if (private->render_thread != NULL && private->render_thread->thread != NULL)
+    gl_render_thread_wakeup (private->render_thread);
+  else if (private->render_thread == NULL && private->resize_pending)
+    gtk_gl_widget_apply_resize (widget, private);
+
+  return FALSE;
+}
+
+static gboolean
+gtk_gl_widget_prewarm (gpointer data)
+{
+  GtkWidget *widget = GTK_WIDGET (data);
+  GLWidgetPrivate *private;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  private = g_object_get_qdata (G_OBJECT (widget), quark_gl_private);
+  private->prewarm_id = 0;
+
+  /*
+   * Create the context now, and let the application compile shaders
+   * and upload resources with it, so the first draw does not pay for it.
+   */
+
+  if (gtk_widget_begin_gl (widget))
+    {
+      if (private->prewarm_func != NULL)
+        private->prewarm_func (widget, private->glcontext, private->prewarm_data);
+
+      gtk_widget_end_gl (widget, FALSE);
+    }
+
+  return FALSE;
+}
+
+/*
+ * Brings the GL viewport up to date with the allocation, at the next draw.
+ * The X sync only happens when the drawable size actually changed.
+ * Leaves the widget's context current.
+ */
+static void
+gtk_gl_widget_apply_resize (GtkWidget       *widget,
+                            GLWidgetPrivate *private)
+{
+  GtkAllocation allocation;
+  GdkGLDrawable *gldrawable;
+  GdkGLContext *glcontext;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  private->resize_pending = FALSE;
+
+  if (!gtk_widget_get_realized (widget) || !private->is_realized)
+    return;
+
+  gtk_widget_get_allocation (widget, &allocation);
+
+  if (allocation.width == private->width &&
+      allocation.height == private->height)
+    return;
+
+  gldrawable = gdk_window_get_gl_drawable (gtk_gl_widget_get_gl_gdk_window (widget));
+  glcontext = gtk_widget_get_gl_context (widget);
+  if (gldrawable == NULL || glcontext == NULL)
+    return;
+
+  if (!gdk_gl_context_make_current (glcontext, gldrawable, gldrawable))
+    return;
+
+  /*
+   * Synchronize OpenGL and window resizing request streams.
+   */
+
+  gdk_gl_drawable_wait_gdk (gldrawable);
+
+  private->width = allocation.width;
+  private->height = allocation.height;
+
+  glViewport (0, 0, allocation.width, allocation.height);
+
+  if (private->resize_func != NULL)
+    private->resize_func (widget, allocation.width, allocation.height,
+                          private->resize_data);
+}
+
+static void
+gl_render_snapshot_free (GLRenderSnapshot *snapshot)
+{
+  if (snapshot->destroy != NULL)
+    snapshot->destroy (snapshot->data);
+
+  g_slice_free (GLRenderSnapshot, snapshot);
+}
+
+static GLRenderSnapshot *
+gl_render_thread_take_snapshot (GLRenderThread *render_thread)
+{
+  GLRenderSnapshot *snapshot;
+
+  do
+    snapshot = g_atomic_pointer_get (&render_thread->pending);
+  while (snapshot != NULL &&
+         !g_atomic_pointer_compare_and_exchange (&render_thread->pending, snapshot, NULL));
+
+  return snapshot;
+}
+
+static void
+gl_render_thread_wakeup (GLRenderThread *render_thread)
+{
+  g_mutex_lock (&render_thread->lock);
+  render_thread->wakeup = TRUE;
+  g_cond_signal (&render_thread->cond);
+  g_mutex_unlock (&render_thread->lock);
+}
+
+static gpointer
+gl_render_thread_main (gpointer data)
+{
+  GLWidgetPrivate *private = data;
+  GLRenderThread *render_thread = private->render_thread;
+  GdkGLDrawable *gldrawable = GDK_GL_DRAWABLE (render_thread->glwindow);
+  GdkGLContext *glcontext = render_thread->glcontext;
+  GLRenderSnapshot *current = NULL;
+  GLRenderSnapshot *snapshot;
+  gint resize_serial = 0;
+  gint serial;
+
+  for (;;)
+    {
+      g_mutex_lock (&render_thread->lock);
+      while (!render_thread->wakeup)
+        g_cond_wait (&render_thread->cond, &render_thread->lock);
+      render_thread->wakeup = FALSE;
+      g_mutex_unlock (&render_thread->lock);
+
+      if (g_atomic_int_get (&render_thread->quit))
+        break;
+
+      snapshot = gl_render_thread_take_snapshot (render_thread);
+      if (snapshot != NULL)
+        {
+          if (current != NULL)
+            gl_render_snapshot_free (current);
+          current = snapshot;
+        }
+
+      if (!gdk_gl_context_make_current (glcontext, gldrawable, gldrawable))
+        continue;
+
+      /* Synchronize OpenGL and window resizing request streams. */
+      serial = g_atomic_int_get (&render_thread->resize_serial);
+      if (serial != resize_serial)
+        {
+          gdk_gl_drawable_wait_gdk (gldrawable);
+          resize_serial = serial;
+        }
+
+      render_thread->func (gldrawable,
+                           g_atomic_int_get (&render_thread->width),
+                           g_atomic_int_get (&render_thread->height),
+                           current != NULL ? current->data : NULL,
+                           render_thread->user_data);
+
+      if (gdk_gl_drawable_is_double_buffered (gldrawable))
+        gdk_gl_drawable_swap_buffers (gldrawable);
+      else
+        glFlush ();
+
+      gdk_gl_context_release_current ();
+    }
+
+  if (current != NULL)
+    gl_render_snapshot_free (current);
+
+  return NULL;
+}
+
+static void
+gl_render_thread_start (GtkWidget       *widget,
+                        GLWidgetPrivate *private)
+{
+  GLRenderThread *render_thread = private->render_thread;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (render_thread->thread != NULL)
+    return;
+
+  render_thread->glwindow = gdk_window_get_gl_window (gtk_gl_widget_get_gl_gdk_window (widget));
+
+  /*
+   * Create the context here, the render thread must not call GDK. It is
+   * only ever current on the render thread.
+   */
+
+  render_thread->glcontext = gdk_gl_context_new (GDK_GL_DRAWABLE (render_thread->glwindow),
+                                                 private->share_list,
+                                                 private->direct,
+                                                 private->render_type);
+  if (render_thread->glcontext == NULL)
+    {
+      g_warning ("cannot create GdkGLContext for the render thread\n");
+      render_thread->glwindow = NULL;
+      return;
+    }
+
+  g_object_ref (G_OBJECT (render_thread->glwindow));
+
+  render_thread->width = gtk_widget_get_allocated_width (widget);
+  render_thread->height = gtk_widget_get_allocated_height (widget);
+  render_thread->resize_serial = 1;
+  render_thread->quit = FALSE;
+  render_thread->wakeup = TRUE;
+
+  render_thread->thread = g_thread_new ("gtk-gl-render",
+                                        gl_render_thread_main,
+                                        private);
+}
+
+static void
+gl_render_thread_stop (GLWidgetPrivate *private)
+{
+  GLRenderThread *render_thread = private->render_thread;
+  GLRenderSnapshot *snapshot;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (render_thread->thread == NULL)
+    return;
+
+  g_atomic_int_set (&render_thread->quit, TRUE);
+  gl_render_thread_wakeup (render_thread);
+
+  g_thread_join (render_thread->thread);
+  render_thread->thread = NULL;
+
+  snapshot = gl_render_thread_take_snapshot (render_thread);
+  if (snapshot != NULL)
+    gl_render_snapshot_free (snapshot);
+
+  g_object_unref (G_OBJECT (render_thread->glcontext));
+  render_thread->glcontext = NULL;
+
+  g_object_unref (G_OBJECT (render_thread->glwindow));
+  render_thread->glwindow = NULL;
+}
+
+static void
+gl_render_thread_free (GLRenderThread *render_thread)
+{
+  GLRenderSnapshot *snapshot;
+
+  snapshot = gl_render_thread_take_snapshot (render_thread);
+  if (snapshot != NULL)
+    gl_render_snapshot_free (snapshot);
+
+  if (render_thread->destroy != NULL)
+    render_thread->destroy (render_thread->user_data);
+
+  g_mutex_clear (&render_thread->lock);
+  g_cond_clear (&render_thread->cond);
+
+  g_free (render_thread);
+}
+
 static void
 gtk_gl_widget_parent_set (GtkWidget *widget,
                           GObject   *old_parent,
@@ -228,6 +792,24 @@ gl_widget_private_destroy (GLWidgetPrivate *private)
   if (private->share_list != NULL)
     g_object_unref (G_OBJECT (private->share_list));
 
+  if (private->render_thread != NULL)
+    gl_render_thread_free (private->render_thread);
+
+  if (private->prewarm_destroy != NULL)
+    private->prewarm_destroy (private->prewarm_data);
+
+  if (private->resize_destroy != NULL)
+    private->resize_destroy (private->resize_data);
+
+  if (private->binding != NULL)
+    {
+      private->binding->widget = NULL;
+      private->binding->private = NULL;
+      private->binding->glcontext = NULL;
+      private->binding->glwindow = NULL;
+      gtk_gl_binding_unref (private->binding);
+    }
+
   g_free (private);
 }
 
@@ -244,6 +826,16 @@ gl_widget_private_destroy (GLWidgetPrivate *private)
  * Set the OpenGL-capability to the @widget.
  * This function prepares the widget for its use with OpenGL.
  *
+ * Resizes are coalesced until the next "draw" of the @widget, ahead of
+ * the application's own handlers, or the next gtk_widget_begin_gl() if
+ * that comes first. Only then is the widget's #GdkGLContext made current,
+ * glViewport() set to the new size and the function given to
+ * gtk_widget_set_gl_resize_func() called, so the projection can be
+ * updated there instead of in "configure_event". This is not tied to the
+ * frame clock: a widget that is not redrawn keeps its old viewport until
+ * it is. The X server is only synchronized with when the size actually
+ * changed.
+ *
  * Return value: TRUE if it is successful, FALSE otherwise.
  **/
 gboolean
@@ -278,15 +870,17 @@ gtk_widget_set_gl_capability (GtkWidget    *widget,
     return TRUE;
 
   /*
-   * Set OpenGL-capable colormap.
+   * Set OpenGL-capable colormap. In child window mode the visual only
+   * goes to the child window created at realization.
    */
 
   visual = gdk_gl_config_get_visual (glconfig);
 
-  gtk_widget_set_visual (widget, visual);
+  if (!_gtk_gl_widget_use_child_window)
+    gtk_widget_set_visual (widget, visual);
 
   /* Install visual to the top-level window. */
-  if (_gtk_gl_widget_install_toplevel_visual)
+  if (_gtk_gl_widget_install_toplevel_visual && !_gtk_gl_widget_use_child_window)
     {
       /*
        * If window manager doesn't watch the WM_COLORMAP_WINDOWS property on
@@ -344,9 +938,36 @@ gtk_widget_set_gl_capability (GtkWidget    *widget,
 
   private->glcontext = NULL;
 
+  private->child_window = NULL;
+
+  private->width = -1;
+  private->height = -1;
+
   private->unrealize_handler = 0;
+  private->frame_presented_handler = 0;
+
+  private->presentation_time = 0;
+  private->presentation_msc = 0;
+  private->refresh_interval = 0;
+
+  private->render_thread = NULL;
+
+  private->binding = NULL;
+
+  private->prewarm_func = NULL;
+  private->prewarm_data = NULL;
+  private->prewarm_destroy = NULL;
+  private->prewarm_id = 0;
+  private->prewarm = FALSE;
+
+  private->resize_func = NULL;
+  private->resize_data = NULL;
+  private->resize_destroy = NULL;
 
   private->is_realized = FALSE;
+  private->has_presentation = FALSE;
+  private->use_child_window = _gtk_gl_widget_use_child_window;
+  private->resize_pending = FALSE;
 
   g_object_set_qdata_full (G_OBJECT (widget), quark_gl_private, private,
                            (GDestroyNotify) gl_widget_private_destroy);
@@ -373,6 +994,15 @@ gtk_widget_set_gl_capability (GtkWidget    *widget,
                     G_CALLBACK (gtk_gl_widget_size_allocate),
                     private);
 
+  /*
+   * Connect "draw" signal handler to apply pending resizes, ahead of the
+   * application's own "draw" handlers.
+   */
+
+  g_signal_connect (G_OBJECT (widget), "draw",
+                    G_CALLBACK (gtk_gl_widget_draw),
+                    private);
+
   return TRUE;
 }
 
@@ -443,7 +1073,7 @@ gtk_widget_create_gl_context (GtkWidget    *widget,
   g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
   g_return_val_if_fail (gtk_widget_get_realized (widget), NULL);
 
-  gldrawable = gdk_window_get_gl_drawable (gtk_widget_get_window (widget));
+  gldrawable = gdk_window_get_gl_drawable (gtk_gl_widget_get_gl_gdk_window (widget));
   if (gldrawable == NULL)
     return NULL;
 
@@ -512,17 +1142,23 @@ gtk_widget_get_gl_window (GtkWidget *widget)
   g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
   g_return_val_if_fail (gtk_widget_get_realized (widget), NULL);
 
-  return gdk_window_get_gl_window (gtk_widget_get_window (widget));
+  return gdk_window_get_gl_window (gtk_gl_widget_get_gl_gdk_window (widget));
 }
 
 gboolean
 gtk_widget_begin_gl(GtkWidget *widget)
 {
+  GLWidgetPrivate *private;
   GdkGLContext *glcontext;
   GdkGLWindow  *glwindow;
 
   g_return_val_if_fail (GTK_IS_WIDGET (widget), FALSE);
 
+  /* Drawing outside of "draw" still sees an up to date viewport. */
+  private = g_object_get_qdata (G_OBJECT (widget), quark_gl_private);
+  if (private != NULL && private->resize_pending && private->render_thread == NULL)
+    gtk_gl_widget_apply_resize (widget, private);
+
   glcontext = gtk_widget_get_gl_context (widget);
   glwindow  = gtk_widget_get_gl_window (widget);
 
@@ -548,3 +1184,457 @@ gtk_widget_end_gl(GtkWidget *widget, gboolean do_swap)
 
   gdk_gl_context_release_current();
 }
+
+/**
+ * gtk_widget_end_gl_with_damage:
+ * @widget: a #GtkWidget.
+ * @rects: (array length=n_rects) (allow-none): the rectangles that changed
+ *         since the previous frame, in @widget window coordinates.
+ * @n_rects: number of rectangles in @rects.
+ *
+ * Like gtk_widget_end_gl() with buffer swapping, but only presents the
+ * damaged rectangles where the window system allows it. Combine this with
+ * gdk_gl_drawable_get_buffer_age() to repaint only what has changed.
+ **/
+void
+gtk_widget_end_gl_with_damage (GtkWidget          *widget,
+                               const GdkRectangle *rects,
+                               gint                n_rects)
+{
+  GdkGLDrawable *gldrawable;
+
+  g_return_if_fail (GTK_IS_WIDGET (widget));
+
+  gldrawable = GDK_GL_DRAWABLE (gtk_widget_get_gl_window (widget));
+
+  if (gdk_gl_drawable_is_double_buffered (gldrawable))
+    gdk_gl_drawable_swap_buffers_with_damage (gldrawable, rects, n_rects);
+  else
+    glFlush ();
+
+  gdk_gl_context_release_current();
+}
+
+/**
+ * gtk_widget_get_gl_presentation_time:
+ * @widget: a #GtkWidget.
+ * @presentation_time: (out) (allow-none): return location for the time
+ *                     at which the latest frame reached the screen, or NULL.
+ * @refresh_interval: (out) (allow-none): return location for the measured
+ *                    refresh interval of the display, or 0 if it is not
+ *                    known yet, or NULL.
+ *
+ * Returns the presentation feedback of the OpenGL-capable @widget, as
+ * reported by the #GdkGLWindow::frame-presented signal. Both values are
+ * in microseconds; on Linux the time uses the same time base as
+ * gdk_frame_clock_get_frame_time(), so the two can be compared directly
+ * to schedule the next frame, e.g. for audio/video synchronization.
+ *
+ * Return value: TRUE if a frame has been presented since the @widget was
+ *               realized, FALSE otherwise.
+ **/
+gboolean
+gtk_widget_get_gl_presentation_time (GtkWidget *widget,
+                                     gint64    *presentation_time,
+                                     gint64    *refresh_interval)
+{
+  GLWidgetPrivate *private;
+
+  g_return_val_if_fail (GTK_IS_WIDGET (widget), FALSE);
+
+  private = g_object_get_qdata (G_OBJECT (widget), quark_gl_private);
+  if (private == NULL)
+    return FALSE;
+
+  if (!private->has_presentation)
+    return FALSE;
+
+  if (presentation_time != NULL)
+    *presentation_time = private->presentation_time;
+  if (refresh_interval != NULL)
+    *refresh_interval = private->refresh_interval;
+
+  return TRUE;
+}
+
+/**
+ * gtk_widget_set_gl_render_thread:
+ * @widget: an OpenGL-capable #GtkWidget which is not realized yet.
+ * @func: the function that renders a frame.
+ * @user_data: data to pass to @func.
+ * @destroy: (allow-none): function to free @user_data, or NULL.
+ *
+ * Moves OpenGL rendering of @widget off the GTK main thread. Once the
+ * @widget is realized, a #GdkGLContext is created for a dedicated render
+ * thread, which calls @func with it current whenever a new snapshot
+ * is posted with gtk_widget_post_gl_snapshot(), the @widget is resized,
+ * or it needs to be redrawn. Buffers are swapped by the render thread
+ * after @func returns. The thread is joined when the @widget is
+ * unrealized. Presentation feedback of these swaps, the "frame-presented"
+ * signal and the present function of the #GdkGLWindow, is still
+ * delivered in the default main context.
+ *
+ * @func must not call GTK+ or GDK functions other than those of
+ * GdkGLExt, and the application must not draw to the @widget from its
+ * "draw" handler. On X11, XInitThreads() must be called before
+ * gtk_init().
+ *
+ * Return value: TRUE if it is successful, FALSE otherwise.
+ **/
+gboolean
+gtk_widget_set_gl_render_thread (GtkWidget       *widget,
+                                 GtkGLRenderFunc  func,
+                                 gpointer         user_data,
+                                 GDestroyNotify   destroy)
+{
+  GLWidgetPrivate *private;
+  GLRenderThread *render_thread;
+
+  GTK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (GTK_IS_WIDGET (widget), FALSE);
+  g_return_val_if_fail (!gtk_widget_get_realized (widget), FALSE);
+  g_return_val_if_fail (func != NULL, FALSE);
+
+  private = g_object_get_qdata (G_OBJECT (widget), quark_gl_private);
+  if (private == NULL)
+    return FALSE;
+
+  if (private->render_thread != NULL)
+    {
+      render_thread = private->render_thread;
+      if (render_thread->destroy != NULL)
+        render_thread->destroy (render_thread->user_data);
+    }
+  else
+    {
+      render_thread = g_new0 (GLRenderThread, 1);
+      g_mutex_init (&render_thread->lock);
+      g_cond_init (&render_thread->cond);
+
+      private->render_thread = render_thread;
+    }
+
+  render_thread->func = func;
+  render_thread->user_data = user_data;
+  render_thread->destroy = destroy;
+
+  return TRUE;
+}
+
+/**
+ * gtk_widget_post_gl_snapshot:
+ * @widget: a #GtkWidget rendering in a render thread.
+ * @snapshot: the application state to render the next frame from.
+ * @destroy: (allow-none): function to free @snapshot, or NULL.
+ *
+ * Hands @snapshot over to the render thread of @widget and wakes it up.
+ * The render thread owns @snapshot from now on and keeps it to redraw the
+ * @widget until a newer one is posted. A snapshot which is superseded
+ * before the render thread got to it is freed right away, so only the
+ * latest state is ever rendered. This never blocks on the render thread.
+ **/
+void
+gtk_widget_post_gl_snapshot (GtkWidget      *widget,
+                             gpointer        snapshot,
+                             GDestroyNotify  destroy)
+{
+  GLWidgetPrivate *private;
+  GLRenderThread *render_thread;
+  GLRenderSnapshot *new_snapshot;
+  GLRenderSnapshot *old_snapshot;
+
+  g_return_if_fail (GTK_IS_WIDGET (widget));
+
+  private = g_object_get_qdata (G_OBJECT (widget), quark_gl_private);
+  if (private == NULL || private->render_thread == NULL)
+    {
+      if (destroy != NULL)
+        destroy (snapshot);
+      return;
+    }
+
+  render_thread = private->render_thread;
+
+  new_snapshot = g_slice_new (GLRenderSnapshot);
+  new_snapshot->data = snapshot;
+  new_snapshot->destroy = destroy;
+
+  do
+    old_snapshot = g_atomic_pointer_get (&render_thread->pending);
+  while (!g_atomic_pointer_compare_and_exchange (&render_thread->pending,
+                                                 old_snapshot, new_snapshot));
+
+  if (old_snapshot != NULL)
+    gl_render_snapshot_free (old_snapshot);
+
+  if (render_thread->thread != NULL)
+    gl_render_thread_wakeup (render_thread);
+}
+
+/**
+ * gtk_widget_set_gl_prewarm:
+ * @widget: an OpenGL-capable #GtkWidget which is not realized yet.
+ * @func: (allow-none): function to run with the new context current,
+ *        or NULL.
+ * @user_data: data to pass to @func.
+ * @destroy: (allow-none): function to free @user_data, or NULL.
+ *
+ * Creates the @widget's #GdkGLContext as soon as the @widget is realized,
+ * from an idle handler that runs before the first redraw, instead of
+ * lazily from the first "draw". If @func is given, it is called right
+ * after with the context current, which is the place to compile shaders
+ * and upload textures. This happens again on every realization, as the
+ * context does not outlive the window.
+ *
+ * Creating a context can take a noticeable time with drivers that set up
+ * shader caches, so this moves that work out of the first frame and
+ * overlaps it with the mapping of the window.
+ *
+ * Return value: TRUE if it is successful, FALSE otherwise.
+ **/
+gboolean
+gtk_widget_set_gl_prewarm (GtkWidget        *widget,
+                           GtkGLPrewarmFunc  func,
+                           gpointer          user_data,
+                           GDestroyNotify    destroy)
+{
+  GLWidgetPrivate *private;
+
+  GTK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (GTK_IS_WIDGET (widget), FALSE);
+  g_return_val_if_fail (!gtk_widget_get_realized (widget), FALSE);
+
+  private = g_object_get_qdata (G_OBJECT (widget), quark_gl_private);
+  if (private == NULL)
+    return FALSE;
+
+  if (private->prewarm_destroy != NULL)
+    private->prewarm_destroy (private->prewarm_data);
+
+  private->prewarm_func = func;
+  private->prewarm_data = user_data;
+  private->prewarm_destroy = destroy;
+  private->prewarm = TRUE;
+
+  return TRUE;
+}
+
+/**
+ * gtk_widget_set_gl_resize_func:
+ * @widget: an OpenGL-capable #GtkWidget.
+ * @func: (allow-none): function to call when the viewport was resized,
+ *        or NULL.
+ * @user_data: data to pass to @func.
+ * @destroy: (allow-none): function to free @user_data, or NULL.
+ *
+ * Sets the function that is called with the new width and height after
+ * a coalesced resize, see gtk_widget_set_gl_capability(). The @widget's
+ * #GdkGLContext is current and glViewport() already set when @func runs.
+ * A #GtkGLDrawingArea uses this itself; connect to its "resize" signal
+ * instead.
+ *
+ * Return value: TRUE if it is successful, FALSE otherwise.
+ **/
+gboolean
+gtk_widget_set_gl_resize_func (GtkWidget       *widget,
+                               GtkGLResizeFunc  func,
+                               gpointer         user_data,
+                               GDestroyNotify   destroy)
+{
+  GLWidgetPrivate *private;
+
+  GTK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (GTK_IS_WIDGET (widget), FALSE);
+
+  private = g_object_get_qdata (G_OBJECT (widget), quark_gl_private);
+  if (private == NULL)
+    return FALSE;
+
+  if (private->resize_destroy != NULL)
+    private->resize_destroy (private->resize_data);
+
+  private->resize_func = func;
+  private->resize_data = user_data;
+  private->resize_destroy = destroy;
+
+  return TRUE;
+}
+
+/*
+ * GL binding.
+ */
+
+G_DEFINE_BOXED_TYPE (GtkGLBinding, gtk_gl_binding,
+                     gtk_gl_binding_ref, gtk_gl_binding_unref)
+
+/**
+ * gtk_widget_get_gl_binding:
+ * @widget: an OpenGL-capable #GtkWidget.
+ *
+ * Returns a handle on the @widget's #GdkGLContext and #GdkGLWindow for
+ * gtk_gl_binding_begin() and gtk_gl_binding_end(), the per-frame
+ * counterparts of gtk_widget_begin_gl() and gtk_widget_end_gl(). The
+ * context and window are looked up at the first begin after each
+ * realization; later calls use them directly, without widget data
+ * lookups or type checks (those are only done in debug builds).
+ *
+ * The handle stays valid across unrealize and realize. Once the @widget
+ * is destroyed, gtk_gl_binding_begin() returns FALSE.
+ *
+ * Return value: (transfer none): the #GtkGLBinding of the @widget, or
+ *               NULL if the @widget is not OpenGL-capable.
+ **/
+GtkGLBinding *
+gtk_widget_get_gl_binding (GtkWidget *widget)
+{
+  GLWidgetPrivate *private;
+
+  GTK_GL_NOTE_FUNC ();
+
+  g_return_val_if_fail (GTK_IS_WIDGET (widget), NULL);
+
+  private = g_object_get_qdata (G_OBJECT (widget), quark_gl_private);
+  if (private == NULL)
+    return NULL;
+
+  if (private->binding == NULL)
+    {
+      private->binding = g_slice_new0 (GtkGLBinding);
+      private->binding->ref_count = 1;
+      private->binding->widget = widget;
+      private->binding->private = private;
+    }
+
+  return private->binding;
+}
+
+/**
+ * gtk_gl_binding_ref:
+ * @binding: a #GtkGLBinding.
+ *
+ * Adds a reference to @binding.
+ *
+ * Return value: @binding.
+ **/
+GtkGLBinding *
+gtk_gl_binding_ref (GtkGLBinding *binding)
+{
+  g_return_val_if_fail (binding != NULL, NULL);
+
+  g_atomic_int_inc (&binding->ref_count);
+
+  return binding;
+}
+
+/**
+ * gtk_gl_binding_unref:
+ * @binding: a #GtkGLBinding.
+ *
+ * Removes a reference from @binding.
+ **/
+void
+gtk_gl_binding_unref (GtkGLBinding *binding)
+{
+  g_return_if_fail (binding != NULL);
+
+  if (g_atomic_int_dec_and_test (&binding->ref_count))
+    g_slice_free (GtkGLBinding, binding);
+}
+
+/*
+ * Slow path of gtk_gl_binding_begin (): looks the context and window up
+ * again after a realization, and brings the viewport up to date.
+ */
+static gboolean
+gtk_gl_binding_resolve (GtkGLBinding *binding)
+{
+  GLWidgetPrivate *private = binding->private;
+  GtkWidget *widget = binding->widget;
+
+  GTK_GL_NOTE_FUNC_PRIVATE ();
+
+  if (private == NULL || !private->is_realized ||
+      !gtk_widget_get_realized (widget))
+    return FALSE;
+
+  if (private->resize_pending && private->render_thread == NULL)
+    gtk_gl_widget_apply_resize (widget, private);
+
+  if (binding->glcontext == NULL)
+    {
+      binding->glcontext = gtk_widget_get_gl_context (widget);
+      binding->glwindow = gtk_widget_get_gl_window (widget);
+
+      if (binding->glcontext == NULL || binding->glwindow == NULL)
+        {
+          binding->glcontext = NULL;
+          binding->glwindow = NULL;
+          return FALSE;
+        }
+
+      binding->double_buffered =
+        gdk_gl_drawable_is_double_buffered (GDK_GL_DRAWABLE (binding->glwindow));
+    }
+
+  return TRUE;
+}
+
+/**
+ * gtk_gl_binding_begin:
+ * @binding: a #GtkGLBinding.
+ *
+ * Makes the widget's #GdkGLContext current, like gtk_widget_begin_gl().
+ *
+ * Return value: TRUE if it is successful, FALSE otherwise.
+ **/
+gboolean
+gtk_gl_binding_begin (GtkGLBinding *binding)
+{
+#ifdef G_ENABLE_DEBUG
+  g_return_val_if_fail (binding != NULL, FALSE);
+#endif
+
+  if (G_UNLIKELY (binding->glcontext == NULL ||
+                  binding->private->resize_pending))
+    {
+      if (!gtk_gl_binding_resolve (binding))
+        return FALSE;
+    }
+
+  return gdk_gl_context_make_current_unchecked (binding->glcontext,
+                                                binding->glwindow);
+}
+
+/**
+ * gtk_gl_binding_end:
+ * @binding: a #GtkGLBinding.
+ * @do_swap: whether to swap the buffers (or flush a single-buffered
+ *           window) before releasing the context.
+ *
+ * Ends the drawing started with gtk_gl_binding_begin(), like
+ * gtk_widget_end_gl().
+ **/
+void
+gtk_gl_binding_end (GtkGLBinding *binding,
+                    gboolean      do_swap)
+{
+#ifdef G_ENABLE_DEBUG
+  g_return_if_fail (binding != NULL);
+#endif
+
+  if (G_UNLIKELY (binding->glcontext == NULL))
+    return;
+
+  if (do_swap)
+    {
+      if (binding->double_buffered)
+        gdk_gl_window_swap_buffers_unchecked (binding->glwindow);
+      else
+        glFlush ();
+    }
+
+  gdk_gl_context_release_current_unchecked (binding->glcontext);
+}
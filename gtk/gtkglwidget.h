@@ -29,6 +29,25 @@
 
 G_BEGIN_DECLS
 
+#define GTK_TYPE_GL_BINDING (gtk_gl_binding_get_type ())
+
+typedef struct _GtkGLBinding GtkGLBinding;
+
+typedef void (*GtkGLRenderFunc) (GdkGLDrawable *gldrawable,
+                                 gint           width,
+                                 gint           height,
+                                 gpointer       snapshot,
+                                 gpointer       user_data);
+
+typedef void (*GtkGLPrewarmFunc) (GtkWidget    *widget,
+                                  GdkGLContext *glcontext,
+                                  gpointer      user_data);
+
+typedef void (*GtkGLResizeFunc) (GtkWidget *widget,
+                                 gint       width,
+                                 gint       height,
+                                 gpointer   user_data);
+
 gboolean      gtk_widget_set_gl_capability (GtkWidget    *widget,
                                             GdkGLConfig  *glconfig,
                                             GdkGLContext *share_list,
@@ -56,6 +75,46 @@ gboolean      gtk_widget_begin_gl(GtkWidget *widget);
 
 void          gtk_widget_end_gl(GtkWidget *widget, gboolean do_swap);
 
+void          gtk_widget_end_gl_with_damage (GtkWidget          *widget,
+                                             const GdkRectangle *rects,
+                                             gint                n_rects);
+
+gboolean      gtk_widget_get_gl_presentation_time (GtkWidget *widget,
+                                                   gint64    *presentation_time,
+                                                   gint64    *refresh_interval);
+
+gboolean      gtk_widget_set_gl_render_thread (GtkWidget       *widget,
+                                               GtkGLRenderFunc  func,
+                                               gpointer         user_data,
+                                               GDestroyNotify   destroy);
+
+void          gtk_widget_post_gl_snapshot  (GtkWidget      *widget,
+                                            gpointer        snapshot,
+                                            GDestroyNotify  destroy);
+
+gboolean      gtk_widget_set_gl_prewarm    (GtkWidget        *widget,
+                                            GtkGLPrewarmFunc  func,
+                                            gpointer          user_data,
+                                            GDestroyNotify    destroy);
+
+gboolean      gtk_widget_set_gl_resize_func (GtkWidget       *widget,
+                                             GtkGLResizeFunc  func,
+                                             gpointer         user_data,
+                                             GDestroyNotify   destroy);
+
+GType         gtk_gl_binding_get_type      (void);
+
+GtkGLBinding *gtk_widget_get_gl_binding    (GtkWidget    *widget);
+
+GtkGLBinding *gtk_gl_binding_ref           (GtkGLBinding *binding);
+
+void          gtk_gl_binding_unref         (GtkGLBinding *binding);
+
+gboolean      gtk_gl_binding_begin         (GtkGLBinding *binding);
+
+void          gtk_gl_binding_end           (GtkGLBinding *binding,
+                                            gboolean      do_swap);
+
 G_END_DECLS
 
 #endif /* __GTK_GL_WIDGET_H__ */